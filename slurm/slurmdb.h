@@ -567,6 +567,14 @@ struct slurmdb_assoc_usage {
 	long double level_fs;	/* (FAIR_TREE) Result of fairshare equation
 				 * compared to the association's siblings
 				 * (DON'T PACK for state file) */
+	bool fs_dirty;		/* (FAIR_TREE) usage of this association or
+				 * of one of its children changed since the
+				 * last fairshare calculation
+				 * (DON'T PACK) */
+	void *fs_data;		/* (FAIR_TREE) children sorted by level_fs
+				 * and ranking of the last fairshare
+				 * calculation, a single xmalloc'ed block
+				 * (DON'T PACK) */
 
 	bitstr_t *valid_qos;    /* qos available for this association
 				 * derived from the qos_list.
@@ -1038,6 +1038,173 @@ slurm_load_jobs (time_t update_time, job_info_msg_t **job_info_msg_pptr,
 	return SLURM_PROTOCOL_SUCCESS;
 }
 
+typedef struct {
+	uint32_t job_id;
+	uint32_t inx;
+} _job_inx_t;
+
+static int _job_inx_cmp(const void *x, const void *y)
+{
+	const _job_inx_t *inx1 = x, *inx2 = y;
+
+	if (inx1->job_id < inx2->job_id)
+		return -1;
+	if (inx1->job_id > inx2->job_id)
+		return 1;
+	return 0;
+}
+
+static int _job_id_cmp(const void *x, const void *y)
+{
+	uint32_t id1 = *(const uint32_t *) x, id2 = *(const uint32_t *) y;
+
+	if (id1 < id2)
+		return -1;
+	if (id1 > id2)
+		return 1;
+	return 0;
+}
+
+/* Merge the changed job records from a delta response into old_msg.
+ * Changed records replace the old ones in place, new records are appended
+ * and removed records are dropped. The delta's job records are moved into
+ * old_msg. */
+static void _merge_job_info_delta(job_info_msg_t *old_msg,
+				  job_info_delta_msg_t *delta_msg)
+{
+	job_info_msg_t *new_msg = delta_msg->job_info;
+	slurm_job_info_t *job_array;
+	_job_inx_t *new_inx = NULL, key, *inx_ptr;
+	bool *new_used = NULL;
+	uint32_t i, job_cnt = 0;
+
+	if (new_msg->record_count) {
+		new_inx = xmalloc(sizeof(_job_inx_t) * new_msg->record_count);
+		new_used = xmalloc(sizeof(bool) * new_msg->record_count);
+		for (i = 0; i < new_msg->record_count; i++) {
+			new_inx[i].job_id = new_msg->job_array[i].job_id;
+			new_inx[i].inx = i;
+		}
+		qsort(new_inx, new_msg->record_count, sizeof(_job_inx_t),
+		      _job_inx_cmp);
+	}
+	if (delta_msg->removed_cnt) {
+		qsort(delta_msg->removed_job_id, delta_msg->removed_cnt,
+		      sizeof(uint32_t), _job_id_cmp);
+	}
+
+	job_array = xmalloc(sizeof(slurm_job_info_t) *
+			    (old_msg->record_count + new_msg->record_count + 1));
+	for (i = 0; i < old_msg->record_count; i++) {
+		key.job_id = old_msg->job_array[i].job_id;
+		inx_ptr = NULL;
+		if (new_inx) {
+			inx_ptr = bsearch(&key, new_inx, new_msg->record_count,
+					  sizeof(_job_inx_t), _job_inx_cmp);
+		}
+		if (inx_ptr) {
+			/* Changed record */
+			slurm_free_job_info_members(&old_msg->job_array[i]);
+			job_array[job_cnt++] = new_msg->job_array[inx_ptr->inx];
+			new_used[inx_ptr->inx] = true;
+		} else if (delta_msg->removed_cnt &&
+			   bsearch(&key.job_id, delta_msg->removed_job_id,
+				   delta_msg->removed_cnt, sizeof(uint32_t),
+				   _job_id_cmp)) {
+			slurm_free_job_info_members(&old_msg->job_array[i]);
+		} else {
+			job_array[job_cnt++] = old_msg->job_array[i];
+		}
+	}
+	for (i = 0; i < new_msg->record_count; i++) {
+		if (!new_used[i])
+			job_array[job_cnt++] = new_msg->job_array[i];
+	}
+	xfree(new_inx);
+	xfree(new_used);
+
+	xfree(old_msg->job_array);
+	old_msg->job_array = job_array;
+	old_msg->record_count = job_cnt;
+	old_msg->last_update = new_msg->last_update;
+
+	/* Records now belong to old_msg */
+	xfree(new_msg->job_array);
+	new_msg->record_count = 0;
+}
+
+/*
+ * slurm_load_jobs_delta - issue RPC to get the job records which changed
+ *	since the previous call and merge them into the existing records
+ * IN/OUT job_info_msg_pptr - job records from the previous call to update,
+ *	or NULL to load all job records
+ * IN/OUT delta_seq - generation of the job records, set by the previous
+ *	call, or 0 to load all job records
+ * IN show_flags - job filtering options, should be the same on each call
+ * RET 0 or -1 on error
+ * NOTE: free the response using slurm_free_job_info_msg
+ */
+extern int slurm_load_jobs_delta(job_info_msg_t **job_info_msg_pptr,
+				 uint32_t *delta_seq, uint16_t show_flags)
+{
+	int rc;
+	slurm_msg_t resp_msg;
+	slurm_msg_t req_msg;
+	job_info_delta_request_msg_t req;
+	job_info_delta_msg_t *delta_msg;
+	job_info_msg_t *old_msg = *job_info_msg_pptr;
+	uint32_t i;
+
+	slurm_msg_t_init(&req_msg);
+	slurm_msg_t_init(&resp_msg);
+
+	memset(&req, 0, sizeof(job_info_delta_request_msg_t));
+	req.show_flags   = show_flags;
+	if (old_msg && *delta_seq) {
+		/* The controller only reports these jobs as removed */
+		req.delta_seq   = *delta_seq;
+		req.last_update = old_msg->last_update;
+		req.job_id_cnt  = old_msg->record_count;
+		req.job_id = xmalloc(sizeof(uint32_t) *
+				     (old_msg->record_count + 1));
+		for (i = 0; i < old_msg->record_count; i++)
+			req.job_id[i] = old_msg->job_array[i].job_id;
+	}
+	req_msg.msg_type = REQUEST_JOB_INFO_DELTA;
+	req_msg.data     = &req;
+
+	rc = slurm_send_recv_controller_msg(&req_msg, &resp_msg);
+	xfree(req.job_id);
+	if (rc < 0)
+		return SLURM_ERROR;
+
+	switch (resp_msg.msg_type) {
+	case RESPONSE_JOB_INFO_DELTA:
+		delta_msg = (job_info_delta_msg_t *) resp_msg.data;
+		if (!old_msg || (delta_msg->flags & JOB_INFO_DELTA_COMPLETE)) {
+			slurm_free_job_info_msg(old_msg);
+			*job_info_msg_pptr = delta_msg->job_info;
+			delta_msg->job_info = NULL;
+		} else {
+			_merge_job_info_delta(old_msg, delta_msg);
+		}
+		*delta_seq = delta_msg->delta_seq;
+		slurm_free_job_info_delta_msg(delta_msg);
+		break;
+	case RESPONSE_SLURM_RC:
+		rc = ((return_code_msg_t *) resp_msg.data)->return_code;
+		slurm_free_return_code_msg(resp_msg.data);
+		if (rc)
+			slurm_seterrno_ret(rc);
+		break;
+	default:
+		slurm_seterrno_ret(SLURM_UNEXPECTED_MSG_ERROR);
+		break;
+	}
+
+	return SLURM_PROTOCOL_SUCCESS;
+}
+
 /*
  * slurm_load_job_user - issue RPC to get slurm information about all jobs
  *	to be run as the specified user
@@ -77,6 +77,8 @@
 
 #define MAX_THREADS      8	/* These can be huge messages, so
 				 * only run MAX_THREADS at one time */
+#define MAX_BLOCKS_IN_FLIGHT 4	/* blocks being read, compressed and
+				 * broadcast at one time */
 
 int block_len;				/* block size */
 int fd;					/* source file descriptor */
@@ -84,6 +86,19 @@ void *src;				/* source mmap'd address */
 struct stat f_stat;			/* source file stats */
 job_sbcast_cred_msg_t *sbcast_cred;	/* job alloc info and sbcast cred */
 
+/* state shared by the threads broadcasting blocks of the file */
+typedef struct bcast_pipe {
+	struct bcast_parameters *params;
+	file_bcast_msg_t *bcast_msg;	/* fields common to all blocks */
+	int buf_len;			/* size of a block buffer */
+	uint16_t block_cnt;		/* number of the last block */
+	pthread_mutex_t mutex;		/* protects fields below */
+	uint16_t next_block;		/* next block to broadcast */
+	int rc;				/* first error from any block */
+	uint64_t size_compressed;	/* bytes sent */
+	uint64_t time_compression;	/* usec spent compressing */
+} bcast_pipe_t;
+
 static int   _bcast_file(struct bcast_parameters *params);
 static int   _file_bcast(struct bcast_parameters *params,
 			 file_bcast_msg_t *bcast_msg,
@@ -204,44 +219,24 @@ static int _file_bcast(struct bcast_parameters *params,
 	return rc;
 }
 
-/* load a buffer with data from the file to broadcast,
- * return number of bytes read, zero on end of file */
-static int _get_block_none(char **buffer, int *orig_len, bool *more)
+/* copy size bytes of the file from position into buffer,
+ * return the number of bytes in buffer */
+static int _get_block_none(char *buffer, void *position, int size)
 {
-	static int remaining = -1;
-	static void *position;
-	int size;
-
-	if (remaining < 0) {
-		*buffer = xmalloc(block_len);
-		remaining = f_stat.st_size;
-		position = src;
-	}
-
-	size = MIN(block_len, remaining);
-	memcpy(*buffer, position, size);
-	remaining -= size;
-	position += size;
-
-	*orig_len = size;
-	*more = (remaining) ? true : false;
+	memcpy(buffer, position, size);
 	return size;
 }
 
-static int _get_block_zlib(struct bcast_parameters *params,
-			   char **buffer,
-			   int *orig_len,
-			   bool *more)
+/* compress size bytes of the file from position into buffer,
+ * return the number of bytes in buffer or -1 on error */
+static int _get_block_zlib(char *buffer, int max_out, void *position,
+			   int size)
 {
 #if HAVE_LIBZ
-	static z_stream strm;
+	z_stream strm;
 	int chunk = (256 * 1024);
 	int flush = Z_NO_FLUSH;
-
-	static int remaining = -1;
-	static int max_out;
-	static void *position;
-	int chunk_remaining, out_remaining, chunk_bite, size = 0;
+	int chunk_remaining = size, chunk_bite;
 
 	/* allocate deflate state, compress each block independently */
 	strm.zalloc = Z_NULL;
@@ -249,140 +244,228 @@ static int _get_block_zlib(struct bcast_parameters *params,
 	strm.opaque = Z_NULL;
 	strm.avail_in = 0;
 	strm.next_in = Z_NULL;
-	if (deflateInit(&strm, Z_DEFAULT_COMPRESSION) != Z_OK) {
-		error("File compression configuration error,"
-		      "sending uncompressed file.");
-		params->compress = 0;
-		return _get_block_none(buffer, orig_len, more);
-	}
-
-	/* first pass through, initialize */
-	if (remaining < 0) {
-		remaining = f_stat.st_size;
-		max_out = deflateBound(&strm, block_len);
-		*buffer = xmalloc(max_out);
-		position = src;
-	}
+	if (deflateInit(&strm, Z_DEFAULT_COMPRESSION) != Z_OK)
+		return -1;
 
-	chunk_remaining = MIN(block_len, remaining);
-	out_remaining = max_out;
-	strm.next_out = (void *) *buffer;
-	while (chunk_remaining) {
+	strm.next_out = (void *) buffer;
+	strm.avail_out = max_out;
+	do {
 		strm.next_in = position;
 		chunk_bite = MIN(chunk, chunk_remaining);
 		strm.avail_in = chunk_bite;
-		strm.avail_out = out_remaining;
 
 		if (chunk_remaining <= chunk)
 			flush = Z_FINISH;
 
-		if (deflate(&strm, flush) == Z_STREAM_ERROR)
-			fatal("Error compressing file");
+		if (deflate(&strm, flush) == Z_STREAM_ERROR) {
+			(void) deflateEnd(&strm);
+			return -1;
+		}
 
 		position += chunk_bite;
-		size += chunk_bite;
 		chunk_remaining -= chunk_bite;
-		out_remaining = strm.avail_out;
-	}
-	remaining -= size;
+	} while (chunk_remaining);
 
 	(void) deflateEnd(&strm);
 
-	*orig_len = size;
-	*more = (remaining) ? true : false;
-	return (max_out - out_remaining);
+	return (max_out - strm.avail_out);
 #else
-	info("zlib compression not supported, sending uncompressed file.");
-	params->compress = 0;
-	return _get_block_none(buffer, orig_len, more);
+	return -1;
 #endif
 }
 
-static int _get_block_lz4(struct bcast_parameters *params,
-			  char **buffer,
-			  int32_t *orig_len,
-			  bool *more)
+/* compress size bytes of the file from position into buffer,
+ * return the number of bytes in buffer or -1 on error */
+static int _get_block_lz4(char *buffer, int max_out, void *position,
+			  int size)
 {
 #if HAVE_LZ4
 	int size_out;
-	static int remaining = -1;
-	static void *position;
-	int size;
 
-	if (!f_stat.st_size) {
-		*more = false;
+	if (!size)
 		return 0;
-	}
-
-	if (remaining < 0) {
-		position = src;
-		remaining = f_stat.st_size;
-		*buffer = xmalloc(block_len);
-	}
-
-	/* intentionally limit decompressed size to 10x compressed
-	 * to avoid problems on receive size when decompressed */
-	size = MIN(block_len * 10, remaining);
-	if (!(size_out = LZ4_compress_destSize(position, *buffer,
-					       &size, block_len))) {
-		/* compression failure */
-		fatal("LZ4 compression error");
-	}
-	position += size;
-	remaining -= size;
-
-	*orig_len = size;
-	*more = (remaining) ? true : false;
+	if (!(size_out = LZ4_compress_default(position, buffer, size,
+					      max_out)))
+		return -1;
 	return size_out;
 #else
-	info("lz4 compression not supported, sending uncompressed file.");
-	params->compress = 0;
-	return _get_block_none(buffer, orig_len, more);
+	return -1;
 #endif
+}
+
+/* size of the buffer needed to hold one block compressed as requested */
+static int _block_buf_len(struct bcast_parameters *params)
+{
+	int len = MAX(block_len, 1);
 
+	switch (params->compress) {
+#if HAVE_LIBZ
+	case COMPRESS_ZLIB:
+		return MAX(len, compressBound(len));
+#endif
+#if HAVE_LZ4
+	case COMPRESS_LZ4:
+		return MAX(len, LZ4_compressBound(len));
+#endif
+	}
+	return len;
 }
 
-static int _next_block(struct bcast_parameters *params,
-		       char **buffer,
-		       int32_t *orig_len,
-		       bool *more)
+/* validate the compression type once, before blocks get compressed by
+ * several threads at the same time */
+static void _check_compress(struct bcast_parameters *params)
 {
-	switch(params->compress) {
+	switch (params->compress) {
 	case COMPRESS_OFF:
-		return _get_block_none(buffer, orig_len, more);
+		return;
 	case COMPRESS_ZLIB:
-		return _get_block_zlib(params, buffer, orig_len, more);
+#if !HAVE_LIBZ
+		info("zlib compression not supported, sending uncompressed file.");
+		params->compress = 0;
+#endif
+		return;
 	case COMPRESS_LZ4:
-		return _get_block_lz4(params, buffer, orig_len, more);
+#if !HAVE_LZ4
+		info("lz4 compression not supported, sending uncompressed file.");
+		params->compress = 0;
+#endif
+		return;
 	}
 
 	/* compression type not recognized */
 	error("File compression type %u not supported,"
 	      " sending uncompressed file.", params->compress);
 	params->compress = 0;
-	return _get_block_none(buffer, orig_len, more);
 }
 
-/* read and broadcast the file */
+/*
+ * Load buffer with block number block_no of the file, compressed when
+ * requested. Each block holds block_len bytes of the file (less for the
+ * last one), so blocks can be prepared in any order. A block which fails
+ * to compress, or does not get any smaller, is sent uncompressed.
+ */
+static void _next_block(bcast_pipe_t *pipe, file_bcast_msg_t *bcast_msg,
+			uint16_t block_no, char *buffer)
+{
+	struct bcast_parameters *params = pipe->params;
+	uint64_t offset = (uint64_t) (block_no - 1) * block_len;
+	int size = MIN(block_len, f_stat.st_size - offset);
+	void *position = src + offset;
+	int len = -1;
+	DEF_TIMERS;
+
+	START_TIMER;
+	switch (params->compress) {
+	case COMPRESS_ZLIB:
+		len = _get_block_zlib(buffer, pipe->buf_len, position, size);
+		break;
+	case COMPRESS_LZ4:
+		len = _get_block_lz4(buffer, pipe->buf_len, position, size);
+		break;
+	}
+	if ((len < 0) || (len >= size)) {
+		bcast_msg->compress = COMPRESS_OFF;
+		len = _get_block_none(buffer, position, size);
+	} else
+		bcast_msg->compress = params->compress;
+	END_TIMER;
+
+	bcast_msg->block_no	= block_no;
+	bcast_msg->last_block	= (block_no == pipe->block_cnt) ? 1 : 0;
+	bcast_msg->block_offset	= offset;
+	bcast_msg->uncomp_len	= size;
+	bcast_msg->block_len	= len;
+	bcast_msg->block	= buffer;
+	debug("block %u, size %u", block_no, bcast_msg->block_len);
+
+	slurm_mutex_lock(&pipe->mutex);
+	pipe->size_compressed += len;
+	pipe->time_compression += DELTA_TIMER;
+	slurm_mutex_unlock(&pipe->mutex);
+}
+
+/* prepare and broadcast one block of the file */
+static int _send_block(bcast_pipe_t *pipe, uint16_t block_no, char *buffer)
+{
+	file_bcast_msg_t bcast_msg;
+	int rc;
+
+	memcpy(&bcast_msg, pipe->bcast_msg, sizeof(file_bcast_msg_t));
+	_next_block(pipe, &bcast_msg, block_no, buffer);
+	rc = _file_bcast(pipe->params, &bcast_msg, sbcast_cred);
+
+	if (rc != SLURM_SUCCESS) {
+		slurm_mutex_lock(&pipe->mutex);
+		pipe->rc = MAX(pipe->rc, rc);
+		slurm_mutex_unlock(&pipe->mutex);
+	}
+	return rc;
+}
+
+/* prepare and broadcast blocks until those before the last one are all
+ * taken by some thread */
+static void *_bcast_thread(void *arg)
+{
+	bcast_pipe_t *pipe = (bcast_pipe_t *) arg;
+	char *buffer = xmalloc(pipe->buf_len);
+	uint16_t block_no;
+
+	while (1) {
+		slurm_mutex_lock(&pipe->mutex);
+		if (pipe->rc || (pipe->next_block >= pipe->block_cnt)) {
+			slurm_mutex_unlock(&pipe->mutex);
+			break;
+		}
+		block_no = pipe->next_block++;
+		slurm_mutex_unlock(&pipe->mutex);
+
+		if (_send_block(pipe, block_no, buffer) != SLURM_SUCCESS)
+			break;
+	}
+	xfree(buffer);
+
+	return NULL;
+}
+
+/*
+ * Read and broadcast the file.
+ *
+ * The first block registers the file on the compute nodes and the last one
+ * completes it, so each is sent alone. Up to MAX_BLOCKS_IN_FLIGHT threads,
+ * no more than there are CPUs, read, compress and broadcast the blocks in
+ * between at the same time; the slurmd write each of them at its offset
+ * in the file.
+ */
 static int _bcast_file(struct bcast_parameters *params)
 {
-	int rc = SLURM_SUCCESS;
+	int i, rc = SLURM_SUCCESS;
 	file_bcast_msg_t bcast_msg;
-	char *buffer = NULL;
-	int32_t orig_len = 0;
-	uint32_t size_uncompressed = 0, size_compressed = 0;
-	uint32_t time_compression = 0;
-	bool more = true;
-	DEF_TIMERS;
+	bcast_pipe_t pipe;
+	pthread_t thread_id[MAX_BLOCKS_IN_FLIGHT];
+	pthread_attr_t attr;
+	int thread_cnt = 0, thread_max;
+	char *buffer;
+	uint64_t block_cnt;
 
 	if (params->block_size)
 		block_len = MIN(params->block_size, f_stat.st_size);
 	else
 		block_len = MIN((512 * 1024), f_stat.st_size);
+	if (block_len)
+		block_cnt = (f_stat.st_size + block_len - 1) / block_len;
+	else
+		block_cnt = 1;
+	if (block_cnt > 0xffff) {
+		error("File `%s` needs %"PRIu64" blocks of %d bytes, "
+		      "more than the 65535 allowed. Increase the block size.",
+		      params->src_fname, block_cnt, block_len);
+		return SLURM_ERROR;
+	}
+
+	_check_compress(params);
 
 	bzero(&bcast_msg, sizeof(file_bcast_msg_t));
 	bcast_msg.fname		= params->dst_fname;
-	bcast_msg.block_no	= 1;
 	bcast_msg.force		= params->force;
 	bcast_msg.modes		= f_stat.st_mode;
 	bcast_msg.uid		= f_stat.st_uid;
@@ -400,50 +483,62 @@ static int _bcast_file(struct bcast_parameters *params)
 		params->fanout = MAX_THREADS;
 	slurm_set_tree_width(MIN(MAX_THREADS, params->fanout));
 
-	while (more) {
-		START_TIMER;
-		bcast_msg.block_len = _next_block(params, &buffer, &orig_len,
-						  &more);
-		END_TIMER;
-		time_compression += DELTA_TIMER;
-		size_uncompressed += orig_len;
-		size_compressed += bcast_msg.block_len;
-		debug("block %d, size %u", bcast_msg.block_no,
-		      bcast_msg.block_len);
-		bcast_msg.compress = params->compress;
-		bcast_msg.uncomp_len = orig_len;
-		bcast_msg.block = buffer;
-		if (!more)
-			bcast_msg.last_block = 1;
-
-		rc = _file_bcast(params, &bcast_msg, sbcast_cred);
-		if (rc != SLURM_SUCCESS)
-			break;
-		if (bcast_msg.last_block)
-			break;	/* end of file */
-		bcast_msg.block_no++;
-		bcast_msg.block_offset += orig_len;
+	bzero(&pipe, sizeof(bcast_pipe_t));
+	slurm_mutex_init(&pipe.mutex);
+	pipe.params	= params;
+	pipe.bcast_msg	= &bcast_msg;
+	pipe.block_cnt	= block_cnt;
+	pipe.next_block	= 2;
+	pipe.buf_len	= _block_buf_len(params);
+	buffer = xmalloc(pipe.buf_len);
+
+	rc = _send_block(&pipe, 1, buffer);
+
+	if ((rc == SLURM_SUCCESS) && (block_cnt > 2)) {
+		thread_max = MIN(MAX_BLOCKS_IN_FLIGHT,
+				 sysconf(_SC_NPROCESSORS_ONLN));
+		thread_max = MIN(thread_max, (int) block_cnt - 2);
+		slurm_attr_init(&attr);
+		for (i = 0; (thread_max > 1) && (i < thread_max); i++) {
+			if (pthread_create(&thread_id[thread_cnt], &attr,
+					   _bcast_thread, &pipe)) {
+				error("pthread_create error %m");
+				break;
+			}
+			thread_cnt++;
+		}
+		slurm_attr_destroy(&attr);
+		if (thread_cnt == 0)	/* single CPU or no threads */
+			_bcast_thread(&pipe);
+		for (i = 0; i < thread_cnt; i++)
+			pthread_join(thread_id[i], NULL);
+		rc = pipe.rc;
 	}
+
+	if ((rc == SLURM_SUCCESS) && (block_cnt > 1))
+		rc = _send_block(&pipe, block_cnt, buffer);
+
 	xfree(bcast_msg.user_name);
 	xfree(buffer);
+	slurm_mutex_destroy(&pipe.mutex);
 
-	if (size_uncompressed && params->compress != 0) {
-		int64_t pct = (int64_t) size_uncompressed - size_compressed;
+	if (f_stat.st_size && params->compress != 0) {
+		int64_t pct = (int64_t) f_stat.st_size - pipe.size_compressed;
 		/* Dividing a negative by a positive in C99 results in
 		 * "truncation towards zero" which gives unexpected values for
 		 * pct. This construct avoids that problem.
 		 */
-		pct = (pct>=0) ? pct * 100 / size_uncompressed
-			       : - (-pct * 100 / size_uncompressed);
-		verbose("File compressed from %u to %u (%d percent) in %u usec",
-			size_uncompressed, size_compressed, (int) pct,
-			time_compression);
+		pct = (pct>=0) ? pct * 100 / f_stat.st_size
+			       : - (-pct * 100 / f_stat.st_size);
+		verbose("File compressed from %"PRIu64" to %"PRIu64
+			" (%d percent) in %"PRIu64" usec",
+			(uint64_t) f_stat.st_size, pipe.size_compressed,
+			(int) pct, pipe.time_compression);
 	}
 
 	return rc;
 }
 
-
 static int _decompress_data_zlib(file_bcast_msg_t *req)
 {
 #if HAVE_LIBZ
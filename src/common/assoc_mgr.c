@@ -56,6 +56,7 @@ slurmdb_assoc_rec_t *assoc_mgr_root_assoc = NULL;
 uint32_t g_qos_max_priority = 0;
 uint32_t g_qos_count = 0;
 uint32_t g_user_assoc_count = 0;
+uint32_t g_assoc_tree_update = 0;
 uint32_t g_tres_count = 0;
 
 List assoc_mgr_tres_list = NULL;
@@ -924,6 +925,7 @@ static int _post_assoc_list(void)
 
 	//START_TIMER;
 	g_user_assoc_count = 0;
+	g_assoc_tree_update++;
 	while ((assoc = list_next(itr))) {
 		_set_assoc_parent_and_user(assoc, reset);
 		_add_assoc_hash(assoc);
@@ -3523,6 +3525,7 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update, bool locked)
 			assoc_mgr_unlock(&locks);
 		return SLURM_SUCCESS;
 	}
+	g_assoc_tree_update++;
 
 	while ((object = list_pop(update->objects))) {
 		bool update_jobs = false;
@@ -5019,6 +5022,7 @@ extern void assoc_mgr_remove_assoc_usage(slurmdb_assoc_rec_t *assoc)
 		child_str = assoc->acct;
 	}
 	info("Resetting usage for %s %s", child, child_str);
+	g_assoc_tree_update++;
 
 	old_usage_raw = assoc->usage->usage_raw;
 	/* clang needs this memset to avoid a warning */
@@ -5441,6 +5445,7 @@ extern int load_assoc_usage(char *state_save_location)
 
 		xfree(tmp_str);
 	}
+	g_assoc_tree_update++;
 	assoc_mgr_unlock(&locks);
 
 	free_buf(buffer);
@@ -122,6 +122,10 @@ extern slurmdb_assoc_rec_t *assoc_mgr_root_assoc;
 extern uint32_t g_qos_max_priority; /* max priority in all qos's */
 extern uint32_t g_qos_count; /* count used for generating qos bitstr's */
 extern uint32_t g_user_assoc_count; /* Number of associations which are users */
+extern uint32_t g_assoc_tree_update; /* Incremented whenever associations are
+				      * added, removed, modified or have
+				      * their usage reset, but not when job
+				      * usage accrues (see usage->fs_dirty) */
 extern uint32_t g_tres_count; /* Number of TRES from the database
 			       * which also is the number of elements
 			       * in the assoc_mgr_tres_array */
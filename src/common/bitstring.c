@@ -44,6 +44,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
 #include "src/common/bitstring.h"
 #include "src/common/log.h"
@@ -52,6 +53,16 @@
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
+/*
+ * The AVX2/AVX-512 kernels need compiler support found by configure, without
+ * it only the portable word at a time code below is built.
+ */
+#if defined(HAVE_X86_VECTOR_KERNELS) && \
+    !defined(USE_64BIT_BITSTR) && !defined(SLURM_BIGENDIAN)
+#  define BIT_X86_KERNELS 1
+#  include <immintrin.h>
+#endif
+
 /* word of the bitstring bit is in */
 #define	_bit_word(bit) 		(((bit) >> BITSTR_SHIFT) + BITSTR_OVERHEAD)
 
@@ -77,6 +88,12 @@
 	((((nbits) + BITSTR_MAXPOS) >> BITSTR_SHIFT) + BITSTR_OVERHEAD)
 
 /* check signature */
+/* data words of bitstring, full words and all words (including any
+ * partially used last word) */
+#define _bitstr_data(name)	(&(name)[BITSTR_OVERHEAD])
+#define _bitstr_full_words(nbits) ((nbits) >> BITSTR_SHIFT)
+#define _bitstr_data_words(nbits) (_bitstr_words(nbits) - BITSTR_OVERHEAD)
+
 #define _assert_bitstr_valid(name) do { \
 	assert((name) != NULL); \
 	assert(_bitstr_magic(name) == BITSTR_MAGIC \
@@ -152,6 +169,666 @@ strong_alias(bit_nffs,		slurm_bit_nffs);
 strong_alias(bit_copybits,	slurm_bit_copybits);
 strong_alias(bit_get_bit_num,	slurm_bit_get_bit_num);
 strong_alias(bit_get_pos_num,	slurm_bit_get_pos_num);
+strong_alias(bit_and_not,	slurm_bit_and_not);
+strong_alias(bit_and_set_count, slurm_bit_and_set_count);
+strong_alias(bit_overlap_any,	slurm_bit_overlap_any);
+strong_alias(bit_kernels_name,	slurm_bit_kernels_name);
+strong_alias(bit_kernels_select, slurm_bit_kernels_select);
+
+#if !defined(USE_64BIT_BITSTR)
+/*
+ * Returns the hamming weight (i.e. the number of bits set) in a word.
+ * NOTE: This routine borrowed from Linux 2.4.9 <linux/bitops.h>.
+ */
+static uint32_t
+hweight(uint32_t w)
+{
+	uint32_t res;
+
+	res = (w   & 0x55555555) + ((w >> 1)    & 0x55555555);
+	res = (res & 0x33333333) + ((res >> 2)  & 0x33333333);
+	res = (res & 0x0F0F0F0F) + ((res >> 4)  & 0x0F0F0F0F);
+	res = (res & 0x00FF00FF) + ((res >> 8)  & 0x00FF00FF);
+	res = (res & 0x0000FFFF) + ((res >> 16) & 0x0000FFFF);
+
+	return res;
+}
+#else
+/*
+ * A 64 bit version crafted from 32-bit one borrowed above.
+ */
+static uint64_t
+hweight(uint64_t w)
+{
+	uint64_t res;
+
+	res = (w   & 0x5555555555555555) + ((w >> 1)    & 0x5555555555555555);
+	res = (res & 0x3333333333333333) + ((res >> 2)  & 0x3333333333333333);
+	res = (res & 0x0F0F0F0F0F0F0F0F) + ((res >> 4)  & 0x0F0F0F0F0F0F0F0F);
+	res = (res & 0x00FF00FF00FF00FF) + ((res >> 8)  & 0x00FF00FF00FF00FF);
+	res = (res & 0x0000FFFF0000FFFF) + ((res >> 16) & 0x0000FFFF0000FFFF);
+	res = (res & 0x00000000FFFFFFFF) + ((res >> 32) & 0x00000000FFFFFFFF);
+
+	return res;
+}
+#endif /* !USE_64BIT_BITSTR */
+
+/*
+ * Whole bitmap kernels. Each operates on the "n" data words following the
+ * bitstring header and is chosen once, at first use, for the instruction
+ * set of the running processor.
+ */
+typedef struct bit_kernels {
+	const char *name;
+	void	(*op_and)(bitstr_t *d, const bitstr_t *s, int32_t n);
+	void	(*op_and_not)(bitstr_t *d, const bitstr_t *s, int32_t n);
+	void	(*op_or)(bitstr_t *d, const bitstr_t *s, int32_t n);
+	void	(*op_not)(bitstr_t *d, int32_t n);
+	int32_t	(*count)(const bitstr_t *a, int32_t n);
+	int32_t	(*and_count)(const bitstr_t *a, const bitstr_t *b, int32_t n);
+	int32_t	(*and_store_count)(bitstr_t *d, const bitstr_t *s, int32_t n);
+	int	(*any_and)(const bitstr_t *a, const bitstr_t *b, int32_t n);
+	int	(*any_and_not)(const bitstr_t *a, const bitstr_t *b, int32_t n);
+	int32_t	(*first_set)(const bitstr_t *a, int32_t n);
+} bit_kernels_t;
+
+static void _and_generic(bitstr_t *d, const bitstr_t *s, int32_t n)
+{
+	int32_t i;
+
+	for (i = 0; i < n; i++)
+		d[i] &= s[i];
+}
+
+static void _and_not_generic(bitstr_t *d, const bitstr_t *s, int32_t n)
+{
+	int32_t i;
+
+	for (i = 0; i < n; i++)
+		d[i] &= ~s[i];
+}
+
+static void _or_generic(bitstr_t *d, const bitstr_t *s, int32_t n)
+{
+	int32_t i;
+
+	for (i = 0; i < n; i++)
+		d[i] |= s[i];
+}
+
+static void _not_generic(bitstr_t *d, int32_t n)
+{
+	int32_t i;
+
+	for (i = 0; i < n; i++)
+		d[i] = ~d[i];
+}
+
+static int32_t _count_generic(const bitstr_t *a, int32_t n)
+{
+	int32_t i, count = 0;
+
+	for (i = 0; i < n; i++)
+		count += hweight(a[i]);
+	return count;
+}
+
+static int32_t _and_count_generic(const bitstr_t *a, const bitstr_t *b,
+				  int32_t n)
+{
+	int32_t i, count = 0;
+
+	for (i = 0; i < n; i++)
+		count += hweight(a[i] & b[i]);
+	return count;
+}
+
+static int32_t _and_store_count_generic(bitstr_t *d, const bitstr_t *s,
+					int32_t n)
+{
+	int32_t i, count = 0;
+
+	for (i = 0; i < n; i++) {
+		d[i] &= s[i];
+		count += hweight(d[i]);
+	}
+	return count;
+}
+
+static int _any_and_generic(const bitstr_t *a, const bitstr_t *b, int32_t n)
+{
+	int32_t i;
+
+	for (i = 0; i < n; i++) {
+		if (a[i] & b[i])
+			return 1;
+	}
+	return 0;
+}
+
+static int _any_and_not_generic(const bitstr_t *a, const bitstr_t *b,
+				int32_t n)
+{
+	int32_t i;
+
+	for (i = 0; i < n; i++) {
+		if (a[i] & ~b[i])
+			return 1;
+	}
+	return 0;
+}
+
+/* Return the index of the first non-zero word or -1 if none */
+static int32_t _first_set_generic(const bitstr_t *a, int32_t n)
+{
+	int32_t i;
+
+	for (i = 0; i < n; i++) {
+		if (a[i])
+			return i;
+	}
+	return -1;
+}
+
+static const bit_kernels_t bit_kernels_generic = {
+	"generic",
+	_and_generic, _and_not_generic, _or_generic, _not_generic,
+	_count_generic, _and_count_generic, _and_store_count_generic,
+	_any_and_generic, _any_and_not_generic, _first_set_generic
+};
+
+#if defined(BIT_X86_KERNELS)
+/* Load or store 64 bits of a bitstring, which is only 32 bit aligned */
+static inline uint64_t _load64(const bitstr_t *a)
+{
+	uint64_t w;
+
+	memcpy(&w, a, sizeof(w));
+	return w;
+}
+
+__attribute__((target("popcnt")))
+static int32_t _count_popcnt(const bitstr_t *a, int32_t n)
+{
+	int32_t i, count = 0;
+
+	for (i = 0; (i + 2) <= n; i += 2)
+		count += __builtin_popcountll(_load64(a + i));
+	if (i < n)
+		count += __builtin_popcount((uint32_t) a[i]);
+	return count;
+}
+
+__attribute__((target("popcnt")))
+static int32_t _and_count_popcnt(const bitstr_t *a, const bitstr_t *b,
+				 int32_t n)
+{
+	int32_t i, count = 0;
+
+	for (i = 0; (i + 2) <= n; i += 2)
+		count += __builtin_popcountll(_load64(a + i) & _load64(b + i));
+	if (i < n)
+		count += __builtin_popcount((uint32_t) (a[i] & b[i]));
+	return count;
+}
+
+__attribute__((target("popcnt")))
+static int32_t _and_store_count_popcnt(bitstr_t *d, const bitstr_t *s,
+				       int32_t n)
+{
+	int32_t i, count = 0;
+
+	for (i = 0; i < n; i++) {
+		d[i] &= s[i];
+		count += __builtin_popcount((uint32_t) d[i]);
+	}
+	return count;
+}
+
+static const bit_kernels_t bit_kernels_popcnt = {
+	"popcnt",
+	_and_generic, _and_not_generic, _or_generic, _not_generic,
+	_count_popcnt, _and_count_popcnt, _and_store_count_popcnt,
+	_any_and_generic, _any_and_not_generic, _first_set_generic
+};
+
+/*
+ * AVX2 kernels handle 8 words per instruction. AVX2 has no population
+ * count instruction, so bits are counted 4 at a time with a table lookup
+ * (vpshufb) and the byte counts summed with vpsadbw.
+ */
+#define AVX2_WORDS	8
+
+__attribute__((target("avx2")))
+static inline __m256i _popcnt_avx2(__m256i v)
+{
+	const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3,
+					       1, 2, 2, 3, 2, 3, 3, 4,
+					       0, 1, 1, 2, 1, 2, 2, 3,
+					       1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i low_mask = _mm256_set1_epi8(0x0f);
+	__m256i lo, hi, cnt;
+
+	lo = _mm256_and_si256(v, low_mask);
+	hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+	cnt = _mm256_add_epi8(_mm256_shuffle_epi8(table, lo),
+			      _mm256_shuffle_epi8(table, hi));
+	return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2")))
+static inline int32_t _sum_avx2(__m256i v)
+{
+	return (int32_t) (_mm256_extract_epi64(v, 0) +
+			  _mm256_extract_epi64(v, 1) +
+			  _mm256_extract_epi64(v, 2) +
+			  _mm256_extract_epi64(v, 3));
+}
+
+__attribute__((target("avx2")))
+static void _and_avx2(bitstr_t *d, const bitstr_t *s, int32_t n)
+{
+	int32_t i;
+	__m256i v;
+
+	for (i = 0; (i + AVX2_WORDS) <= n; i += AVX2_WORDS) {
+		v = _mm256_and_si256(_mm256_loadu_si256((__m256i *) (d + i)),
+				     _mm256_loadu_si256((__m256i *) (s + i)));
+		_mm256_storeu_si256((__m256i *) (d + i), v);
+	}
+	_and_generic(d + i, s + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void _and_not_avx2(bitstr_t *d, const bitstr_t *s, int32_t n)
+{
+	int32_t i;
+	__m256i v;
+
+	for (i = 0; (i + AVX2_WORDS) <= n; i += AVX2_WORDS) {
+		v = _mm256_andnot_si256(_mm256_loadu_si256((__m256i *) (s + i)),
+					_mm256_loadu_si256((__m256i *) (d + i)));
+		_mm256_storeu_si256((__m256i *) (d + i), v);
+	}
+	_and_not_generic(d + i, s + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void _or_avx2(bitstr_t *d, const bitstr_t *s, int32_t n)
+{
+	int32_t i;
+	__m256i v;
+
+	for (i = 0; (i + AVX2_WORDS) <= n; i += AVX2_WORDS) {
+		v = _mm256_or_si256(_mm256_loadu_si256((__m256i *) (d + i)),
+				    _mm256_loadu_si256((__m256i *) (s + i)));
+		_mm256_storeu_si256((__m256i *) (d + i), v);
+	}
+	_or_generic(d + i, s + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void _not_avx2(bitstr_t *d, int32_t n)
+{
+	const __m256i ones = _mm256_set1_epi32(-1);
+	int32_t i;
+	__m256i v;
+
+	for (i = 0; (i + AVX2_WORDS) <= n; i += AVX2_WORDS) {
+		v = _mm256_xor_si256(_mm256_loadu_si256((__m256i *) (d + i)),
+				     ones);
+		_mm256_storeu_si256((__m256i *) (d + i), v);
+	}
+	_not_generic(d + i, n - i);
+}
+
+__attribute__((target("avx2,popcnt")))
+static int32_t _count_avx2(const bitstr_t *a, int32_t n)
+{
+	__m256i sum = _mm256_setzero_si256();
+	int32_t i;
+
+	for (i = 0; (i + AVX2_WORDS) <= n; i += AVX2_WORDS) {
+		sum = _mm256_add_epi64(sum, _popcnt_avx2(
+				_mm256_loadu_si256((__m256i *) (a + i))));
+	}
+	return _sum_avx2(sum) + _count_popcnt(a + i, n - i);
+}
+
+__attribute__((target("avx2,popcnt")))
+static int32_t _and_count_avx2(const bitstr_t *a, const bitstr_t *b,
+			       int32_t n)
+{
+	__m256i sum = _mm256_setzero_si256(), v;
+	int32_t i;
+
+	for (i = 0; (i + AVX2_WORDS) <= n; i += AVX2_WORDS) {
+		v = _mm256_and_si256(_mm256_loadu_si256((__m256i *) (a + i)),
+				     _mm256_loadu_si256((__m256i *) (b + i)));
+		sum = _mm256_add_epi64(sum, _popcnt_avx2(v));
+	}
+	return _sum_avx2(sum) + _and_count_popcnt(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2,popcnt")))
+static int32_t _and_store_count_avx2(bitstr_t *d, const bitstr_t *s,
+				     int32_t n)
+{
+	__m256i sum = _mm256_setzero_si256(), v;
+	int32_t i;
+
+	for (i = 0; (i + AVX2_WORDS) <= n; i += AVX2_WORDS) {
+		v = _mm256_and_si256(_mm256_loadu_si256((__m256i *) (d + i)),
+				     _mm256_loadu_si256((__m256i *) (s + i)));
+		_mm256_storeu_si256((__m256i *) (d + i), v);
+		sum = _mm256_add_epi64(sum, _popcnt_avx2(v));
+	}
+	return _sum_avx2(sum) + _and_store_count_popcnt(d + i, s + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static int _any_and_avx2(const bitstr_t *a, const bitstr_t *b, int32_t n)
+{
+	int32_t i;
+
+	for (i = 0; (i + AVX2_WORDS) <= n; i += AVX2_WORDS) {
+		if (!_mm256_testz_si256(
+				_mm256_loadu_si256((__m256i *) (a + i)),
+				_mm256_loadu_si256((__m256i *) (b + i))))
+			return 1;
+	}
+	return _any_and_generic(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static int _any_and_not_avx2(const bitstr_t *a, const bitstr_t *b, int32_t n)
+{
+	int32_t i;
+
+	/* vptest sets CF if (~b & a) is zero */
+	for (i = 0; (i + AVX2_WORDS) <= n; i += AVX2_WORDS) {
+		if (!_mm256_testc_si256(
+				_mm256_loadu_si256((__m256i *) (b + i)),
+				_mm256_loadu_si256((__m256i *) (a + i))))
+			return 1;
+	}
+	return _any_and_not_generic(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static int32_t _first_set_avx2(const bitstr_t *a, int32_t n)
+{
+	int32_t i, j;
+	__m256i v;
+
+	for (i = 0; (i + AVX2_WORDS) <= n; i += AVX2_WORDS) {
+		v = _mm256_loadu_si256((__m256i *) (a + i));
+		if (!_mm256_testz_si256(v, v))
+			return i + _first_set_generic(a + i, AVX2_WORDS);
+	}
+	j = _first_set_generic(a + i, n - i);
+	return (j < 0) ? -1 : (i + j);
+}
+
+static const bit_kernels_t bit_kernels_avx2 = {
+	"avx2",
+	_and_avx2, _and_not_avx2, _or_avx2, _not_avx2,
+	_count_avx2, _and_count_avx2, _and_store_count_avx2,
+	_any_and_avx2, _any_and_not_avx2, _first_set_avx2
+};
+
+/*
+ * AVX-512 kernels handle 16 words per instruction, counting bits with the
+ * same table lookup as AVX2 (AVX512BW) as the population count instruction
+ * (AVX512_VPOPCNTDQ) is missing from most processors which have AVX-512.
+ */
+#define AVX512_WORDS	16
+
+__attribute__((target("avx512f,avx512bw")))
+static inline __m512i _popcnt_avx512(__m512i v)
+{
+	const __m512i table = _mm512_broadcast_i32x4(
+		_mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3,
+			      1, 2, 2, 3, 2, 3, 3, 4));
+	const __m512i low_mask = _mm512_set1_epi8(0x0f);
+	__m512i lo, hi, cnt;
+
+	lo = _mm512_and_si512(v, low_mask);
+	hi = _mm512_and_si512(_mm512_srli_epi16(v, 4), low_mask);
+	cnt = _mm512_add_epi8(_mm512_shuffle_epi8(table, lo),
+			      _mm512_shuffle_epi8(table, hi));
+	return _mm512_sad_epu8(cnt, _mm512_setzero_si512());
+}
+
+__attribute__((target("avx512f")))
+static void _and_avx512(bitstr_t *d, const bitstr_t *s, int32_t n)
+{
+	int32_t i;
+	__m512i v;
+
+	for (i = 0; (i + AVX512_WORDS) <= n; i += AVX512_WORDS) {
+		v = _mm512_and_si512(_mm512_loadu_si512(d + i),
+				     _mm512_loadu_si512(s + i));
+		_mm512_storeu_si512(d + i, v);
+	}
+	_and_generic(d + i, s + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static void _and_not_avx512(bitstr_t *d, const bitstr_t *s, int32_t n)
+{
+	int32_t i;
+	__m512i v;
+
+	for (i = 0; (i + AVX512_WORDS) <= n; i += AVX512_WORDS) {
+		v = _mm512_andnot_si512(_mm512_loadu_si512(s + i),
+					_mm512_loadu_si512(d + i));
+		_mm512_storeu_si512(d + i, v);
+	}
+	_and_not_generic(d + i, s + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static void _or_avx512(bitstr_t *d, const bitstr_t *s, int32_t n)
+{
+	int32_t i;
+	__m512i v;
+
+	for (i = 0; (i + AVX512_WORDS) <= n; i += AVX512_WORDS) {
+		v = _mm512_or_si512(_mm512_loadu_si512(d + i),
+				    _mm512_loadu_si512(s + i));
+		_mm512_storeu_si512(d + i, v);
+	}
+	_or_generic(d + i, s + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static void _not_avx512(bitstr_t *d, int32_t n)
+{
+	const __m512i ones = _mm512_set1_epi32(-1);
+	int32_t i;
+	__m512i v;
+
+	for (i = 0; (i + AVX512_WORDS) <= n; i += AVX512_WORDS) {
+		v = _mm512_xor_si512(_mm512_loadu_si512(d + i), ones);
+		_mm512_storeu_si512(d + i, v);
+	}
+	_not_generic(d + i, n - i);
+}
+
+__attribute__((target("avx512f,avx512bw,popcnt")))
+static int32_t _count_avx512(const bitstr_t *a, int32_t n)
+{
+	__m512i sum = _mm512_setzero_si512();
+	int32_t i;
+
+	for (i = 0; (i + AVX512_WORDS) <= n; i += AVX512_WORDS) {
+		sum = _mm512_add_epi64(sum,
+				       _popcnt_avx512(_mm512_loadu_si512(a + i)));
+	}
+	return (int32_t) _mm512_reduce_add_epi64(sum) +
+	       _count_popcnt(a + i, n - i);
+}
+
+__attribute__((target("avx512f,avx512bw,popcnt")))
+static int32_t _and_count_avx512(const bitstr_t *a, const bitstr_t *b,
+				 int32_t n)
+{
+	__m512i sum = _mm512_setzero_si512(), v;
+	int32_t i;
+
+	for (i = 0; (i + AVX512_WORDS) <= n; i += AVX512_WORDS) {
+		v = _mm512_and_si512(_mm512_loadu_si512(a + i),
+				     _mm512_loadu_si512(b + i));
+		sum = _mm512_add_epi64(sum, _popcnt_avx512(v));
+	}
+	return (int32_t) _mm512_reduce_add_epi64(sum) +
+	       _and_count_popcnt(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx512f,avx512bw,popcnt")))
+static int32_t _and_store_count_avx512(bitstr_t *d, const bitstr_t *s,
+				       int32_t n)
+{
+	__m512i sum = _mm512_setzero_si512(), v;
+	int32_t i;
+
+	for (i = 0; (i + AVX512_WORDS) <= n; i += AVX512_WORDS) {
+		v = _mm512_and_si512(_mm512_loadu_si512(d + i),
+				     _mm512_loadu_si512(s + i));
+		_mm512_storeu_si512(d + i, v);
+		sum = _mm512_add_epi64(sum, _popcnt_avx512(v));
+	}
+	return (int32_t) _mm512_reduce_add_epi64(sum) +
+	       _and_store_count_popcnt(d + i, s + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static int _any_and_avx512(const bitstr_t *a, const bitstr_t *b, int32_t n)
+{
+	int32_t i;
+
+	for (i = 0; (i + AVX512_WORDS) <= n; i += AVX512_WORDS) {
+		if (_mm512_test_epi32_mask(_mm512_loadu_si512(a + i),
+					   _mm512_loadu_si512(b + i)))
+			return 1;
+	}
+	return _any_and_generic(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static int _any_and_not_avx512(const bitstr_t *a, const bitstr_t *b,
+			       int32_t n)
+{
+	int32_t i;
+	__m512i v;
+
+	for (i = 0; (i + AVX512_WORDS) <= n; i += AVX512_WORDS) {
+		v = _mm512_andnot_si512(_mm512_loadu_si512(b + i),
+					_mm512_loadu_si512(a + i));
+		if (_mm512_test_epi32_mask(v, v))
+			return 1;
+	}
+	return _any_and_not_generic(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static int32_t _first_set_avx512(const bitstr_t *a, int32_t n)
+{
+	int32_t i, j;
+	__m512i v;
+	__mmask16 m;
+
+	for (i = 0; (i + AVX512_WORDS) <= n; i += AVX512_WORDS) {
+		v = _mm512_loadu_si512(a + i);
+		if ((m = _mm512_test_epi32_mask(v, v)))
+			return i + __builtin_ctz(m);
+	}
+	j = _first_set_generic(a + i, n - i);
+	return (j < 0) ? -1 : (i + j);
+}
+
+static const bit_kernels_t bit_kernels_avx512 = {
+	"avx512",
+	_and_avx512, _and_not_avx512, _or_avx512, _not_avx512,
+	_count_avx512, _and_count_avx512, _and_store_count_avx512,
+	_any_and_avx512, _any_and_not_avx512, _first_set_avx512
+};
+#endif	/* BIT_X86_KERNELS */
+
+static const bit_kernels_t *bit_kernels_all[] = {
+#if defined(BIT_X86_KERNELS)
+	&bit_kernels_avx512,
+	&bit_kernels_avx2,
+	&bit_kernels_popcnt,
+#endif
+	&bit_kernels_generic,
+	NULL
+};
+
+static const bit_kernels_t *bit_kernels = NULL;
+
+/* Return true if the processor can run the kernels */
+static bool _bit_kernels_usable(const bit_kernels_t *kernels)
+{
+#if defined(BIT_X86_KERNELS)
+	__builtin_cpu_init();
+	if (kernels == &bit_kernels_avx512)
+		return (__builtin_cpu_supports("avx512f") &&
+			__builtin_cpu_supports("avx512bw") &&
+			__builtin_cpu_supports("popcnt"));
+	if (kernels == &bit_kernels_avx2)
+		return (__builtin_cpu_supports("avx2") &&
+			__builtin_cpu_supports("popcnt"));
+	if (kernels == &bit_kernels_popcnt)
+		return __builtin_cpu_supports("popcnt");
+#endif
+	return true;
+}
+
+/* Return the kernels to use, picking the best the processor can run on the
+ * first call. Concurrent first calls pick the same kernels. */
+static inline const bit_kernels_t *_bit_kernels(void)
+{
+	int i;
+
+	if (bit_kernels)
+		return bit_kernels;
+	for (i = 0; bit_kernels_all[i]; i++) {
+		if (_bit_kernels_usable(bit_kernels_all[i]))
+			break;
+	}
+	bit_kernels = bit_kernels_all[i];
+	return bit_kernels;
+}
+
+/*
+ * Return the name of the instruction set used for whole bitmap operations,
+ * one of "avx512", "avx2", "popcnt" or "generic".
+ */
+extern const char *bit_kernels_name(void)
+{
+	return _bit_kernels()->name;
+}
+
+/*
+ * Use the named instruction set for whole bitmap operations, intended for
+ * tests and benchmarks. NULL picks the best one available.
+ * RETURN 0 on success, -1 if not supported by this processor or build
+ */
+extern int bit_kernels_select(const char *name)
+{
+	int i;
+
+	for (i = 0; bit_kernels_all[i]; i++) {
+		if ((!name || !strcmp(name, bit_kernels_all[i]->name)) &&
+		    _bit_kernels_usable(bit_kernels_all[i])) {
+			bit_kernels = bit_kernels_all[i];
+			return 0;
+		}
+	}
+	return -1;
+}
 
 /*
  * Allocate a bitstring.
@@ -469,26 +1146,29 @@ bit_nffs(bitstr_t *b, int32_t n)
 bitoff_t
 bit_ffs(bitstr_t *b)
 {
-	bitoff_t bit = 0, value = -1;
+	bitoff_t bit, bit_cnt;
+	int32_t word;
 
 	_assert_bitstr_valid(b);
 
-	while (bit < _bitstr_bits(b) && value == -1) {
-		int32_t word = _bit_word(bit);
-
-		if (b[word] == 0) {
-			bit += sizeof(bitstr_t)*8;
-			continue;
-		}
-		while (bit < _bitstr_bits(b) && _bit_word(bit) == word) {
-			if (bit_test(b, bit)) {
-				value = bit;
-				break;
-			}
-			bit++;
-		}
+	bit_cnt = _bitstr_bits(b);
+	word = _bit_kernels()->first_set(_bitstr_data(b),
+					 _bitstr_data_words(bit_cnt));
+	if (word < 0)
+		return -1;
+	/* The last word may have bits set beyond the end (e.g. bit_not) */
+	bit = (bitoff_t) word << BITSTR_SHIFT;
+#if !defined(SLURM_BIGENDIAN) && !defined(USE_64BIT_BITSTR)
+	bit += ffs(_bitstr_data(b)[word]) - 1;
+	return (bit < bit_cnt) ? bit : -1;
+#else
+	for ( ; (bit < bit_cnt) && (_bit_word(bit) - BITSTR_OVERHEAD == word);
+	     bit++) {
+		if (bit_test(b, bit))
+			return bit;
 	}
-	return value;
+	return -1;
+#endif
 }
 
 /*
@@ -561,15 +1241,20 @@ bit_fill_gaps(bitstr_t *b)
 int
 bit_super_set(bitstr_t *b1, bitstr_t *b2)
 {
-	bitoff_t bit;
+	bitoff_t bit, bit_cnt;
+	int32_t words;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8) {
-		if (b1[_bit_word(bit)] != (b1[_bit_word(bit)] &
-		                           b2[_bit_word(bit)]))
+	bit_cnt = _bitstr_bits(b1);
+	words = _bitstr_full_words(bit_cnt);
+	if (_bit_kernels()->any_and_not(_bitstr_data(b1), _bitstr_data(b2),
+					words))
+		return 0;
+	for (bit = (bitoff_t) words << BITSTR_SHIFT; bit < bit_cnt; bit++) {
+		if (bit_test(b1, bit) && !bit_test(b2, bit))
 			return 0;
 	}
 
@@ -608,14 +1293,29 @@ bit_equal(bitstr_t *b1, bitstr_t *b2)
 void
 bit_and(bitstr_t *b1, bitstr_t *b2)
 {
-	bitoff_t bit;
+	_assert_bitstr_valid(b1);
+	_assert_bitstr_valid(b2);
+	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
+
+	_bit_kernels()->op_and(_bitstr_data(b1), _bitstr_data(b2),
+			       _bitstr_data_words(_bitstr_bits(b1)));
+}
 
+/*
+ * b1 &= ~b2, the same as bit_not(b2); bit_and(b1, b2); bit_not(b2);
+ * without modifying b2
+ *   b1 (IN/OUT)	first string
+ *   b2 (IN)		second bitstring
+ */
+void
+bit_and_not(bitstr_t *b1, bitstr_t *b2)
+{
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8)
-		b1[_bit_word(bit)] &= b2[_bit_word(bit)];
+	_bit_kernels()->op_and_not(_bitstr_data(b1), _bitstr_data(b2),
+				   _bitstr_data_words(_bitstr_bits(b1)));
 }
 
 /*
@@ -625,12 +1325,10 @@ bit_and(bitstr_t *b1, bitstr_t *b2)
 void
 bit_not(bitstr_t *b)
 {
-	bitoff_t bit;
-
 	_assert_bitstr_valid(b);
 
-	for (bit = 0; bit < _bitstr_bits(b); bit += sizeof(bitstr_t)*8)
-		b[_bit_word(bit)] = ~b[_bit_word(bit)];
+	_bit_kernels()->op_not(_bitstr_data(b),
+			       _bitstr_data_words(_bitstr_bits(b)));
 }
 
 /*
@@ -641,14 +1339,12 @@ bit_not(bitstr_t *b)
 void
 bit_or(bitstr_t *b1, bitstr_t *b2)
 {
-	bitoff_t bit;
-
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8)
-		b1[_bit_word(bit)] |= b2[_bit_word(bit)];
+	_bit_kernels()->op_or(_bitstr_data(b1), _bitstr_data(b2),
+			      _bitstr_data_words(_bitstr_bits(b1)));
 }
 
 
@@ -687,44 +1383,6 @@ bit_copybits(bitstr_t *dest, bitstr_t *src)
 	memcpy(&dest[BITSTR_OVERHEAD], &src[BITSTR_OVERHEAD], len);
 }
 
-#if !defined(USE_64BIT_BITSTR)
-/*
- * Returns the hamming weight (i.e. the number of bits set) in a word.
- * NOTE: This routine borrowed from Linux 2.4.9 <linux/bitops.h>.
- */
-static uint32_t
-hweight(uint32_t w)
-{
-	uint32_t res;
-
-	res = (w   & 0x55555555) + ((w >> 1)    & 0x55555555);
-	res = (res & 0x33333333) + ((res >> 2)  & 0x33333333);
-	res = (res & 0x0F0F0F0F) + ((res >> 4)  & 0x0F0F0F0F);
-	res = (res & 0x00FF00FF) + ((res >> 8)  & 0x00FF00FF);
-	res = (res & 0x0000FFFF) + ((res >> 16) & 0x0000FFFF);
-
-	return res;
-}
-#else
-/*
- * A 64 bit version crafted from 32-bit one borrowed above.
- */
-static uint64_t
-hweight(uint64_t w)
-{
-	uint64_t res;
-
-	res = (w   & 0x5555555555555555) + ((w >> 1)    & 0x5555555555555555);
-	res = (res & 0x3333333333333333) + ((res >> 2)  & 0x3333333333333333);
-	res = (res & 0x0F0F0F0F0F0F0F0F) + ((res >> 4)  & 0x0F0F0F0F0F0F0F0F);
-	res = (res & 0x00FF00FF00FF00FF) + ((res >> 8)  & 0x00FF00FF00FF00FF);
-	res = (res & 0x0000FFFF0000FFFF) + ((res >> 16) & 0x0000FFFF0000FFFF);
-	res = (res & 0x00000000FFFFFFFF) + ((res >> 32) & 0x00000000FFFFFFFF);
-
-	return res;
-}
-#endif /* !USE_64BIT_BITSTR */
-
 /*
  * Count the number of bits set in bitstring.
  *   b (IN)		bitstring to check
@@ -733,17 +1391,15 @@ hweight(uint64_t w)
 int32_t
 bit_set_count(bitstr_t *b)
 {
-	int32_t count = 0;
+	int32_t count, words;
 	bitoff_t bit, bit_cnt;
-	int32_t word_size = sizeof(bitstr_t) * 8;
 
 	_assert_bitstr_valid(b);
 
 	bit_cnt = _bitstr_bits(b);
-	for (bit = 0; (bit + word_size) <= bit_cnt; bit += word_size) {
-		count += hweight(b[_bit_word(bit)]);
-	}
-	for ( ; bit < bit_cnt; bit++) {
+	words = _bitstr_full_words(bit_cnt);
+	count = _bit_kernels()->count(_bitstr_data(b), words);
+	for (bit = (bitoff_t) words << BITSTR_SHIFT; bit < bit_cnt; bit++) {
 		if (bit_test(b, bit))
 			count++;
 	}
@@ -790,21 +1446,18 @@ bit_set_count_range(bitstr_t *b, int32_t start, int32_t end)
 extern int32_t
 bit_overlap(bitstr_t *b1, bitstr_t *b2)
 {
-	int32_t count = 0;
+	int32_t count, words;
 	bitoff_t bit, bit_cnt;
-	int32_t word_size = sizeof(bitstr_t) * 8;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
 	bit_cnt = _bitstr_bits(b1);
-	for (bit = 0; bit < bit_cnt; bit += word_size) {
-		if ((bit + word_size - 1) >= bit_cnt)
-			break;
-		count += hweight(b1[_bit_word(bit)] & b2[_bit_word(bit)]);
-	}
-	for ( ; bit < bit_cnt; bit++) {
+	words = _bitstr_full_words(bit_cnt);
+	count = _bit_kernels()->and_count(_bitstr_data(b1), _bitstr_data(b2),
+					  words);
+	for (bit = (bitoff_t) words << BITSTR_SHIFT; bit < bit_cnt; bit++) {
 		if (bit_test(b1, bit) && bit_test(b2, bit))
 			count++;
 	}
@@ -812,6 +1465,65 @@ bit_overlap(bitstr_t *b1, bitstr_t *b2)
 	return count;
 }
 
+/*
+ * return 1 if any bit set in b1 is also set in b2, 0 if no overlap.
+ * Faster than bit_overlap() when only the existence of an overlap matters.
+ */
+extern int
+bit_overlap_any(bitstr_t *b1, bitstr_t *b2)
+{
+	int32_t words;
+	bitoff_t bit, bit_cnt;
+
+	_assert_bitstr_valid(b1);
+	_assert_bitstr_valid(b2);
+	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
+
+	bit_cnt = _bitstr_bits(b1);
+	words = _bitstr_full_words(bit_cnt);
+	if (_bit_kernels()->any_and(_bitstr_data(b1), _bitstr_data(b2), words))
+		return 1;
+	for (bit = (bitoff_t) words << BITSTR_SHIFT; bit < bit_cnt; bit++) {
+		if (bit_test(b1, bit) && bit_test(b2, bit))
+			return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * b1 &= b2 and return the number of bits then set in b1, the same as
+ * bit_and(b1, b2); bit_set_count(b1); with a single pass over the bitmaps
+ *   b1 (IN/OUT)	first string
+ *   b2 (IN)		second bitstring
+ *   RETURN		count of set bits in the result
+ */
+extern int32_t
+bit_and_set_count(bitstr_t *b1, bitstr_t *b2)
+{
+	int32_t count, words;
+	bitoff_t bit, bit_cnt;
+
+	_assert_bitstr_valid(b1);
+	_assert_bitstr_valid(b2);
+	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
+
+	bit_cnt = _bitstr_bits(b1);
+	words = _bitstr_full_words(bit_cnt);
+	count = _bit_kernels()->and_store_count(_bitstr_data(b1),
+						_bitstr_data(b2), words);
+	if (words < _bitstr_data_words(bit_cnt)) {
+		_bitstr_data(b1)[words] &= _bitstr_data(b2)[words];
+		for (bit = (bitoff_t) words << BITSTR_SHIFT; bit < bit_cnt;
+		     bit++) {
+			if (bit_test(b1, bit))
+				count++;
+		}
+	}
+
+	return count;
+}
+
 /*
  * Count the number of bits clear in bitstring.
  *   b (IN)		bitstring to check
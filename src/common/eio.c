@@ -66,6 +66,7 @@ strong_alias(eio_new_obj,		slurm_eio_new_obj);
 strong_alias(eio_new_initial_obj,	slurm_eio_new_initial_obj);
 strong_alias(eio_obj_create,		slurm_eio_obj_create);
 strong_alias(eio_obj_destroy,		slurm_eio_obj_destroy);
+strong_alias(eio_obj_set_timer,		slurm_eio_obj_set_timer);
 strong_alias(eio_remove_obj,		slurm_eio_remove_obj);
 strong_alias(eio_signal_shutdown,	slurm_eio_signal_shutdown);
 strong_alias(eio_signal_wakeup,		slurm_eio_signal_wakeup);
@@ -93,12 +94,14 @@ struct eio_handle_components {
  */
 
 static int          _poll_internal(struct pollfd *pfds, unsigned int nfds,
-				   time_t shutdown_time);
+				   time_t shutdown_time, int timer_msec);
 static unsigned int _poll_setup_pollfds(struct pollfd *, eio_obj_t **, List);
 static void         _poll_dispatch(struct pollfd *, unsigned int, eio_obj_t **,
 		                   List objList);
 static void         _poll_handle_event(short revents, eio_obj_t *obj,
 		                       List objList);
+static int          _timer_msec(List objList);
+static void         _timer_dispatch(List objList);
 
 
 eio_handle_t *eio_handle_create(uint16_t shutdown_wait)
@@ -286,6 +289,7 @@ int eio_handle_mainloop(eio_handle_t *eio)
 	unsigned int   maxnfds = 0, nfds = 0;
 	unsigned int   n       = 0;
 	time_t shutdown_time;
+	int timer_msec;
 
 	xassert (eio != NULL);
 	xassert (eio->magic == EIO_MAGIC);
@@ -322,13 +326,17 @@ int eio_handle_mainloop(eio_handle_t *eio)
 		slurm_mutex_lock(&eio->shutdown_mutex);
 		shutdown_time = eio->shutdown_time;
 		slurm_mutex_unlock(&eio->shutdown_mutex);
-		if (_poll_internal(pollfds, nfds, shutdown_time) < 0)
+		timer_msec = _timer_msec(eio->obj_list);
+		if (_poll_internal(pollfds, nfds, shutdown_time,
+				   timer_msec) < 0)
 			goto error;
 
 		if (pollfds[nfds-1].revents & POLLIN)
 			_eio_wakeup_handler(eio);
 
 		_poll_dispatch(pollfds, nfds - 1, map, eio->obj_list);
+		if (timer_msec >= 0)
+			_timer_dispatch(eio->obj_list);
 
 		slurm_mutex_lock(&eio->shutdown_mutex);
 		shutdown_time = eio->shutdown_time;
@@ -349,7 +357,8 @@ int eio_handle_mainloop(eio_handle_t *eio)
 }
 
 static int
-_poll_internal(struct pollfd *pfds, unsigned int nfds, time_t shutdown_time)
+_poll_internal(struct pollfd *pfds, unsigned int nfds, time_t shutdown_time,
+	       int timer_msec)
 {
 	int n, timeout;
 
@@ -357,6 +366,8 @@ _poll_internal(struct pollfd *pfds, unsigned int nfds, time_t shutdown_time)
 		timeout = 1000;	/* Return every 1000 msec during shutdown */
 	else
 		timeout = -1;
+	if ((timer_msec >= 0) && ((timeout < 0) || (timer_msec < timeout)))
+		timeout = timer_msec;
 	while ((n = poll(pfds, nfds, timeout)) < 0) {
 		switch (errno) {
 		case EINTR :
@@ -508,6 +519,57 @@ _poll_handle_event(short revents, eio_obj_t *obj, List objList)
 	}
 }
 
+/* Return the msec until the earliest timer of an object is due, 0 if one is
+ * already due, -1 if no timer is set */
+static int
+_timer_msec(List objList)
+{
+	ListIterator iter;
+	eio_obj_t *obj;
+	struct timeval now;
+	long msec, min_msec = -1;
+
+	gettimeofday(&now, NULL);
+	iter = list_iterator_create(objList);
+	while ((obj = list_next(iter))) {
+		if (!obj->timer.tv_sec || !obj->ops->handle_timer)
+			continue;
+		msec = (obj->timer.tv_sec - now.tv_sec) * 1000 +
+		       (obj->timer.tv_usec - now.tv_usec) / 1000;
+		if (msec < 0)
+			msec = 0;
+		if ((min_msec < 0) || (msec < min_msec))
+			min_msec = msec;
+	}
+	list_iterator_destroy(iter);
+
+	return (int) min_msec;
+}
+
+/* Call the handle_timer function of the objects whose timer is due */
+static void
+_timer_dispatch(List objList)
+{
+	ListIterator iter;
+	eio_obj_t *obj;
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	iter = list_iterator_create(objList);
+	while ((obj = list_next(iter))) {
+		if (!obj->timer.tv_sec || !obj->ops->handle_timer)
+			continue;
+		if ((obj->timer.tv_sec > now.tv_sec) ||
+		    ((obj->timer.tv_sec == now.tv_sec) &&
+		     (obj->timer.tv_usec > now.tv_usec)))
+			continue;
+		obj->timer.tv_sec = 0;
+		obj->timer.tv_usec = 0;
+		(*obj->ops->handle_timer) (obj, objList);
+	}
+	list_iterator_destroy(iter);
+}
+
 static struct io_operations *
 _ops_copy(struct io_operations *ops)
 {
@@ -529,6 +591,22 @@ eio_obj_create(int fd, struct io_operations *ops, void *arg)
 	return obj;
 }
 
+void eio_obj_set_timer(eio_obj_t *obj, int msec)
+{
+	if (msec < 0) {
+		obj->timer.tv_sec = 0;
+		obj->timer.tv_usec = 0;
+		return;
+	}
+	gettimeofday(&obj->timer, NULL);
+	obj->timer.tv_sec += msec / 1000;
+	obj->timer.tv_usec += (msec % 1000) * 1000;
+	if (obj->timer.tv_usec >= 1000000) {
+		obj->timer.tv_sec++;
+		obj->timer.tv_usec -= 1000000;
+	}
+}
+
 void eio_obj_destroy(void *arg)
 {
 	eio_obj_t *obj = (eio_obj_t *)arg;
@@ -28,6 +28,8 @@
 #ifndef _EIO_H
 #define _EIO_H 1
 
+#include <sys/time.h>
+
 #include "src/common/list.h"
 #include "src/common/macros.h"
 #include "src/common/slurm_protocol_defs.h"
@@ -50,6 +52,9 @@ typedef struct eio_handle_components eio_handle_t;
  * that the shutdown flag is essentially just an advisory flag.  The
  * "readable" and "writable" functions have the final say over whether a
  * file descriptor will continue to be polled.
+ *
+ * "handle_timer" is called once the time set with eio_obj_set_timer() has
+ * passed, whether or not there was activity on the file descriptor.
  */
 struct io_operations {
 	bool (*readable    )(eio_obj_t *);
@@ -59,6 +64,7 @@ struct io_operations {
 	int  (*handle_write)(eio_obj_t *, List);
 	int  (*handle_error)(eio_obj_t *, List);
 	int  (*handle_close)(eio_obj_t *, List);
+	int  (*handle_timer)(eio_obj_t *, List);
 	int  timeout;
 };
 
@@ -67,6 +73,8 @@ struct eio_obj {
 	void *arg;                        /* application-specific data       */
 	struct io_operations *ops;        /* pointer to ops struct for obj   */
 	bool shutdown;
+	struct timeval timer;             /* when to call handle_timer, zero
+					   * if not set                      */
 };
 
 eio_handle_t *eio_handle_create(uint16_t);
@@ -115,4 +123,12 @@ int eio_signal_shutdown(eio_handle_t *eio);
 eio_obj_t *eio_obj_create(int fd, struct io_operations *ops, void *arg);
 void eio_obj_destroy(void *arg);
 
+/*
+ * Call obj->ops->handle_timer() "msec" milliseconds from now, unless the
+ * timer is set again or cleared (msec < 0) before then. Supposed to be
+ * called from the eio thread, e.g. from read/write handlers; other threads
+ * must call eio_signal_wakeup() for the new time to be used.
+ */
+void eio_obj_set_timer(eio_obj_t *obj, int msec);
+
 #endif /* !_EIO_H */
@@ -42,6 +42,7 @@
 #include <ctype.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -175,7 +176,7 @@ extern void * lsd_nomem_error(char *file, int line, char *mesg);
 #define HOSTLIST_CHUNK    16
 
 /* max host range: anything larger will be assumed to be an error */
-#define MAX_RANGE    (64*1024)    /* 64K Hosts */
+#define MAX_RANGE    (1024*1024)  /* 1M Hosts */
 
 /* max number of ranges that will be processed between brackets */
 #define MAX_RANGES   (64*1024)    /* 64K Hosts */
@@ -831,7 +832,12 @@ static int hostrange_prefix_cmp(hostrange_t h1, hostrange_t h2)
 	if (h2 == NULL)
 		return -1;
 
-	retval = strnatcmp(h1->prefix, h2->prefix);
+	/* Most ranges compared share a prefix, and strcmp() is much
+	 * cheaper than a natural order comparison to find that */
+	if ((h1->prefix == h2->prefix) || !strcmp(h1->prefix, h2->prefix))
+		retval = 0;
+	else
+		retval = strnatcmp(h1->prefix, h2->prefix);
 	return retval == 0 ? h2->singlehost - h1->singlehost : retval;
 }
 
@@ -1040,6 +1046,10 @@ static hostrange_t hostrange_intersect(hostrange_t h1, hostrange_t h2)
  */
 static int hostrange_hn_within(hostrange_t hr, hostname_t hn)
 {
+	char *suffix;
+	unsigned long num;
+	int len1, len2, ldiff = 0, width;
+
 	if (hr->singlehost) {
 		/*
 		 *  If the current hostrange [hr] is a `singlehost' (no valid
@@ -1064,12 +1074,14 @@ static int hostrange_hn_within(hostrange_t hr, hostname_t hn)
 	if (!hostname_suffix_is_valid (hn))
 		return 0;
 
+	suffix = hn->suffix;
+	num = hn->num;
+
 	/*
 	 *  If hostrange and hostname prefixes don't match, then
 	 *   there is way the hostname falls within the range [hr].
 	 */
 	if (strcmp(hr->prefix, hn->prefix) != 0) {
-		int len1, len2, ldiff;
 		int dims = slurmdb_setup_cluster_name_dims();
 
 		if (dims != 1)
@@ -1087,33 +1099,23 @@ static int hostrange_hn_within(hostrange_t hr, hostname_t hn)
 
 		/* First see if by taking some of the leading digits of the
 		 * suffix of hn and moving it to the end of the prefix if it
-		 * would be a match.
+		 * would be a match. hn is only changed once it matches, so
+		 * that it can still be tested against other ranges.
 		 */
 		len1  = strlen(hr->prefix);
 		len2  = strlen(hn->prefix);
 		ldiff = len1 - len2;
 
 		if (ldiff > 0 && isdigit(hr->prefix[len1-1])
-		    && (strlen(hn->suffix) >= ldiff)) {
-			/* Tack on ldiff of the hostname's suffix to that of
-			 * it's prefix */
-			hn->prefix = realloc(hn->prefix, len2+ldiff+1);
-			strncat(hn->prefix, hn->suffix, ldiff);
-			/* Now adjust the suffix of the hostname object. */
-			hn->suffix += ldiff;
-			/* And the numeric representation just incase
-			 * whatever we just tacked on to the prefix
-			 * had something other than 0 in it.
-			 *
-			 * Since we are only going through this logic for
+		    && (strlen(hn->suffix) >= ldiff)
+		    && !strncmp(hr->prefix, hn->prefix, len2)
+		    && !strncmp(hr->prefix + len2, hn->suffix, ldiff)) {
+			/* Since we are only going through this logic for
 			 * single dimension systems we will always use
 			 * the base 10.
 			 */
-			hn->num = strtoul(hn->suffix, NULL, 10);
-
-			/* Now compare them and see if they match */
-			if (strcmp(hr->prefix, hn->prefix) != 0)
-				return 0;
+			suffix = hn->suffix + ldiff;
+			num = strtoul(suffix, NULL, 10);
 		} else
 			return 0;
 	}
@@ -1122,13 +1124,22 @@ static int hostrange_hn_within(hostrange_t hr, hostname_t hn)
 	 *  Finally, check whether [hn], with a valid numeric suffix,
 	 *   falls within the range of [hr].
 	 */
-	if (hn->num <= hr->hi && hn->num >= hr->lo) {
-		int width = hostname_suffix_width(hn);
-		int num = hn->num;
-		return (_width_equiv(hr->lo, &hr->width, num, &width));
-	}
+	if (num > hr->hi || num < hr->lo)
+		return 0;
+	width = (int) strlen(suffix);
+	if (!_width_equiv(hr->lo, &hr->width, num, &width))
+		return 0;
 
-	return 0;
+	if (ldiff > 0) {
+		/* Tack on ldiff of the hostname's suffix to that of
+		 * it's prefix, so the caller sees hn relative to hr */
+		len2 = strlen(hn->prefix);
+		hn->prefix = realloc(hn->prefix, len2+ldiff+1);
+		strncat(hn->prefix, hn->suffix, ldiff);
+		hn->suffix = suffix;
+		hn->num = num;
+	}
+	return 1;
 }
 
 
@@ -2212,6 +2223,34 @@ int hostlist_pop_range_values(
 	return 1;
 }
 
+int hostlist_for_each_range(hostlist_t hl, hostlist_range_f f, void *arg)
+{
+	int i, n = 0;
+	hostrange_t hr;
+
+	if (!hl)
+		return 0;
+
+	LOCK_HOSTLIST(hl);
+	for (i = 0; i < hl->nranges; i++) {
+		hr = hl->hr[i];
+		if (hr->singlehost) {
+			if ((*f)(hr->prefix, 0, 0, -1, arg) < 0) {
+				n = -n;
+				break;
+			}
+		} else if ((*f)(hr->prefix, hr->lo, hr->hi, hr->width,
+				arg) < 0) {
+			n = -n;
+			break;
+		}
+		n++;
+	}
+	UNLOCK_HOSTLIST(hl);
+
+	return n;
+}
+
 char *hostlist_shift_range(hostlist_t hl)
 {
 	int i;
@@ -3628,27 +3667,214 @@ int hostset_insert(hostset_t set, const char *hosts)
 }
 
 
-/* linear search through N ranges for hostname "host"
- * */
-static int hostset_find_host(hostset_t set, const char *host)
+/* linear search through N ranges of hostlist hl for hostname "host"
+ * Assumes that the hl lock is already held
+ */
+static int _hostlist_find_host(hostlist_t hl, const char *host)
 {
 	int i;
 	int retval = 0;
 	hostname_t hn;
-	LOCK_HOSTLIST(set->hl);
+
 	hn = hostname_create(host);
-	for (i = 0; i < set->hl->nranges; i++) {
-		if (hostrange_hn_within(set->hl->hr[i], hn)) {
+	for (i = 0; i < hl->nranges; i++) {
+		if (hostrange_hn_within(hl->hr[i], hn)) {
 			retval = 1;
-			goto done;
+			break;
 		}
 	}
-done:
-	UNLOCK_HOSTLIST(set->hl);
 	hostname_destroy(hn);
 	return retval;
 }
 
+static int hostset_find_host(hostset_t set, const char *host)
+{
+	int retval;
+
+	LOCK_HOSTLIST(set->hl);
+	retval = _hostlist_find_host(set->hl, host);
+	UNLOCK_HOSTLIST(set->hl);
+	return retval;
+}
+
+/* sort hostranges by prefix, width and lowest suffix, so that the ranges
+ * of a uniq'ed hostlist with the same prefix and width are ordered by
+ * both their lowest and highest suffix */
+static int _cmp_prefix_width(const void *hr1, const void *hr2)
+{
+	hostrange_t h1 = *(hostrange_t *) hr1;
+	hostrange_t h2 = *(hostrange_t *) hr2;
+	int retval;
+
+	if ((retval = strcmp(h1->prefix, h2->prefix)))
+		return retval;
+	if (h1->width != h2->width)
+		return h1->width - h2->width;
+	return (h1->lo < h2->lo) ? -1 : (h1->lo > h2->lo);
+}
+
+/* return the index of the first of the cnt sorted ranges in hr not below
+ * (prefix, width, num), comparing num with the highest suffix of ranges */
+static int _range_lower_bound(hostrange_t *hr, int cnt, const char *prefix,
+			      int width, unsigned long num)
+{
+	int first = 0, last = cnt, mid, retval;
+
+	while (first < last) {
+		mid = (first + last) / 2;
+		if (!(retval = strcmp(hr[mid]->prefix, prefix)))
+			retval = (hr[mid]->width < width) ? -1 :
+				 (hr[mid]->width > width);
+		if ((retval < 0) || ((retval == 0) && (hr[mid]->hi < num)))
+			first = mid + 1;
+		else
+			last = mid;
+	}
+	return first;
+}
+
+/* Find the hosts of hostrange hr in the cnt ranges of a uniq'ed hostlist,
+ * sorted by _cmp_prefix_width(), a range at a time.
+ * If "any" is set, return 1 if any host of hr is in those ranges,
+ * otherwise return 1 if all hosts of hr are.
+ *
+ * Only ranges with hr's prefix and width are compared a range at a time.
+ * Hosts not found there are looked up individually in hl when they may
+ * still match by hostrange_hn_within(): when hr's prefix ends in a digit
+ * (n1[36-49] holding n136, in n[100-200]), when a range's prefix is hr's
+ * followed by digits (nid0000[2-7] holding nid00002), when a range of the
+ * prefix has another width or padding, or when "by_name" is set.
+ * Assumes that the hl lock is already held and that hostnames are one
+ * dimensional.
+ */
+static int _hostlist_find_range(hostlist_t hl, hostrange_t *sorted, int cnt,
+				hostrange_t hr, int any, int by_name)
+{
+	unsigned long num, next;
+	hostrange_t h;
+	char *host = NULL;
+	size_t len, size;
+	int i, first, end, found, width, extended, slow;
+	int retval = any ? 0 : 1;
+
+	if (hr->singlehost)
+		return _hostlist_find_host(hl, hr->prefix);
+
+	len = strlen(hr->prefix);
+	size = len + hr->width + 16;
+	if (!(host = malloc(size))) {
+		errno = ENOMEM;
+		lsd_nomem_error(__FILE__, __LINE__, "hostset find range");
+		return 0;
+	}
+
+	/* is there a prefix of hr->prefix followed by a digit */
+	snprintf(host, size, "%s0", hr->prefix);
+	i = _range_lower_bound(sorted, cnt, host, INT_MIN, 0);
+	extended = ((i < cnt) &&
+		    !strncmp(sorted[i]->prefix, hr->prefix, len) &&
+		    isdigit((int) sorted[i]->prefix[len]));
+	if (by_name || (len && isdigit((int) hr->prefix[len - 1])))
+		extended = 1;
+
+	first = _range_lower_bound(sorted, cnt, hr->prefix, INT_MIN, 0);
+
+	num = hr->lo;
+	while (num <= hr->hi) {
+		/* look for a range holding num in each width, or else the
+		 * start of the next range that may hold a later host */
+		next = hr->hi + 1;
+		found = 0;
+		slow = extended;
+		for (i = first; (i < cnt) && !found &&
+			     !strcmp(sorted[i]->prefix, hr->prefix); i = end) {
+			width = sorted[i]->width;
+			end = _range_lower_bound(sorted, cnt, hr->prefix,
+						 width + 1, 0);
+			i = _range_lower_bound(sorted + i, end - i,
+					       hr->prefix, width, num) + i;
+			if (i >= end)
+				continue;
+			h = sorted[i];
+			if (h->lo > num) {
+				next = MIN(next, h->lo);
+			} else if (width == hr->width) {
+				found = 1;
+				if (any || (h->hi >= hr->hi))
+					next = hr->hi + 1;
+				else
+					next = h->hi + 1;
+			} else
+				slow = 1;
+		}
+
+		if (!found && slow) {
+			snprintf(host, size, "%s%0*lu", hr->prefix, hr->width,
+				 num);
+			found = _hostlist_find_host(hl, host);
+			next = num + 1;
+		}
+
+		if (found && any) {
+			retval = 1;
+			break;
+		}
+		if (!found && !any) {
+			retval = 0;
+			break;
+		}
+		if (next <= num)	/* suffix wrapped around */
+			break;
+		num = next;
+	}
+
+	free(host);
+	return retval;
+}
+
+/* Compare the ranges of "hosts" against those of "set" rather than one
+ * hostname at a time, see _hostlist_find_range()
+ */
+static int _hostset_find_ranges(hostset_t set, hostlist_t hl, int any)
+{
+	hostrange_t *sorted;
+	int i, cnt = 0, by_name = 0, retval = any ? 0 : 1;
+	size_t len;
+
+	LOCK_HOSTLIST(set->hl);
+	if (!(sorted = malloc(sizeof(hostrange_t) *
+			      (set->hl->nranges + 1)))) {
+		UNLOCK_HOSTLIST(set->hl);
+		errno = ENOMEM;
+		lsd_nomem_error(__FILE__, __LINE__, "hostset find ranges");
+		return 0;
+	}
+	for (i = 0; i < set->hl->nranges; i++) {
+		if (!set->hl->hr[i]->singlehost) {
+			sorted[cnt++] = set->hl->hr[i];
+			continue;
+		}
+		/* a host without a valid numeric suffix, but ending in a
+		 * digit, can only be found by name */
+		len = strlen(set->hl->hr[i]->prefix);
+		if (len && isdigit((int) set->hl->hr[i]->prefix[len - 1]))
+			by_name = 1;
+	}
+	qsort(sorted, cnt, sizeof(hostrange_t), _cmp_prefix_width);
+
+	for (i = 0; i < hl->nranges; i++) {
+		if (_hostlist_find_range(set->hl, sorted, cnt, hl->hr[i],
+					 any, by_name) == any) {
+			retval = any;
+			break;
+		}
+	}
+	UNLOCK_HOSTLIST(set->hl);
+	free(sorted);
+
+	return retval;
+}
+
 int hostset_intersects(hostset_t set, const char *hosts)
 {
 	int retval = 0;
@@ -3657,7 +3883,14 @@ int hostset_intersects(hostset_t set, const char *hosts)
 
 	assert(set->hl->magic == HOSTLIST_MAGIC);
 
-	hl = hostlist_create(hosts);
+	if (!(hl = hostlist_create(hosts)))
+		return (0);
+	if (slurmdb_setup_cluster_name_dims() == 1) {
+		retval = _hostset_find_ranges(set, hl, 1);
+		hostlist_destroy(hl);
+		return retval;
+	}
+
 	while ((hostname = hostlist_pop(hl)) != NULL) {
 		retval += hostset_find_host(set, hostname);
 		free(hostname);
@@ -3680,6 +3913,11 @@ int hostset_within(hostset_t set, const char *hosts)
 
 	if (!(hl = hostlist_create(hosts)))
 		return (0);
+	if (slurmdb_setup_cluster_name_dims() == 1) {
+		nfound = _hostset_find_ranges(set, hl, 0);
+		hostlist_destroy(hl);
+		return nfound;
+	}
 	nhosts = hostlist_count(hl);
 	nfound = 0;
 
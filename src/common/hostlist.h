@@ -259,6 +259,21 @@ char * hostlist_pop_range(hostlist_t hl);
 int hostlist_pop_range_values(
 	hostlist_t hl, unsigned long *lo, unsigned long *hi);
 
+/* hostlist_for_each_range():
+ *
+ * Call function f for each range of hosts in the hostlist hl, with the
+ * prefix, lowest and highest numeric suffix and zero padded width of the
+ * suffix of the range. A host without a numeric suffix is passed as the
+ * prefix with a width of -1. The suffixes of multi-dimensional hostnames
+ * are passed as encoded by hostlist_parse_int_to_array().
+ * Stops at the first range for which f returns a negative value.
+ * Returns the number of ranges processed, negated if f returned a
+ * negative value.
+ */
+typedef int (*hostlist_range_f)(const char *prefix, unsigned long lo,
+				unsigned long hi, int width, void *arg);
+int hostlist_for_each_range(hostlist_t hl, hostlist_range_f f, void *arg);
+
 /* hostlist_shift_range():
  *
  * Shift the first bracketed hostlist (improperly: range) off the
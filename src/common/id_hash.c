@@ -0,0 +1,247 @@
+/*****************************************************************************\
+ *  id_hash.c - hash table of items keyed by a numeric ID. Uses open
+ *	addressing and grows incrementally, so no single insertion pays the
+ *	full cost of rebuilding a large table.
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+/*
+ * Items are stored using linear probing in a table whose size is a power of
+ * two. Once the table is three quarters full, a table twice the size is
+ * allocated and new items are added there, while every later update moves
+ * a few slots of the old table into the new one. Lookups check both tables
+ * until the old one is empty. Slots of the old table which have been moved
+ * or removed are marked rather than emptied so that probe sequences through
+ * them remain intact.
+ */
+
+#include <string.h>
+
+#include "src/common/id_hash.h"
+#include "src/common/xassert.h"
+#include "src/common/xmalloc.h"
+
+#define ID_HASH_MIN_SIZE	64
+#define ID_HASH_MIGRATE_CNT	64	/* old table slots moved per update */
+#define ID_HASH_FULL(_size, _cnt) ((_cnt) >= ((_size) - ((_size) >> 2)))
+
+static char id_hash_moved;
+#define ID_HASH_MOVED ((void *) &id_hash_moved)
+
+typedef struct {
+	uint64_t key;
+	void *item;		/* NULL if unused, ID_HASH_MOVED if moved */
+} id_hash_slot_t;
+
+typedef struct {
+	id_hash_slot_t *slot;
+	uint32_t mask;		/* table size - 1 */
+	uint32_t cnt;		/* items in table */
+} id_hash_table_t;
+
+struct id_hash {
+	id_hash_table_t cur;	/* new items are added here */
+	id_hash_table_t old;	/* items being moved into cur, if any */
+	uint32_t move_inx;	/* next slot of old table to move */
+};
+
+/* Spread sequential IDs across the table (MurmurHash3 finalizer) */
+static inline uint32_t _hash(uint64_t key)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+	return (uint32_t) key;
+}
+
+static void _table_alloc(id_hash_table_t *table, uint64_t size)
+{
+	uint64_t table_size = ID_HASH_MIN_SIZE;
+
+	while ((table_size < size) && (table_size < 0x80000000))
+		table_size <<= 1;
+	table->slot = xmalloc(sizeof(id_hash_slot_t) * table_size);
+	table->mask = table_size - 1;
+	table->cnt = 0;
+}
+
+static void _table_insert(id_hash_table_t *table, uint64_t key, void *item)
+{
+	uint32_t inx = _hash(key) & table->mask;
+
+	while (table->slot[inx].item)
+		inx = (inx + 1) & table->mask;
+	table->slot[inx].key = key;
+	table->slot[inx].item = item;
+	table->cnt++;
+}
+
+/* Return the slot holding the given key and item (any item if NULL),
+ * or -1 if not found */
+static int64_t _table_find(id_hash_table_t *table, uint64_t key, void *item)
+{
+	uint32_t inx;
+	id_hash_slot_t *slot;
+
+	if (!table->slot)
+		return -1;
+	inx = _hash(key) & table->mask;
+	while ((slot = &table->slot[inx])->item) {
+		if ((slot->key == key) && (slot->item != ID_HASH_MOVED) &&
+		    (!item || (slot->item == item)))
+			return inx;
+		inx = (inx + 1) & table->mask;
+	}
+	return -1;
+}
+
+/* Empty a slot of the current table, shifting back any later items of the
+ * same probe sequence so that no marker is needed */
+static void _table_delete(id_hash_table_t *table, uint32_t inx)
+{
+	uint32_t next = inx, home;
+
+	while (1) {
+		next = (next + 1) & table->mask;
+		if (!table->slot[next].item)
+			break;
+		home = _hash(table->slot[next].key) & table->mask;
+		/* Item can move if its home slot is not in (inx, next] */
+		if (((next - home) & table->mask) >=
+		    ((next - inx) & table->mask)) {
+			table->slot[inx] = table->slot[next];
+			inx = next;
+		}
+	}
+	table->slot[inx].item = NULL;
+	table->cnt--;
+}
+
+/* Move up to cnt slots of the old table into the current one */
+static void _move_slots(id_hash_t *hash, uint32_t cnt)
+{
+	id_hash_slot_t *slot;
+
+	while (hash->old.slot && cnt--) {
+		slot = &hash->old.slot[hash->move_inx];
+		if (slot->item && (slot->item != ID_HASH_MOVED)) {
+			_table_insert(&hash->cur, slot->key, slot->item);
+			slot->item = ID_HASH_MOVED;
+			hash->old.cnt--;
+		}
+		if (hash->move_inx++ == hash->old.mask) {
+			xassert(hash->old.cnt == 0);
+			xfree(hash->old.slot);
+			memset(&hash->old, 0, sizeof(id_hash_table_t));
+			hash->move_inx = 0;
+		}
+	}
+}
+
+extern id_hash_t *id_hash_init(uint32_t size)
+{
+	id_hash_t *hash = xmalloc(sizeof(id_hash_t));
+
+	/* Room for "size" items without growing */
+	_table_alloc(&hash->cur, (uint64_t) size + (size / 3) + 1);
+	return hash;
+}
+
+extern void id_hash_free(id_hash_t *hash)
+{
+	if (!hash)
+		return;
+	xfree(hash->cur.slot);
+	xfree(hash->old.slot);
+	xfree(hash);
+}
+
+extern void id_hash_add(id_hash_t *hash, uint64_t key, void *item)
+{
+	uint32_t size;
+
+	xassert(hash);
+	xassert(item);
+
+	_move_slots(hash, ID_HASH_MIGRATE_CNT);
+	size = hash->cur.mask + 1;
+	if (ID_HASH_FULL(size, hash->cur.cnt + hash->old.cnt + 1) &&
+	    (size < 0x80000000)) {
+		_move_slots(hash, UINT32_MAX);	/* Finish any earlier move */
+		hash->old = hash->cur;
+		hash->move_inx = 0;
+		_table_alloc(&hash->cur, (uint64_t) size << 1);
+	}
+	_table_insert(&hash->cur, key, item);
+}
+
+extern void *id_hash_find(id_hash_t *hash, uint64_t key)
+{
+	int64_t inx;
+
+	if (!hash)
+		return NULL;
+	if ((inx = _table_find(&hash->cur, key, NULL)) >= 0)
+		return hash->cur.slot[inx].item;
+	if ((inx = _table_find(&hash->old, key, NULL)) >= 0)
+		return hash->old.slot[inx].item;
+	return NULL;
+}
+
+extern void *id_hash_remove(id_hash_t *hash, uint64_t key, void *item)
+{
+	int64_t inx;
+
+	xassert(hash);
+
+	_move_slots(hash, ID_HASH_MIGRATE_CNT);
+	if ((inx = _table_find(&hash->cur, key, item)) >= 0) {
+		item = hash->cur.slot[inx].item;
+		_table_delete(&hash->cur, inx);
+		return item;
+	}
+	if ((inx = _table_find(&hash->old, key, item)) >= 0) {
+		item = hash->old.slot[inx].item;
+		hash->old.slot[inx].item = ID_HASH_MOVED;
+		hash->old.cnt--;
+		return item;
+	}
+	return NULL;
+}
+
+extern uint32_t id_hash_count(id_hash_t *hash)
+{
+	if (!hash)
+		return 0;
+	return hash->cur.cnt + hash->old.cnt;
+}
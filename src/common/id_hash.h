@@ -0,0 +1,85 @@
+/*****************************************************************************\
+ *  id_hash.h - hash table of items keyed by a numeric ID. Uses open
+ *	addressing and grows incrementally, so no single insertion pays the
+ *	full cost of rebuilding a large table.
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _ID_HASH_H
+#define _ID_HASH_H
+
+#include <inttypes.h>
+
+/* Build a 64-bit key from a pair of 32-bit IDs (e.g. job array and task) */
+#define ID_HASH_KEY2(_id1, _id2) \
+	((((uint64_t) (_id1)) << 32) | ((uint64_t) (_id2)))
+
+typedef struct id_hash id_hash_t;
+
+/*
+ * id_hash_init - create an empty hash table
+ * IN size - expected number of items, the table grows as needed
+ * RET the hash table, release using id_hash_free()
+ */
+extern id_hash_t *id_hash_init(uint32_t size);
+
+/* Free a hash table. The items themselves are not freed. */
+extern void id_hash_free(id_hash_t *hash);
+
+/*
+ * id_hash_add - add an item to a hash table
+ * IN hash - hash table
+ * IN key - item's key, need not be unique
+ * IN item - the item, must not be NULL
+ */
+extern void id_hash_add(id_hash_t *hash, uint64_t key, void *item);
+
+/*
+ * id_hash_find - find an item in a hash table
+ * IN hash - hash table, may be NULL
+ * IN key - item's key
+ * RET an item with the given key or NULL if none found
+ */
+extern void *id_hash_find(id_hash_t *hash, uint64_t key);
+
+/*
+ * id_hash_remove - remove an item from a hash table
+ * IN hash - hash table
+ * IN key - item's key
+ * IN item - item to remove, NULL to remove any item with the given key
+ * RET the item removed or NULL if none found
+ */
+extern void *id_hash_remove(id_hash_t *hash, uint64_t key, void *item);
+
+/* Return the number of items in a hash table */
+extern uint32_t id_hash_count(id_hash_t *hash);
+
+#endif /* !_ID_HASH_H */
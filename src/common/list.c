@@ -101,13 +101,29 @@ strong_alias(list_install_fork_handlers, slurm_list_install_fork_handlers);
  * valgrind can identify where exactly any leak associated with the use
  * of the list functions originates.
 \**************************************************************************/
-#ifdef MEMORY_LEAK_DEBUG
-#  define LIST_ALLOC 1
-#else
-#  define LIST_ALLOC 128
-#endif
+#define LIST_ALLOC 128
 #define LIST_MAGIC 0xDEADBEEF
 
+/**************************************************************************\
+ * Lists, nodes and iterators are handed out from a cache private to each
+ * thread, so most allocations and frees take no lock at all. A thread
+ * refills its cache of a type by taking a whole batch of objects from the
+ * global free list of that type, and once it caches 2 * LIST_ALLOC objects
+ * it returns a batch of LIST_ALLOC of them. Each batch is moved with one
+ * push or pop under list_free_lock. A thread returns its cached objects
+ * when it exits.
+ *
+ * Free objects are chained through their first word and the batches on a
+ * global free list are chained through the second word of their first
+ * object.
+\**************************************************************************/
+enum {
+	LIST_OBJ_LIST,
+	LIST_OBJ_NODE,
+	LIST_OBJ_ITERATOR,
+	LIST_OBJ_TYPES
+};
+
 
 /****************
  *  Data Types  *
@@ -142,6 +158,11 @@ struct list {
 
 typedef struct listNode * ListNode;
 
+typedef struct {
+	void                 *free[LIST_OBJ_TYPES];  /* free objects       */
+	int                   count[LIST_OBJ_TYPES]; /* objects in free[]  */
+} list_cache_t;
+
 
 /****************
  *  Prototypes  *
@@ -155,8 +176,8 @@ static ListNode list_node_alloc (void);
 static void list_node_free (ListNode p);
 static ListIterator list_iterator_alloc (void);
 static void list_iterator_free (ListIterator i);
-static void * list_alloc_aux (int size, void *pfreelist);
-static void list_free_aux (void *x, void *pfreelist);
+static void * list_alloc_aux (int type);
+static void list_free_aux (void *x, int type);
 static void *_list_pop_locked(List l);
 static void *_list_append_locked(List l, void *x);
 
@@ -168,12 +189,20 @@ static int _list_mutex_is_locked (pthread_mutex_t *mutex);
  *  Variables  *
  ***************/
 
-static List list_free_lists = NULL;
-static ListNode list_free_nodes = NULL;
-static ListIterator list_free_iterators = NULL;
+static const int list_obj_size[LIST_OBJ_TYPES] = {
+	sizeof(struct list),
+	sizeof(struct listNode),
+	sizeof(struct listIterator)
+};
+static void *list_free_batches[LIST_OBJ_TYPES] = { NULL };
 
 static pthread_mutex_t list_free_lock = PTHREAD_MUTEX_INITIALIZER;
 
+#ifndef MEMORY_LEAK_DEBUG
+static pthread_key_t list_cache_key;
+static pthread_once_t list_cache_once = PTHREAD_ONCE_INIT;
+#endif
+
 /***************
  *  Functions  *
  ***************/
@@ -861,7 +890,7 @@ list_node_destroy (List l, ListNode *pp)
 static List
 list_alloc (void)
 {
-	return(list_alloc_aux(sizeof(struct list), &list_free_lists));
+	return(list_alloc_aux(LIST_OBJ_LIST));
 }
 
 /* list_free()
@@ -869,7 +898,7 @@ list_alloc (void)
 static void
 list_free (List l)
 {
-	list_free_aux(l, &list_free_lists);
+	list_free_aux(l, LIST_OBJ_LIST);
 }
 
 /* list_node_alloc()
@@ -877,7 +906,7 @@ list_free (List l)
 static ListNode
 list_node_alloc (void)
 {
-	return(list_alloc_aux(sizeof(struct listNode), &list_free_nodes));
+	return(list_alloc_aux(LIST_OBJ_NODE));
 }
 
 /* list_node_free()
@@ -885,7 +914,7 @@ list_node_alloc (void)
 static void
 list_node_free (ListNode p)
 {
-	list_free_aux(p, &list_free_nodes);
+	list_free_aux(p, LIST_OBJ_NODE);
 }
 
 /* list_iterator_alloc()
@@ -893,7 +922,7 @@ list_node_free (ListNode p)
 static ListIterator
 list_iterator_alloc (void)
 {
-	return(list_alloc_aux(sizeof(struct listIterator), &list_free_iterators));
+	return(list_alloc_aux(LIST_OBJ_ITERATOR));
 }
 
 /* list_iterator_free()
@@ -901,67 +930,168 @@ list_iterator_alloc (void)
 static void
 list_iterator_free (ListIterator i)
 {
-	list_free_aux(i, &list_free_iterators);
+	list_free_aux(i, LIST_OBJ_ITERATOR);
+}
+
+#ifndef MEMORY_LEAK_DEBUG
+/* list_batch_push()
+ */
+static void
+list_batch_push (void **batch, int type)
+{
+/*  Returns the chain of free objects [batch] to the global free list.
+ */
+	slurm_mutex_lock(&list_free_lock);
+	batch[1] = list_free_batches[type];
+	list_free_batches[type] = batch;
+	slurm_mutex_unlock(&list_free_lock);
+}
+
+/* list_cache_destroy()
+ */
+static void
+list_cache_destroy (void *arg)
+{
+/*  Returns the objects cached by an exiting thread to the global free lists.
+ */
+	list_cache_t *cache = arg;
+	int type;
+
+	for (type = 0; type < LIST_OBJ_TYPES; type++) {
+		if (cache->free[type])
+			list_batch_push(cache->free[type], type);
+	}
+	xfree(cache);
+}
+
+static void
+list_cache_key_create (void)
+{
+	if (pthread_key_create(&list_cache_key, list_cache_destroy))
+		fatal("cannot create list cache key");
+}
+
+/* list_cache_get()
+ */
+static list_cache_t *
+list_cache_get (void)
+{
+/*  Returns the object cache of the calling thread, creating it if needed.
+ */
+	list_cache_t *cache;
+
+	pthread_once(&list_cache_once, list_cache_key_create);
+	if (!(cache = pthread_getspecific(list_cache_key))) {
+		cache = xmalloc(sizeof(list_cache_t));
+		if (pthread_setspecific(list_cache_key, cache))
+			fatal("cannot set list cache");
+	}
+	return cache;
+}
+
+/* list_cache_refill()
+ */
+static void
+list_cache_refill (list_cache_t *cache, int type)
+{
+/*  Fills the empty cache of [type] with a batch from the global free list,
+ *  or with a new chunk of LIST_ALLOC objects if there is none.
+ */
+	int size = list_obj_size[type];
+	void **batch, **px, **plast;
+	int count = 1;
+
+	slurm_mutex_lock(&list_free_lock);
+	if ((batch = list_free_batches[type]))
+		list_free_batches[type] = batch[1];
+	slurm_mutex_unlock(&list_free_lock);
+
+	if (batch) {
+		for (px = *batch; px; px = *px)
+			count++;
+	} else {
+		batch = xmalloc(LIST_ALLOC * size);
+		px = batch;
+		plast = (void **) ((char *) batch + ((LIST_ALLOC - 1) * size));
+		while (px < plast)
+			*px = (char *) px + size, px = *px;
+		*plast = NULL;
+		count = LIST_ALLOC;
+	}
+	cache->free[type] = batch;
+	cache->count[type] = count;
 }
 
+/* list_cache_drain()
+ */
+static void
+list_cache_drain (list_cache_t *cache, int type)
+{
+/*  Returns a batch of LIST_ALLOC objects from the cache of [type] to the
+ *  global free list.
+ */
+	void **batch = cache->free[type];
+	void **plast = batch;
+	int i;
+
+	for (i = 1; i < LIST_ALLOC; i++)
+		plast = *plast;
+	cache->free[type] = *plast;
+	cache->count[type] -= LIST_ALLOC;
+	*plast = NULL;
+
+	list_batch_push(batch, type);
+}
+#endif
+
 /* list_alloc_aux()
  */
 static void *
-list_alloc_aux (int size, void *pfreelist)
+list_alloc_aux (int type)
 {
-/*  Allocates an object of [size] bytes from the freelist [*pfreelist].
- *  Memory is added to the freelist in chunks of size LIST_ALLOC.
- *  Returns a ptr to the object, or NULL if the memory request fails.
+/*  Allocates an object of [type] from the calling thread's cache.
+ *  Memory is added to the global free lists in chunks of LIST_ALLOC objects.
+ *
+ *  When MEMORY_LEAK_DEBUG is set, each object is a separate xmalloc.
  */
+#ifdef MEMORY_LEAK_DEBUG
+	return xmalloc(list_obj_size[type]);
+#else
+	list_cache_t *cache = list_cache_get();
 	void **px;
-	void **pfree = pfreelist;
-	void **plast;
 
 	assert(sizeof(char) == 1);
-	assert(size >= sizeof(void *));
-	assert(pfreelist != NULL);
-	assert(LIST_ALLOC > 0);
-	slurm_mutex_lock(&list_free_lock);
+	assert(list_obj_size[type] >= 2 * sizeof(void *));
 
-	if (!*pfree) {
-		if ((*pfree = xmalloc(LIST_ALLOC * size))) {
-			px = *pfree;
-			plast = (void **) ((char *) *pfree + ((LIST_ALLOC - 1) * size));
-			while (px < plast)
-				*px = (char *) px + size, px = *px;
-			*plast = NULL;
-		}
-	}
-	if ((px = *pfree))
-		*pfree = *px;
-	else
-		errno = ENOMEM;
-	slurm_mutex_unlock(&list_free_lock);
+	if (!cache->free[type])
+		list_cache_refill(cache, type);
+	px = cache->free[type];
+	cache->free[type] = *px;
+	cache->count[type]--;
 
 	return px;
+#endif
 }
 
 /* list_free_aux()
  */
 static void
-list_free_aux (void *x, void *pfreelist)
+list_free_aux (void *x, int type)
 {
-/*  Frees the object [x], returning it to the freelist [*pfreelist].
+/*  Frees the object [x], returning it to the calling thread's cache.
  */
 #ifdef MEMORY_LEAK_DEBUG
 	xfree(x);
 #else
+	list_cache_t *cache = list_cache_get();
 	void **px = x;
-	void **pfree = pfreelist;
 
 	assert(x != NULL);
-	assert(pfreelist != NULL);
-	slurm_mutex_lock(&list_free_lock);
 
-	*px = *pfree;
-	*pfree = px;
-
-	slurm_mutex_unlock(&list_free_lock);
+	*px = cache->free[type];
+	cache->free[type] = px;
+	if (++cache->count[type] >= (2 * LIST_ALLOC))
+		list_cache_drain(cache, type);
 #endif
 }
 
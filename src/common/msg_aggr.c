@@ -53,19 +53,28 @@
 #include "src/common/xstring.h"
 #include "src/slurmd/slurmd/slurmd.h"
 
+/* Shortest collection window in milliseconds */
+#define MSG_AGGR_WINDOW_MIN	1
+/* Collect for this many times the composite send time, so that the
+ * sender is blocked sending for at most 1/(factor + 1) of the time */
+#define MSG_AGGR_SEND_FACTOR	4
+
 typedef struct {
 	pthread_mutex_t	aggr_mutex;
 	pthread_cond_t	cond;
 	uint32_t        debug_flags;
 	bool		max_msgs;
 	uint64_t        max_msg_cnt;
+	uint64_t        max_window;
 	List            msg_aggr_list;
+	uint64_t        msg_interval;	/* usec between msgs, averaged */
 	List            msg_list;
 	pthread_mutex_t	mutex;
 	slurm_addr_t    node_addr;
 	bool            running;
+	uint64_t        send_usec;	/* usec to send composite, averaged */
 	pthread_t       thread_id;
-	uint64_t        window;
+	uint64_t        window;		/* current window in msec */
 } msg_collection_type_t;
 
 typedef struct {
@@ -184,6 +193,61 @@ static int _send_to_next_collector(slurm_msg_t *msg)
 	return rc;
 }
 
+static uint64_t _usec_diff(struct timeval *end, struct timeval *start)
+{
+	return ((end->tv_sec - start->tv_sec) * 1000000) +
+		end->tv_usec - start->tv_usec;
+}
+
+/*
+ * Adjust the collection window after sending a composite msg of msg_cnt
+ * msgs collected over collect_usec that took send_usec to send.
+ *
+ * The window tracks the time needed to send to the next collector, which
+ * grows with the load on the collector or slurmctld, so a busy receiver
+ * gets fewer and larger composite msgs. If msgs arrive too slowly for
+ * another one to be expected within that window, waiting would only delay
+ * them, so the shortest window is used. The configured window is the
+ * upper bound.
+ */
+static void _update_window(uint32_t msg_cnt, uint64_t collect_usec,
+			   uint64_t send_usec)
+{
+	uint64_t interval, window;
+
+	if (!msg_cnt)
+		return;
+	/* An idle period says no more than a gap of the longest window */
+	interval = MIN(collect_usec / msg_cnt,
+		       msg_collection.max_window * 1000);
+
+	/* Running averages, weighting the newest sample by 1/4 */
+	if (!msg_collection.send_usec) {
+		msg_collection.msg_interval = interval;
+		msg_collection.send_usec = send_usec;
+	} else {
+		msg_collection.msg_interval =
+			((msg_collection.msg_interval * 3) + interval) / 4;
+		msg_collection.send_usec =
+			((msg_collection.send_usec * 3) + send_usec) / 4;
+	}
+
+	window = msg_collection.send_usec * MSG_AGGR_SEND_FACTOR;
+	if (window < msg_collection.msg_interval)
+		window = MSG_AGGR_WINDOW_MIN;
+	else
+		window = MAX(window / 1000, MSG_AGGR_WINDOW_MIN);
+	window = MIN(window, msg_collection.max_window);
+
+	if ((window != msg_collection.window) &&
+	    (msg_collection.debug_flags & DEBUG_FLAG_ROUTE)) {
+		info("msg aggr: window %"PRIu64" ms (msg interval %"PRIu64
+		     " usec, send time %"PRIu64" usec)", window,
+		     msg_collection.msg_interval, msg_collection.send_usec);
+	}
+	msg_collection.window = window;
+}
+
 /*
  * _msg_aggregation_sender()
  *
@@ -193,14 +257,16 @@ static int _send_to_next_collector(slurm_msg_t *msg)
  */
 static void * _msg_aggregation_sender(void *arg)
 {
-	struct timeval now;
+	struct timeval now, last_send, sent;
 	struct timespec timeout;
 	slurm_msg_t msg;
 	composite_msg_t cmp;
+	uint32_t msg_cnt;
 
 	msg_collection.running = 1;
 
 	slurm_mutex_lock(&msg_collection.mutex);
+	gettimeofday(&last_send, NULL);
 
 	while (msg_collection.running) {
 		/* Wait for a new msg to be collected */
@@ -236,6 +302,7 @@ static void * _msg_aggregation_sender(void *arg)
 		memcpy(&cmp.sender, &msg_collection.node_addr,
 		       sizeof(slurm_addr_t));
 		cmp.msg_list = msg_collection.msg_list;
+		msg_cnt = list_count(cmp.msg_list);
 
 		msg_collection.msg_list =
 			list_create(slurm_free_comp_msg_list);
@@ -245,12 +312,18 @@ static void * _msg_aggregation_sender(void *arg)
 		msg.msg_type = MESSAGE_COMPOSITE;
 		msg.protocol_version = SLURM_PROTOCOL_VERSION;
 		msg.data = &cmp;
+		gettimeofday(&now, NULL);
 		if (_send_to_next_collector(&msg) != SLURM_SUCCESS) {
 			error("_msg_aggregation_engine: Unable to send "
 			      "composite msg: %m");
 		}
 		FREE_NULL_LIST(cmp.msg_list);
 
+		gettimeofday(&sent, NULL);
+		_update_window(msg_cnt, _usec_diff(&now, &last_send),
+			       _usec_diff(&sent, &now));
+		last_send = sent;
+
 		/* Resume message collection */
 		slurm_cond_broadcast(&msg_collection.cond);
 	}
@@ -277,7 +350,8 @@ extern void msg_aggr_sender_init(char *host, uint16_t port, uint64_t window,
 	slurm_mutex_lock(&msg_collection.aggr_mutex);
 	slurm_cond_init(&msg_collection.cond, NULL);
 	slurm_set_addr(&msg_collection.node_addr, port, host);
-	msg_collection.window = window;
+	msg_collection.max_window = MAX(window, MSG_AGGR_WINDOW_MIN);
+	msg_collection.window = msg_collection.max_window;
 	msg_collection.max_msg_cnt = max_msg_cnt;
 	msg_collection.msg_aggr_list = list_create(_msg_aggr_free);
 	msg_collection.msg_list = list_create(slurm_free_comp_msg_list);
@@ -303,7 +377,9 @@ extern void msg_aggr_sender_reconfig(uint64_t window, uint64_t max_msg_cnt)
 {
 	if (msg_collection.running) {
 		slurm_mutex_lock(&msg_collection.mutex);
-		msg_collection.window = window;
+		msg_collection.max_window = MAX(window, MSG_AGGR_WINDOW_MIN);
+		msg_collection.window = MIN(msg_collection.window,
+					    msg_collection.max_window);
 		msg_collection.max_msg_cnt = max_msg_cnt;
 		msg_collection.debug_flags = slurm_get_debug_flags();
 		slurm_mutex_unlock(&msg_collection.mutex);
@@ -83,6 +83,24 @@ int node_record_count = 0;		/* count in node_record_table_ptr */
 uint16_t *cr_node_num_cores = NULL;
 uint32_t *cr_node_cores_offset = NULL;
 
+/* Runs of node records whose names share a prefix and have consecutive
+ * numeric suffixes of the same length, sorted by prefix, suffix length
+ * and suffix, used to convert ranges of node names into bitmaps without
+ * building and looking up each name */
+typedef struct {
+	char *prefix;		/* node name up to the numeric suffix */
+	int len;		/* characters in the numeric suffix */
+	unsigned long lo, hi;	/* numeric suffixes of first and last node */
+	int inx;		/* node_record_table_ptr offset of first node */
+} node_range_t;
+
+#define NODE_RANGE_MAX_LEN 9	/* longest numeric suffix indexed */
+
+static node_range_t *node_range_table = NULL;
+static int node_range_count = 0;
+static struct node_record *node_range_table_base = NULL;
+static int node_range_record_count = 0;
+
 /* Local function defiitions */
 static int	_build_single_nodeline_info(slurm_conf_node_t *node_ptr,
 					    struct config_record *config_ptr);
@@ -96,6 +114,7 @@ static struct node_record *
 		_find_node_record (char *name,bool test_alias,bool log_missing);
 static void	_list_delete_config (void *config_entry);
 static int	_list_find_config (void *config_entry, void *key);
+static void	_node_range_free (void);
 
 /*
  * _build_single_nodeline_info - From the slurm.conf reader, build table,
@@ -828,6 +847,7 @@ extern int init_node_conf (void)
 	node_record_count = 0;
 	xfree(node_record_table_ptr);
 	xhash_free(node_hash_table);
+	_node_range_free();
 
 	if (config_list)	/* delete defunct configuration entries */
 		(void) _delete_config_record ();
@@ -852,6 +872,7 @@ extern void node_fini2 (void)
 	}
 
 	xhash_free(node_hash_table);
+	_node_range_free();
 	node_ptr = node_record_table_ptr;
 	for (i = 0; i < node_record_count; i++, node_ptr++)
 		purge_node_rec(node_ptr);
@@ -861,6 +882,195 @@ extern void node_fini2 (void)
 }
 
 
+static void _node_range_free (void)
+{
+	int i;
+
+	for (i = 0; i < node_range_count; i++)
+		xfree(node_range_table[i].prefix);
+	xfree(node_range_table);
+	node_range_count = 0;
+	node_range_table_base = NULL;
+	node_range_record_count = 0;
+}
+
+static int _node_range_cmp (const void *x, const void *y)
+{
+	const node_range_t *r1 = (const node_range_t *) x;
+	const node_range_t *r2 = (const node_range_t *) y;
+	int rc;
+
+	if ((rc = xstrcmp(r1->prefix, r2->prefix)))
+		return rc;
+	if (r1->len != r2->len)
+		return (r1->len - r2->len);
+	return (r1->lo < r2->lo) ? -1 : 1;
+}
+
+/* Build node_range_table from node_record_table_ptr */
+static void _node_range_build (void)
+{
+	struct node_record *node_ptr = node_record_table_ptr;
+	node_range_t *range = NULL;
+	char *suffix;
+	unsigned long num;
+	int i, len, prefix_len;
+
+	_node_range_free();
+	if (slurmdb_setup_cluster_name_dims() > 1)
+		return;		/* suffixes are coordinates, not numbers */
+
+	for (i = 0; i < node_record_count; i++, node_ptr++) {
+		if ((node_ptr->name == NULL) || (node_ptr->name[0] == '\0'))
+			continue;	/* vestigial record */
+		suffix = node_ptr->name + strlen(node_ptr->name);
+		while ((suffix > node_ptr->name) && isdigit((int) suffix[-1]))
+			suffix--;
+		prefix_len = suffix - node_ptr->name;
+		len = strlen(suffix);
+		if (!prefix_len || !len || (len > NODE_RANGE_MAX_LEN))
+			continue;
+		num = strtoul(suffix, NULL, 10);
+
+		if (range && (range->len == len) && (range->hi + 1 == num) &&
+		    (range->inx + (num - range->lo) == i) &&
+		    !strncmp(range->prefix, node_ptr->name, prefix_len) &&
+		    (range->prefix[prefix_len] == '\0')) {
+			range->hi = num;
+			continue;
+		}
+
+		if (!(node_range_count % 64)) {
+			xrealloc(node_range_table, sizeof(node_range_t) *
+				 (node_range_count + 64));
+		}
+		range = &node_range_table[node_range_count++];
+		range->prefix = xstrndup(node_ptr->name, prefix_len);
+		range->len = len;
+		range->lo = range->hi = num;
+		range->inx = i;
+	}
+
+	qsort(node_range_table, node_range_count, sizeof(node_range_t),
+	      _node_range_cmp);
+	node_range_table_base = node_record_table_ptr;
+	node_range_record_count = node_record_count;
+}
+
+/*
+ * Set the bits of the nodes named prefix followed by the numbers lo
+ * through hi zero padded to width in bitmap, using node_range_table.
+ * RET the count of nodes found
+ */
+static unsigned long _node_range_set (const char *prefix, unsigned long lo,
+				      unsigned long hi, int width,
+				      bitstr_t *bitmap)
+{
+	node_range_t *range;
+	unsigned long a, b, cnt = 0, min = 0, max = 9;
+	int len, first, last, mid;
+
+	if (!node_range_count || !node_hash_table ||
+	    (node_range_table_base != node_record_table_ptr) ||
+	    (node_range_record_count != node_record_count))
+		return 0;
+
+	/* A number printed with a given width is as long as the larger of
+	 * the width and its digits, so only index entries with suffixes at
+	 * least width long can match and, for longer suffixes, only numbers
+	 * without leading zeros */
+	for (len = 1; len <= NODE_RANGE_MAX_LEN;
+	     len++, min = max + 1, max = (max * 10) + 9) {
+		if (len < width)
+			continue;
+		a = (len == width) ? lo : MAX(lo, min);
+		b = MIN(hi, max);
+		if (a > b)
+			continue;
+
+		/* first range with this prefix and length ending at or
+		 * after a */
+		first = 0;
+		last = node_range_count;
+		while (first < last) {
+			int rc;
+			mid = (first + last) / 2;
+			range = &node_range_table[mid];
+			if (!(rc = xstrcmp(range->prefix, prefix)))
+				rc = range->len - len;
+			if ((rc < 0) || ((rc == 0) && (range->hi < a)))
+				first = mid + 1;
+			else
+				last = mid;
+		}
+
+		for (range = &node_range_table[first];
+		     range < &node_range_table[node_range_count]; range++) {
+			unsigned long start, end;
+			if ((range->len != len) || (range->lo > b) ||
+			    xstrcmp(range->prefix, prefix))
+				break;
+			start = MAX(a, range->lo);
+			end = MIN(b, range->hi);
+			bit_nset(bitmap, range->inx + (start - range->lo),
+				 range->inx + (end - range->lo));
+			cnt += end - start + 1;
+		}
+	}
+
+	return cnt;
+}
+
+typedef struct {
+	bool best_effort;
+	bitstr_t *bitmap;
+	const char *caller;
+	int rc;
+} range2bitmap_args_t;
+
+static void _name2bitmap (char *name, range2bitmap_args_t *args)
+{
+	struct node_record *node_ptr;
+
+	node_ptr = _find_node_record(name, args->best_effort, true);
+	if (node_ptr) {
+		bit_set(args->bitmap, (bitoff_t) (node_ptr -
+						  node_record_table_ptr));
+	} else {
+		error("%s: invalid node specified %s", args->caller, name);
+		if (!args->best_effort)
+			args->rc = EINVAL;
+	}
+}
+
+/* hostlist_for_each_range() function to set the bits of a range of nodes,
+ * looking up each node name only if they are not all in node_range_table */
+static int _range2bitmap (const char *prefix, unsigned long lo,
+			  unsigned long hi, int width, void *arg)
+{
+	range2bitmap_args_t *args = (range2bitmap_args_t *) arg;
+	char *name = NULL;
+	unsigned long num;
+
+	if (width < 0) {
+		name = xstrdup(prefix);
+		_name2bitmap(name, args);
+		xfree(name);
+		return 0;
+	}
+
+	if (_node_range_set(prefix, lo, hi, width, args->bitmap) ==
+	    (hi - lo + 1))
+		return 0;
+
+	for (num = lo; num <= hi; num++) {
+		xstrfmtcat(name, "%s%0*lu", prefix, width, num);
+		_name2bitmap(name, args);
+		xfree(name);
+	}
+	return 0;
+}
+
 /*
  * node_name2bitmap - given a node name regular expression, build a bitmap
  *	representation
@@ -894,19 +1104,31 @@ extern int node_name2bitmap (char *node_names, bool best_effort,
 		return rc;
 	}
 
-	while ( (this_node_name = hostlist_shift (host_list)) ) {
-		struct node_record *node_ptr;
-		node_ptr = _find_node_record(this_node_name, best_effort, true);
-		if (node_ptr) {
-			bit_set (my_bitmap, (bitoff_t) (node_ptr -
-							node_record_table_ptr));
-		} else {
-			error ("node_name2bitmap: invalid node specified %s",
-			       this_node_name);
-			if (!best_effort)
-				rc = EINVAL;
+	if (slurmdb_setup_cluster_name_dims() > 1) {
+		while ( (this_node_name = hostlist_shift (host_list)) ) {
+			struct node_record *node_ptr;
+			node_ptr = _find_node_record(this_node_name,
+						     best_effort, true);
+			if (node_ptr) {
+				bit_set (my_bitmap, (bitoff_t) (node_ptr -
+						node_record_table_ptr));
+			} else {
+				error ("node_name2bitmap: invalid node "
+				       "specified %s", this_node_name);
+				if (!best_effort)
+					rc = EINVAL;
+			}
+			free (this_node_name);
 		}
-		free (this_node_name);
+	} else {
+		range2bitmap_args_t args;
+
+		args.best_effort = best_effort;
+		args.bitmap = my_bitmap;
+		args.caller = "node_name2bitmap";
+		args.rc = rc;
+		(void) hostlist_for_each_range(host_list, _range2bitmap, &args);
+		rc = args.rc;
 	}
 	hostlist_destroy (host_list);
 
@@ -931,6 +1153,17 @@ extern int hostlist2bitmap (hostlist_t hl, bool best_effort, bitstr_t **bitmap)
 	my_bitmap = (bitstr_t *) bit_alloc (node_record_count);
 	*bitmap = my_bitmap;
 
+	if (slurmdb_setup_cluster_name_dims() == 1) {
+		range2bitmap_args_t args;
+
+		args.best_effort = best_effort;
+		args.bitmap = my_bitmap;
+		args.caller = "hostlist2bitmap";
+		args.rc = rc;
+		(void) hostlist_for_each_range(hl, _range2bitmap, &args);
+		return args.rc;
+	}
+
 	hi = hostlist_iterator_create(hl);
 	while ((name = hostlist_next(hi)) != NULL) {
 		struct node_record *node_ptr;
@@ -979,7 +1212,8 @@ extern void purge_node_rec (struct node_record *node_ptr)
 }
 
 /*
- * rehash_node - build a hash table of the node_record entries.
+ * rehash_node - build a hash table of the node_record entries and the
+ *	index of their numeric name ranges.
  * NOTE: using xhash implementation
  */
 extern void rehash_node (void)
@@ -996,6 +1230,7 @@ extern void rehash_node (void)
 			continue;	/* vestigial record */
 		xhash_add(node_hash_table, node_ptr);
 	}
+	_node_range_build();
 
 #if _DEBUG
 	_dump_hash();
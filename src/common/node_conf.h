@@ -310,7 +310,9 @@ extern int node_name2bitmap (char *node_names, bool best_effort,
 extern void purge_node_rec (struct node_record *node_ptr);
 
 /*
- * rehash_node - build a hash table of the node_record entries.
+ * rehash_node - build a hash table of the node_record entries and an
+ *	index of their names' numeric ranges used by node_name2bitmap() and
+ *	hostlist2bitmap()
  * NOTE: manages memory for node_hash_table
  */
 extern void rehash_node (void);
@@ -72,6 +72,7 @@ const char *node_select_syms[] = {
 	"select_p_node_init",
 	"select_p_block_init",
 	"select_p_job_test",
+	"select_p_job_list_test",
 	"select_p_job_begin",
 	"select_p_job_ready",
 	"select_p_job_expand_allow",
@@ -591,6 +592,19 @@ extern int select_g_job_test(struct job_record *job_ptr, bitstr_t *bitmap,
 		 exc_core_bitmap);
 }
 
+/*
+ * Determine when and where each of several pending jobs can start
+ * IN/OUT req_list - list of select_will_run_t records
+ * RET SLURM_SUCCESS or error code
+ */
+extern int select_g_job_list_test(List req_list)
+{
+	if (slurm_select_init(0) < 0)
+		return SLURM_ERROR;
+
+	return (*(ops[select_context_default].job_list_test))(req_list);
+}
+
 /*
  * Note initiation of job is about to begin. Called immediately
  * after select_g_job_test(). Executed from slurmctld.
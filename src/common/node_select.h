@@ -54,6 +54,7 @@ typedef struct {
 	bitstr_t *avail_nodes;      /* usable nodes are set on input, nodes
 				     * not required to satisfy the request
 				     * are cleared, other left set */
+	bitstr_t *exc_core_bitmap;  /* cores reserved and not usable */
 	struct job_record *job_ptr; /* pointer to job being scheduled
 				     * start_time is set when we can
 				     * possibly start job. Or must not
@@ -62,6 +63,7 @@ typedef struct {
 				     */
 	uint32_t max_nodes;         /* maximum count of nodes (0==don't care) */
 	uint32_t min_nodes;         /* minimum count of nodes */
+	int rc;                     /* result of the test, set on output */
 	uint32_t req_nodes;         /* requested (or desired) count of nodes */
 } select_will_run_t;
 
@@ -144,6 +146,7 @@ typedef struct slurm_select_ops {
 						 List preeemptee_candidates,
 						 List *preemptee_job_list,
 						 bitstr_t *exc_core_bitmap);
+	int		(*job_list_test)	(List req_list);
 	int		(*job_begin)		(struct job_record *job_ptr);
 	int		(*job_ready)		(struct job_record *job_ptr);
 	bool		(*job_expand_allow)	(void);
@@ -575,6 +578,20 @@ extern int select_g_job_test(struct job_record *job_ptr, bitstr_t *bitmap,
 			     List *preemptee_job_list,
 			     bitstr_t *exc_core_bitmap);
 
+/*
+ * Determine when and where each of several pending jobs can start, as
+ * select_g_job_test() with SELECT_MODE_WILL_RUN and no preemptee candidates
+ * would for each of them. Plugins may share the simulated termination of
+ * running jobs between all of the jobs, so this is much faster than testing
+ * the jobs one at a time.
+ * IN/OUT req_list - list of select_will_run_t records. On output, the rc
+ *	of each record is set to the result of its test, its avail_nodes
+ *	to the nodes to be allocated and its job's start_time is set as by
+ *	select_g_job_test()
+ * RET SLURM_SUCCESS or error code
+ */
+extern int select_g_job_list_test(List req_list);
+
 /*
  * Note initiation of job is about to begin. Called immediately
  * after select_g_job_test(). Executed from slurmctld.
@@ -51,7 +51,9 @@
 #include "src/common/log.h"
 #include "src/common/macros.h"
 #include "src/common/pack.h"
+#include "src/common/xhash.h"
 #include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
 
 /*
  * Define slurm-specific aliases for use by plugins, see slurm_xlator.h
@@ -89,6 +91,46 @@ strong_alias(packstr_array,	slurm_packstr_array);
 strong_alias(unpackstr_array,	slurm_unpackstr_array);
 strong_alias(packmem_array,	slurm_packmem_array);
 strong_alias(unpackmem_array,	slurm_unpackmem_array);
+strong_alias(packstr_dict,	slurm_packstr_dict);
+strong_alias(unpackstr_dict_xmalloc,	slurm_unpackstr_dict_xmalloc);
+
+/* Strings of a buffer packed with packstr_dict(). The first occurrence of a
+ * string is packed as by packstr() and later ones as its index here. */
+struct pack_str_dict {
+	xhash_t *index;		/* packing: str_dict_ent_t of each string */
+	uint32_t count;		/* strings in the dictionary */
+	uint32_t alloc;		/* unpacking: size of offset and size arrays */
+	uint32_t *offset;	/* unpacking: buffer offset of each string */
+	uint32_t *size;		/* unpacking: size of each string */
+};
+
+typedef struct {
+	char *str;
+	uint32_t inx;
+} str_dict_ent_t;
+
+static const char *_str_dict_ent_id(void *item)
+{
+	return ((str_dict_ent_t *) item)->str;
+}
+
+static void _str_dict_ent_free(void *item)
+{
+	str_dict_ent_t *ent = (str_dict_ent_t *) item;
+
+	xfree(ent->str);
+	xfree(ent);
+}
+
+static void _str_dict_free(struct pack_str_dict *dict)
+{
+	if (!dict)
+		return;
+	xhash_free_ptr(&dict->index);
+	xfree(dict->offset);
+	xfree(dict->size);
+	xfree(dict);
+}
 
 /* Basic buffer management routines */
 /* create_buf - create a buffer with the supplied contents, contents must
@@ -108,6 +150,8 @@ Buf create_buf(char *data, uint32_t size)
 	my_buf->size = size;
 	my_buf->processed = 0;
 	my_buf->head = data;
+	my_buf->arena = NULL;
+	my_buf->str_dict = NULL;
 
 	return my_buf;
 }
@@ -119,6 +163,7 @@ void free_buf(Buf my_buf)
 		return;
 	assert(my_buf->magic == BUF_MAGIC);
 	xfree(my_buf->head);
+	_str_dict_free(my_buf->str_dict);
 	xfree(my_buf);
 }
 
@@ -152,6 +197,8 @@ Buf init_buf(uint32_t size)
 	my_buf->size = size;
 	my_buf->processed = 0;
 	my_buf->head = xmalloc(sizeof(char)*size);
+	my_buf->arena = NULL;
+	my_buf->str_dict = NULL;
 	return my_buf;
 }
 
@@ -163,10 +210,20 @@ void *xfer_buf_data(Buf my_buf)
 
 	assert(my_buf->magic == BUF_MAGIC);
 	data_ptr = (void *) my_buf->head;
+	_str_dict_free(my_buf->str_dict);
 	xfree(my_buf);
 	return data_ptr;
 }
 
+/* Allocate memory for data unpacked from a buffer, from the buffer's arena
+ * if it has one. Either way the memory is released with xfree(). */
+static inline void *_unpack_alloc(Buf buffer, size_t size)
+{
+	if (buffer->arena)
+		return xarena_alloc(buffer->arena, size);
+	return xmalloc_nz(size);
+}
+
 /*
  * Given a time_t in host byte order, promote it to int64_t, convert to
  * network byte order, store in buffer and adjust buffer acc'd'ngly
@@ -394,7 +451,7 @@ int unpack16_array(uint16_t ** valp, uint32_t * size_val, Buf buffer)
 	if (unpack32(size_val, buffer))
 		return SLURM_ERROR;
 
-	*valp = xmalloc_nz((*size_val) * sizeof(uint16_t));
+	*valp = _unpack_alloc(buffer, (*size_val) * sizeof(uint16_t));
 	for (i = 0; i < *size_val; i++) {
 		if (unpack16((*valp) + i, buffer))
 			return SLURM_ERROR;
@@ -423,7 +480,7 @@ int unpack32_array(uint32_t ** valp, uint32_t * size_val, Buf buffer)
 	if (unpack32(size_val, buffer))
 		return SLURM_ERROR;
 
-	*valp = xmalloc_nz((*size_val) * sizeof(uint32_t));
+	*valp = _unpack_alloc(buffer, (*size_val) * sizeof(uint32_t));
 	for (i = 0; i < *size_val; i++) {
 		if (unpack32((*valp) + i, buffer))
 			return SLURM_ERROR;
@@ -465,7 +522,7 @@ int unpack64_array(uint64_t ** valp, uint32_t * size_val, Buf buffer)
 	if (unpack32(size_val, buffer))
 		return SLURM_ERROR;
 
-	*valp = xmalloc_nz((*size_val) * sizeof(uint64_t));
+	*valp = _unpack_alloc(buffer, (*size_val) * sizeof(uint64_t));
 	for (i = 0; i < *size_val; i++) {
 		if (unpack64((*valp) + i, buffer))
 			return SLURM_ERROR;
@@ -482,7 +539,7 @@ int unpack64_array_from_32(uint64_t ** valp, uint32_t * size_val, Buf buffer)
 	if (unpack32(size_val, buffer))
 		return SLURM_ERROR;
 
-	*valp = xmalloc_nz((*size_val) * sizeof(uint64_t));
+	*valp = _unpack_alloc(buffer, (*size_val) * sizeof(uint64_t));
 	for (i = 0; i < *size_val; i++) {
 		if (unpack32(&val32, buffer))
 			return SLURM_ERROR;
@@ -509,7 +566,7 @@ int unpackdouble_array(double **valp, uint32_t* size_val, Buf buffer)
 	if (unpack32(size_val, buffer))
 		return SLURM_ERROR;
 
-	*valp = xmalloc_nz((*size_val) * sizeof(double));
+	*valp = _unpack_alloc(buffer, (*size_val) * sizeof(double));
 	for (i = 0; i < *size_val; i++) {
 		if (unpackdouble((*valp) + i, buffer))
 			return SLURM_ERROR;
@@ -535,7 +592,7 @@ int unpacklongdouble_array(long double **valp, uint32_t* size_val, Buf buffer)
 	if (unpack32(size_val, buffer))
 		return SLURM_ERROR;
 
-	*valp = xmalloc_nz((*size_val) * sizeof(long double));
+	*valp = _unpack_alloc(buffer, (*size_val) * sizeof(long double));
 	for (i = 0; i < *size_val; i++) {
 		if (unpacklongdouble((*valp) + i, buffer))
 			return SLURM_ERROR;
@@ -752,7 +809,7 @@ int unpackmem_xmalloc(char **valp, uint32_t * size_valp, Buf buffer)
 	else if (*size_valp > 0) {
 		if (remaining_buf(buffer) < *size_valp)
 			return SLURM_ERROR;
-		*valp = xmalloc_nz(*size_valp);
+		*valp = _unpack_alloc(buffer, *size_valp);
 		memcpy(*valp, &buffer->head[buffer->processed],
 		       *size_valp);
 		buffer->processed += *size_valp;
@@ -761,6 +818,92 @@ int unpackmem_xmalloc(char **valp, uint32_t * size_valp, Buf buffer)
 	return SLURM_SUCCESS;
 }
 
+/*
+ * Given a string, store it in the buffer as packstr() does the first time it
+ * is packed into this buffer, and as a 32-bit reference to that copy after
+ * that. For the many strings repeated across the records of a response
+ * (features, gres, os, etc.). Must be unpacked by unpackstr_dict_xmalloc()
+ * from a buffer holding everything packed into this one in the same order.
+ */
+void packstr_dict(char *valp, Buf buffer)
+{
+	struct pack_str_dict *dict = buffer->str_dict;
+	str_dict_ent_t *ent;
+
+	if (!valp) {
+		packmem(NULL, 0, buffer);
+		return;
+	}
+
+	if (!dict) {
+		dict = buffer->str_dict = xmalloc(sizeof(struct pack_str_dict));
+		dict->index = xhash_init(_str_dict_ent_id, _str_dict_ent_free,
+					 NULL, 0);
+	}
+	if ((ent = xhash_get(dict->index, valp))) {
+		pack32(PACK_STR_DICT_REF | ent->inx, buffer);
+		return;
+	}
+
+	if (dict->count < PACK_STR_DICT_REF) {
+		ent = xmalloc(sizeof(str_dict_ent_t));
+		ent->str = xstrdup(valp);
+		ent->inx = dict->count++;
+		xhash_add(dict->index, ent);
+	}
+	packstr(valp, buffer);
+}
+
+/*
+ * Given a buffer containing a string packed by packstr_dict(), copy the
+ * string or the earlier string it refers to into the location specified by
+ * valp. Also return the sizes of 'valp' in bytes. Adjust buffer counters.
+ * NOTE: valp is set to point into a newly created buffer,
+ *	the caller is responsible for calling xfree() on *valp
+ *	if non-NULL (set to NULL on zero size buffer value)
+ */
+int unpackstr_dict_xmalloc(char **valp, uint32_t *size_valp, Buf buffer)
+{
+	struct pack_str_dict *dict = buffer->str_dict;
+	uint32_t ns, inx, offset;
+
+	if (remaining_buf(buffer) < sizeof(ns))
+		return SLURM_ERROR;
+
+	memcpy(&ns, &buffer->head[buffer->processed], sizeof(ns));
+	ns = ntohl(ns);
+	if (ns & PACK_STR_DICT_REF) {
+		inx = ns & ~PACK_STR_DICT_REF;
+		if (!dict || (inx >= dict->count)) {
+			error("%s: Invalid string reference (%u)",
+			      __func__, inx);
+			return SLURM_ERROR;
+		}
+		buffer->processed += sizeof(ns);
+		*size_valp = dict->size[inx];
+		*valp = _unpack_alloc(buffer, *size_valp);
+		memcpy(*valp, &buffer->head[dict->offset[inx]], *size_valp);
+		return SLURM_SUCCESS;
+	}
+
+	offset = buffer->processed + sizeof(ns);
+	if (unpackmem_xmalloc(valp, size_valp, buffer))
+		return SLURM_ERROR;
+	if (*size_valp == 0)
+		return SLURM_SUCCESS;
+
+	if (!dict)
+		dict = buffer->str_dict = xmalloc(sizeof(struct pack_str_dict));
+	if (dict->count >= dict->alloc) {
+		dict->alloc = MAX(dict->alloc * 2, 64);
+		xrealloc_nz(dict->offset, sizeof(uint32_t) * dict->alloc);
+		xrealloc_nz(dict->size, sizeof(uint32_t) * dict->alloc);
+	}
+	dict->offset[dict->count] = offset;
+	dict->size[dict->count++] = *size_valp;
+	return SLURM_SUCCESS;
+}
+
 /*
  * Given a buffer containing a network byte order 16-bit integer,
  * and an arbitrary data string, copy the data string into the location
@@ -858,7 +1001,8 @@ int unpackstr_array(char ***valp, uint32_t * size_valp, Buf buffer)
 		return SLURM_ERROR;
 	}
 	else if (*size_valp > 0) {
-		*valp = xmalloc_nz(sizeof(char *) * (*size_valp + 1));
+		*valp = _unpack_alloc(buffer,
+				      sizeof(char *) * (*size_valp + 1));
 		for (i = 0; i < *size_valp; i++) {
 			if (unpackmem_xmalloc(&(*valp)[i], &uint32_tmp, buffer))
 				return SLURM_ERROR;
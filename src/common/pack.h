@@ -47,6 +47,7 @@
 #include <string.h>
 
 #include "src/common/bitstring.h"
+#include "src/common/xmalloc.h"
 
 #define BUF_MAGIC 0x42554545
 #define BUF_SIZE (16 * 1024)
@@ -58,11 +59,21 @@
 #define MAX_PACK_ARRAY_LEN	(128 * 1024)
 #define MAX_PACK_MEM_LEN	(1024 * 1024 * 1024)
 
+/* Flag marking a string packed by packstr_dict() as a reference to an earlier
+ * string of the buffer. Can never be set in a valid packmem() length. */
+#define PACK_STR_DICT_REF	0x80000000
+
+struct pack_str_dict;
+
 struct slurm_buf {
 	uint32_t magic;
 	char *head;
 	uint32_t size;
 	uint32_t processed;
+	xarena_t *arena;	/* strings and arrays are unpacked into this
+				 * arena if set, see xarena_create() */
+	struct pack_str_dict *str_dict;	/* strings packed or unpacked by
+					 * packstr_dict(), created on use */
 };
 
 typedef struct slurm_buf * Buf;
@@ -125,6 +136,9 @@ int	unpackmem_ptr(char **valp, uint32_t *size_valp, Buf buffer);
 int	unpackmem_xmalloc(char **valp, uint32_t *size_valp, Buf buffer);
 int	unpackmem_malloc(char **valp, uint32_t *size_valp, Buf buffer);
 
+void	packstr_dict(char *valp, Buf buffer);
+int	unpackstr_dict_xmalloc(char **valp, uint32_t *size_valp, Buf buffer);
+
 void	packstr_array(char **valp, uint32_t size_val, Buf buffer);
 int	unpackstr_array(char ***valp, uint32_t* size_val, Buf buffer);
 
@@ -243,6 +257,13 @@ int	unpackmem_array(char *valp, uint32_t size_valp, Buf buffer);
 		goto unpack_error;			\
 } while (0)
 
+#define safe_unpackstr_dict_xmalloc(valp,size_valp,buf) do {	\
+	assert(sizeof(*size_valp) == sizeof(uint32_t));	\
+	assert(buf->magic == BUF_MAGIC);			\
+	if (unpackstr_dict_xmalloc(valp,size_valp,buf))		\
+		goto unpack_error;				\
+} while (0)
+
 #define safe_unpackmem_malloc(valp,size_valp,buf) do {	\
 	assert(sizeof(*size_valp) == sizeof(uint32_t)); \
 	assert(buf->magic == BUF_MAGIC);		\
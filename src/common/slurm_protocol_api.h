@@ -1015,6 +1015,20 @@ int slurm_receive_msg(int fd, slurm_msg_t *msg, int timeout);
  */
 List slurm_receive_msgs(int fd, int steps, int timeout);
 
+/*
+ *  Unpack a complete message received on "fd" into a list of the
+ *    responses it carries, the message itself plus those of the nodes
+ *    it was forwarded to. "buffer" is freed. For callers which read the
+ *    message from a non-blocking socket themselves.
+ *
+ * IN fd	- file descriptor the message came from
+ * IN buffer	- the message, without the length which preceded it
+ * RET List	- List containing type (ret_data_info_t), errno is set
+ *		  to the result of unpacking the message itself. NULL is
+ *		  returned if nothing could be unpacked.
+ */
+extern List slurm_unpack_received_msgs(int fd, Buf buffer);
+
 /*
  *  Receive a slurm message on the open slurm descriptor "fd" waiting
  *    at most "timeout" seconds for the message data. This will also
@@ -1047,6 +1061,15 @@ int slurm_receive_msg_and_forward(int fd, slurm_addr_t *orig_addr,
  */
 int slurm_send_node_msg(int open_fd, slurm_msg_t *msg);
 
+/* packs a message with a new credential for the caller to send itself,
+ *	preceded by its length in network byte order
+ *
+ * IN msg		- a slurm msg struct to be sent
+ * RET Buf		- packed message to be freed with free_buf(),
+ *			  NULL on failure with errno set
+ */
+extern Buf slurm_pack_node_msg(slurm_msg_t *msg);
+
 /**********************************************************************\
  * msg connection establishment functions used by msg clients
 \**********************************************************************/
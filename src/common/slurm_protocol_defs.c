@@ -696,6 +696,24 @@ extern void slurm_free_job_info_request_msg(job_info_request_msg_t *msg)
 	xfree(msg);
 }
 
+extern void slurm_free_job_info_delta_request_msg(
+	job_info_delta_request_msg_t *msg)
+{
+	if (msg) {
+		xfree(msg->job_id);
+		xfree(msg);
+	}
+}
+
+extern void slurm_free_job_info_delta_msg(job_info_delta_msg_t *msg)
+{
+	if (msg) {
+		xfree(msg->removed_job_id);
+		slurm_free_job_info_msg(msg->job_info);
+		xfree(msg);
+	}
+}
+
 extern void slurm_free_job_step_info_request_msg(job_step_info_request_msg_t *msg)
 {
 	xfree(msg);
@@ -1416,9 +1434,23 @@ extern void slurm_free_stats_response_msg(stats_info_response_msg_t *msg)
 		xfree(msg->rpc_type_id);
 		xfree(msg->rpc_type_cnt);
 		xfree(msg->rpc_type_time);
+		xfree(msg->rpc_type_queue_time);
 		xfree(msg->rpc_user_id);
 		xfree(msg->rpc_user_cnt);
 		xfree(msg->rpc_user_time);
+		xfree(msg->lock_cnt);
+		xfree(msg->lock_wait_time);
+		xfree(msg->lock_wait_max);
+		xfree(msg->lock_wait_hist);
+		xfree(msg->rpc_queue_depth);
+		xfree(msg->rpc_queue_depth_max);
+		xfree(msg->rpc_queue_cnt);
+		xfree(msg->rpc_queue_wait_time);
+		xfree(msg->bf_worker_group_cnt);
+		xfree(msg->bf_worker_depth);
+		xfree(msg->bf_worker_depth_try);
+		xfree(msg->bf_worker_test_time);
+		xfree(msg->bf_worker_overlap);
 		xfree(msg);
 	}
 }
@@ -3843,6 +3875,12 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 	case REQUEST_JOB_INFO:
 		slurm_free_job_info_request_msg(data);
 		break;
+	case REQUEST_JOB_INFO_DELTA:
+		slurm_free_job_info_delta_request_msg(data);
+		break;
+	case RESPONSE_JOB_INFO_DELTA:
+		slurm_free_job_info_delta_msg(data);
+		break;
 	case REQUEST_NODE_INFO:
 		slurm_free_node_info_request_msg(data);
 		break;
@@ -4442,6 +4480,10 @@ rpc_num2string(uint16_t opcode)
 		return "REQUEST_FED_INFO";
 	case RESPONSE_FED_INFO:
 		return "RESPONSE_FED_INFO";
+	case REQUEST_JOB_INFO_DELTA:
+		return "REQUEST_JOB_INFO_DELTA";
+	case RESPONSE_JOB_INFO_DELTA:
+		return "RESPONSE_JOB_INFO_DELTA";
 
 	case REQUEST_UPDATE_JOB:				/* 3001 */
 		return "REQUEST_UPDATE_JOB";
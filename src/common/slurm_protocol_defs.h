@@ -249,6 +249,8 @@ typedef enum {
 	RESPONSE_LAYOUT_INFO,
 	REQUEST_FED_INFO,
 	RESPONSE_FED_INFO,		/* 2050 */
+	REQUEST_JOB_INFO_DELTA,
+	RESPONSE_JOB_INFO_DELTA,
 
 	REQUEST_UPDATE_JOB = 3001,
 	REQUEST_UPDATE_NODE,
@@ -596,6 +598,25 @@ typedef struct job_info_request_msg {
 	uint16_t show_flags;
 } job_info_request_msg_t;
 
+typedef struct job_info_delta_request_msg {
+	uint32_t delta_seq;	/* generation of the client's job records,
+				 * 0 to request all records */
+	time_t last_update;	/* time the client's job records were packed */
+	uint16_t show_flags;
+	uint32_t job_id_cnt;	/* count of job_id */
+	uint32_t *job_id;	/* jobs of the client's job records */
+} job_info_delta_request_msg_t;
+
+#define JOB_INFO_DELTA_COMPLETE	0x0001	/* job_info holds all records */
+
+typedef struct job_info_delta_msg {
+	uint32_t delta_seq;	/* generation of these job records */
+	uint16_t flags;		/* JOB_INFO_DELTA_* */
+	uint32_t removed_cnt;	/* count of removed_job_id */
+	uint32_t *removed_job_id; /* jobs removed or no longer visible */
+	job_info_msg_t *job_info; /* new or changed job records */
+} job_info_delta_msg_t;
+
 typedef struct job_step_info_request_msg {
 	time_t last_update;
 	uint32_t job_id;
@@ -1115,7 +1136,7 @@ typedef struct file_bcast_msg {
 	time_t mtime;		/* last modification time for dest file */
 	sbcast_cred_t *cred;	/* credential for the RPC */
 	uint32_t block_len;	/* length of this data block */
-	uint32_t block_offset;	/* offset for this data block */
+	uint64_t block_offset;	/* offset for this data block */
 	uint32_t uncomp_len;	/* uncompressed length of this data block */
 	char *block;		/* data for this block */
 	uint64_t file_size;	/* file size */
@@ -1278,6 +1299,9 @@ extern void slurm_free_last_update_msg(last_update_msg_t * msg);
 extern void slurm_free_return_code_msg(return_code_msg_t * msg);
 extern void slurm_free_job_alloc_info_msg(job_alloc_info_msg_t * msg);
 extern void slurm_free_job_info_request_msg(job_info_request_msg_t *msg);
+extern void slurm_free_job_info_delta_request_msg(
+	job_info_delta_request_msg_t *msg);
+extern void slurm_free_job_info_delta_msg(job_info_delta_msg_t *msg);
 extern void slurm_free_job_step_info_request_msg(
 		job_step_info_request_msg_t *msg);
 extern void slurm_free_front_end_info_request_msg(
@@ -80,6 +80,10 @@
 #define _pack_layout_info_msg(msg,buf)		_pack_buffer_msg(msg,buf)
 #define _pack_assoc_mgr_info_msg(msg,buf)      _pack_buffer_msg(msg,buf)
 
+/* Largest first chunk of the arena a message is unpacked into. Unpacked
+ * strings take about twice the space they take in the buffer. */
+#define UNPACK_ARENA_MAX	(16 * 1024)
+
 static void _pack_assoc_shares_object(void *in, uint32_t tres_cnt, Buf buffer,
 				      uint16_t protocol_version);
 static int _unpack_assoc_shares_object(void **object, uint32_t tres_cnt,
@@ -457,6 +461,14 @@ static void _pack_job_desc_msg(job_desc_msg_t * job_desc_ptr, Buf buffer,
 static int _unpack_job_desc_msg(job_desc_msg_t ** job_desc_buffer_ptr,
 				Buf buffer,
 				uint16_t protocol_version);
+static void _pack_job_info_delta_request_msg(
+	job_info_delta_request_msg_t *msg, Buf buffer,
+	uint16_t protocol_version);
+static int _unpack_job_info_delta_request_msg(
+	job_info_delta_request_msg_t **msg, Buf buffer,
+	uint16_t protocol_version);
+static int _unpack_job_info_delta_msg(job_info_delta_msg_t **msg, Buf buffer,
+				      uint16_t protocol_version);
 static int _unpack_job_info_msg(job_info_msg_t ** msg, Buf buffer,
 				uint16_t protocol_version);
 
@@ -1062,6 +1074,7 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 					 msg->protocol_version);
 		break;
 	case RESPONSE_JOB_INFO:
+	case RESPONSE_JOB_INFO_DELTA:
 		_pack_job_info_msg((slurm_msg_t *) msg, buffer);
 		break;
 	case RESPONSE_PARTITION_INFO:
@@ -1275,6 +1288,11 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 					   msg->data, buffer,
 					   msg->protocol_version);
 		break;
+	case REQUEST_JOB_INFO_DELTA:
+		_pack_job_info_delta_request_msg(
+			(job_info_delta_request_msg_t *) msg->data, buffer,
+			msg->protocol_version);
+		break;
 	case REQUEST_CANCEL_JOB_STEP:
 	case REQUEST_KILL_JOB:
 	case SRUN_STEP_SIGNAL:
@@ -1692,8 +1710,23 @@ int
 unpack_msg(slurm_msg_t * msg, Buf buffer)
 {
 	int rc = SLURM_SUCCESS;
+	xarena_t *arena = NULL, *prev_arena = buffer->arena;
 	msg->data = NULL;	/* Initialize to no data for now */
 
+	/* Unpack the many strings of these frequent messages into one arena,
+	 * freed along with the last of them. Handlers keeping any of them
+	 * longer than the message should take them with xmove(). Strings of
+	 * node and partition records packed with packstr_dict() are then
+	 * each resolved with one copy into the arena. */
+	if ((msg->msg_type == REQUEST_JOB_STEP_CREATE) ||
+	    (msg->msg_type == MESSAGE_NODE_REGISTRATION_STATUS) ||
+	    (msg->msg_type == RESPONSE_NODE_INFO) ||
+	    (msg->msg_type == RESPONSE_PARTITION_INFO)) {
+		arena = xarena_create(MIN(remaining_buf(buffer) * 2,
+					  UNPACK_ARENA_MAX));
+		buffer->arena = arena;
+	}
+
 	switch (msg->msg_type) {
 	case REQUEST_NODE_INFO:
 		rc = _unpack_node_info_request_msg((node_info_request_msg_t **)
@@ -1737,6 +1770,11 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 					  buffer,
 					  msg->protocol_version);
 		break;
+	case RESPONSE_JOB_INFO_DELTA:
+		rc = _unpack_job_info_delta_msg(
+			(job_info_delta_msg_t **) &(msg->data), buffer,
+			msg->protocol_version);
+		break;
 	case RESPONSE_PARTITION_INFO:
 		rc = _unpack_partition_info_msg((partition_info_msg_t **) &
 						(msg->data), buffer,
@@ -1965,6 +2003,11 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 						  & (msg->data), buffer,
 						  msg->protocol_version);
 		break;
+	case REQUEST_JOB_INFO_DELTA:
+		rc = _unpack_job_info_delta_request_msg(
+			(job_info_delta_request_msg_t **) &(msg->data), buffer,
+			msg->protocol_version);
+		break;
 	case REQUEST_CANCEL_JOB_STEP:
 	case REQUEST_KILL_JOB:
 	case SRUN_STEP_SIGNAL:
@@ -2412,6 +2455,10 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 		break;
 	}
 
+	if (arena) {
+		buffer->arena = prev_arena;
+		xarena_release(arena);
+	}
 	if (rc) {
 		error("Malformed RPC of type %s(%u) received",
 		      rpc_num2string(msg->msg_type), msg->msg_type);
@@ -4200,7 +4247,8 @@ _unpack_node_info_members(node_info_t * node, Buf buffer,
 		safe_unpackstr_xmalloc(&node->node_addr, &uint32_tmp, buffer);
 		safe_unpack16(&node->port, buffer);
 		safe_unpack32(&node->node_state, buffer);
-		safe_unpackstr_xmalloc(&node->version, &uint32_tmp, buffer);
+		safe_unpackstr_dict_xmalloc(&node->version, &uint32_tmp,
+					    buffer);
 
 		safe_unpack16(&node->cpus, buffer);
 		safe_unpack16(&node->boards, buffer);
@@ -4211,12 +4259,13 @@ _unpack_node_info_members(node_info_t * node, Buf buffer,
 		safe_unpack64(&node->real_memory, buffer);
 		safe_unpack32(&node->tmp_disk, buffer);
 
-		safe_unpackstr_xmalloc(&node->mcs_label, &uint32_tmp, buffer);
+		safe_unpackstr_dict_xmalloc(&node->mcs_label, &uint32_tmp,
+					    buffer);
 		safe_unpack32(&node->owner, buffer);
 		safe_unpack16(&node->core_spec_cnt, buffer);
 		safe_unpack64(&node->mem_spec_limit, buffer);
-		safe_unpackstr_xmalloc(&node->cpu_spec_list, &uint32_tmp,
-				       buffer);
+		safe_unpackstr_dict_xmalloc(&node->cpu_spec_list, &uint32_tmp,
+					    buffer);
 
 		safe_unpack32(&node->cpu_load, buffer);
 		safe_unpack64(&node->free_mem, buffer);
@@ -4230,16 +4279,20 @@ _unpack_node_info_members(node_info_t * node, Buf buffer,
 		select_g_select_nodeinfo_unpack(&node->select_nodeinfo, buffer,
 						protocol_version);
 
-		safe_unpackstr_xmalloc(&node->arch, &uint32_tmp, buffer);
-		safe_unpackstr_xmalloc(&node->features, &uint32_tmp, buffer);
-		safe_unpackstr_xmalloc(&node->features_act, &uint32_tmp, buffer);
+		safe_unpackstr_dict_xmalloc(&node->arch, &uint32_tmp, buffer);
+		safe_unpackstr_dict_xmalloc(&node->features, &uint32_tmp,
+					    buffer);
+		safe_unpackstr_dict_xmalloc(&node->features_act, &uint32_tmp,
+					    buffer);
 		if (!node->features_act)
 			node->features_act = xstrdup(node->features);
-		safe_unpackstr_xmalloc(&node->gres, &uint32_tmp, buffer);
-		safe_unpackstr_xmalloc(&node->gres_drain, &uint32_tmp, buffer);
-		safe_unpackstr_xmalloc(&node->gres_used, &uint32_tmp, buffer);
-		safe_unpackstr_xmalloc(&node->os, &uint32_tmp, buffer);
-		safe_unpackstr_xmalloc(&node->reason, &uint32_tmp, buffer);
+		safe_unpackstr_dict_xmalloc(&node->gres, &uint32_tmp, buffer);
+		safe_unpackstr_dict_xmalloc(&node->gres_drain, &uint32_tmp,
+					    buffer);
+		safe_unpackstr_dict_xmalloc(&node->gres_used, &uint32_tmp,
+					    buffer);
+		safe_unpackstr_dict_xmalloc(&node->os, &uint32_tmp, buffer);
+		safe_unpackstr_dict_xmalloc(&node->reason, &uint32_tmp, buffer);
 		if (acct_gather_energy_unpack(&node->energy, buffer,
 					      protocol_version, 1)
 		    != SLURM_SUCCESS)
@@ -4252,8 +4305,8 @@ _unpack_node_info_members(node_info_t * node, Buf buffer,
 					   protocol_version) != SLURM_SUCCESS)
 			goto unpack_error;
 
-		safe_unpackstr_xmalloc(&node->tres_fmt_str, &uint32_tmp,
-				       buffer);
+		safe_unpackstr_dict_xmalloc(&node->tres_fmt_str, &uint32_tmp,
+					    buffer);
 	} else if (protocol_version >= SLURM_16_05_PROTOCOL_VERSION) {
 		uint32_t tmp_mem;
 		safe_unpackstr_xmalloc(&node->name, &uint32_tmp, buffer);
@@ -5543,22 +5596,23 @@ _unpack_partition_info_members(partition_info_t * part, Buf buffer,
 		safe_unpack16(&part->state_up,     buffer);
 		safe_unpack16(&part->cr_type ,     buffer);
 
-		safe_unpackstr_xmalloc(&part->allow_accounts, &uint32_tmp,
-				       buffer);
-		safe_unpackstr_xmalloc(&part->allow_groups, &uint32_tmp,
-				       buffer);
-		safe_unpackstr_xmalloc(&part->allow_alloc_nodes, &uint32_tmp,
-				       buffer);
-		safe_unpackstr_xmalloc(&part->allow_qos, &uint32_tmp,
-				       buffer);
-		safe_unpackstr_xmalloc(&part->qos_char, &uint32_tmp,
-				       buffer);
-		safe_unpackstr_xmalloc(&part->alternate, &uint32_tmp, buffer);
-		safe_unpackstr_xmalloc(&part->deny_accounts, &uint32_tmp,
-				       buffer);
-		safe_unpackstr_xmalloc(&part->deny_qos, &uint32_tmp,
-				       buffer);
-		safe_unpackstr_xmalloc(&part->nodes, &uint32_tmp, buffer);
+		safe_unpackstr_dict_xmalloc(&part->allow_accounts, &uint32_tmp,
+					    buffer);
+		safe_unpackstr_dict_xmalloc(&part->allow_groups, &uint32_tmp,
+					    buffer);
+		safe_unpackstr_dict_xmalloc(&part->allow_alloc_nodes,
+					    &uint32_tmp, buffer);
+		safe_unpackstr_dict_xmalloc(&part->allow_qos, &uint32_tmp,
+					    buffer);
+		safe_unpackstr_dict_xmalloc(&part->qos_char, &uint32_tmp,
+					    buffer);
+		safe_unpackstr_dict_xmalloc(&part->alternate, &uint32_tmp,
+					    buffer);
+		safe_unpackstr_dict_xmalloc(&part->deny_accounts, &uint32_tmp,
+					    buffer);
+		safe_unpackstr_dict_xmalloc(&part->deny_qos, &uint32_tmp,
+					    buffer);
+		safe_unpackstr_dict_xmalloc(&part->nodes, &uint32_tmp, buffer);
 		safe_unpackstr_xmalloc(&node_inx_str, &uint32_tmp, buffer);
 		if (node_inx_str == NULL)
 			part->node_inx = bitfmt2int("");
@@ -5567,10 +5621,10 @@ _unpack_partition_info_members(partition_info_t * part, Buf buffer,
 			xfree(node_inx_str);
 			node_inx_str = NULL;
 		}
-		safe_unpackstr_xmalloc(&part->billing_weights_str, &uint32_tmp,
-				       buffer);
-		safe_unpackstr_xmalloc(&part->tres_fmt_str, &uint32_tmp,
-				       buffer);
+		safe_unpackstr_dict_xmalloc(&part->billing_weights_str,
+					    &uint32_tmp, buffer);
+		safe_unpackstr_dict_xmalloc(&part->tres_fmt_str, &uint32_tmp,
+					    buffer);
 	} else if (protocol_version >= SLURM_16_05_PROTOCOL_VERSION) {
 		uint32_t tmp_mem;
 		safe_unpackstr_xmalloc(&part->name, &uint32_tmp, buffer);
@@ -6051,6 +6105,37 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+static int
+_unpack_job_info_delta_msg(job_info_delta_msg_t **msg, Buf buffer,
+			   uint16_t protocol_version)
+{
+	job_info_delta_msg_t *delta_ptr;
+
+	xassert(msg != NULL);
+	delta_ptr = xmalloc(sizeof(job_info_delta_msg_t));
+	*msg = delta_ptr;
+
+	if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+		safe_unpack32(&delta_ptr->delta_seq, buffer);
+		safe_unpack16(&delta_ptr->flags, buffer);
+		safe_unpack32_array(&delta_ptr->removed_job_id,
+				    &delta_ptr->removed_cnt, buffer);
+		if (_unpack_job_info_msg(&delta_ptr->job_info, buffer,
+					 protocol_version))
+			goto unpack_error;
+	} else {
+		error("_unpack_job_info_delta_msg: protocol_version "
+		      "%hu not supported", protocol_version);
+		goto unpack_error;
+	}
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_job_info_delta_msg(delta_ptr);
+	*msg = NULL;
+	return SLURM_ERROR;
+}
+
 /* Translate bitmap representation from hex to decimal format, replacing
  * array_task_str and store the bitmap in job->array_bitmap. */
 static void _xlate_task_str(job_info_t *job_ptr)
@@ -11565,6 +11650,37 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+static void
+_pack_job_info_delta_request_msg(job_info_delta_request_msg_t *msg,
+				 Buf buffer, uint16_t protocol_version)
+{
+	pack32(msg->delta_seq, buffer);
+	pack_time(msg->last_update, buffer);
+	pack16(msg->show_flags, buffer);
+	pack32_array(msg->job_id, msg->job_id_cnt, buffer);
+}
+
+static int
+_unpack_job_info_delta_request_msg(job_info_delta_request_msg_t **msg,
+				   Buf buffer, uint16_t protocol_version)
+{
+	job_info_delta_request_msg_t *req_ptr;
+
+	req_ptr = xmalloc(sizeof(job_info_delta_request_msg_t));
+	*msg = req_ptr;
+
+	safe_unpack32(&req_ptr->delta_seq, buffer);
+	safe_unpack_time(&req_ptr->last_update, buffer);
+	safe_unpack16(&req_ptr->show_flags, buffer);
+	safe_unpack32_array(&req_ptr->job_id, &req_ptr->job_id_cnt, buffer);
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_job_info_delta_request_msg(req_ptr);
+	*msg = NULL;
+	return SLURM_ERROR;
+}
+
 static void
 _pack_block_info_req_msg(block_info_request_msg_t *msg, Buf buffer,
 			 uint16_t protocol_version)
@@ -13738,7 +13854,7 @@ static void _pack_file_bcast(file_bcast_msg_t * msg , Buf buffer,
 
 	grow_buf(buffer,  msg->block_len);
 
-	if (protocol_version >= SLURM_16_05_PROTOCOL_VERSION) {
+	if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
 		pack16 ( msg->block_no, buffer );
 		pack16 ( msg->compress, buffer );
 		pack16 ( msg->last_block, buffer );
@@ -13755,7 +13871,28 @@ static void _pack_file_bcast(file_bcast_msg_t * msg , Buf buffer,
 		packstr ( msg->fname, buffer );
 		pack32 ( msg->block_len, buffer );
 		pack32(msg->uncomp_len, buffer);
-		pack32(msg->block_offset, buffer);
+		pack64(msg->block_offset, buffer);
+		pack64(msg->file_size, buffer);
+		packmem ( msg->block, msg->block_len, buffer );
+		pack_sbcast_cred( msg->cred, buffer );
+	} else if (protocol_version >= SLURM_16_05_PROTOCOL_VERSION) {
+		pack16 ( msg->block_no, buffer );
+		pack16 ( msg->compress, buffer );
+		pack16 ( msg->last_block, buffer );
+		pack16 ( msg->force, buffer );
+		pack16 ( msg->modes, buffer );
+
+		pack32 ( msg->uid, buffer );
+		packstr ( msg->user_name, buffer );
+		pack32 ( msg->gid, buffer );
+
+		pack_time ( msg->atime, buffer );
+		pack_time ( msg->mtime, buffer );
+
+		packstr ( msg->fname, buffer );
+		pack32 ( msg->block_len, buffer );
+		pack32(msg->uncomp_len, buffer);
+		pack32((uint32_t) msg->block_offset, buffer);
 		pack64(msg->file_size, buffer);
 		packmem ( msg->block, msg->block_len, buffer );
 		pack_sbcast_cred( msg->cred, buffer );
@@ -13790,7 +13927,35 @@ static int _unpack_file_bcast(file_bcast_msg_t ** msg_ptr , Buf buffer,
 	msg = xmalloc ( sizeof (file_bcast_msg_t) ) ;
 	*msg_ptr = msg;
 
-	if (protocol_version >= SLURM_16_05_PROTOCOL_VERSION) {
+	if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+		safe_unpack16 ( & msg->block_no, buffer );
+		safe_unpack16 ( & msg->compress, buffer );
+		safe_unpack16 ( & msg->last_block, buffer );
+		safe_unpack16 ( & msg->force, buffer );
+		safe_unpack16 ( & msg->modes, buffer );
+
+		safe_unpack32 ( & msg->uid, buffer );
+		safe_unpackstr_xmalloc ( &msg->user_name, &uint32_tmp, buffer );
+		safe_unpack32 ( & msg->gid, buffer );
+
+		safe_unpack_time ( & msg->atime, buffer );
+		safe_unpack_time ( & msg->mtime, buffer );
+
+		safe_unpackstr_xmalloc ( & msg->fname, &uint32_tmp, buffer );
+		safe_unpack32 ( & msg->block_len, buffer );
+		safe_unpack32(&msg->uncomp_len, buffer);
+		safe_unpack64(&msg->block_offset, buffer);
+		safe_unpack64(&msg->file_size, buffer);
+		safe_unpackmem_xmalloc ( & msg->block, &uint32_tmp , buffer ) ;
+		if ( uint32_tmp != msg->block_len )
+			goto unpack_error;
+
+		msg->cred = unpack_sbcast_cred( buffer );
+		if (msg->cred == NULL)
+			goto unpack_error;
+	} else if (protocol_version >= SLURM_16_05_PROTOCOL_VERSION) {
+		uint32_t block_offset;
+
 		safe_unpack16 ( & msg->block_no, buffer );
 		safe_unpack16 ( & msg->compress, buffer );
 		safe_unpack16 ( & msg->last_block, buffer );
@@ -13807,7 +13972,8 @@ static int _unpack_file_bcast(file_bcast_msg_t ** msg_ptr , Buf buffer,
 		safe_unpackstr_xmalloc ( & msg->fname, &uint32_tmp, buffer );
 		safe_unpack32 ( & msg->block_len, buffer );
 		safe_unpack32(&msg->uncomp_len, buffer);
-		safe_unpack32(&msg->block_offset, buffer);
+		safe_unpack32(&block_offset, buffer);
+		msg->block_offset = block_offset;
 		safe_unpack64(&msg->file_size, buffer);
 		safe_unpackmem_xmalloc ( & msg->block, &uint32_tmp , buffer ) ;
 		if ( uint32_tmp != msg->block_len )
@@ -14751,17 +14917,124 @@ static int  _unpack_stats_response_msg(stats_info_response_msg_t **msg_ptr,
 			safe_unpack32(&msg->bf_depth_try_sum,	buffer);
 			safe_unpack32(&msg->bf_queue_len_sum,	buffer);
 			safe_unpack32(&msg->bf_active,		buffer);
+
+			if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+				safe_unpack32(&msg->job_info_cache_hits,
+					      buffer);
+				safe_unpack32(&msg->job_info_cache_misses,
+					      buffer);
+				safe_unpack32(&msg->job_state_ckpt_cnt,
+					      buffer);
+				safe_unpack32(&msg->job_state_journal_cnt,
+					      buffer);
+				safe_unpack64(&msg->job_state_bytes, buffer);
+				safe_unpack32(&msg->job_state_journal_size,
+					      buffer);
+				safe_unpack32(&msg->job_state_load_time,
+					      buffer);
+				safe_unpack32(&msg->bf_group_cnt, buffer);
+				safe_unpack32_array(&msg->bf_worker_group_cnt,
+						    &msg->bf_worker_cnt,
+						    buffer);
+				safe_unpack32_array(&msg->bf_worker_depth,
+						    &uint32_tmp, buffer);
+				if (uint32_tmp != msg->bf_worker_cnt)
+					goto unpack_error;
+				safe_unpack32_array(&msg->bf_worker_depth_try,
+						    &uint32_tmp, buffer);
+				if (uint32_tmp != msg->bf_worker_cnt)
+					goto unpack_error;
+				safe_unpack64_array(&msg->bf_worker_test_time,
+						    &uint32_tmp, buffer);
+				if (uint32_tmp != msg->bf_worker_cnt)
+					goto unpack_error;
+				safe_unpack32_array(&msg->bf_worker_overlap,
+						    &uint32_tmp, buffer);
+				if (uint32_tmp != msg->bf_worker_cnt)
+					goto unpack_error;
+				safe_unpack32(&msg->prio_calc_cnt, buffer);
+				safe_unpack32(&msg->prio_calc_jobs, buffer);
+				safe_unpack32(&msg->prio_calc_threads, buffer);
+				safe_unpack32(&msg->prio_decay_time, buffer);
+				safe_unpack32(&msg->prio_usage_time, buffer);
+				safe_unpack32(&msg->prio_fs_time, buffer);
+				safe_unpack32(&msg->prio_factor_time, buffer);
+				safe_unpack32(&msg->prio_store_time, buffer);
+			}
 		}
 
 		safe_unpack32(&msg->rpc_type_size,		buffer);
 		safe_unpack16_array(&msg->rpc_type_id,   &uint32_tmp, buffer);
 		safe_unpack32_array(&msg->rpc_type_cnt,  &uint32_tmp, buffer);
 		safe_unpack64_array(&msg->rpc_type_time, &uint32_tmp, buffer);
+		if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+			safe_unpack64_array(&msg->rpc_type_queue_time,
+					    &uint32_tmp, buffer);
+		} else {
+			msg->rpc_type_queue_time = xmalloc(sizeof(uint64_t) *
+							   msg->rpc_type_size);
+		}
 
 		safe_unpack32(&msg->rpc_user_size,		buffer);
 		safe_unpack32_array(&msg->rpc_user_id,   &uint32_tmp, buffer);
 		safe_unpack32_array(&msg->rpc_user_cnt,  &uint32_tmp, buffer);
 		safe_unpack64_array(&msg->rpc_user_time, &uint32_tmp, buffer);
+
+		if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+			uint32_t i;
+
+			safe_unpack32(&msg->lock_stat_size,	buffer);
+			safe_unpack32(&msg->lock_hist_size,	buffer);
+			if ((msg->lock_stat_size > 1024) ||
+			    (msg->lock_hist_size > 1024))
+				goto unpack_error;
+			msg->lock_cnt = xmalloc(sizeof(uint64_t) *
+						msg->lock_stat_size);
+			msg->lock_wait_time = xmalloc(sizeof(uint64_t) *
+						      msg->lock_stat_size);
+			msg->lock_wait_max = xmalloc(sizeof(uint64_t) *
+						     msg->lock_stat_size);
+			msg->lock_wait_hist = xmalloc(sizeof(uint32_t) *
+						      msg->lock_stat_size *
+						      msg->lock_hist_size);
+			for (i = 0; i < msg->lock_stat_size; i++) {
+				uint32_t *hist = NULL;
+				safe_unpack64(&msg->lock_cnt[i],	buffer);
+				safe_unpack64(&msg->lock_wait_time[i],	buffer);
+				safe_unpack64(&msg->lock_wait_max[i],	buffer);
+				safe_unpack32_array(&hist, &uint32_tmp, buffer);
+				if (uint32_tmp != msg->lock_hist_size) {
+					xfree(hist);
+					goto unpack_error;
+				}
+				memcpy(msg->lock_wait_hist +
+				       (i * msg->lock_hist_size), hist,
+				       sizeof(uint32_t) * msg->lock_hist_size);
+				xfree(hist);
+			}
+
+			safe_unpack32(&msg->rpc_worker_cnt,	buffer);
+			safe_unpack32(&msg->rpc_worker_busy,	buffer);
+			safe_unpack32(&msg->rpc_queue_size,	buffer);
+			if (msg->rpc_queue_size > 1024)
+				goto unpack_error;
+			msg->rpc_queue_depth = xmalloc(sizeof(uint32_t) *
+						       msg->rpc_queue_size);
+			msg->rpc_queue_depth_max = xmalloc(sizeof(uint32_t) *
+							   msg->rpc_queue_size);
+			msg->rpc_queue_cnt = xmalloc(sizeof(uint32_t) *
+						     msg->rpc_queue_size);
+			msg->rpc_queue_wait_time = xmalloc(sizeof(uint64_t) *
+							   msg->rpc_queue_size);
+			for (i = 0; i < msg->rpc_queue_size; i++) {
+				safe_unpack32(&msg->rpc_queue_depth[i], buffer);
+				safe_unpack32(&msg->rpc_queue_depth_max[i],
+					      buffer);
+				safe_unpack32(&msg->rpc_queue_cnt[i],	buffer);
+				safe_unpack64(&msg->rpc_queue_wait_time[i],
+					      buffer);
+			}
+		}
 	} else {
 		error("_unpack_stats_response_msg: protocol_version "
 		      "%hu not supported", protocol_version);
@@ -85,6 +85,8 @@
 #define	bit_realloc		slurm_bit_realloc
 #define	bit_size		slurm_bit_size
 #define	bit_and			slurm_bit_and
+#define	bit_and_not		slurm_bit_and_not
+#define	bit_overlap_any		slurm_bit_overlap_any
 #define	bit_not			slurm_bit_not
 #define	bit_or			slurm_bit_or
 #define	bit_set_count		slurm_bit_set_count
@@ -110,6 +112,8 @@
 #define bit_noc			slurm_bit_noc
 #define bit_nffs		slurm_bit_nffs
 #define bit_copybits		slurm_bit_copybits
+#define bit_kernels_name	slurm_bit_kernels_name
+#define bit_kernels_select	slurm_bit_kernels_select
 
 /* fd.[ch] functions */
 #define fd_read_n		slurm_fd_read_n
@@ -411,6 +415,7 @@
 #define eio_new_initial_obj		slurm_eio_new_initial_obj
 #define eio_obj_create			slurm_eio_obj_create
 #define eio_obj_destroy			slurm_eio_obj_destroy
+#define eio_obj_set_timer		slurm_eio_obj_set_timer
 #define eio_remove_obj			slurm_eio_remove_obj
 #define eio_signal_shutdown		slurm_eio_signal_shutdown
 #define eio_signal_wakeup		slurm_eio_signal_wakeup
@@ -653,6 +653,7 @@ extern void slurmdb_destroy_assoc_usage(void *object)
 	if (usage) {
 		FREE_NULL_LIST(usage->children_list);
 		FREE_NULL_BITMAP(usage->valid_qos);
+		xfree(usage->fs_data);
 		xfree(usage->grp_used_tres_run_secs);
 		xfree(usage->grp_used_tres);
 		xfree(usage->usage_tres_raw);
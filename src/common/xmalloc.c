@@ -42,6 +42,7 @@
 #include "config.h"
 
 #include <errno.h>
+#include <inttypes.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -63,6 +64,27 @@ static void malloc_assert_failed(char *, const char *, int,
           } while (0)
 #endif /* NDEBUG */
 
+/*
+ * Allocations from an arena have a four word header so that they stay
+ * aligned like malloc()'s: the arena, padding, XARENA_MAGIC and the size.
+ * The last two words are where xmalloc() keeps its magic and size, so
+ * xfree(), xrealloc() and xsize() tell the two kinds apart by the magic.
+ */
+#define XARENA_HDR_WORDS	4
+#define XARENA_ALIGN		16
+#define XARENA_MIN_CHUNK	1024
+
+struct xarena {
+	uint32_t refs;		/* allocations not yet freed, plus one until
+				 * xarena_release() */
+	size_t chunk_size;	/* minimum size of a new chunk */
+	char *next;		/* free space in the current chunk */
+	char *end;
+	void *chunks;		/* chunks, chained through their first word */
+};
+
+static void _xarena_unref(xarena_t *arena);
+
 
 /*
  * "Safe" version of malloc().
@@ -126,6 +148,17 @@ extern void * slurm_xrealloc(void **item, size_t newsize, bool clear,
 {
 	size_t *p = NULL;
 
+	if ((*item != NULL) && (((size_t *)*item)[-2] == XARENA_MAGIC)) {
+		/* Arena memory can not grow in place, move it out */
+		void *old = *item;
+		size_t old_size = ((size_t *)old)[-1];
+
+		*item = slurm_xmalloc(newsize, clear, file, line, func);
+		memcpy(*item, old, MIN(old_size, newsize));
+		slurm_xfree(&old, file, line, func);
+		return *item;
+	}
+
 	if (*item != NULL) {
 		size_t old_size;
 		p = (size_t *)*item - 2;
@@ -175,6 +208,19 @@ int slurm_try_xrealloc(void **item, size_t newsize,
 {
 	size_t *p = NULL;
 
+	if ((*item != NULL) && (((size_t *)*item)[-2] == XARENA_MAGIC)) {
+		void *old = *item;
+		size_t old_size = ((size_t *)old)[-1];
+		void *new = slurm_try_xmalloc(newsize, file, line, func);
+
+		if (!new)
+			return 0;
+		memcpy(new, old, MIN(old_size, newsize));
+		slurm_xfree(&old, file, line, func);
+		*item = new;
+		return 1;
+	}
+
 	if (*item != NULL) {
 		size_t old_size;
 		p = (size_t *)*item - 2;
@@ -216,7 +262,8 @@ size_t slurm_xsize(void *item, const char *file, int line, const char *func)
 {
 	size_t *p = (size_t *)item - 2;
 	xmalloc_assert(item != NULL);
-	xmalloc_assert(p[0] == XMALLOC_MAGIC); /* CLANG false positive here */
+	xmalloc_assert((p[0] == XMALLOC_MAGIC) || /* CLANG false positive */
+		       (p[0] == XARENA_MAGIC));
 	return p[1];
 }
 
@@ -229,6 +276,13 @@ void slurm_xfree(void **item, const char *file, int line, const char *func)
 {
 	if (*item != NULL) {
 		size_t *p = (size_t *)*item - 2;
+		if (p[0] == XARENA_MAGIC) {
+			p[0] = 0;
+			_xarena_unref((xarena_t *)
+				      ((size_t *)*item)[-XARENA_HDR_WORDS]);
+			*item = NULL;
+			return;
+		}
 		/* magic cookie still there? */
 		xmalloc_assert(p[0] == XMALLOC_MAGIC);
 		p[0] = 0;	/* make sure xfree isn't called twice */
@@ -237,6 +291,116 @@ void slurm_xfree(void **item, const char *file, int line, const char *func)
 	}
 }
 
+/*
+ * Create an arena handing out memory in chunks of at least size bytes.
+ *   size (IN)	size of the first chunk, usually the expected total
+ *   RETURN	arena to pass to xarena_alloc() and xarena_release()
+ */
+xarena_t *slurm_xarena_create(size_t size)
+{
+	xarena_t *arena = malloc(sizeof(xarena_t));
+
+	if (!arena) {
+		log_oom(__FILE__, __LINE__, __func__);
+		abort();
+	}
+	arena->refs = 1;
+	arena->chunk_size = MAX(size, XARENA_MIN_CHUNK);
+	arena->next = NULL;
+	arena->end = NULL;
+	arena->chunks = NULL;
+
+	return arena;
+}
+
+/*
+ * Drop the creator's reference to an arena. Its memory is freed now if
+ * nothing allocated from it remains, otherwise with the last allocation.
+ * Nothing may be allocated from it afterwards.
+ */
+void slurm_xarena_release(xarena_t *arena)
+{
+	if (arena)
+		_xarena_unref(arena);
+}
+
+static void _xarena_unref(xarena_t *arena)
+{
+	void *chunk, *next;
+
+	/* Allocations may be freed by threads other than the creator's */
+	if (__sync_sub_and_fetch(&arena->refs, 1))
+		return;
+
+	for (chunk = arena->chunks; chunk; chunk = next) {
+		next = *(void **)chunk;
+		free(chunk);
+	}
+	free(arena);
+}
+
+/*
+ * Allocate uninitialized memory from an arena. Only the thread which created
+ * the arena may allocate from it.
+ *   arena (IN)	arena from xarena_create()
+ *   size (IN)	number of bytes to allocate
+ *   RETURN	pointer to the memory, to be freed with xfree()
+ */
+void *slurm_xarena_alloc(xarena_t *arena, size_t size,
+			 const char *file, int line, const char *func)
+{
+	size_t total = (XARENA_HDR_WORDS * sizeof(size_t)) +
+		       ((size + XARENA_ALIGN - 1) & ~(XARENA_ALIGN - 1));
+	size_t *p;
+
+	if ((arena->end - arena->next) < (ssize_t) total) {
+		/* The chunk's first XARENA_ALIGN bytes chain the chunks */
+		size_t chunk_size = MAX(arena->chunk_size,
+					total + XARENA_ALIGN);
+		char *chunk = malloc(chunk_size);
+
+		if (!chunk) {
+			log_oom(file, line, func);
+			abort();
+		}
+		*(void **)chunk = arena->chunks;
+		arena->chunks = chunk;
+		arena->next = chunk + XARENA_ALIGN;
+		arena->end = chunk + chunk_size;
+	}
+
+	p = (size_t *) arena->next;
+	arena->next += total;
+	p[0] = (size_t) arena;
+	p[1] = 0;
+	p[2] = XARENA_MAGIC;
+	p[3] = size;
+	__sync_add_and_fetch(&arena->refs, 1);
+
+	return &p[XARENA_HDR_WORDS];
+}
+
+/*
+ * Take ownership of memory, leaving NULL in its place.
+ *   item (IN/OUT)	double-pointer to allocated space
+ *   RETURN		the memory, or an xmalloc'ed copy of arena memory
+ */
+void *slurm_xmove(void **item, const char *file, int line, const char *func)
+{
+	void *new = *item;
+
+	if (new && (((size_t *)new)[-2] == XARENA_MAGIC)) {
+		size_t size = ((size_t *)new)[-1];
+
+		new = slurm_xmalloc(size, false, file, line, func);
+		memcpy(new, *item, size);
+		slurm_xfree(item, file, line, func);
+	}
+	*item = NULL;
+
+	return new;
+}
+
 #ifndef NDEBUG
 static void malloc_assert_failed(char *expr, const char *file,
 		                 int line, const char *caller, const char *func)
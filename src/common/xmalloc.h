@@ -71,6 +71,16 @@
  * p. The memory must have been allocated with [try_]xmalloc() or
  * [try_]xrealloc().
  *
+ * xarena_create(size) creates an arena from which xarena_alloc(arena, size)
+ * hands out uninitialized memory by bumping a pointer, in chunks of at least
+ * size bytes. Memory from an arena may be passed to xfree(), xrealloc() and
+ * xsize() like any other. An arena is reference counted: it is freed when
+ * xarena_release() was called and every allocation from it was freed.
+ *
+ * xmove(p) returns p and sets it to NULL, transferring ownership to the
+ * caller. Memory from an arena is copied so that a long lived reference does
+ * not keep the rest of its arena allocated.
+ *
 \*****************************************************************************/
 
 #ifndef _XMALLOC_H
@@ -107,13 +117,32 @@
 #define xsize(__p) \
 	slurm_xsize((void *)__p, __FILE__, __LINE__, __func__)
 
+#define xarena_create(__sz) \
+	slurm_xarena_create(__sz)
+
+#define xarena_release(__a) \
+	slurm_xarena_release(__a)
+
+#define xarena_alloc(__a, __sz) \
+	slurm_xarena_alloc(__a, __sz, __FILE__, __LINE__, __func__)
+
+#define xmove(__p) \
+	slurm_xmove((void **)&(__p), __FILE__, __LINE__, __func__)
+
+typedef struct xarena xarena_t;
+
 void *slurm_xmalloc(size_t, bool, const char *, int, const char *);
 void *slurm_try_xmalloc(size_t , const char *, int , const char *);
 void slurm_xfree(void **, const char *, int, const char *);
 void *slurm_xrealloc(void **, size_t, bool, const char *, int, const char *);
 int  slurm_try_xrealloc(void **, size_t, const char *, int, const char *);
 size_t slurm_xsize(void *, const char *, int, const char *);
+xarena_t *slurm_xarena_create(size_t);
+void slurm_xarena_release(xarena_t *);
+void *slurm_xarena_alloc(xarena_t *, size_t, const char *, int, const char *);
+void *slurm_xmove(void **, const char *, int, const char *);
 
 #define XMALLOC_MAGIC 0x42
+#define XARENA_MAGIC 0x43
 
 #endif /* !_XMALLOC_H */
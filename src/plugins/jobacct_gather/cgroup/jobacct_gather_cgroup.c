@@ -45,6 +45,7 @@
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_protocol_defs.h"
 #include "src/common/slurm_acct_gather_energy.h"
+#include "src/common/timers.h"
 #include "src/common/xstring.h"
 #include "src/slurmd/common/proctrack.h"
 #include "src/slurmd/common/xcpuinfo.h"
@@ -99,88 +100,174 @@ const uint32_t plugin_version = SLURM_VERSION_NUMBER;
 /* Other useful declarations */
 static slurm_cgroup_conf_t slurm_cgroup_conf;
 
+/* JobAcctGatherParams=CgroupOnly, gather from the task cgroups only */
+static bool cgroup_only = false;
+static bool blkio_enabled = false;
+
+/* Fill usec and ssec from cpuacct.stat, in USER_HZ ticks like /proc */
+static void _parse_cpuacct_stat(char *cpu_time, jag_prec_t *prec)
+{
+	unsigned long utime, stime;
+
+	if (sscanf(cpu_time, "%*s %lu %*s %lu", &utime, &stime) == 2) {
+		prec->usec = utime;
+		prec->ssec = stime;
+	}
+}
+
+/* Fill rss and pages from memory.stat */
+static void _parse_memory_stat(char *memory_stat, jag_prec_t *prec)
+{
+	unsigned long total_rss, total_pgpgin;
+	char *ptr;
+
+	/* This number represents the amount of "dirty" private memory
+	   used by the cgroup.  From our experience this is slightly
+	   different than what proc presents, but is probably more
+	   accurate on what the user is actually using.
+	*/
+	if ((ptr = strstr(memory_stat, "total_rss")) &&
+	    (sscanf(ptr, "total_rss %lu", &total_rss) == 1))
+		prec->rss = total_rss / 1024; /* convert from bytes to KB */
+
+	/* total_pgmajfault is what is reported in proc, so we use
+	 * the same thing here. */
+	if ((ptr = strstr(memory_stat, "total_pgmajfault")) &&
+	    (sscanf(ptr, "total_pgmajfault %lu", &total_pgpgin) == 1))
+		prec->pages = total_pgpgin;
+}
+
+/*
+ * Fill disk_read and disk_write from blkio.throttle.io_service_bytes.
+ *
+ * "Read" and "Write" are counts of bytes read and written for physical
+ * disk I/Os only. These counts do not include disk I/Os satisfied from
+ * cache.
+ */
+static void _parse_blkio_bytes(char *blkio_bytes, jag_prec_t *prec)
+{
+	uint64_t bytes, tot_read = 0, tot_write = 0;
+	int dev_major, dev_minor;
+	char op[16], *line = blkio_bytes;
+
+	while (line && *line) {
+		if ((sscanf(line, "%d:%d %15s %"SCNu64, &dev_major, &dev_minor,
+			    op, &bytes) == 4) &&
+		    /* skip experimental device codes */
+		    ((dev_major < 240) || (dev_major > 254))) {
+			if (!xstrcmp(op, "Read"))
+				tot_read += bytes;
+			else if (!xstrcmp(op, "Write"))
+				tot_write += bytes;
+		}
+		if ((line = strchr(line, '\n')))
+			line++;
+	}
+	prec->disk_read = (double)tot_read / (double)1048576;
+	prec->disk_write = (double)tot_write / (double)1048576;
+}
+
 static void _prec_extra(jag_prec_t *prec)
 {
-	unsigned long utime, stime, total_rss, total_pgpgin;
-	char *cpu_time = NULL, *memory_stat = NULL, *ptr;
+	char *cpu_time = NULL, *memory_stat = NULL;
 	size_t cpu_time_size = 0, memory_stat_size = 0;
 
-	//DEF_TIMERS;
-	//START_TIMER;
-	/* info("before"); */
-	/* print_jag_prec(prec); */
 	xcgroup_get_param(&task_cpuacct_cg, "cpuacct.stat",
 			  &cpu_time, &cpu_time_size);
 	if (cpu_time == NULL) {
 		debug2("%s: failed to collect cpuacct.stat pid %d ppid %d",
 		       __func__, prec->pid, prec->ppid);
-	} else {
-		sscanf(cpu_time, "%*s %lu %*s %lu", &utime, &stime);
-		prec->usec = utime;
-		prec->ssec = stime;
-	}
+	} else
+		_parse_cpuacct_stat(cpu_time, prec);
 
 	xcgroup_get_param(&task_memory_cg, "memory.stat",
 			  &memory_stat, &memory_stat_size);
 	if (memory_stat == NULL) {
 		debug2("%s: failed to collect memory.stat  pid %d ppid %d",
 		       __func__, prec->pid, prec->ppid);
-	} else {
-		/* This number represents the amount of "dirty" private memory
-		   used by the cgroup.  From our experience this is slightly
-		   different than what proc presents, but is probably more
-		   accurate on what the user is actually using.
-		*/
-		ptr = strstr(memory_stat, "total_rss");
-		sscanf(ptr, "total_rss %lu", &total_rss);
-		prec->rss = total_rss / 1024; /* convert from bytes to KB */
-
-		/* total_pgmajfault is what is reported in proc, so we use
-		 * the same thing here. */
-		if ((ptr = strstr(memory_stat, "total_pgmajfault"))) {
-			sscanf(ptr, "total_pgmajfault %lu", &total_pgpgin);
-			prec->pages = total_pgpgin;
-		}
-	}
+	} else
+		_parse_memory_stat(memory_stat, prec);
 
 	xfree(cpu_time);
 	xfree(memory_stat);
+}
 
-	/* FIXME: Enable when kernel support ready.
-	 *
-	 * "Read" and "Write" from blkio.throttle.io_service_bytes are
-	 * counts of bytes read and written for physical disk I/Os only.
-	 * These counts do not include disk I/Os satisfied from cache.
-	 */
-	/* int dev_major; */
-	/* uint64_t read_bytes, write_bytes, tot_read, tot_write; */
-	/* char *blkio_bytes, *next_device; */
-	/* size_t blkio_bytes_size; */
-	/* xcgroup_get_param(&task_blkio_cg, "blkio.throttle.io_service_bytes", */
-	/*                   &blkio_bytes, &blkio_bytes_size); */
-	/* next_device = blkio_bytes; */
-	/* tot_read = tot_write = 0; */
-	/* while ((sscanf(next_device, "%d:", &dev_major)) > 0) { */
-	/* 	if ((dev_major > 239) && (dev_major < 255)) */
-	/* 		/\* skip experimental device codes *\/ */
-	/* 		continue; */
-	/* 	next_device = strstr(next_device, "Read"); */
-	/* 	sscanf(next_device, "%*s %"PRIu64"", &read_bytes); */
-	/* 	next_device = strstr(next_device, "Write"); */
-	/* 	sscanf(next_device, "%*s %"PRIu64"", &write_bytes); */
-	/* 	tot_read+=read_bytes; */
-	/* 	tot_write+=write_bytes; */
-	/* 	next_device = strstr(next_device, "Total"); */
-	/* } */
-	/* prec->disk_read = (double)tot_read / (double)1048576; */
-	/* prec->disk_write = (double)tot_write / (double)1048576; */
-
-	/* info("after %d %d", total_rss); */
-	/* print_jag_prec(prec); */
-	//END_TIMER;
-	//info("took %s", TIME_STR);
-	return;
+/* Read one counter file of the cgroup of task taskid below step_path */
+static char *_get_task_param(char *step_path, uint16_t taskid, char *param)
+{
+	char path[PATH_MAX], *content = NULL;
+	size_t size = 0;
+	xcgroup_t cg;
+
+	if (!step_path)
+		return NULL;
+	if (snprintf(path, sizeof(path), "%s/task_%u", step_path, taskid)
+	    >= sizeof(path))
+		return NULL;
+	memset(&cg, 0, sizeof(xcgroup_t));
+	cg.path = path;
+	if (xcgroup_get_param(&cg, param, &content, &size) != XCGROUP_SUCCESS)
+		xfree(content);
+
+	return content;
+}
 
+/*
+ * get_precs callback of CgroupOnly mode: build one record per task from
+ * the counters of its cgroups rather than from /proc. The kernel already
+ * sums these over every process of the task, so the cost of a poll depends
+ * on the number of tasks and not on the number of processes they run.
+ */
+static List _get_precs_cgroup(List task_list, bool pgid_plugin,
+			      uint64_t cont_id, jag_callbacks_t *callbacks)
+{
+	List prec_list = list_create(destroy_jag_prec);
+	char *cpuacct_path = jobacct_gather_cgroup_cpuacct_step_path();
+	char *memory_path = jobacct_gather_cgroup_memory_step_path();
+	char *blkio_path = NULL, *content;
+	struct jobacctinfo *jobacct;
+	ListIterator itr;
+	jag_prec_t *prec;
+	int tasks = 0;
+	DEF_TIMERS;
+
+	if (!task_list)
+		return prec_list;
+	if (blkio_enabled)
+		blkio_path = jobacct_gather_cgroup_blkio_step_path();
+
+	START_TIMER;
+	itr = list_iterator_create(task_list);
+	while ((jobacct = list_next(itr))) {
+		prec = xmalloc(sizeof(jag_prec_t));
+		prec->pid = jobacct->pid;
+
+		if ((content = _get_task_param(cpuacct_path, jobacct->id.taskid,
+					       "cpuacct.stat"))) {
+			_parse_cpuacct_stat(content, prec);
+			xfree(content);
+		}
+		if ((content = _get_task_param(memory_path, jobacct->id.taskid,
+					       "memory.stat"))) {
+			_parse_memory_stat(content, prec);
+			xfree(content);
+		}
+		if ((content = _get_task_param(
+			     blkio_path, jobacct->id.taskid,
+			     "blkio.throttle.io_service_bytes"))) {
+			_parse_blkio_bytes(content, prec);
+			xfree(content);
+		}
+
+		list_append(prec_list, prec);
+		tasks++;
+	}
+	list_iterator_destroy(itr);
+	END_TIMER;
+	debug2("%s: read %d task cgroups in %ld usec",
+	       __func__, tasks, DELTA_TIMER);
+
+	return prec_list;
 }
 
 static bool _run_in_daemon(void)
@@ -206,6 +293,8 @@ extern int init (void)
 	   isn't needed.
 	*/
 	if (_run_in_daemon()) {
+		char *acct_params;
+
 		jag_common_init(0);
 
 		/* read cgroup configuration */
@@ -234,16 +323,21 @@ extern int init (void)
 			return SLURM_ERROR;
 		}
 
-		/* FIXME: Enable when kernel support ready.
-		 *
-		 * Enable blkio subsystem.
-		 */
-		/* if (jobacct_gather_cgroup_blkio_init(&slurm_cgroup_conf) */
-		/*     != SLURM_SUCCESS) { */
-		/* 	xcpuinfo_fini(); */
-		/* 	free_slurm_cgroup_conf(&slurm_cgroup_conf); */
-		/* 	return SLURM_ERROR; */
-		/* } */
+		acct_params = slurm_get_jobacct_gather_params();
+		if (acct_params && strstr(acct_params, "CgroupOnly"))
+			cgroup_only = true;
+		xfree(acct_params);
+
+		/* enable blkio cgroup subsystem, disk I/O is only gathered
+		 * from it in CgroupOnly mode */
+		if (cgroup_only) {
+			if (jobacct_gather_cgroup_blkio_init(&slurm_cgroup_conf)
+			    == SLURM_SUCCESS)
+				blkio_enabled = true;
+			else
+				info("%s: blkio cgroup unavailable, disk I/O "
+				     "will not be gathered", plugin_type);
+		}
 	}
 
 	debug("%s loaded", plugin_name);
@@ -255,7 +349,8 @@ extern int fini (void)
 	if (_run_in_daemon()) {
 		jobacct_gather_cgroup_cpuacct_fini(&slurm_cgroup_conf);
 		jobacct_gather_cgroup_memory_fini(&slurm_cgroup_conf);
-		/* jobacct_gather_cgroup_blkio_fini(&slurm_cgroup_conf); */
+		if (blkio_enabled)
+			jobacct_gather_cgroup_blkio_fini(&slurm_cgroup_conf);
 		acct_gather_energy_fini();
 
 		/* unload configuration */
@@ -290,7 +385,10 @@ extern void jobacct_gather_p_poll_data(
 	if (first) {
 		memset(&callbacks, 0, sizeof(jag_callbacks_t));
 		first = 0;
-		callbacks.prec_extra = _prec_extra;
+		if (cgroup_only)
+			callbacks.get_precs = _get_precs_cgroup;
+		else
+			callbacks.prec_extra = _prec_extra;
 	}
 
 	jag_common_poll_data(task_list, pgid_plugin, cont_id, &callbacks,
@@ -316,9 +414,11 @@ extern int jobacct_gather_p_add_task(pid_t pid, jobacct_id_t *jobacct_id)
 	    SLURM_SUCCESS)
 		return SLURM_ERROR;
 
-	/* if (jobacct_gather_cgroup_blkio_attach_task(pid, jobacct_id) != */
-	/*     SLURM_SUCCESS) */
-	/* 	return SLURM_ERROR; */
+	/* disk I/O is optional, do not fail the task without it */
+	if (blkio_enabled &&
+	    (jobacct_gather_cgroup_blkio_attach_task(pid, jobacct_id) !=
+	     SLURM_SUCCESS))
+		debug("%s: unable to attach task to blkio cgroup", plugin_type);
 
 	return SLURM_SUCCESS;
 }
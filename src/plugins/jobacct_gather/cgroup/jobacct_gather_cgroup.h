@@ -64,15 +64,22 @@ extern int jobacct_gather_cgroup_memory_fini(
 extern int jobacct_gather_cgroup_memory_attach_task(
 	pid_t pid, jobacct_id_t *jobacct_id);
 
-/* FIXME: Enable when kernel support ready. */
- /* extern xcgroup_t task_blkio_cg; */
-/* extern int jobacct_gather_cgroup_blkio_init( */
-/* 	slurm_cgroup_conf_t *slurm_cgroup_conf); */
+extern xcgroup_t task_blkio_cg;
 
-/* extern int jobacct_gather_cgroup_blkio_fini( */
-/* 	slurm_cgroup_conf_t *slurm_cgroup_conf); */
+extern int jobacct_gather_cgroup_blkio_init(
+	slurm_cgroup_conf_t *slurm_cgroup_conf);
+
+extern int jobacct_gather_cgroup_blkio_fini(
+	slurm_cgroup_conf_t *slurm_cgroup_conf);
+
+extern int jobacct_gather_cgroup_blkio_attach_task(
+	pid_t pid, jobacct_id_t *jobacct_id);
 
-/* extern int jobacct_gather_cgroup_blkio_attach_task( */
-/* 	pid_t pid, jobacct_id_t *jobacct_id); */
+/* Absolute path of the step cgroup of each subsystem, NULL until the first
+ * task of the step has been attached. Task cgroups are its task_<id>
+ * children. */
+extern char *jobacct_gather_cgroup_cpuacct_step_path(void);
+extern char *jobacct_gather_cgroup_memory_step_path(void);
+extern char *jobacct_gather_cgroup_blkio_step_path(void);
 
 extern char* jobacct_cgroup_create_slurm_cg (xcgroup_ns_t* ns);
@@ -387,3 +387,8 @@ error:
 	xcgroup_destroy(&cpuacct_cg);
 	return fstatus;
 }
+
+extern char *jobacct_gather_cgroup_cpuacct_step_path(void)
+{
+	return step_cpuacct_cg.path;
+}
@@ -401,3 +401,8 @@ error:
 	xcgroup_destroy(&memory_cg);
 	return fstatus;
 }
+
+extern char *jobacct_gather_cgroup_memory_step_path(void)
+{
+	return step_memory_cg.path;
+}
@@ -42,7 +42,6 @@
 #include <fcntl.h>
 #include <signal.h>
 #include <time.h>
-#include <ctype.h>
 
 #include "src/common/slurm_xlator.h"
 #include "src/common/slurm_jobacct_gather.h"
@@ -53,11 +52,11 @@
 #include "src/slurmd/common/proctrack.h"
 
 #include "common_jag.h"
+#include "common_jag_proc.h"
 
 static int cpunfo_frequency = 0;
 static long hertz = 0;
 
-static int my_pagesize = 0;
 static DIR  *slash_proc = NULL;
 static int energy_profile = ENERGY_DATA_NODE_ENERGY_UP;
 static uint64_t debug_flags = 0;
@@ -125,64 +124,6 @@ inline static bool _get_freq(char *str)
 	return true;
 }
 
-/*
- * collects the Pss value from /proc/<pid>/smaps
- */
-static int _get_pss(char *proc_smaps_file, jag_prec_t *prec)
-{
-        uint64_t pss;
-	uint64_t p;
-        char line[128];
-        FILE *fp;
-	int i;
-
-	fp = fopen(proc_smaps_file, "r");
-        if (!fp) {
-                return -1;
-        }
-
-	fcntl(fileno(fp), F_SETFD, FD_CLOEXEC);
-	pss = 0;
-
-        while (fgets(line,sizeof(line),fp)) {
-
-                if (xstrncmp(line, "Pss:", 4) != 0) {
-                        continue;
-                }
-
-                for (i = 4; i < sizeof(line); i++) {
-
-                        if (!isdigit(line[i])) {
-                                continue;
-                        }
-                        if (sscanf(&line[i],"%"PRIu64"", &p) == 1) {
-                                pss += p;
-                        }
-                        break;
-                }
-        }
-
-	/* Check for error
-	 */
-	if (ferror(fp)) {
-		error("%s: ferror() indicates error on file %s",
-		      __func__, proc_smaps_file);
-		fclose(fp);
-		return -1;
-	}
-
-        fclose(fp);
-        /* Sanity checks */
-        if (pss > 0 && prec->rss > pss) {
-                prec->rss = pss;
-        }
-
-	debug3("%s: read pss %"PRIu64" for process %s",
-	       __func__, pss, proc_smaps_file);
-
-        return 0;
-}
-
 static int _get_sys_interface_freq_line(uint32_t cpu, char *filename,
 					char * sbuf)
 {
@@ -229,288 +170,32 @@ static int _get_sys_interface_freq_line(uint32_t cpu, char *filename,
 	return 0;
 }
 
-static int _is_a_lwp(uint32_t pid) {
-
-	FILE		*status_fp = NULL;
-	char		proc_status_file[256];
-	uint32_t        tgid;
-	int             rc;
-
-	if (snprintf(proc_status_file, 256, "/proc/%d/status",pid) > 256) {
-		debug("jobacct_gather_linux: unable to build proc_status "
-		      "fpath");
-		return -1;
-	}
-	if (!(status_fp = fopen(proc_status_file, "r"))) {
-		debug3("jobacct_gather_linux: unable to open %s",
-		       proc_status_file);
-		return -1;
-	}
-
-
-	do {
-		rc = fscanf(status_fp,
-			    "Name:\t%*s\n%*[ \ta-zA-Z0-9:()]\nTgid:\t%d\n",
-			    &tgid);
-	} while (rc < 0 && errno == EINTR);
-	fclose(status_fp);
-
-	/* unable to read /proc/[pid]/status content */
-	if (rc != 1) {
-		debug3("jobacct_gather_linux: unable to read requested "
-		       "pattern in %s", proc_status_file);
-		return -1;
-	}
-
-	/* if tgid differs from pid, this is a LWP (Thread POSIX) */
-	if ((uint32_t) tgid != (uint32_t) pid) {
-		debug3("jobacct_gather_linux: pid=%d is a lightweight process",
-		       tgid);
-		return 1;
-	} else
-		return 0;
-
-}
-
-/* _get_process_data_line() - get line of data from /proc/<pid>/stat
- *
- * IN:	in - input file descriptor
- * OUT:	prec - the destination for the data
- *
- * RETVAL:	==0 - no valid data
- * 		!=0 - data are valid
- *
- * Based upon stat2proc() from the ps command. It can handle arbitrary
- * executable file basenames for `cmd', i.e. those with embedded whitespace or
- * embedded ')'s. Such names confuse %s (see scanf(3)), so the string is split
- * and %39c is used instead. (except for embedded ')' "(%[^)]c)" would work.
- */
-static int _get_process_data_line(int in, jag_prec_t *prec) {
-	char sbuf[256], *tmp;
-	int num_read, nvals;
-	char cmd[40], state[1];
-	int ppid, pgrp, session, tty_nr, tpgid;
-	long unsigned flags, minflt, cminflt, majflt, cmajflt;
-	long unsigned utime, stime, starttime, vsize;
-	long int cutime, cstime, priority, nice, timeout, itrealvalue, rss;
-	long unsigned f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13;
-	int exit_signal, last_cpu;
-
-	num_read = read(in, sbuf, (sizeof(sbuf) - 1));
-	if (num_read <= 0)
-		return 0;
-	sbuf[num_read] = '\0';
-
-	tmp = strrchr(sbuf, ')');	/* split into "PID (cmd" and "<rest>" */
-	*tmp = '\0';			/* replace trailing ')' with NUL */
-	/* parse these two strings separately, skipping the leading "(". */
-	nvals = sscanf(sbuf, "%d (%39c", &prec->pid, cmd);
-	if (nvals < 2)
-		return 0;
-
-	nvals = sscanf(tmp + 2,	 /* skip space after ')' too */
-		       "%c %d %d %d %d %d "
-		       "%lu %lu %lu %lu %lu "
-		       "%lu %lu %ld %ld %ld %ld "
-		       "%ld %ld %lu %lu %ld "
-		       "%lu %lu %lu %lu %lu "
-		       "%lu %lu %lu %lu %lu "
-		       "%lu %lu %lu %d %d ",
-		       state, &ppid, &pgrp, &session, &tty_nr, &tpgid,
-		       &flags, &minflt, &cminflt, &majflt, &cmajflt,
-		       &utime, &stime, &cutime, &cstime, &priority, &nice,
-		       &timeout, &itrealvalue, &starttime, &vsize, &rss,
-		       &f1, &f2, &f3, &f4, &f5 ,&f6, &f7, &f8, &f9, &f10, &f11,
-		       &f12, &f13, &exit_signal, &last_cpu);
-	/* There are some additional fields, which we do not scan or use */
-	if ((nvals < 37) || (rss < 0))
-		return 0;
-
-	/* If current pid corresponds to a Light Weight Process (Thread POSIX) */
-	/* skip it, we will only account the original process (pid==tgid) */
-	if (_is_a_lwp(prec->pid) > 0)
-		return 0;
-
-	/* Copy the values that slurm records into our data structure */
-	prec->ppid  = ppid;
-	prec->pages = majflt;
-	prec->usec  = utime;
-	prec->ssec  = stime;
-	prec->vsize = vsize / 1024; /* convert from bytes to KB */
-	prec->rss   = rss * my_pagesize;/* convert from pages to KB */
-	prec->last_cpu = last_cpu;
-	return 1;
-}
-
-/* _get_process_memory_line() - get line of data from /proc/<pid>/statm
- *
- * IN:	in - input file descriptor
- * OUT:	prec - the destination for the data
- *
- * RETVAL:	==0 - no valid data
- * 		!=0 - data are valid
- *
- * The *prec will mostly be filled in. We need to simply subtract the
- * amount of shared memory used by the process (in KB) from *prec->rss
- * and return the updated struct.
- *
- */
-static int _get_process_memory_line(int in, jag_prec_t *prec)
-{
-	char sbuf[256];
-	int num_read, nvals;
-	long int size, rss, share, text, lib, data, dt;
-
-	num_read = read(in, sbuf, (sizeof(sbuf) - 1));
-	if (num_read <= 0)
-		return 0;
-	sbuf[num_read] = '\0';
-
-	nvals = sscanf(sbuf,
-		       "%ld %ld %ld %ld %ld %ld %ld",
-		       &size, &rss, &share, &text, &lib, &data, &dt);
-	/* There are some additional fields, which we do not scan or use */
-	if (nvals != 7)
-		return 0;
-
-	/* If shared > rss then there is a problem, give up... */
-	if (share > rss) {
-		debug("jobacct_gather_linux: share > rss - bail!");
-		return 0;
-	}
-
-	/* Copy the values that slurm records into our data structure */
-	prec->rss = (rss - share) * my_pagesize; /* convert from pages to KB */
-	return 1;
-}
-
-static int _remove_share_data(char *proc_stat_file, jag_prec_t *prec)
+static void _handle_stats(List prec_list, pid_t pid,
+			  jag_callbacks_t *callbacks)
 {
-	FILE *statm_fp = NULL;
-	char proc_statm_file[256];	/* Allow ~20x extra length */
-	int rc = 0, fd;
-
-	snprintf(proc_statm_file, sizeof(proc_statm_file), "%sm",
-		 proc_stat_file);
-	if (!(statm_fp = fopen(proc_statm_file, "r")))
-		return rc;  /* Assume the process went away */
-	fd = fileno(statm_fp);
-	fcntl(fd, F_SETFD, FD_CLOEXEC);
-	rc = _get_process_memory_line(fd, prec);
-	fclose(statm_fp);
-	return rc;
-}
-
-/* _get_process_io_data_line() - get line of data from /proc/<pid>/io
- *
- * IN:	in - input file descriptor
- * OUT:	prec - the destination for the data
- *
- * RETVAL:	==0 - no valid data
- * 		!=0 - data are valid
- *
- * /proc/<pid>/io content format is:
- * rchar: <# of characters read>
- * wrchar: <# of characters written>
- *   . . .
- */
-static int _get_process_io_data_line(int in, jag_prec_t *prec) {
-	char sbuf[256];
-	char f1[7], f3[7];
-	int num_read, nvals;
-	uint64_t rchar, wchar;
-
-	num_read = read(in, sbuf, (sizeof(sbuf) - 1));
-	if (num_read <= 0)
-		return 0;
-	sbuf[num_read] = '\0';
-
-	nvals = sscanf(sbuf, "%s %"PRIu64" %s %"PRIu64"",
-		       f1, &rchar, f3, &wchar);
-	if (nvals < 4)
-		return 0;
-
-	if (_is_a_lwp(prec->pid) > 0)
-		return 0;
-
-	/* Copy the values that slurm records into our data structure */
-	prec->disk_read = (double)rchar / (double)1048576;
-	prec->disk_write = (double)wchar / (double)1048576;
-
-	return 1;
-}
-
-static void _handle_stats(List prec_list, char *proc_stat_file, char *proc_io_file,
-			  char *proc_smaps_file, jag_callbacks_t *callbacks)
-{
-	static int no_share_data = -1;
-	static int use_pss = -1;
-	FILE *stat_fp = NULL;
-	FILE *io_fp = NULL;
-	int fd, fd2;
+	static uint32_t flags = NO_VAL;
 	jag_prec_t *prec = NULL;
 
-	if (no_share_data == -1) {
+	if (flags == NO_VAL) {
 		char *acct_params = slurm_get_jobacct_gather_params();
+		flags = 0;
 		if (acct_params && strstr(acct_params, "NoShare"))
-			no_share_data = 1;
-		else
-			no_share_data = 0;
-
+			flags |= JAG_PROC_NO_SHARE;
 		if (acct_params && strstr(acct_params, "UsePss"))
-			use_pss = 1;
-		else
-			use_pss = 0;
+			flags |= JAG_PROC_USE_PSS;
 		xfree(acct_params);
 	}
 
-	if (!(stat_fp = fopen(proc_stat_file, "r")))
-		return;  /* Assume the process went away */
-	/*
-	 * Close the file on exec() of user tasks.
-	 *
-	 * NOTE: If we fork() slurmstepd after the
-	 * fopen() above and before the fcntl() below,
-	 * then the user task may have this extra file
-	 * open, which can cause problems for
-	 * checkpoint/restart, but this should be a very rare
-	 * problem in practice.
-	 */
-	fd = fileno(stat_fp);
-	fcntl(fd, F_SETFD, FD_CLOEXEC);
-
 	prec = try_xmalloc(sizeof(jag_prec_t));
-	if (prec == NULL) {	/* Avoid killing slurmstepd on malloc failure */
-		fclose(stat_fp);
+	if (prec == NULL)	/* Avoid killing slurmstepd on malloc failure */
 		return;
-	}
-	if (!_get_process_data_line(fd, prec)) {
+	if (!jag_proc_read(pid, flags, prec)) {
 		xfree(prec);
-		fclose(stat_fp);
 		return;
 	}
-	fclose(stat_fp);
-
-	/* Remove shared data from rss */
-	if (no_share_data)
-		_remove_share_data(proc_stat_file, prec);
-
-	/* Use PSS instead if RSS */
-	if (use_pss) {
-		if (_get_pss(proc_smaps_file, prec) == -1) {
-			xfree(prec);
-			return;
-		}
-	}
 
 	list_append(prec_list, prec);
 
-	if ((io_fp = fopen(proc_io_file, "r"))) {
-		fd2 = fileno(io_fp);
-		fcntl(fd2, F_SETFD, FD_CLOEXEC);
-		_get_process_io_data_line(fd2, prec);
-		fclose(io_fp);
-	}
 	if (callbacks->prec_extra)
 		(*(callbacks->prec_extra))(prec);
 }
@@ -519,12 +204,11 @@ static List _get_precs(List task_list, bool pgid_plugin, uint64_t cont_id,
 		       jag_callbacks_t *callbacks)
 {
 	List prec_list = list_create(destroy_jag_prec);
-	char	proc_stat_file[256];	/* Allow ~20x extra length */
-	char	proc_io_file[256];	/* Allow ~20x extra length */
-	char	proc_smaps_file[256];	/* Allow ~20x extra length */
 	static	int	slash_proc_open = 0;
+	jag_proc_stats_t stats;
 	int i;
 
+	jag_proc_poll_start();
 	if (!pgid_plugin) {
 		pid_t *pids = NULL;
 		int npids = 0;
@@ -544,17 +228,13 @@ static List _get_precs(List task_list, bool pgid_plugin, uint64_t cont_id,
 			debug4("no pids in this container %"PRIu64"", cont_id);
 			goto finished;
 		}
-		for (i = 0; i < npids; i++) {
-			snprintf(proc_stat_file, 256, "/proc/%d/stat", pids[i]);
-			snprintf(proc_io_file, 256, "/proc/%d/io", pids[i]);
-			snprintf(proc_smaps_file, 256, "/proc/%d/smaps", pids[i]);
-			_handle_stats(prec_list, proc_stat_file, proc_io_file,
-				      proc_smaps_file, callbacks);
-		}
+		for (i = 0; i < npids; i++)
+			_handle_stats(prec_list, pids[i], callbacks);
 		xfree(pids);
 	} else {
 		struct dirent *slash_proc_entry;
-		char  *iptr = NULL, *optr = NULL, *optr2 = NULL;
+		char *iptr;
+		pid_t pid;
 
 		if (slash_proc_open) {
 			rewinddir(slash_proc);
@@ -566,83 +246,29 @@ static List _get_precs(List task_list, bool pgid_plugin, uint64_t cont_id,
 			}
 			slash_proc_open=1;
 		}
-		strcpy(proc_stat_file, "/proc/");
-		strcpy(proc_io_file, "/proc/");
-		strcpy(proc_smaps_file, "/proc/");
 
 		while ((slash_proc_entry = readdir(slash_proc))) {
-
-			/* Save a few cyles by simulating
-			 * strcat(statFileName, slash_proc_entry->d_name);
-			 * strcat(statFileName, "/stat");
-			 * while checking for a numeric filename (which really
-			 * should be a pid). Then do the same for the
-			 * /proc/<pid>/io file name.
-			 */
-			optr = proc_stat_file + sizeof("/proc");
-			iptr = slash_proc_entry->d_name;
-			i = 0;
-			do {
-				if ((*iptr < '0') ||
-				    ((*optr++ = *iptr++) > '9')) {
-					i = -1;
-					break;
-				}
-			} while (*iptr);
-
-			if (i == -1)
-				continue;
-			iptr = (char*)"/stat";
-
-			do {
-				*optr++ = *iptr++;
-			} while (*iptr);
-			*optr = 0;
-
-			optr2 = proc_io_file + sizeof("/proc");
-			iptr = slash_proc_entry->d_name;
-			i = 0;
-			do {
-				if ((*iptr < '0') ||
-				    ((*optr2++ = *iptr++) > '9')) {
-					i = -1;
-					break;
-				}
-			} while (*iptr);
-			if (i == -1)
-				continue;
-			iptr = (char*)"/io";
-
-			do {
-				*optr2++ = *iptr++;
-			} while (*iptr);
-			*optr2 = 0;
-
-			optr2 = proc_smaps_file + sizeof("/proc");
+			/* Only numeric file names, which really should be
+			 * pids */
 			iptr = slash_proc_entry->d_name;
-			i = 0;
+			pid = 0;
 			do {
-				if ((*iptr < '0') ||
-				    ((*optr2++ = *iptr++) > '9')) {
-					i = -1;
+				if ((*iptr < '0') || (*iptr > '9')) {
+					pid = 0;
 					break;
 				}
+				pid = (pid * 10) + (*iptr++ - '0');
 			} while (*iptr);
-			if (i == -1)
-				continue;
-			iptr = (char*)"/smaps";
-
-			do {
-				*optr2++ = *iptr++;
-			} while (*iptr);
-			*optr2 = 0;
-
-			_handle_stats(prec_list, proc_stat_file, proc_io_file,
-				      proc_smaps_file,callbacks);
+			if (pid > 0)
+				_handle_stats(prec_list, pid, callbacks);
 		}
 	}
 
 finished:
+	jag_proc_poll_end(&stats);
+	debug2("%s: read %u processes in %"PRIu64" usec (%"PRIu64" usec CPU), "
+	       "opened %u files, %u kept open", __func__, stats.procs,
+	       stats.usec, stats.cpu_usec, stats.opened, stats.open_files);
 
 	return prec_list;
 }
@@ -765,13 +391,14 @@ extern void jag_common_init(long in_hertz)
 		}
 	}
 
-	my_pagesize = getpagesize() / 1024;
+	jag_proc_init(-1);
 }
 
 extern void jag_common_fini(void)
 {
 	if (slash_proc)
 		(void) closedir(slash_proc);
+	jag_proc_fini();
 }
 
 extern void destroy_jag_prec(void *object)
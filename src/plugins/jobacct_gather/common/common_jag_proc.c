@@ -0,0 +1,539 @@
+/*****************************************************************************\
+ *  common_jag_proc.c - sample process data from /proc for job accounting
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "src/common/slurm_xlator.h"
+#include "src/common/xmalloc.h"
+
+#include "common_jag_proc.h"
+
+/* Files of /proc/<pid> kept open between polls */
+enum {
+	JAG_FILE_STAT,
+	JAG_FILE_STATM,
+	JAG_FILE_IO,
+	JAG_FILE_SMAPS,
+	JAG_FILE_CNT
+};
+
+#define JAG_PROC_HASH_SIZE	1024
+#define JAG_READ_BUF_SIZE	4096
+#define JAG_MAX_FILES		16384
+
+typedef struct jag_proc {
+	pid_t pid;
+	int fd[JAG_FILE_CNT];	/* open files of /proc/<pid>, or -1 */
+	bool cached;		/* keep files open after reading them */
+	int is_lwp;		/* thread, not its process: 1, no: 0, or -1 */
+	uint32_t poll;		/* last poll reading this process */
+	struct jag_proc *next;	/* next in hash bucket */
+} jag_proc_t;
+
+static jag_proc_t **proc_hash = NULL;
+static int max_files = -1;
+static int my_pagesize = 0;
+static int smaps_rollup = -1;	/* smaps_rollup exists: 1, no: 0, or -1 */
+static char *read_buf = NULL;
+static int read_buf_size = 0;
+
+static uint32_t poll_cnt = 0;
+static struct timeval poll_start;
+static struct timespec poll_cpu_start;
+static jag_proc_stats_t stats;
+
+static char *_file_name(int file)
+{
+	switch (file) {
+	case JAG_FILE_STAT:
+		return "stat";
+	case JAG_FILE_STATM:
+		return "statm";
+	case JAG_FILE_IO:
+		return "io";
+	case JAG_FILE_SMAPS:
+		return (smaps_rollup == 0) ? "smaps" : "smaps_rollup";
+	}
+	return NULL;
+}
+
+static int _open_file(pid_t pid, const char *name)
+{
+	char path[64];
+	int fd;
+
+	snprintf(path, sizeof(path), "/proc/%d/%s", (int) pid, name);
+	/* Close the file on exec() of user tasks */
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) >= 0) {
+		stats.opened++;
+		return fd;
+	}
+
+	if ((errno == ENOENT) && !strcmp(name, "smaps_rollup") &&
+	    (kill(pid, 0) == 0 || errno == EPERM)) {
+		/* Before Linux 4.14, sum up the Pss of every mapping */
+		smaps_rollup = 0;
+		return _open_file(pid, "smaps");
+	}
+	return -1;
+}
+
+/*
+ * Read all of a /proc/<pid> file into read_buf, NUL terminated. A file
+ * holding one record is read with one pread(). smaps holds a record per
+ * mapping and procfs returns whole records, so it is read until EOF.
+ * RET length read or -1 on error
+ */
+static int _read_file(jag_proc_t *proc, int file)
+{
+	int fd = proc->fd[file], len = 0, n;
+
+	if (fd < 0) {
+		if ((fd = _open_file(proc->pid, _file_name(file))) < 0)
+			return -1;
+		if (proc->cached) {
+			proc->fd[file] = fd;
+			stats.open_files++;
+		}
+	}
+	if (file == JAG_FILE_SMAPS && smaps_rollup == -1)
+		smaps_rollup = 1;
+
+	while (1) {
+		if ((read_buf_size - len) < 2) {
+			read_buf_size *= 2;
+			xrealloc_nz(read_buf, read_buf_size);
+		}
+		n = pread(fd, read_buf + len, read_buf_size - len - 1, len);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			len = -1;
+			break;
+		}
+		len += n;
+		if ((n == 0) || (file != JAG_FILE_SMAPS) || smaps_rollup)
+			break;
+	}
+	if (!proc->cached)
+		close(fd);
+	if (len >= 0)
+		read_buf[len] = '\0';
+	return len;
+}
+
+static void _close_files(jag_proc_t *proc)
+{
+	int i;
+
+	for (i = 0; i < JAG_FILE_CNT; i++) {
+		if (proc->fd[i] < 0)
+			continue;
+		close(proc->fd[i]);
+		proc->fd[i] = -1;
+		stats.open_files--;
+	}
+	proc->is_lwp = -1;
+}
+
+/* Parse a decimal number, skipping leading spaces. RET the character after
+ * the number or NULL if there is none */
+static char *_parse_num(char *p, int64_t *val)
+{
+	int64_t v = 0;
+	bool neg = false;
+
+	while (*p == ' ')
+		p++;
+	if (*p == '-') {
+		neg = true;
+		p++;
+	}
+	if ((*p < '0') || (*p > '9'))
+		return NULL;
+	do {
+		v = (v * 10) + (*p++ - '0');
+	} while ((*p >= '0') && (*p <= '9'));
+
+	*val = neg ? -v : v;
+	return p;
+}
+
+/* Find the value of a "Name:\tvalue" line of a /proc file */
+static char *_find_field(char *buf, const char *name)
+{
+	int len = strlen(name);
+	char *p = buf;
+
+	while (p) {
+		if (!strncmp(p, name, len) && (p[len] == ':'))
+			return p + len + 1;
+		if ((p = strchr(p, '\n')))
+			p++;
+	}
+	return NULL;
+}
+
+/* Check /proc/<pid>/status for a Tgid differing from the pid, i.e. a light
+ * weight process (POSIX thread). Only the main thread is accounted. */
+static int _is_a_lwp(pid_t pid)
+{
+	char buf[512], path[64], *p;
+	int64_t tgid;
+	int fd, n;
+
+	snprintf(path, sizeof(path), "/proc/%d/status", (int) pid);
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0) {
+		debug3("%s: unable to open %s", __func__, path);
+		return -1;
+	}
+	while (((n = read(fd, buf, sizeof(buf) - 1)) < 0) && (errno == EINTR))
+		;
+	close(fd);
+	if (n <= 0)
+		return -1;
+	buf[n] = '\0';
+
+	if (!(p = _find_field(buf, "Tgid")) || !_parse_num(p + 1, &tgid)) {
+		debug3("%s: unable to read Tgid in %s", __func__, path);
+		return -1;
+	}
+
+	if ((pid_t) tgid != pid) {
+		debug3("%s: pid=%d is a lightweight process",
+		       __func__, (int) pid);
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Parse /proc/<pid>/stat. The command name may hold spaces and ')', so the
+ * fields are counted from the last ')'. Field numbers are as in proc(5).
+ */
+static int _parse_stat(char *buf, jag_prec_t *prec)
+{
+	char *p;
+	int64_t val, rss = 0;
+	int field;
+
+	if (!_parse_num(buf, &val))
+		return 0;
+	prec->pid = val;
+	if (!(p = strrchr(buf, ')')))
+		return 0;
+	p++;
+
+	/* There are additional fields after 39, which we do not use */
+	for (field = 3; field <= 39; field++) {
+		while (*p == ' ')
+			p++;
+		if (*p == '\0')
+			return 0;
+		switch (field) {
+		case 4:
+		case 12:
+		case 14:
+		case 15:
+		case 23:
+		case 24:
+		case 39:
+			if (!(p = _parse_num(p, &val)))
+				return 0;
+			break;
+		default:
+			while (*p && (*p != ' '))
+				p++;
+			continue;
+		}
+		switch (field) {
+		case 4:
+			prec->ppid = val;
+			break;
+		case 12:
+			prec->pages = val;	/* majflt */
+			break;
+		case 14:
+			prec->usec = val;
+			break;
+		case 15:
+			prec->ssec = val;
+			break;
+		case 23:
+			prec->vsize = val / 1024; /* convert from bytes to KB */
+			break;
+		case 24:
+			rss = val;
+			break;
+		case 39:
+			prec->last_cpu = val;
+			break;
+		}
+	}
+	if (rss < 0)
+		return 0;
+	prec->rss = rss * my_pagesize;	/* convert from pages to KB */
+	return 1;
+}
+
+/* Subtract the process' shared memory from its rss using
+ * /proc/<pid>/statm: size resident shared text lib data dt */
+static int _parse_statm(char *buf, jag_prec_t *prec)
+{
+	int64_t size, rss, share;
+	char *p;
+
+	if (!(p = _parse_num(buf, &size)) || !(p = _parse_num(p, &rss)) ||
+	    !_parse_num(p, &share))
+		return 0;
+
+	/* If shared > rss then there is a problem, give up... */
+	if (share > rss) {
+		debug("jobacct_gather_linux: share > rss - bail!");
+		return 0;
+	}
+
+	prec->rss = (rss - share) * my_pagesize; /* convert from pages to KB */
+	return 1;
+}
+
+/* Parse /proc/<pid>/io, which starts with:
+ * rchar: <# of characters read>
+ * wchar: <# of characters written> */
+static int _parse_io(char *buf, jag_prec_t *prec)
+{
+	int64_t rchar, wchar;
+	char *p;
+
+	if (!(p = _find_field(buf, "rchar")) || !_parse_num(p, &rchar) ||
+	    !(p = _find_field(p, "wchar")) || !_parse_num(p, &wchar))
+		return 0;
+
+	prec->disk_read = (double)rchar / (double)1048576;
+	prec->disk_write = (double)wchar / (double)1048576;
+	return 1;
+}
+
+/* Sum the Pss of /proc/<pid>/smaps_rollup, or of every mapping in
+ * /proc/<pid>/smaps, and use it as the rss if smaller */
+static int _parse_smaps(char *buf, jag_prec_t *prec)
+{
+	uint64_t pss = 0;
+	int64_t val;
+	char *p = buf;
+
+	while ((p = _find_field(p, "Pss"))) {
+		if ((p = _parse_num(p, &val)))
+			pss += val;
+		else
+			break;
+	}
+
+	/* Sanity checks */
+	if (pss > 0 && prec->rss > pss)
+		prec->rss = pss;
+
+	debug3("%s: read pss %"PRIu64" for process %d",
+	       __func__, pss, prec->pid);
+	return 1;
+}
+
+static jag_proc_t *_find_proc(pid_t pid)
+{
+	jag_proc_t *proc = proc_hash[pid % JAG_PROC_HASH_SIZE];
+
+	while (proc && (proc->pid != pid))
+		proc = proc->next;
+	return proc;
+}
+
+/* Add a process to the hash table if its files fit within max_files,
+ * otherwise use tmp to read the process once */
+static jag_proc_t *_add_proc(pid_t pid, jag_proc_t *tmp)
+{
+	jag_proc_t *proc = tmp;
+	int i;
+
+	if ((stats.open_files + JAG_FILE_CNT) <= max_files) {
+		proc = xmalloc(sizeof(jag_proc_t));
+		proc->cached = true;
+		proc->next = proc_hash[pid % JAG_PROC_HASH_SIZE];
+		proc_hash[pid % JAG_PROC_HASH_SIZE] = proc;
+	} else {
+		memset(tmp, 0, sizeof(jag_proc_t));
+	}
+	proc->pid = pid;
+	proc->is_lwp = -1;
+	for (i = 0; i < JAG_FILE_CNT; i++)
+		proc->fd[i] = -1;
+	return proc;
+}
+
+extern void jag_proc_init(int files)
+{
+	struct rlimit rlim;
+
+	if (files < 0) {
+		if (getrlimit(RLIMIT_NOFILE, &rlim) < 0)
+			files = 0;
+		else if (rlim.rlim_cur == RLIM_INFINITY)
+			files = JAG_MAX_FILES;
+		else
+			files = MIN(rlim.rlim_cur / 4, JAG_MAX_FILES);
+	}
+	max_files = files;
+
+	if (!proc_hash)
+		proc_hash = xmalloc(sizeof(jag_proc_t *) * JAG_PROC_HASH_SIZE);
+	if (!read_buf) {
+		read_buf_size = JAG_READ_BUF_SIZE;
+		read_buf = xmalloc_nz(read_buf_size);
+	}
+	my_pagesize = getpagesize() / 1024;
+}
+
+extern void jag_proc_fini(void)
+{
+	jag_proc_t *proc, *next;
+	int i;
+
+	if (!proc_hash)
+		return;
+	for (i = 0; i < JAG_PROC_HASH_SIZE; i++) {
+		for (proc = proc_hash[i]; proc; proc = next) {
+			next = proc->next;
+			_close_files(proc);
+			xfree(proc);
+		}
+	}
+	xfree(proc_hash);
+	xfree(read_buf);
+	read_buf_size = 0;
+}
+
+extern void jag_proc_poll_start(void)
+{
+	if (!proc_hash)
+		jag_proc_init(-1);
+	poll_cnt++;
+	stats.procs = 0;
+	stats.opened = 0;
+	gettimeofday(&poll_start, NULL);
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &poll_cpu_start);
+}
+
+extern int jag_proc_read(pid_t pid, uint32_t flags, jag_prec_t *prec)
+{
+	jag_proc_t tmp, *proc;
+	bool was_open;
+
+	if (!(proc = _find_proc(pid)))
+		proc = _add_proc(pid, &tmp);
+	proc->poll = poll_cnt;
+
+	/* Files kept open refer to the process that had this pid when they
+	 * were opened. If it is gone, the pid may have been reused. */
+	was_open = (proc->fd[JAG_FILE_STAT] >= 0);
+	if (_read_file(proc, JAG_FILE_STAT) <= 0) {
+		_close_files(proc);
+		if (!was_open || (_read_file(proc, JAG_FILE_STAT) <= 0))
+			return 0;  /* Assume the process went away */
+	}
+
+	if (proc->is_lwp == -1)
+		proc->is_lwp = _is_a_lwp(pid);
+	/* If current pid corresponds to a Light Weight Process (Thread POSIX)
+	 * skip it, we will only account the original process (pid==tgid) */
+	if (proc->is_lwp > 0)
+		return 0;
+
+	memset(prec, 0, sizeof(jag_prec_t));
+	if (!_parse_stat(read_buf, prec))
+		return 0;
+	stats.procs++;
+
+	/* Remove shared data from rss */
+	if ((flags & JAG_PROC_NO_SHARE) &&
+	    (_read_file(proc, JAG_FILE_STATM) > 0))
+		_parse_statm(read_buf, prec);
+
+	/* Use PSS instead if RSS */
+	if ((flags & JAG_PROC_USE_PSS) &&
+	    ((_read_file(proc, JAG_FILE_SMAPS) < 0) ||
+	     !_parse_smaps(read_buf, prec)))
+		return 0;
+
+	if (_read_file(proc, JAG_FILE_IO) > 0)
+		_parse_io(read_buf, prec);
+
+	return 1;
+}
+
+extern void jag_proc_poll_end(jag_proc_stats_t *out)
+{
+	jag_proc_t **prev, *proc;
+	struct timeval now;
+	struct timespec cpu_now;
+	int i;
+
+	/* Close the files of processes which have gone away */
+	for (i = 0; i < JAG_PROC_HASH_SIZE; i++) {
+		prev = &proc_hash[i];
+		while ((proc = *prev)) {
+			if (proc->poll == poll_cnt) {
+				prev = &proc->next;
+				continue;
+			}
+			*prev = proc->next;
+			_close_files(proc);
+			xfree(proc);
+		}
+	}
+
+	gettimeofday(&now, NULL);
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_now);
+	stats.usec = ((now.tv_sec - poll_start.tv_sec) * 1000000) +
+		     (now.tv_usec - poll_start.tv_usec);
+	stats.cpu_usec =
+		((cpu_now.tv_sec - poll_cpu_start.tv_sec) * 1000000) +
+		((cpu_now.tv_nsec - poll_cpu_start.tv_nsec) / 1000);
+	if (out)
+		*out = stats;
+}
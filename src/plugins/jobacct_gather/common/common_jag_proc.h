@@ -0,0 +1,87 @@
+/*****************************************************************************\
+ *  common_jag_proc.h - sample process data from /proc for job accounting
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef __COMMON_JAG_PROC_H__
+#define __COMMON_JAG_PROC_H__
+
+#include <inttypes.h>
+#include <sys/types.h>
+
+#include "common_jag.h"
+
+/* Flags for jag_proc_read() */
+#define JAG_PROC_NO_SHARE	0x0001	/* Remove shared memory from rss */
+#define JAG_PROC_USE_PSS	0x0002	/* Use smaps Pss as rss, skip the
+					 * process if unavailable */
+
+typedef struct jag_proc_stats {
+	uint32_t procs;		/* processes read by the last poll */
+	uint32_t opened;	/* files opened by the last poll */
+	uint32_t open_files;	/* files kept open for the next poll */
+	uint64_t usec;		/* wall clock time of the last poll */
+	uint64_t cpu_usec;	/* CPU time of the last poll */
+} jag_proc_stats_t;
+
+/*
+ * jag_proc_init - initialize the process sampler
+ * IN max_files - most /proc files to keep open between polls, -1 for a
+ *	quarter of the open file limit, 0 to open and close every file on
+ *	every read
+ */
+extern void jag_proc_init(int max_files);
+
+/* Close all files kept open and release the sampler's memory */
+extern void jag_proc_fini(void);
+
+/* Start a poll, which reads some processes with jag_proc_read() */
+extern void jag_proc_poll_start(void);
+
+/*
+ * jag_proc_read - read a process' data from /proc/<pid>/stat and related
+ *	files, keeping them open for the next poll
+ * IN pid - process to read
+ * IN flags - JAG_PROC_* flags
+ * OUT prec - the process' data
+ * RET 1 if the data is valid, 0 if the process is gone, is a thread other
+ *	than its process' main thread or its data could not be read
+ */
+extern int jag_proc_read(pid_t pid, uint32_t flags, jag_prec_t *prec);
+
+/*
+ * jag_proc_poll_end - end a poll, closing the files of processes it did not
+ *	read
+ * OUT stats - the poll's statistics, may be NULL
+ */
+extern void jag_proc_poll_end(jag_proc_stats_t *stats);
+
+#endif
@@ -42,34 +42,53 @@
 #include <math.h>
 #include <stdlib.h>
 
+#include "src/common/timers.h"
+
 #include "fair_tree.h"
 
-static int  _ft_decay_apply_new_usage(struct job_record *job, time_t *start);
+/* Fair Tree state of an account, kept in usage->fs_data. The children array
+ * follows the struct in the same xmalloc'ed block. */
+typedef struct {
+	bool ranked;		/* rank_* and rnt_* below are valid */
+	bool tied_in;		/* account_tied when last ranked */
+	uint32_t rank_in;	/* rank and rnt when last ranked */
+	uint32_t rnt_in;
+	uint32_t rank_out;	/* rank and rnt after ranking the subtree */
+	uint32_t rnt_out;
+	slurmdb_assoc_rec_t **children; /* children sorted by level_fs,
+					 * null terminated */
+} ft_data_t;
+
+static uint32_t last_tree_update = NO_VAL; /* g_assoc_tree_update of the
+					    * last full calculation */
+static uint32_t last_user_assoc_count = NO_VAL;
+
 static void _apply_priority_fs(void);
+static void _calc_tree_fs(slurmdb_assoc_rec_t** siblings,
+			  uint16_t assoc_level, uint32_t *rank,
+			  uint32_t *rnt, bool account_tied, bool full);
 
 /* Fair Tree code called from the decay thread loop */
 extern void fair_tree_decay(List jobs, time_t start)
 {
-	slurmctld_lock_t job_write_lock =
-		{ NO_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK, NO_LOCK };
 	assoc_mgr_lock_t locks =
 		{ WRITE_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
 		  NO_LOCK, NO_LOCK, NO_LOCK };
+	DEF_TIMERS;
 
 	/* apply decayed usage */
-	lock_slurmctld(job_write_lock);
-	list_for_each(jobs, (ListForF) _ft_decay_apply_new_usage, &start);
-	unlock_slurmctld(job_write_lock);
+	decay_apply_job_usage(jobs, start);
 
 	/* calculate fs factor for associations */
+	START_TIMER;
 	assoc_mgr_lock(&locks);
 	_apply_priority_fs();
 	assoc_mgr_unlock(&locks);
+	END_TIMER;
+	slurmctld_diag_stats.prio_fs_time = DELTA_TIMER;
 
 	/* assign job priorities */
-	lock_slurmctld(job_write_lock);
-	list_for_each(jobs, (ListForF) decay_apply_weighted_factors, &start);
-	unlock_slurmctld(job_write_lock);
+	decay_apply_job_priorities(jobs, start);
 }
 
 
@@ -88,18 +107,6 @@ static void _ft_set_assoc_usage_efctv(slurmdb_assoc_rec_t *assoc)
 }
 
 
-/* Apply usage with decay factor. Call standard functions */
-static int _ft_decay_apply_new_usage(struct job_record *job, time_t *start)
-{
-	/* Always return SUCCESS so that list_for_each will
-	 * continue processing list of jobs. For this reason,
-	 * don't call decay_apply_new_usage() directly. */
-	decay_apply_new_usage(job, start);
-
-	return SLURM_SUCCESS;
-}
-
-
 static void _ft_debug(slurmdb_assoc_rec_t *assoc,
 		      uint16_t assoc_level, bool tied)
 {
@@ -291,13 +298,117 @@ static slurmdb_assoc_rec_t** _merge_accounts(
 		}
 
 		merged = _append_list_to_array(children, merged, &merged_size);
+
+		/* The cached order of these children is not used, so sort
+		 * them again when this account is next ranked alone */
+		siblings[i]->usage->fs_dirty = true;
 	}
+
+	/* Calculate level_fs for each child then sort them */
+	for (i = 0; i < merged_size; i++)
+		_calc_assoc_fs(merged[i]);
+	qsort(merged, merged_size, sizeof(slurmdb_assoc_rec_t *),
+	      _cmp_level_fs);
+
 	return merged;
 }
 
 
-/* Calculate fairshare for each child then sort children by fairshare value
- * (level_fs). Once they are sorted, operate on each child in sorted order.
+/* Return the children of an account sorted by level_fs.
+ *
+ * level_fs of a child only depends on its own usage and shares and on the
+ * usage of the account, so the children need to be recalculated and sorted
+ * again only if the account is marked dirty. Decaying usage scales every
+ * association equally and so does not change level_fs.
+ *
+ * IN assoc - account
+ * IN full - rebuild the array from the children list
+ * RET - null terminated array of the children, owned by the account
+ */
+static slurmdb_assoc_rec_t** _sorted_children(slurmdb_assoc_rec_t *assoc,
+					      bool full)
+{
+	ft_data_t *data = (ft_data_t *)assoc->usage->fs_data;
+	List children = assoc->usage->children_list;
+	slurmdb_assoc_rec_t *child;
+	ListIterator itr;
+	size_t i, count;
+
+	if (full || !data) {
+		count = children ? list_count(children) : 0;
+		xfree(assoc->usage->fs_data);
+		data = xmalloc(sizeof(ft_data_t) +
+			       sizeof(slurmdb_assoc_rec_t *) * (count + 1));
+		data->children = (slurmdb_assoc_rec_t **)(data + 1);
+		if (count) {
+			i = 0;
+			itr = list_iterator_create(children);
+			while ((child = list_next(itr)))
+				data->children[i++] = child;
+			list_iterator_destroy(itr);
+		}
+		assoc->usage->fs_data = data;
+		assoc->usage->fs_dirty = true;
+	}
+
+	if (assoc->usage->fs_dirty) {
+		/* Calculate level_fs for each child */
+		for (i = 0; (child = data->children[i]); i++)
+			_calc_assoc_fs(child);
+
+		/* Sort children by level_fs */
+		qsort(data->children, i, sizeof(slurmdb_assoc_rec_t *),
+		      _cmp_level_fs);
+		data->ranked = false;
+	}
+
+	return data->children;
+}
+
+
+/* Rank the users below an account. If neither the subtree nor the ranking
+ * it starts with changed since it was last ranked, the fs_factor of its users
+ * are all still valid, so just skip to the rank it ended with.
+ *
+ * IN assoc - account
+ * IN assoc_level - depth in the tree of the account's children
+ * IN/OUT rank - current user ranking
+ * IN/OUT rnt - rank, no ties
+ * IN account_tied - is this account tied with the previous user
+ * IN full - recalculate everything
+ */
+static void _calc_account_fs(slurmdb_assoc_rec_t *assoc,
+			     uint16_t assoc_level, uint32_t *rank,
+			     uint32_t *rnt, bool account_tied, bool full)
+{
+	ft_data_t *data = (ft_data_t *)assoc->usage->fs_data;
+	slurmdb_assoc_rec_t** children;
+
+	if (!full && !priority_debug && data && data->ranked &&
+	    !assoc->usage->fs_dirty &&
+	    (data->rank_in == *rank) && (data->rnt_in == *rnt) &&
+	    (data->tied_in == account_tied)) {
+		*rank = data->rank_out;
+		*rnt = data->rnt_out;
+		return;
+	}
+
+	children = _sorted_children(assoc, full);
+	data = (ft_data_t *)assoc->usage->fs_data;
+	data->rank_in = *rank;
+	data->rnt_in = *rnt;
+	data->tied_in = account_tied;
+
+	_calc_tree_fs(children, assoc_level, rank, rnt, account_tied, full);
+
+	data->rank_out = *rank;
+	data->rnt_out = *rnt;
+	data->ranked = true;
+	assoc->usage->fs_dirty = false;
+}
+
+
+/* Operate on each child in order of fairshare value (level_fs).
  * This portion of the tree is now sorted and users are given a fairshare value
  * based on the order they are operated on. The basic equation is
  * (rank / g_user_assoc_count), though ties are allowed. The rank is
@@ -310,28 +421,22 @@ static slurmdb_assoc_rec_t** _merge_accounts(
  *	3) A user with the same level_fs as a sibling account will receive
  *	   the same rank as the account's highest ranked user
  *
- * IN siblings - array of siblings
+ * IN siblings - array of siblings, sorted by level_fs
  * IN assoc_level - depth in the tree (root is 0)
  * IN/OUT rank - current user ranking, starting at g_user_assoc_count
  * IN/OUT rnt - rank, no ties (what rank would be if no tie exists)
  * IN account_tied - is this account tied with the previous user
+ * IN full - recalculate every association rather than dirty ones
  */
 static void _calc_tree_fs(slurmdb_assoc_rec_t** siblings,
 			  uint16_t assoc_level, uint32_t *rank,
-			  uint32_t *rnt, bool account_tied)
+			  uint32_t *rnt, bool account_tied, bool full)
 {
 	slurmdb_assoc_rec_t *assoc = NULL;
 	long double prev_level_fs = (long double) NO_VAL;
 	bool tied = false;
 	size_t i;
 
-	/* Calculate level_fs for each child */
-	for (i = 0; (assoc = siblings[i]); i++)
-		_calc_assoc_fs(assoc);
-
-	/* Sort children by level_fs */
-	qsort(siblings, i, sizeof(slurmdb_assoc_rec_t *), _cmp_level_fs);
-
 	/* Iterate through children in sorted order. If it's a user, calculate
 	 * fs_factor, otherwise recurse. */
 	for (i = 0; (assoc = siblings[i]); i++) {
@@ -357,12 +462,20 @@ static void _calc_tree_fs(slurmdb_assoc_rec_t** siblings,
 
 			assoc->usage->fs_factor =
 				*rank / (double) g_user_assoc_count;
+			assoc->usage->fs_dirty = false;
 
 			(*rnt)--;
 		} else {
 			slurmdb_assoc_rec_t** children;
 			size_t merge_count = _count_tied_accounts(siblings, i);
 
+			if (!merge_count) {
+				_calc_account_fs(assoc, assoc_level + 1,
+						 rank, rnt, tied, full);
+				prev_level_fs = assoc->usage->level_fs;
+				continue;
+			}
+
 			/* Merging does not affect child level_fs calculations
 			 * since the necessary information is stored on each
 			 * assoc's usage struct */
@@ -371,7 +484,7 @@ static void _calc_tree_fs(slurmdb_assoc_rec_t** siblings,
 						   assoc_level);
 
 			_calc_tree_fs(children, assoc_level+1,
-				      rank, rnt, tied);
+				      rank, rnt, tied, full);
 
 			/* Skip over any merged accounts */
 			i += merge_count;
@@ -384,26 +497,30 @@ static void _calc_tree_fs(slurmdb_assoc_rec_t** siblings,
 }
 
 
-/* Start fairshare calculations at root. Call assoc_mgr_lock before this. */
+/* Start fairshare calculations at root. Call assoc_mgr_lock before this.
+ *
+ * New job usage marks each association it is added to dirty, up to root, so
+ * only the children of dirty accounts have their level_fs recalculated and
+ * are sorted again. Everything is recalculated after associations or their
+ * shares or usage change in some other way.
+ */
 static void _apply_priority_fs(void)
 {
-	slurmdb_assoc_rec_t** children = NULL;
 	uint32_t rank = g_user_assoc_count;
 	uint32_t rnt = rank;
-	size_t child_count = 0;
+	bool full = false;
 
 	if (priority_debug)
 		info("Fair Tree fairshare algorithm, starting at root:");
 
-	assoc_mgr_root_assoc->usage->level_fs = (long double) NO_VAL;
-
-	/* _calc_tree_fs requires an array instead of List */
-	children = _append_list_to_array(
-		assoc_mgr_root_assoc->usage->children_list,
-		children,
-		&child_count);
+	if ((last_tree_update != g_assoc_tree_update) ||
+	    (last_user_assoc_count != g_user_assoc_count)) {
+		last_tree_update = g_assoc_tree_update;
+		last_user_assoc_count = g_user_assoc_count;
+		full = true;
+	}
 
-	_calc_tree_fs(children, 0, &rank, &rnt, false);
+	assoc_mgr_root_assoc->usage->level_fs = (long double) NO_VAL;
 
-	xfree(children);
+	_calc_account_fs(assoc_mgr_root_assoc, 0, &rank, &rnt, false, full);
 }
@@ -61,10 +61,12 @@
 #include "src/common/parse_time.h"
 #include "src/common/slurm_mcs.h"
 #include "src/common/slurm_time.h"
+#include "src/common/timers.h"
 #include "src/common/xstring.h"
 #include "src/common/gres.h"
 
 #include "src/slurmctld/licenses.h"
+#include "src/slurmctld/prio_queue.h"
 #include "src/slurmctld/read_config.h"
 
 #include "fair_tree.h"
@@ -74,6 +76,9 @@
 
 #define MIN_USAGE_FACTOR 0.01
 
+#define PRIO_CALC_CHUNK		64	/* jobs taken at once by a worker */
+#define PRIO_MAX_THREADS	64	/* most priority calculation threads */
+
 /* These are defined here so when we link with something other than
  * the slurmctld we will have these symbols defined.  They will get
  * overwritten when linking with the slurmctld.
@@ -87,6 +92,7 @@ uint16_t part_max_priority __attribute__((weak_import)) = 0;
 slurm_ctl_conf_t slurmctld_conf __attribute__((weak_import));
 int slurmctld_tres_cnt __attribute__((weak_import)) = 0;
 int accounting_enforce __attribute__((weak_import)) = 0;
+diag_stats_t slurmctld_diag_stats __attribute__((weak_import));
 #else
 void *acct_db_conn = NULL;
 uint32_t cluster_cpus = NO_VAL;
@@ -96,6 +102,7 @@ uint16_t part_max_priority = 0;
 slurm_ctl_conf_t slurmctld_conf;
 int slurmctld_tres_cnt = 0;
 int accounting_enforce = 0;
+diag_stats_t slurmctld_diag_stats;
 #endif
 
 /*
@@ -149,12 +156,39 @@ static uint32_t prevflags;    /* Priority Flags before _internal_setup() resets
 			       * flags after a reconfigure */
 static time_t g_last_ran = 0; /* when the last poll ran */
 static double decay_factor = 1; /* The decay factor when decaying time. */
+static int calc_threads = 1; /* threads calculating job priorities */
+static pthread_mutex_t calc_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t usage_efctv_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Priority of one job calculated by decay_apply_job_priorities() */
+typedef struct prio_calc {
+	struct job_record *job_ptr;	/* valid only under the read lock */
+	uint32_t job_id;
+	uint32_t priority;
+	priority_factors_object_t *prio_factors; /* NULL to clear */
+	uint32_t *priority_array;	/* priority by partition */
+	int priority_array_cnt;
+} prio_calc_t;
+
+typedef struct prio_calc_args {
+	prio_calc_t *calc;		/* jobs to calculate */
+	int calc_cnt;
+	int calc_next;			/* next job to take, under calc_lock */
+	time_t start_time;
+} prio_calc_args_t;
 
 /* variables defined in prirority_multifactor.h */
 bool priority_debug = 0;
 
+static void _calc_priority_factors(time_t start_time,
+				   struct job_record *job_ptr,
+				   priority_factors_object_t *factors,
+				   bool assoc_locked);
 static void _priority_p_set_assoc_usage_debug(slurmdb_assoc_rec_t *assoc);
 static void _set_assoc_usage_efctv(slurmdb_assoc_rec_t *assoc);
+static uint32_t _weigh_priority_factors(struct job_record *job_ptr,
+					priority_factors_object_t *factors,
+					uint32_t *priority_array);
 
 /*
  * apply decay factor to all associations usage_raw
@@ -242,6 +276,7 @@ static int _reset_usage(void)
 		assoc->usage->grp_used_wall = 0;
 	}
 	list_iterator_destroy(itr);
+	g_assoc_tree_update++;
 
 	itr = list_iterator_create(assoc_mgr_qos_list);
 	while ((qos = list_next(itr))) {
@@ -429,8 +464,10 @@ static int _set_children_usage_efctv(List children_list)
 
 /* job_ptr should already have the partition priority and such added here
  * before had we will be adding to it
+ * IN assoc_locked - caller holds a read lock on associations
  */
-static double _get_fairshare_priority(struct job_record *job_ptr)
+static double _get_fairshare_priority(struct job_record *job_ptr,
+				      bool assoc_locked)
 {
 	slurmdb_assoc_rec_t *job_assoc;
 	slurmdb_assoc_rec_t *fs_assoc = NULL;
@@ -441,12 +478,14 @@ static double _get_fairshare_priority(struct job_record *job_ptr)
 	if (!calc_fairshare)
 		return 0;
 
-	assoc_mgr_lock(&locks);
+	if (!assoc_locked)
+		assoc_mgr_lock(&locks);
 
 	job_assoc = (slurmdb_assoc_rec_t *)job_ptr->assoc_ptr;
 
 	if (!job_assoc) {
-		assoc_mgr_unlock(&locks);
+		if (!assoc_locked)
+			assoc_mgr_unlock(&locks);
 		error("Job %u has no association.  Unable to "
 		      "compute fairshare.", job_ptr->job_id);
 		return 0;
@@ -458,8 +497,13 @@ static double _get_fairshare_priority(struct job_record *job_ptr)
 	else
 		fs_assoc = job_assoc;
 
-	if (fuzzy_equal(fs_assoc->usage->usage_efctv, NO_VAL))
-		priority_p_set_assoc_usage(fs_assoc);
+	/* Several threads may get here holding only a read lock */
+	if (fuzzy_equal(fs_assoc->usage->usage_efctv, NO_VAL)) {
+		slurm_mutex_lock(&usage_efctv_lock);
+		if (fuzzy_equal(fs_assoc->usage->usage_efctv, NO_VAL))
+			priority_p_set_assoc_usage(fs_assoc);
+		slurm_mutex_unlock(&usage_efctv_lock);
+	}
 
 	/* Priority is 0 -> 1 */
 	if (flags & PRIORITY_FLAGS_FAIR_TREE) {
@@ -482,7 +526,8 @@ static double _get_fairshare_priority(struct job_record *job_ptr)
 			     fs_assoc->usage->shares_norm, priority_fs);
 		}
 	}
-	assoc_mgr_unlock(&locks);
+	if (!assoc_locked)
+		assoc_mgr_unlock(&locks);
 
 	return priority_fs;
 }
@@ -492,10 +537,7 @@ static double _get_fairshare_priority(struct job_record *job_ptr)
 static uint32_t _get_priority_internal(time_t start_time,
 				       struct job_record *job_ptr)
 {
-	double priority	= 0.0;
-	priority_factors_object_t pre_factors;
-	uint64_t tmp_64;
-	double tmp_tres = 0.0;
+	int i;
 
 	if (job_ptr->direct_set_prio && (job_ptr->priority > 0)) {
 		if (job_ptr->prio_factors) {
@@ -520,31 +562,49 @@ static uint32_t _get_priority_internal(time_t start_time,
 		return 0;
 	}
 
+	if (job_ptr->part_ptr_list && !job_ptr->priority_array) {
+		i = list_count(job_ptr->part_ptr_list) + 1;
+		job_ptr->priority_array = xmalloc(sizeof(uint32_t) * i);
+	}
+
 	set_priority_factors(start_time, job_ptr);
 
+	return _weigh_priority_factors(job_ptr, job_ptr->prio_factors,
+				       job_ptr->priority_array);
+}
+
+/* Apply the weights to the priority factors of a job, set the priority of
+ * each of its partitions in priority_array and return its priority */
+static uint32_t _weigh_priority_factors(struct job_record *job_ptr,
+					priority_factors_object_t *factors,
+					uint32_t *priority_array)
+{
+	double priority	= 0.0;
+	priority_factors_object_t pre_factors;
+	uint64_t tmp_64;
+	double tmp_tres = 0.0;
+
 	if (priority_debug) {
-		memcpy(&pre_factors, job_ptr->prio_factors,
-		       sizeof(priority_factors_object_t));
-		if (job_ptr->prio_factors->priority_tres) {
+		memcpy(&pre_factors, factors, sizeof(priority_factors_object_t));
+		if (factors->priority_tres) {
 			pre_factors.priority_tres = xmalloc(sizeof(double) *
 							    slurmctld_tres_cnt);
-			memcpy(pre_factors.priority_tres,
-			       job_ptr->prio_factors->priority_tres,
+			memcpy(pre_factors.priority_tres, factors->priority_tres,
 			       sizeof(double) * slurmctld_tres_cnt);
 		}
 	} else	/* clang needs this memset to avoid a warning */
 		memset(&pre_factors, 0, sizeof(priority_factors_object_t));
 
-	job_ptr->prio_factors->priority_age  *= (double)weight_age;
-	job_ptr->prio_factors->priority_fs   *= (double)weight_fs;
-	job_ptr->prio_factors->priority_js   *= (double)weight_js;
-	job_ptr->prio_factors->priority_part *= (double)weight_part;
-	job_ptr->prio_factors->priority_qos  *= (double)weight_qos;
+	factors->priority_age  *= (double)weight_age;
+	factors->priority_fs   *= (double)weight_fs;
+	factors->priority_js   *= (double)weight_js;
+	factors->priority_part *= (double)weight_part;
+	factors->priority_qos  *= (double)weight_qos;
 
-	if (weight_tres && job_ptr->prio_factors->priority_tres) {
+	if (weight_tres && factors->priority_tres) {
 		int i;
 		double *tres_factors = NULL;
-		tres_factors = job_ptr->prio_factors->priority_tres;
+		tres_factors = factors->priority_tres;
 
 		for (i = 0; i < slurmctld_tres_cnt; i++) {
 			tres_factors[i] *= weight_tres[i];
@@ -552,14 +612,13 @@ static uint32_t _get_priority_internal(time_t start_time,
 		}
 	}
 
-	priority = job_ptr->prio_factors->priority_age
-		+ job_ptr->prio_factors->priority_fs
-		+ job_ptr->prio_factors->priority_js
-		+ job_ptr->prio_factors->priority_part
-		+ job_ptr->prio_factors->priority_qos
+	priority = factors->priority_age
+		+ factors->priority_fs
+		+ factors->priority_js
+		+ factors->priority_part
+		+ factors->priority_qos
 		+ tmp_tres
-		- (double)(((int64_t)job_ptr->prio_factors->nice)
-			   - NICE_OFFSET);
+		- (double)(((int64_t)factors->nice) - NICE_OFFSET);
 
 	/* Priority 0 is reserved for held jobs */
 	if (priority < 1)
@@ -578,12 +637,6 @@ static uint32_t _get_priority_internal(time_t start_time,
 		ListIterator part_iterator;
 		int i = 0;
 
-		if (!job_ptr->priority_array) {
-			i = list_count(job_ptr->part_ptr_list) + 1;
-			job_ptr->priority_array = xmalloc(sizeof(uint32_t) * i);
-		}
-
-		i = 0;
 		part_iterator = list_iterator_create(job_ptr->part_ptr_list);
 		while ((part_ptr = (struct part_record *)
 			list_next(part_iterator))) {
@@ -591,13 +644,13 @@ static uint32_t _get_priority_internal(time_t start_time,
 				(double)part_max_priority *
 				(double)weight_part;
 			priority_part +=
-				 (job_ptr->prio_factors->priority_age
-				 + job_ptr->prio_factors->priority_fs
-				 + job_ptr->prio_factors->priority_js
-				 + job_ptr->prio_factors->priority_qos
+				 (factors->priority_age
+				 + factors->priority_fs
+				 + factors->priority_js
+				 + factors->priority_qos
 				 + tmp_tres
 				 - (double)
-				   (((uint64_t)job_ptr->prio_factors->nice)
+				   (((uint64_t)factors->nice)
 				    - NICE_OFFSET));
 
 			/* Priority 0 is reserved for held jobs */
@@ -612,14 +665,12 @@ static uint32_t _get_priority_internal(time_t start_time,
 				priority_part = (double) tmp_64;
 			}
 			if (((flags & PRIORITY_FLAGS_INCR_ONLY) == 0) ||
-			    (job_ptr->priority_array[i] <
-			     (uint32_t) priority_part)) {
-				job_ptr->priority_array[i] =
-					(uint32_t) priority_part;
+			    (priority_array[i] < (uint32_t) priority_part)) {
+				priority_array[i] = (uint32_t) priority_part;
 			}
 			debug("Job %u has more than one partition (%s)(%u)",
 			      job_ptr->job_id, part_ptr->name,
-			      job_ptr->priority_array[i]);
+			      priority_array[i]);
 			i++;
 		}
 		list_iterator_destroy(part_iterator);
@@ -627,27 +678,26 @@ static uint32_t _get_priority_internal(time_t start_time,
 
 	if (priority_debug) {
 		int i;
-		double *post_tres_factors =
-			job_ptr->prio_factors->priority_tres;
+		double *post_tres_factors = factors->priority_tres;
 		double *pre_tres_factors = pre_factors.priority_tres;
 		assoc_mgr_lock_t locks = { NO_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
 					   READ_LOCK, NO_LOCK, NO_LOCK };
 
 		info("Weighted Age priority is %f * %u = %.2f",
 		     pre_factors.priority_age, weight_age,
-		     job_ptr->prio_factors->priority_age);
+		     factors->priority_age);
 		info("Weighted Fairshare priority is %f * %u = %.2f",
 		     pre_factors.priority_fs, weight_fs,
-		     job_ptr->prio_factors->priority_fs);
+		     factors->priority_fs);
 		info("Weighted JobSize priority is %f * %u = %.2f",
 		     pre_factors.priority_js, weight_js,
-		     job_ptr->prio_factors->priority_js);
+		     factors->priority_js);
 		info("Weighted Partition priority is %f * %u = %.2f",
 		     pre_factors.priority_part, weight_part,
-		     job_ptr->prio_factors->priority_part);
+		     factors->priority_part);
 		info("Weighted QOS priority is %f * %u = %.2f",
 		     pre_factors.priority_qos, weight_qos,
-		     job_ptr->prio_factors->priority_qos);
+		     factors->priority_qos);
 
 		if (pre_tres_factors && post_tres_factors) {
 			assoc_mgr_lock(&locks);
@@ -664,13 +714,13 @@ static uint32_t _get_priority_internal(time_t start_time,
 
 		info("Job %u priority: %.2f + %.2f + %.2f + %.2f + %.2f + %2.f "
 		     "- %"PRId64" = %.2f",
-		     job_ptr->job_id, job_ptr->prio_factors->priority_age,
-		     job_ptr->prio_factors->priority_fs,
-		     job_ptr->prio_factors->priority_js,
-		     job_ptr->prio_factors->priority_part,
-		     job_ptr->prio_factors->priority_qos,
+		     job_ptr->job_id, factors->priority_age,
+		     factors->priority_fs,
+		     factors->priority_js,
+		     factors->priority_part,
+		     factors->priority_qos,
 		     tmp_tres,
-		     (((int64_t)job_ptr->prio_factors->nice) - NICE_OFFSET),
+		     (((int64_t)factors->nice) - NICE_OFFSET),
 		     priority);
 
 		xfree(pre_factors.priority_tres);
@@ -1128,6 +1178,7 @@ static int _apply_new_usage(struct job_record *job_ptr,
 	while (assoc) {
 		assoc->usage->grp_used_wall += run_decay;
 		assoc->usage->usage_raw += (long double)real_decay;
+		assoc->usage->fs_dirty = true;
 		if (priority_debug)
 			info("Adding %f new usage to assoc %u (%s/%s/%s) "
 			     "raw usage is now %Lf.  Group wall "
@@ -1146,19 +1197,232 @@ static int _apply_new_usage(struct job_record *job_ptr,
 }
 
 
-static int _decay_apply_new_usage_and_weighted_factors(
-	struct job_record *job_ptr,
-	time_t *start_time_ptr)
+static int _decay_apply_new_usage(struct job_record *job_ptr,
+				  time_t *start_time_ptr)
 {
 	/* Always return SUCCESS so that list_for_each will
 	 * continue processing list of jobs. */
+	(void) decay_apply_new_usage(job_ptr, start_time_ptr);
 
-	if (!decay_apply_new_usage(job_ptr, start_time_ptr))
-		return SLURM_SUCCESS;
+	return SLURM_SUCCESS;
+}
 
-	decay_apply_weighted_factors(job_ptr, start_time_ptr);
+/* Calculate the priority of one job without changing its job record */
+static void _calc_job_priority(prio_calc_t *calc, time_t start_time)
+{
+	struct job_record *job_ptr = calc->job_ptr;
 
-	return SLURM_SUCCESS;
+	if (job_ptr->direct_set_prio && (job_ptr->priority > 0)) {
+		calc->priority = job_ptr->priority;
+		return;
+	}
+
+	if (!job_ptr->details) {
+		error("%s: job %u does not have a details symbol set, "
+		      "can't set priority", __func__, job_ptr->job_id);
+		calc->priority = 0;
+		return;
+	}
+
+	calc->prio_factors = xmalloc(sizeof(priority_factors_object_t));
+	_calc_priority_factors(start_time, job_ptr, calc->prio_factors, true);
+	if (job_ptr->part_ptr_list) {
+		calc->priority_array_cnt =
+			list_count(job_ptr->part_ptr_list) + 1;
+		calc->priority_array = xmalloc(sizeof(uint32_t) *
+					       calc->priority_array_cnt);
+		if (job_ptr->priority_array) {
+			memcpy(calc->priority_array, job_ptr->priority_array,
+			       sizeof(uint32_t) * calc->priority_array_cnt);
+		}
+	}
+	calc->priority = _weigh_priority_factors(job_ptr, calc->prio_factors,
+						 calc->priority_array);
+}
+
+/* Worker thread calculating the priority of jobs taken from the array in
+ * groups of PRIO_CALC_CHUNK jobs */
+static void *_calc_worker(void *arg)
+{
+	prio_calc_args_t *args = (prio_calc_args_t *) arg;
+	int i, first, last;
+
+	while (1) {
+		slurm_mutex_lock(&calc_lock);
+		first = args->calc_next;
+		args->calc_next += PRIO_CALC_CHUNK;
+		slurm_mutex_unlock(&calc_lock);
+		if (first >= args->calc_cnt)
+			break;
+		last = MIN(first + PRIO_CALC_CHUNK, args->calc_cnt);
+		for (i = first; i < last; i++)
+			_calc_job_priority(&args->calc[i], args->start_time);
+	}
+
+	return NULL;
+}
+
+/* Store the priority calculated for a job. The job may have changed or
+ * ended since its priority was calculated, so test it again. */
+static void _store_job_priority(prio_calc_t *calc)
+{
+	struct job_record *job_ptr = find_job_record(calc->job_id);
+
+	if (!job_ptr || (job_ptr->priority == 0) ||
+	    (!IS_JOB_PENDING(job_ptr) &&
+	     !(flags & PRIORITY_FLAGS_CALCULATE_RUNNING)))
+		return;
+
+	/* An administrator may have set the priority meanwhile */
+	if (job_ptr->direct_set_prio)
+		return;
+
+	if (job_ptr->prio_factors) {
+		xfree(job_ptr->prio_factors->tres_weights);
+		xfree(job_ptr->prio_factors->priority_tres);
+		if (calc->prio_factors)
+			xfree(job_ptr->prio_factors);
+		else {
+			memset(job_ptr->prio_factors, 0,
+			       sizeof(priority_factors_object_t));
+		}
+	}
+	if (calc->prio_factors) {
+		job_ptr->prio_factors = calc->prio_factors;
+		calc->prio_factors = NULL;
+	}
+
+	if (calc->priority_array && job_ptr->part_ptr_list &&
+	    ((list_count(job_ptr->part_ptr_list) + 1) ==
+	     calc->priority_array_cnt)) {
+		xfree(job_ptr->priority_array);
+		job_ptr->priority_array = calc->priority_array;
+		calc->priority_array = NULL;
+	}
+
+	if (((flags & PRIORITY_FLAGS_INCR_ONLY) == 0) ||
+	    (job_ptr->priority < calc->priority)) {
+		job_ptr->priority = calc->priority;
+		last_job_update = time(NULL);
+	}
+	prio_queue_update_job(job_ptr);
+
+	debug2("priority for job %u is now %u",
+	       job_ptr->job_id, job_ptr->priority);
+}
+
+static void _free_prio_calc(prio_calc_t *calc)
+{
+	if (calc->prio_factors) {
+		xfree(calc->prio_factors->tres_weights);
+		xfree(calc->prio_factors->priority_tres);
+		xfree(calc->prio_factors);
+	}
+	xfree(calc->priority_array);
+}
+
+/* Apply the new usage of every running job to its association and QOS */
+extern void decay_apply_job_usage(List jobs, time_t start_time)
+{
+	/* Write lock on jobs, read lock on nodes and partitions */
+	slurmctld_lock_t job_write_lock =
+		{ NO_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK, NO_LOCK };
+	DEF_TIMERS;
+
+	START_TIMER;
+	lock_slurmctld(job_write_lock);
+	list_for_each(jobs, (ListForF) _decay_apply_new_usage, &start_time);
+	unlock_slurmctld(job_write_lock);
+	END_TIMER;
+	slurmctld_diag_stats.prio_usage_time = DELTA_TIMER;
+}
+
+/* Recalculate the priority of every pending job, plus running jobs with
+ * PRIORITY_FLAGS_CALCULATE_RUNNING. The priorities are calculated on up to
+ * calc_threads threads holding only read locks on jobs and associations,
+ * then stored holding the job write lock. */
+extern void decay_apply_job_priorities(List jobs, time_t start_time)
+{
+	/* Read lock on jobs, nodes and partitions */
+	slurmctld_lock_t job_read_lock =
+		{ NO_LOCK, READ_LOCK, READ_LOCK, READ_LOCK, NO_LOCK };
+	/* Write lock on jobs, read lock on nodes and partitions */
+	slurmctld_lock_t job_write_lock =
+		{ NO_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK, NO_LOCK };
+	assoc_mgr_lock_t locks = { READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
+				   NO_LOCK, NO_LOCK, NO_LOCK };
+	prio_calc_args_t args;
+	struct job_record *job_ptr;
+	ListIterator job_iterator;
+	pthread_t *worker_tid;
+	pthread_attr_t attr;
+	int i, worker_cnt;
+	DEF_TIMERS;
+
+	START_TIMER;
+	memset(&args, 0, sizeof(prio_calc_args_t));
+	args.start_time = start_time;
+
+	lock_slurmctld(job_read_lock);
+	args.calc = xmalloc(sizeof(prio_calc_t) * MAX(list_count(jobs), 1));
+	job_iterator = list_iterator_create(jobs);
+	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
+		/*
+		 * Priority 0 is reserved for held
+		 * jobs. Also skip priority
+		 * calculation for non-pending jobs.
+		 */
+		if ((job_ptr->priority == 0) ||
+		    IS_JOB_FINISHED(job_ptr) || IS_JOB_COMPLETING(job_ptr) ||
+		    (!IS_JOB_PENDING(job_ptr) &&
+		     !(flags & PRIORITY_FLAGS_CALCULATE_RUNNING)))
+			continue;
+		args.calc[args.calc_cnt].job_ptr = job_ptr;
+		args.calc[args.calc_cnt].job_id = job_ptr->job_id;
+		args.calc_cnt++;
+	}
+	list_iterator_destroy(job_iterator);
+
+	worker_cnt = (args.calc_cnt + PRIO_CALC_CHUNK - 1) / PRIO_CALC_CHUNK;
+	worker_cnt = MAX(MIN(calc_threads, worker_cnt), 1);
+	assoc_mgr_lock(&locks);
+	if (worker_cnt == 1) {
+		(void) _calc_worker(&args);
+	} else {
+		worker_tid = xmalloc(sizeof(pthread_t) * worker_cnt);
+		for (i = 0; i < worker_cnt; i++) {
+			slurm_attr_init(&attr);
+			while (pthread_create(&worker_tid[i], &attr,
+					      _calc_worker, &args)) {
+				error("pthread_create error %m");
+				sleep(1);
+			}
+			slurm_attr_destroy(&attr);
+		}
+		for (i = 0; i < worker_cnt; i++)
+			pthread_join(worker_tid[i], NULL);
+		xfree(worker_tid);
+	}
+	assoc_mgr_unlock(&locks);
+	unlock_slurmctld(job_read_lock);
+	END_TIMER;
+	slurmctld_diag_stats.prio_factor_time = DELTA_TIMER;
+
+	START_TIMER;
+	lock_slurmctld(job_write_lock);
+	for (i = 0; i < args.calc_cnt; i++)
+		_store_job_priority(&args.calc[i]);
+	unlock_slurmctld(job_write_lock);
+	END_TIMER;
+	slurmctld_diag_stats.prio_store_time = DELTA_TIMER;
+
+	for (i = 0; i < args.calc_cnt; i++)
+		_free_prio_calc(&args.calc[i]);
+	xfree(args.calc);
+
+	slurmctld_diag_stats.prio_calc_cnt++;
+	slurmctld_diag_stats.prio_calc_jobs = args.calc_cnt;
+	slurmctld_diag_stats.prio_calc_threads = worker_cnt;
 }
 
 
@@ -1174,11 +1438,9 @@ static void *_decay_thread(void *no_data)
 	double run_delta = 0.0, real_decay = 0.0;
 	double elapsed;
 
-	/* Write lock on jobs, read lock on nodes and partitions */
-	slurmctld_lock_t job_write_lock =
-		{ NO_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK, NO_LOCK };
 	assoc_mgr_lock_t locks = { WRITE_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
 				   NO_LOCK, NO_LOCK, NO_LOCK };
+	DEF_TIMERS;
 
 #if HAVE_SYS_PRCTL_H
 	if (prctl(PR_SET_NAME, "decay", NULL, NULL, NULL) < 0) {
@@ -1293,10 +1555,13 @@ static void *_decay_thread(void *no_data)
 		/* Calculate all the normalized usage unless this is Fair Tree;
 		 * it handles these calculations during its tree traversal */
 		if (!(flags & PRIORITY_FLAGS_FAIR_TREE)) {
+			START_TIMER;
 			assoc_mgr_lock(&locks);
 			_set_children_usage_efctv(
 				assoc_mgr_root_assoc->usage->children_list);
 			assoc_mgr_unlock(&locks);
+			END_TIMER;
+			slurmctld_diag_stats.prio_fs_time = DELTA_TIMER;
 		}
 
 		if (!g_last_ran)
@@ -1317,21 +1582,19 @@ static void *_decay_thread(void *no_data)
 			     run_delta, decay_factor, real_decay);
 
 		/* first apply decay to used time */
+		START_TIMER;
 		if (_apply_decay(real_decay) != SLURM_SUCCESS) {
 			error("priority/multifactor: problem applying decay");
 			running_decay = 0;
 			slurm_mutex_unlock(&decay_lock);
 			break;
 		}
+		END_TIMER;
+		slurmctld_diag_stats.prio_decay_time = DELTA_TIMER;
 
 		if (!(flags & PRIORITY_FLAGS_FAIR_TREE)) {
-			lock_slurmctld(job_write_lock);
-			list_for_each(
-				job_list,
-				(ListForF) _decay_apply_new_usage_and_weighted_factors,
-				&start_time
-				);
-			unlock_slurmctld(job_write_lock);
+			decay_apply_job_usage(job_list, start_time);
+			decay_apply_job_priorities(job_list, start_time);
 		}
 
 	get_usage:
@@ -1409,7 +1672,7 @@ static void *_cleanup_thread(void *no_data)
 
 static void _internal_setup(void)
 {
-	char *tres_weights_str;
+	char *tres_weights_str, *prio_params, *tmp_ptr;
 	if (slurm_get_debug_flags() & DEBUG_FLAG_PRIO)
 		priority_debug = 1;
 	else
@@ -1432,6 +1695,18 @@ static void _internal_setup(void)
 	xfree(tres_weights_str);
 	flags = slurm_get_priority_flags();
 
+	calc_threads = 1;
+	prio_params = slurm_get_priority_params();
+	if (prio_params && (tmp_ptr = strstr(prio_params, "calc_threads="))) {
+		calc_threads = atoi(tmp_ptr + 13);
+		if ((calc_threads < 1) || (calc_threads > PRIO_MAX_THREADS)) {
+			error("Invalid PriorityParameters calc_threads: %d",
+			      calc_threads);
+			calc_threads = 1;
+		}
+	}
+	xfree(prio_params);
+
 	if (priority_debug) {
 		info("priority: Damp Factor is %u", damp_factor);
 		info("priority: AccountingStorageEnforce is %u", enforce);
@@ -1442,6 +1717,7 @@ static void _internal_setup(void)
 		info("priority: Weight Part is %u", weight_part);
 		info("priority: Weight QOS is %u", weight_qos);
 		info("priority: Flags is %u", flags);
+		info("priority: Calc Threads is %d", calc_threads);
 	}
 }
 
@@ -1899,54 +2175,15 @@ extern bool decay_apply_new_usage(struct job_record *job_ptr,
 }
 
 
-extern int decay_apply_weighted_factors(struct job_record *job_ptr,
-					 time_t *start_time_ptr)
-{
-	uint32_t new_prio;
-
-	/* Always return SUCCESS so that list_for_each will
-	 * continue processing list of jobs. */
-
-	/*
-	 * Priority 0 is reserved for held
-	 * jobs. Also skip priority
-	 * calculation for non-pending jobs.
-	 */
-	if ((job_ptr->priority == 0) ||
-	    (!IS_JOB_PENDING(job_ptr) &&
-	     !(flags & PRIORITY_FLAGS_CALCULATE_RUNNING)))
-		return SLURM_SUCCESS;
-
-	new_prio = _get_priority_internal(*start_time_ptr, job_ptr);
-	if (((flags & PRIORITY_FLAGS_INCR_ONLY) == 0) ||
-	    (job_ptr->priority < new_prio)) {
-		job_ptr->priority = new_prio;
-		last_job_update = time(NULL);
-	}
-
-	debug2("priority for job %u is now %u",
-	       job_ptr->job_id, job_ptr->priority);
-
-	return SLURM_SUCCESS;
-}
-
-
-extern void set_priority_factors(time_t start_time, struct job_record *job_ptr)
+/* Set the priority factors of a job in factors, which must be cleared
+ * IN assoc_locked - caller holds a read lock on associations */
+static void _calc_priority_factors(time_t start_time,
+				   struct job_record *job_ptr,
+				   priority_factors_object_t *factors,
+				   bool assoc_locked)
 {
 	slurmdb_qos_rec_t *qos_ptr = NULL;
 
-	xassert(job_ptr);
-
-	if (!job_ptr->prio_factors)
-		job_ptr->prio_factors =
-			xmalloc(sizeof(priority_factors_object_t));
-	else {
-		xfree(job_ptr->prio_factors->tres_weights);
-		xfree(job_ptr->prio_factors->priority_tres);
-		memset(job_ptr->prio_factors, 0,
-		       sizeof(priority_factors_object_t));
-	}
-
 	qos_ptr = (slurmdb_qos_rec_t *)job_ptr->qos_ptr;
 
 	if (weight_age) {
@@ -1967,16 +2204,16 @@ extern void set_priority_factors(time_t start_time, struct job_record *job_ptr)
 		if (job_ptr->details->begin_time
 		    || (flags & PRIORITY_FLAGS_ACCRUE_ALWAYS)) {
 			if (diff < max_age) {
-				job_ptr->prio_factors->priority_age =
+				factors->priority_age =
 					(double)diff / (double)max_age;
 			} else
-				job_ptr->prio_factors->priority_age = 1.0;
+				factors->priority_age = 1.0;
 		}
 	}
 
 	if (job_ptr->assoc_ptr && weight_fs) {
-		job_ptr->prio_factors->priority_fs =
-			_get_fairshare_priority(job_ptr);
+		factors->priority_fs =
+			_get_fairshare_priority(job_ptr, assoc_locked);
 	}
 
 	/* FIXME: this should work off the product of TRESBillingWeights */
@@ -1999,12 +2236,12 @@ extern void set_priority_factors(time_t start_time, struct job_record *job_ptr)
 		if (flags & PRIORITY_FLAGS_SIZE_RELATIVE) {
 			uint32_t time_limit = 1;
 			/* Job size in CPUs (based upon average CPUs/Node */
-			job_ptr->prio_factors->priority_js =
+			factors->priority_js =
 				(double)min_nodes *
 				(double)cluster_cpus /
 				(double)node_record_count;
-			if (cpu_cnt > job_ptr->prio_factors->priority_js) {
-				job_ptr->prio_factors->priority_js =
+			if (cpu_cnt > factors->priority_js) {
+				factors->priority_js =
 					(double)cpu_cnt;
 			}
 			/* Divide by job time limit */
@@ -2012,69 +2249,69 @@ extern void set_priority_factors(time_t start_time, struct job_record *job_ptr)
 				time_limit = job_ptr->time_limit;
 			else if (job_ptr->part_ptr)
 				time_limit = job_ptr->part_ptr->max_time;
-			job_ptr->prio_factors->priority_js /= time_limit;
+			factors->priority_js /= time_limit;
 			/* Normalize to max value of 1.0 */
-			job_ptr->prio_factors->priority_js /= cluster_cpus;
+			factors->priority_js /= cluster_cpus;
 			if (favor_small) {
-				job_ptr->prio_factors->priority_js =
+				factors->priority_js =
 					(double) 1.0 -
-					job_ptr->prio_factors->priority_js;
+					factors->priority_js;
 			}
 		} else if (favor_small) {
-			job_ptr->prio_factors->priority_js =
+			factors->priority_js =
 				(double)(node_record_count - min_nodes)
 				/ (double)node_record_count;
 			if (cpu_cnt) {
-				job_ptr->prio_factors->priority_js +=
+				factors->priority_js +=
 					(double)(cluster_cpus - cpu_cnt)
 					/ (double)cluster_cpus;
-				job_ptr->prio_factors->priority_js /= 2;
+				factors->priority_js /= 2;
 			}
 		} else {	/* favor large */
-			job_ptr->prio_factors->priority_js =
+			factors->priority_js =
 				(double)min_nodes / (double)node_record_count;
 			if (cpu_cnt) {
-				job_ptr->prio_factors->priority_js +=
+				factors->priority_js +=
 					(double)cpu_cnt / (double)cluster_cpus;
-				job_ptr->prio_factors->priority_js /= 2;
+				factors->priority_js /= 2;
 			}
 		}
-		if (job_ptr->prio_factors->priority_js < .0)
-			job_ptr->prio_factors->priority_js = 0.0;
-		else if (job_ptr->prio_factors->priority_js > 1.0)
-			job_ptr->prio_factors->priority_js = 1.0;
+		if (factors->priority_js < .0)
+			factors->priority_js = 0.0;
+		else if (factors->priority_js > 1.0)
+			factors->priority_js = 1.0;
 	}
 
 	if (job_ptr->part_ptr && job_ptr->part_ptr->priority_job_factor &&
 	    weight_part) {
-		job_ptr->prio_factors->priority_part =
+		factors->priority_part =
 			job_ptr->part_ptr->norm_priority;
 	}
 
 	if (qos_ptr && qos_ptr->priority && weight_qos) {
-		job_ptr->prio_factors->priority_qos =
+		factors->priority_qos =
 			qos_ptr->usage->norm_priority;
 	}
 
 	if (job_ptr->details)
-		job_ptr->prio_factors->nice = job_ptr->details->nice;
+		factors->nice = job_ptr->details->nice;
 	else
-		job_ptr->prio_factors->nice = NICE_OFFSET;
+		factors->nice = NICE_OFFSET;
 
 	if (weight_tres) {
 		int i;
 		double *tres_factors = NULL;
 
-		if (!job_ptr->prio_factors->priority_tres) {
-			job_ptr->prio_factors->priority_tres =
+		if (!factors->priority_tres) {
+			factors->priority_tres =
 				xmalloc(sizeof(double) * slurmctld_tres_cnt);
-			job_ptr->prio_factors->tres_weights =
+			factors->tres_weights =
 				xmalloc(sizeof(double) * slurmctld_tres_cnt);
-			memcpy(job_ptr->prio_factors->tres_weights, weight_tres,
+			memcpy(factors->tres_weights, weight_tres,
 			       sizeof(double) * slurmctld_tres_cnt);
-			job_ptr->prio_factors->tres_cnt = slurmctld_tres_cnt;
+			factors->tres_cnt = slurmctld_tres_cnt;
 		}
-		tres_factors = job_ptr->prio_factors->priority_tres;
+		tres_factors = factors->priority_tres;
 
 		/* can't memcpy because of different types
 		 * uint64_t vs. double */
@@ -2096,6 +2333,25 @@ extern void set_priority_factors(time_t start_time, struct job_record *job_ptr)
 }
 
 
+extern void set_priority_factors(time_t start_time, struct job_record *job_ptr)
+{
+	xassert(job_ptr);
+
+	if (!job_ptr->prio_factors)
+		job_ptr->prio_factors =
+			xmalloc(sizeof(priority_factors_object_t));
+	else {
+		xfree(job_ptr->prio_factors->tres_weights);
+		xfree(job_ptr->prio_factors->priority_tres);
+		memset(job_ptr->prio_factors, 0,
+		       sizeof(priority_factors_object_t));
+	}
+
+	_calc_priority_factors(start_time, job_ptr, job_ptr->prio_factors,
+			       false);
+}
+
+
 /* Set usage_efctv based on algorithm-specific code. Fair Tree sets this
  * elsewhere.
  */
@@ -92,6 +92,7 @@
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/srun_comm.h"
 #include "backfill.h"
+#include "node_space.h"
 
 #define BACKFILL_INTERVAL	30
 #define BACKFILL_RESOLUTION	60
@@ -103,12 +104,15 @@
 #define SCHED_TIMEOUT		2000000	/* time in micro-seconds */
 #define YIELD_SLEEP		500000;	/* time in micro-seconds */
 
-typedef struct node_space_map {
-	time_t begin_time;
-	time_t end_time;
-	bitstr_t *avail_bitmap;
-	int next;	/* next record, by time, zero termination */
-} node_space_map_t;
+typedef struct bf_worker {
+	int first_group;	/* group tested first, the others are taken
+				 * from bf_group_next */
+	uint32_t group_cnt;	/* node set groups tested */
+	uint32_t depth;		/* jobs considered */
+	uint32_t depth_try;	/* jobs tested for resources */
+	uint64_t test_time;	/* usec in resource tests */
+	uint32_t overlap;	/* tests begun while another worker tested */
+} bf_worker_t;
 
 /* Diag statistics */
 extern diag_stats_t slurmctld_diag_stats;
@@ -137,12 +141,43 @@ static bool backfill_continue = false;
 static int defer_rpc_cnt = 0;
 static int sched_timeout = SCHED_TIMEOUT;
 static int yield_sleep   = YIELD_SLEEP;
+static int bf_threads = 1;
+
+/* State of the current backfill cycle. The jobs are split into groups whose
+ * partitions share no nodes and each group is tested by one worker thread
+ * with its own node space map. Everything below is protected by bf_mutex.
+ * A worker holds it while it checks the limits, reservations and other
+ * slurmctld state of a job and releases it for the work on its own node
+ * space map and for the resource tests of _try_sched(), which the workers
+ * run at the same time. Jobs are only started while no worker is testing.
+ * Unless the select plugin reports that its will-run test is reentrant,
+ * the calls into it are still serialized by bf_select_mutex. */
+static pthread_mutex_t bf_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  bf_cond = PTHREAD_COND_INITIALIZER;
+static List *bf_group_queue = NULL;	/* job queue of each group */
+static int bf_group_cnt = 0;
+static int bf_group_next = 0;		/* next group to hand to a worker */
+static int bf_worker_active = 0;	/* workers still testing groups */
+static int bf_worker_paused = 0;	/* workers waiting for a lock yield */
+static uint32_t bf_yield_cycle = 0;	/* count of completed lock yields */
+static bool bf_yield_pending = false;	/* a worker wants to yield locks */
+static bool bf_stop_cycle = false;	/* end the cycle in all workers */
+static int bf_cycle_rc = 0;
+static int bf_test_cnt = 0;		/* workers testing without bf_mutex */
+static int bf_start_cnt = 0;		/* workers starting a job */
+static pthread_mutex_t bf_select_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t bf_select_reentrant = 0;
+static time_t sched_start, orig_sched_start, window_end;
+static time_t bf_config_update, bf_part_update;
+static struct timeval start_tv;
+static int job_test_count = 0, test_time_count = 0;
+static uint32_t job_start_cnt = 0;
+static uint32_t *uid = NULL, nuser = 0, bf_parts = 0;
+static uint32_t *bf_part_jobs = NULL, *bf_part_resv = NULL;
+static uint16_t *njobs = NULL;
+static struct part_record **bf_part_ptr = NULL;
 
 /*********************** local functions *********************/
-static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
-			     bitstr_t *res_bitmap,
-			     node_space_map_t *node_space,
-			     int *node_space_recs);
 static int  _attempt_backfill(void);
 static void _clear_job_start_times(void);
 static int  _delta_tv(struct timeval *tv);
@@ -160,6 +195,11 @@ static int  _start_job(struct job_record *job_ptr, bitstr_t *avail_bitmap);
 static bool _test_resv_overlap(node_space_map_t *node_space,
 			       bitstr_t *use_bitmap, uint32_t start_time,
 			       uint32_t end_reserve);
+static int  _select_job_test(struct job_record *job_ptr, bitstr_t *bitmap,
+			     uint32_t min_nodes, uint32_t max_nodes,
+			     uint32_t req_nodes, List preemptee_candidates,
+			     List *preemptee_job_list,
+			     bitstr_t *exc_core_bitmap);
 static int  _try_sched(struct job_record *job_ptr, bitstr_t **avail_bitmap,
 		       uint32_t min_nodes, uint32_t max_nodes,
 		       uint32_t req_nodes, bitstr_t *exc_core_bitmap);
@@ -194,23 +234,22 @@ static void _dump_job_test(struct job_record *job_ptr, bitstr_t *avail_bitmap,
 }
 
 /* Log resource allocate table */
-static void _dump_node_space_table(node_space_map_t *node_space_ptr)
+static void _dump_node_space_table(node_space_map_t *node_space)
 {
-	int i = 0;
+	node_space_slice_t *slice;
 	char begin_buf[32], end_buf[32], *node_list;
 
 	info("=========================================");
-	while (1) {
-		slurm_make_time_str(&node_space_ptr[i].begin_time,
+	for (slice = node_space_first(node_space); slice;
+	     slice = slice->next) {
+		slurm_make_time_str(&slice->begin_time,
 				    begin_buf, sizeof(begin_buf));
-		slurm_make_time_str(&node_space_ptr[i].end_time,
+		slurm_make_time_str(&slice->end_time,
 				    end_buf, sizeof(end_buf));
-		node_list = bitmap2node_name(node_space_ptr[i].avail_bitmap);
+		node_list = bitmap2node_name(slice->avail_bitmap);
 		info("Begin:%s End:%s Nodes:%s",
 		     begin_buf, end_buf, node_list);
 		xfree(node_list);
-		if ((i = node_space_ptr[i].next) == 0)
-			break;
 	}
 	info("=========================================");
 }
@@ -261,11 +300,39 @@ static int _num_feature_count(struct job_record *job_ptr, bool *has_xor)
 	return rc;
 }
 
+/* select_g_job_test() in SELECT_MODE_WILL_RUN for a backfill worker.
+ * Workers take turns unless the select plugin's test is reentrant. */
+static int _select_job_test(struct job_record *job_ptr, bitstr_t *bitmap,
+			    uint32_t min_nodes, uint32_t max_nodes,
+			    uint32_t req_nodes, List preemptee_candidates,
+			    List *preemptee_job_list,
+			    bitstr_t *exc_core_bitmap)
+{
+	int rc;
+
+	if (!bf_select_reentrant)
+		slurm_mutex_lock(&bf_select_mutex);
+	rc = select_g_job_test(job_ptr, bitmap, min_nodes, max_nodes,
+			       req_nodes, SELECT_MODE_WILL_RUN,
+			       preemptee_candidates, preemptee_job_list,
+			       exc_core_bitmap);
+	if (!bf_select_reentrant)
+		slurm_mutex_unlock(&bf_select_mutex);
+
+	return rc;
+}
+
 /* Attempt to schedule a specific job on specific available nodes
  * IN job_ptr - job to schedule
  * IN/OUT avail_bitmap - nodes available/selected to use
  * IN exc_core_bitmap - cores which can not be used
  * RET SLURM_SUCCESS on success, otherwise an error code
+ *
+ * NOTE: Jobs are tested one at a time rather than with
+ * select_g_job_list_test(). Each job's avail_bitmap depends upon the
+ * resources reserved in node_space for the higher priority jobs tested
+ * before it, and the test considers preemption, while
+ * select_g_job_list_test() tests every job against the running jobs only.
  */
 static int  _try_sched(struct job_record *job_ptr, bitstr_t **avail_bitmap,
 		       uint32_t min_nodes, uint32_t max_nodes,
@@ -310,12 +377,11 @@ static int  _try_sched(struct job_record *job_ptr, bitstr_t **avail_bitmap,
 		} else {
 			preemptee_candidates =
 				slurm_find_preemptable_jobs(job_ptr);
-			rc = select_g_job_test(job_ptr, *avail_bitmap,
-					       high_cnt, max_nodes, req_nodes,
-					       SELECT_MODE_WILL_RUN,
-					       preemptee_candidates,
-					       &preemptee_job_list,
-					       exc_core_bitmap);
+			rc = _select_job_test(job_ptr, *avail_bitmap,
+					      high_cnt, max_nodes, req_nodes,
+					      preemptee_candidates,
+					      &preemptee_job_list,
+					      exc_core_bitmap);
 			FREE_NULL_LIST(preemptee_job_list);
 		}
 
@@ -348,13 +414,12 @@ static int  _try_sched(struct job_record *job_ptr, bitstr_t **avail_bitmap,
 			    (bit_set_count(*avail_bitmap) >= min_nodes)) {
 				preemptee_candidates =
 					slurm_find_preemptable_jobs(job_ptr);
-				rc = select_g_job_test(job_ptr, *avail_bitmap,
-						       min_nodes, max_nodes,
-						       req_nodes,
-						       SELECT_MODE_WILL_RUN,
-						       preemptee_candidates,
-						       &preemptee_job_list,
-						       exc_core_bitmap);
+				rc = _select_job_test(job_ptr, *avail_bitmap,
+						      min_nodes, max_nodes,
+						      req_nodes,
+						      preemptee_candidates,
+						      &preemptee_job_list,
+						      exc_core_bitmap);
 				FREE_NULL_LIST(preemptee_job_list);
 				if ((rc == SLURM_SUCCESS) &&
 				    ((low_start == 0) ||
@@ -389,12 +454,11 @@ static int  _try_sched(struct job_record *job_ptr, bitstr_t **avail_bitmap,
 		} else {
 			preemptee_candidates =
 					slurm_find_preemptable_jobs(job_ptr);
-			rc = select_g_job_test(job_ptr, *avail_bitmap,
-					       min_nodes, max_nodes, req_nodes,
-					       SELECT_MODE_WILL_RUN,
-					       preemptee_candidates,
-					       &preemptee_job_list,
-					       exc_core_bitmap);
+			rc = _select_job_test(job_ptr, *avail_bitmap,
+					      min_nodes, max_nodes, req_nodes,
+					      preemptee_candidates,
+					      &preemptee_job_list,
+					      exc_core_bitmap);
 			FREE_NULL_LIST(preemptee_job_list);
 		}
 	} else {
@@ -414,12 +478,11 @@ static int  _try_sched(struct job_record *job_ptr, bitstr_t **avail_bitmap,
 			debug2("%s exclude core bitmap: %s", __func__, str);
 		}
 
-		rc = select_g_job_test(job_ptr, *avail_bitmap, min_nodes,
-				       max_nodes, req_nodes,
-				       SELECT_MODE_WILL_RUN,
-				       preemptee_candidates,
-				       &preemptee_job_list,
-				       exc_core_bitmap);
+		rc = _select_job_test(job_ptr, *avail_bitmap, min_nodes,
+				      max_nodes, req_nodes,
+				      preemptee_candidates,
+				      &preemptee_job_list,
+				      exc_core_bitmap);
 		FREE_NULL_LIST(preemptee_job_list);
 
 		job_ptr->details->share_res = orig_shared;
@@ -428,12 +491,11 @@ static int  _try_sched(struct job_record *job_ptr, bitstr_t **avail_bitmap,
 		    (orig_shared != 0)) {
 			FREE_NULL_BITMAP(*avail_bitmap);
 			*avail_bitmap = tmp_bitmap;
-			rc = select_g_job_test(job_ptr, *avail_bitmap,
-					       min_nodes, max_nodes, req_nodes,
-					       SELECT_MODE_WILL_RUN,
-					       preemptee_candidates,
-					       &preemptee_job_list,
-					       exc_core_bitmap);
+			rc = _select_job_test(job_ptr, *avail_bitmap,
+					      min_nodes, max_nodes, req_nodes,
+					      preemptee_candidates,
+					      &preemptee_job_list,
+					      exc_core_bitmap);
 			FREE_NULL_LIST(preemptee_job_list);
 		} else
 			FREE_NULL_BITMAP(tmp_bitmap);
@@ -674,6 +736,23 @@ static void _load_config(void)
 		yield_sleep = YIELD_SLEEP;
 	}
 
+	if (sched_params && (tmp_ptr = strstr(sched_params, "bf_threads="))) {
+		bf_threads = atoi(tmp_ptr + 11);
+		if ((bf_threads < 1) || (bf_threads > BF_MAX_THREADS)) {
+			error("Invalid SchedulerParameters bf_threads: %d",
+			      bf_threads);
+			bf_threads = 1;
+		}
+	} else {
+		bf_threads = 1;
+	}
+	bf_select_reentrant = 0;
+	if (bf_threads > 1) {
+		(void) select_g_get_info_from_plugin(SELECT_WILL_RUN_REENTRANT,
+						     NULL,
+						     &bf_select_reentrant);
+	}
+
 	if (sched_params && (tmp_ptr = strstr(sched_params, "max_rpc_cnt=")))
 		defer_rpc_cnt = atoi(tmp_ptr + 12);
 	else if (sched_params &&
@@ -883,36 +962,242 @@ static bool _job_runnable_now(struct job_record *job_ptr)
 	return true;
 }
 
-static int _attempt_backfill(void)
+static void _bf_queue_rec_del(void *x)
+{
+	xfree(x);
+}
+
+/* Return the index of the group root for partition index "inx" */
+static int _group_root(int *part_root, int inx)
+{
+	while (part_root[inx] != inx) {
+		part_root[inx] = part_root[part_root[inx]];
+		inx = part_root[inx];
+	}
+	return inx;
+}
+
+/* Return the index of a partition in "part_array" or -1 if not found */
+static int _part_inx(struct part_record **part_array, int part_cnt,
+		     struct part_record *part_ptr)
+{
+	int i;
+
+	for (i = 0; i < part_cnt; i++) {
+		if (part_array[i] == part_ptr)
+			return i;
+	}
+	return -1;
+}
+
+/* Split the sorted job queue into groups whose partitions share no nodes
+ * with those of any other group, so each group can be tested by a different
+ * worker thread. A job which can run in several partitions joins them into
+ * one group. Each group keeps the priority order of the job queue and the
+ * groups are ordered by their highest priority job. With one worker thread
+ * all jobs stay in one group. The job queue is consumed. */
+static void _build_groups(List job_queue)
+{
+	struct part_record **part_array, *part_ptr;
+	job_queue_rec_t *job_queue_rec;
+	ListIterator iter, part_iter;
+	int *part_root, *part_group, part_cnt, i, j, k;
+
+	if (bf_threads <= 1) {
+		bf_group_cnt = 1;
+		bf_group_queue = xmalloc(sizeof(List));
+		bf_group_queue[0] = job_queue;
+		return;
+	}
+
+	part_cnt = list_count(part_list);
+	part_array = xmalloc(sizeof(struct part_record *) * part_cnt);
+	part_root  = xmalloc(sizeof(int) * part_cnt);
+	part_group = xmalloc(sizeof(int) * part_cnt);
+	iter = list_iterator_create(part_list);
+	i = 0;
+	while ((part_ptr = (struct part_record *) list_next(iter))) {
+		part_array[i] = part_ptr;
+		part_root[i] = i;
+		part_group[i] = -1;
+		i++;
+	}
+	list_iterator_destroy(iter);
+
+	for (i = 0; i < part_cnt; i++) {
+		if (!part_array[i]->node_bitmap)
+			continue;
+		for (j = i + 1; j < part_cnt; j++) {
+			if (!part_array[j]->node_bitmap ||
+			    !bit_overlap_any(part_array[i]->node_bitmap,
+					     part_array[j]->node_bitmap))
+				continue;
+			part_root[_group_root(part_root, j)] =
+				_group_root(part_root, i);
+		}
+	}
+
+	iter = list_iterator_create(job_queue);
+	while ((job_queue_rec = (job_queue_rec_t *) list_next(iter))) {
+		if (!job_queue_rec->job_ptr->part_ptr_list)
+			continue;
+		i = _part_inx(part_array, part_cnt, job_queue_rec->part_ptr);
+		if (i < 0)
+			continue;
+		part_iter = list_iterator_create(
+					job_queue_rec->job_ptr->part_ptr_list);
+		while ((part_ptr = (struct part_record *)
+				   list_next(part_iter))) {
+			j = _part_inx(part_array, part_cnt, part_ptr);
+			if (j < 0)
+				continue;
+			part_root[_group_root(part_root, j)] =
+				_group_root(part_root, i);
+		}
+		list_iterator_destroy(part_iter);
+	}
+	list_iterator_destroy(iter);
+
+	bf_group_cnt = 0;
+	while ((job_queue_rec = (job_queue_rec_t *) list_pop(job_queue))) {
+		i = _part_inx(part_array, part_cnt, job_queue_rec->part_ptr);
+		if (i < 0)
+			i = 0;
+		k = _group_root(part_root, i);
+		if (part_group[k] < 0) {
+			part_group[k] = bf_group_cnt++;
+			xrealloc(bf_group_queue, sizeof(List) * bf_group_cnt);
+			bf_group_queue[part_group[k]] =
+				list_create(_bf_queue_rec_del);
+		}
+		list_append(bf_group_queue[part_group[k]], job_queue_rec);
+	}
+	FREE_NULL_LIST(job_queue);
+
+	xfree(part_array);
+	xfree(part_root);
+	xfree(part_group);
+}
+
+/* Return true if the backfill workers should release their locks */
+static bool _bf_yield_needed(void)
+{
+	if (bf_yield_pending)
+		return true;
+	if ((defer_rpc_cnt > 0) &&
+	    (slurmctld_config.server_thread_count >= defer_rpc_cnt))
+		return true;
+	if (_delta_tv(&start_tv) >= sched_timeout)
+		return true;
+	return false;
+}
+
+/* Wait until all active workers are ready to yield locks, then the last one
+ * of them releases the slurmctld locks for everyone. Called with bf_mutex
+ * locked.
+ * RET true if the backfill cycle must end because the system state changed */
+static bool _bf_yield(void)
+{
+	uint32_t yield_cycle = bf_yield_cycle;
+
+	bf_yield_pending = true;
+	bf_worker_paused++;
+	while ((yield_cycle == bf_yield_cycle) &&
+	       (bf_worker_paused < bf_worker_active))
+		slurm_cond_wait(&bf_cond, &bf_mutex);
+	if (yield_cycle != bf_yield_cycle)	/* Yielded by another worker */
+		return bf_stop_cycle;
+
+	if ((_yield_locks(yield_sleep) && !backfill_continue) ||
+	    (slurmctld_conf.last_update != bf_config_update) ||
+	    (last_part_update != bf_part_update)) {
+		if (debug_flags & DEBUG_FLAG_BACKFILL) {
+			info("backfill: system state changed, "
+			     "breaking out after testing %u(%d) jobs",
+			     slurmctld_diag_stats.bf_last_depth,
+			     job_test_count);
+		}
+		bf_cycle_rc = 1;
+		bf_stop_cycle = true;
+	} else {
+		/* Reset backfill scheduling timers, resume testing */
+		sched_start = time(NULL);
+		gettimeofday(&start_tv, NULL);
+		job_test_count = 0;
+		test_time_count = 0;
+	}
+	bf_yield_pending = false;
+	bf_worker_paused = 0;
+	bf_yield_cycle++;
+	slurm_cond_broadcast(&bf_cond);
+
+	return bf_stop_cycle;
+}
+
+/* Release bf_mutex for work on a worker's own node space map and resource
+ * tests, which only read the node, partition and running job records. It is
+ * not released while a job is being started. If worker is set, count the
+ * test as overlapping when another worker is testing too.
+ * Called with bf_mutex locked, _bf_test_end() locks it again. */
+static void _bf_test_begin(bf_worker_t *worker)
+{
+	while (bf_start_cnt)
+		slurm_cond_wait(&bf_cond, &bf_mutex);
+	if (worker && bf_test_cnt)
+		worker->overlap++;
+	bf_test_cnt++;
+	slurm_mutex_unlock(&bf_mutex);
+}
+
+static void _bf_test_end(void)
+{
+	slurm_mutex_lock(&bf_mutex);
+	if (--bf_test_cnt == 0)
+		slurm_cond_broadcast(&bf_cond);
+}
+
+/* Wait for the tests in progress to complete before a job is started.
+ * No new tests begin until _bf_start_end() is called. Called with bf_mutex
+ * locked. */
+static void _bf_start_begin(void)
+{
+	bf_start_cnt++;
+	while (bf_test_cnt)
+		slurm_cond_wait(&bf_cond, &bf_mutex);
+}
+
+static void _bf_start_end(void)
+{
+	if (--bf_start_cnt == 0)
+		slurm_cond_broadcast(&bf_cond);
+}
+
+/* Test the jobs of one group in priority order, starting them or reserving
+ * resources for them in the group's own node space map.
+ * Called with bf_mutex locked. */
+static void _bf_test_group(bf_worker_t *worker, List job_queue)
 {
 	DEF_TIMERS;
-	List job_queue;
 	job_queue_rec_t *job_queue_rec;
 	slurmdb_qos_rec_t *qos_ptr = NULL;
-	int bb, i, j, node_space_recs, mcs_select = 0;
+	int bb, j, mcs_select = 0;
 	struct job_record *job_ptr;
-	struct part_record *part_ptr, **bf_part_ptr = NULL;
+	struct part_record *part_ptr;
 	uint32_t end_time, end_reserve, deadline_time_limit;
 	uint32_t time_limit, comp_time_limit, orig_time_limit, part_time_limit;
 	uint32_t min_nodes, max_nodes, req_nodes;
 	bitstr_t *active_bitmap = NULL, *avail_bitmap = NULL;
 	bitstr_t *exc_core_bitmap = NULL, *resv_bitmap = NULL;
-	time_t now, sched_start, later_start, start_res, resv_end, window_end;
-	time_t orig_sched_start, orig_start_time = (time_t) 0;
+	time_t now, later_start, start_res, resv_end;
+	time_t orig_start_time = (time_t) 0;
 	node_space_map_t *node_space;
-	struct timeval bf_time1, bf_time2;
-	int rc = 0;
-	int job_test_count = 0, test_time_count = 0, pend_time;
-	uint32_t *uid = NULL, nuser = 0, bf_parts = 0;
-	uint32_t *bf_part_jobs = NULL, *bf_part_resv = NULL;
-	uint16_t *njobs = NULL;
+	node_space_slice_t *slice;
+	struct timeval tv;
+	int pend_time;
 	bool already_counted;
 	uint32_t reject_array_job_id = 0;
 	struct part_record *reject_array_part = NULL;
-	uint32_t job_start_cnt = 0, start_time;
-	time_t config_update = slurmctld_conf.last_update;
-	time_t part_update = last_part_update;
-	struct timeval start_tv;
+	uint32_t start_time;
 	uint32_t test_array_job_id = 0;
 	uint32_t test_array_count = 0;
 	uint32_t acct_max_nodes, wait_reason = 0, job_no_reserve;
@@ -920,95 +1205,15 @@ static int _attempt_backfill(void)
 	uint8_t save_share_res, save_whole_node;
 	int test_fini;
 
-	bf_sleep_usec = 0;
-#ifdef HAVE_ALPS_CRAY
-	/*
-	 * Run a Basil Inventory immediately before setting up the schedule
-	 * plan, to avoid race conditions caused by ALPS node state change.
-	 * Needs to be done with the node-state lock taken.
-	 */
-	START_TIMER;
-	if (select_g_update_block(NULL)) {
-		debug4("backfill: not scheduling due to ALPS");
-		return SLURM_SUCCESS;
-	}
-	END_TIMER;
-	if (debug_flags & DEBUG_FLAG_BACKFILL)
-		info("backfill: ALPS inventory completed, %s", TIME_STR);
-
-	/* The Basil inventory can take a long time to complete. Process
-	 * pending RPCs before starting the backfill scheduling logic */
-	_yield_locks(1000000);
-#endif
-	(void) bb_g_load_state(false);
-
 	START_TIMER;
-	if (debug_flags & DEBUG_FLAG_BACKFILL)
-		info("backfill: beginning");
-	else
-		debug("backfill: beginning");
-	sched_start = orig_sched_start = now = time(NULL);
-	gettimeofday(&start_tv, NULL);
-
-	job_queue = build_job_queue(true, true);
-	job_test_count = list_count(job_queue);
-	if (job_test_count == 0) {		
-		if (debug_flags & DEBUG_FLAG_BACKFILL)
-			info("backfill: no jobs to backfill");
-		else
-			debug("backfill: no jobs to backfill");
-		FREE_NULL_LIST(job_queue);
-		return 0;
-	} else {
-		debug("backfill: %u jobs to backfill", job_test_count);
-		job_test_count = 0;
-	}
-
-	if (backfill_continue)
-		_clear_job_start_times();
-
-	gettimeofday(&bf_time1, NULL);
-
-	slurmctld_diag_stats.bf_queue_len = list_count(job_queue);
-	slurmctld_diag_stats.bf_queue_len_sum += slurmctld_diag_stats.
-						 bf_queue_len;
-	slurmctld_diag_stats.bf_last_depth = 0;
-	slurmctld_diag_stats.bf_last_depth_try = 0;
-	slurmctld_diag_stats.bf_when_last_cycle = now;
-	slurmctld_diag_stats.bf_active = 1;
-
-	node_space = xmalloc(sizeof(node_space_map_t) *
-			     (max_backfill_job_cnt * 2 + 1));
-	node_space[0].begin_time = sched_start;
-	window_end = sched_start + backfill_window;
-	node_space[0].end_time = window_end;
-	node_space[0].avail_bitmap = bit_copy(avail_node_bitmap);
-	node_space[0].next = 0;
-	node_space_recs = 1;
+	now = time(NULL);
+	_bf_test_begin(NULL);
+	node_space = node_space_create(sched_start, window_end,
+				       avail_node_bitmap);
 	if (debug_flags & DEBUG_FLAG_BACKFILL_MAP)
 		_dump_node_space_table(node_space);
+	_bf_test_end();
 
-	if (bf_job_part_count_reserve || max_backfill_job_per_part) {
-		ListIterator part_iterator;
-		struct part_record *part_ptr;
-		bf_parts = list_count(part_list);
-		bf_part_ptr  = xmalloc(sizeof(struct part_record *) * bf_parts);
-		bf_part_jobs = xmalloc(sizeof(uint32_t) * bf_parts);
-		bf_part_resv = xmalloc(sizeof(uint32_t) * bf_parts);
-		part_iterator = list_iterator_create(part_list);
-		i = 0;
-		while ((part_ptr = (struct part_record *)
-				   list_next(part_iterator))) {
-			bf_part_ptr[i++] = part_ptr;
-		}
-		list_iterator_destroy(part_iterator);
-	}
-	if (max_backfill_job_per_user) {
-		uid = xmalloc(BF_MAX_USERS * sizeof(uint32_t));
-		njobs = xmalloc(BF_MAX_USERS * sizeof(uint16_t));
-	}
-
-	sort_job_queue(job_queue);
 	while (1) {
 		job_queue_rec = (job_queue_rec_t *) list_pop(job_queue);
 		if (!job_queue_rec) {
@@ -1016,14 +1221,13 @@ static int _attempt_backfill(void)
 				info("backfill: reached end of job queue");
 			break;
 		}
-		if (slurmctld_config.shutdown_time ||
+		if (bf_stop_cycle || slurmctld_config.shutdown_time ||
 		    (difftime(time(NULL),orig_sched_start)>=backfill_interval)){
+			bf_stop_cycle = true;
 			xfree(job_queue_rec);
 			break;
 		}
-		if (((defer_rpc_cnt > 0) &&
-		     (slurmctld_config.server_thread_count >= defer_rpc_cnt)) ||
-		    (_delta_tv(&start_tv) >= sched_timeout)) {
+		if (_bf_yield_needed()) {
 			if (debug_flags & DEBUG_FLAG_BACKFILL) {
 				END_TIMER;
 				info("backfill: yielding locks after testing "
@@ -1031,25 +1235,10 @@ static int _attempt_backfill(void)
 				     slurmctld_diag_stats.bf_last_depth,
 				     job_test_count, TIME_STR);
 			}
-			if ((_yield_locks(yield_sleep) && !backfill_continue) ||
-			    (slurmctld_conf.last_update != config_update) ||
-			    (last_part_update != part_update)) {
-				if (debug_flags & DEBUG_FLAG_BACKFILL) {
-					info("backfill: system state changed, "
-					     "breaking out after testing "
-					     "%u(%d) jobs",
-					     slurmctld_diag_stats.bf_last_depth,
-					     job_test_count);
-				}
-				rc = 1;
+			if (_bf_yield()) {
 				xfree(job_queue_rec);
 				break;
 			}
-			/* Reset backfill scheduling timers, resume testing */
-			sched_start = time(NULL);
-			gettimeofday(&start_tv, NULL);
-			job_test_count = 0;
-			test_time_count = 0;
 			START_TIMER;
 		}
 
@@ -1169,6 +1358,7 @@ static int _attempt_backfill(void)
 next_task:
 		job_test_count++;
 		slurmctld_diag_stats.bf_last_depth++;
+		worker->depth++;
 		already_counted = false;
 
 		if (!IS_JOB_PENDING(job_ptr) ||	/* Started in other partition */
@@ -1350,16 +1540,15 @@ next_task:
 		/* Determine impact of any resource reservations */
 		later_start = now;
  TRY_LATER:
-		if (slurmctld_config.shutdown_time ||
+		if (bf_stop_cycle || slurmctld_config.shutdown_time ||
 		    (difftime(time(NULL), orig_sched_start) >=
 		     backfill_interval)) {
+			bf_stop_cycle = true;
 			_set_job_time_limit(job_ptr, orig_time_limit);
 			break;
 		}
 		test_time_count++;
-		if (((defer_rpc_cnt > 0) &&
-		     (slurmctld_config.server_thread_count >= defer_rpc_cnt)) ||
-		    (_delta_tv(&start_tv) >= sched_timeout)) {
+		if (_bf_yield_needed()) {
 			uint32_t save_job_id = job_ptr->job_id;
 			uint32_t save_time_limit = job_ptr->time_limit;
 			_set_job_time_limit(job_ptr, orig_time_limit);
@@ -1370,19 +1559,8 @@ next_task:
 				     slurmctld_diag_stats.bf_last_depth,
 				     job_test_count, test_time_count, TIME_STR);
 			}
-			if ((_yield_locks(yield_sleep) && !backfill_continue) ||
-			    (slurmctld_conf.last_update != config_update) ||
-			    (last_part_update != part_update)) {
-				if (debug_flags & DEBUG_FLAG_BACKFILL) {
-					info("backfill: system state changed, "
-					     "breaking out after testing "
-					     "%u(%d) jobs",
-					     slurmctld_diag_stats.bf_last_depth,
-					     job_test_count);
-				}
-				rc = 1;
+			if (_bf_yield())
 				break;
-			}
 
 			/* With bf_continue configured, the original job could
 			 * have been scheduled or cancelled and purged.
@@ -1402,11 +1580,7 @@ next_task:
 
 			job_ptr->time_limit = save_time_limit;
 			job_ptr->part_ptr = part_ptr;
-			/* Reset backfill scheduling timers, resume testing */
-			sched_start = time(NULL);
-			gettimeofday(&start_tv, NULL);
-			job_test_count = 1;
-			test_time_count = 0;
+			job_test_count++;
 			START_TIMER;
 		}
 
@@ -1430,24 +1604,19 @@ next_task:
 		if (end_time < now)	/* Overflow 32-bits */
 			end_time = INFINITE;
 		resv_end = find_resv_end(start_res);
+		_bf_test_begin(worker);
 		/* Identify usable nodes for this job */
 		bit_and(avail_bitmap, part_ptr->node_bitmap);
 		bit_and(avail_bitmap, up_node_bitmap);
 		filter_by_node_owner(job_ptr, avail_bitmap);
 		filter_by_node_mcs(job_ptr, mcs_select, avail_bitmap);
-		for (j=0; ; ) {
-			if ((node_space[j].end_time > start_res) &&
-			     node_space[j].next && (later_start == 0))
-				later_start = node_space[j].end_time;
-			if (node_space[j].end_time <= start_res)
-				;
-			else if (node_space[j].begin_time <= end_time) {
-				bit_and(avail_bitmap,
-					node_space[j].avail_bitmap);
-			} else
-				break;
-			if ((j = node_space[j].next) == 0)
+		for (slice = node_space_find(node_space, start_res); slice;
+		     slice = slice->next) {
+			if (slice->next && (later_start == 0))
+				later_start = slice->end_time;
+			if (slice->begin_time > end_time)
 				break;
+			bit_and(avail_bitmap, slice->avail_bitmap);
 		}
 		if (resv_end && (++resv_end < window_end) &&
 		    ((later_start == 0) || (resv_end < later_start))) {
@@ -1455,10 +1624,8 @@ next_task:
 		}
 
 		if (job_ptr->details->exc_node_bitmap) {
-			bit_not(job_ptr->details->exc_node_bitmap);
-			bit_and(avail_bitmap,
-				job_ptr->details->exc_node_bitmap);
-			bit_not(job_ptr->details->exc_node_bitmap);
+			bit_and_not(avail_bitmap,
+				    job_ptr->details->exc_node_bitmap);
 		}
 
 		/* Test if insufficient nodes remain OR
@@ -1471,6 +1638,7 @@ next_task:
 		     (!bit_super_set(job_ptr->details->req_node_bitmap,
 				     avail_bitmap))) ||
 		    (job_req_node_filter(job_ptr, avail_bitmap, true))) {
+			_bf_test_end();
 			if (later_start) {
 				job_ptr->start_time = 0;
 				goto TRY_LATER;
@@ -1496,12 +1664,9 @@ next_task:
 		debug2("backfill: entering _try_sched for job %u.",
 		       job_ptr->job_id);
 
-		if (!already_counted) {
-			slurmctld_diag_stats.bf_last_depth_try++;
-			already_counted = true;
-		}
 		if (debug_flags & DEBUG_FLAG_BACKFILL_MAP)
 			_dump_job_test(job_ptr, avail_bitmap, start_res);
+		gettimeofday(&tv, NULL);
 		test_fini = -1;
 		build_active_feature_bitmap(job_ptr, avail_bitmap,
 					    &active_bitmap);
@@ -1534,6 +1699,14 @@ next_task:
 		}
 		job_ptr->bit_flags &= ~BACKFILL_TEST;
 		job_ptr->bit_flags &= ~TEST_NOW_ONLY;
+		worker->test_time += _delta_tv(&tv);
+		_bf_test_end();
+
+		if (!already_counted) {
+			slurmctld_diag_stats.bf_last_depth_try++;
+			worker->depth_try++;
+			already_counted = true;
+		}
 
 		now = time(NULL);
 		if (j != SLURM_SUCCESS) {
@@ -1550,7 +1723,7 @@ next_task:
 			last_job_update = now;
 		}
 		if ((job_ptr->start_time <= now) &&
-		    (bit_overlap(avail_bitmap, cg_node_bitmap) > 0)) {
+		    bit_overlap_any(avail_bitmap, cg_node_bitmap)) {
 			/* Need to wait for in-progress completion/epilog */
 			job_ptr->start_time = now + 1;
 			later_start = 0;
@@ -1585,7 +1758,12 @@ next_task:
 			uint32_t save_time_limit = job_ptr->time_limit;
 			uint32_t hard_limit;
 			bool reset_time = false;
-			int rc = _start_job(job_ptr, resv_bitmap);
+			int rc;
+
+			/* Tests by other workers must not see the job and
+			 * node records change */
+			_bf_start_begin();
+			rc = _start_job(job_ptr, resv_bitmap);
 			if (qos_ptr && (qos_ptr->flags & QOS_FLAG_NO_RESERVE)) {
 				if (orig_time_limit == NO_VAL) {
 					acct_policy_alter_job(
@@ -1632,6 +1810,7 @@ next_task:
 				      "backfill. This shouldn't happen. :)",
 				      __func__);
 			}
+			_bf_start_end();
 
 			if ((rc == ESLURM_RESERVATION_BUSY) ||
 			    (rc == ESLURM_ACCOUNTING_POLICY) ||
@@ -1674,6 +1853,7 @@ next_task:
 						     " limit of %d reached",
 						     max_backfill_jobs_start);
 					}
+					bf_stop_cycle = true;
 					break;
 				}
 				if (job_ptr->array_task_id != NO_VAL) {
@@ -1719,7 +1899,7 @@ next_task:
 			continue;
 		}
 
-		if (node_space_recs >= max_backfill_job_cnt) {
+		if (node_space_rec_cnt(node_space) >= max_backfill_job_cnt) {
 			if (debug_flags & DEBUG_FLAG_BACKFILL) {
 				info("backfill: table size limit of %u reached",
 				     max_backfill_job_cnt);
@@ -1778,10 +1958,12 @@ next_task:
 		xfree(job_ptr->sched_nodes);
 		job_ptr->sched_nodes = bitmap2node_name(avail_bitmap);
 		bit_not(avail_bitmap);
-		_add_reservation(start_time, end_reserve,
-				 avail_bitmap, node_space, &node_space_recs);
+		_bf_test_begin(NULL);
+		node_space_reserve(node_space, start_time, end_reserve,
+				   avail_bitmap);
 		if (debug_flags & DEBUG_FLAG_BACKFILL_MAP)
 			_dump_node_space_table(node_space);
+		_bf_test_end();
 		if ((orig_start_time != 0) &&
 		    (orig_start_time < job_ptr->start_time)) {
 			/* Can start earlier in different partition */
@@ -1800,22 +1982,183 @@ next_task:
 				goto next_task;
 		}
 	}
+	FREE_NULL_BITMAP(avail_bitmap);
+	FREE_NULL_BITMAP(exc_core_bitmap);
+	FREE_NULL_BITMAP(resv_bitmap);
+	node_space_destroy(node_space);
+}
+
+/* Backfill worker thread, tests groups until none remain */
+static void *_bf_worker(void *arg)
+{
+	bf_worker_t *worker = (bf_worker_t *) arg;
+	int group_inx = worker->first_group;
+	List job_queue;
+
+	slurm_mutex_lock(&bf_mutex);
+	while (!bf_stop_cycle && (group_inx < bf_group_cnt)) {
+		job_queue = bf_group_queue[group_inx];
+		worker->group_cnt++;
+		_bf_test_group(worker, job_queue);
+		group_inx = bf_group_next++;
+	}
+	bf_worker_active--;
+	slurm_cond_broadcast(&bf_cond);
+	slurm_mutex_unlock(&bf_mutex);
+
+	return NULL;
+}
+
+static int _attempt_backfill(void)
+{
+	DEF_TIMERS;
+	List job_queue;
+	bf_worker_t *worker;
+	pthread_t *worker_tid;
+	pthread_attr_t attr;
+	struct timeval bf_time1, bf_time2;
+	time_t now;
+	int i, worker_cnt;
+
+	bf_sleep_usec = 0;
+#ifdef HAVE_ALPS_CRAY
+	/*
+	 * Run a Basil Inventory immediately before setting up the schedule
+	 * plan, to avoid race conditions caused by ALPS node state change.
+	 * Needs to be done with the node-state lock taken.
+	 */
+	START_TIMER;
+	if (select_g_update_block(NULL)) {
+		debug4("backfill: not scheduling due to ALPS");
+		return SLURM_SUCCESS;
+	}
+	END_TIMER;
+	if (debug_flags & DEBUG_FLAG_BACKFILL)
+		info("backfill: ALPS inventory completed, %s", TIME_STR);
+
+	/* The Basil inventory can take a long time to complete. Process
+	 * pending RPCs before starting the backfill scheduling logic */
+	_yield_locks(1000000);
+#endif
+	(void) bb_g_load_state(false);
+
+	START_TIMER;
+	if (debug_flags & DEBUG_FLAG_BACKFILL)
+		info("backfill: beginning");
+	else
+		debug("backfill: beginning");
+	sched_start = orig_sched_start = now = time(NULL);
+	gettimeofday(&start_tv, NULL);
+
+	job_queue = build_job_queue(true, true);
+	job_test_count = list_count(job_queue);
+	if (job_test_count == 0) {		
+		if (debug_flags & DEBUG_FLAG_BACKFILL)
+			info("backfill: no jobs to backfill");
+		else
+			debug("backfill: no jobs to backfill");
+		FREE_NULL_LIST(job_queue);
+		return 0;
+	} else {
+		debug("backfill: %u jobs to backfill", job_test_count);
+		job_test_count = 0;
+	}
+	test_time_count = 0;
+
+	if (backfill_continue)
+		_clear_job_start_times();
+
+	gettimeofday(&bf_time1, NULL);
+
+	slurmctld_diag_stats.bf_queue_len = list_count(job_queue);
+	slurmctld_diag_stats.bf_queue_len_sum += slurmctld_diag_stats.
+						 bf_queue_len;
+	slurmctld_diag_stats.bf_last_depth = 0;
+	slurmctld_diag_stats.bf_last_depth_try = 0;
+	slurmctld_diag_stats.bf_when_last_cycle = now;
+	slurmctld_diag_stats.bf_active = 1;
+
+	window_end = sched_start + backfill_window;
+	bf_config_update = slurmctld_conf.last_update;
+	bf_part_update = last_part_update;
+	job_start_cnt = 0;
+	bf_parts = 0;
+	nuser = 0;
+
+	if (bf_job_part_count_reserve || max_backfill_job_per_part) {
+		ListIterator part_iterator;
+		struct part_record *part_ptr;
+		bf_parts = list_count(part_list);
+		bf_part_ptr  = xmalloc(sizeof(struct part_record *) * bf_parts);
+		bf_part_jobs = xmalloc(sizeof(uint32_t) * bf_parts);
+		bf_part_resv = xmalloc(sizeof(uint32_t) * bf_parts);
+		part_iterator = list_iterator_create(part_list);
+		i = 0;
+		while ((part_ptr = (struct part_record *)
+				   list_next(part_iterator))) {
+			bf_part_ptr[i++] = part_ptr;
+		}
+		list_iterator_destroy(part_iterator);
+	}
+	if (max_backfill_job_per_user) {
+		uid = xmalloc(BF_MAX_USERS * sizeof(uint32_t));
+		njobs = xmalloc(BF_MAX_USERS * sizeof(uint16_t));
+	}
+
+	sort_job_queue(job_queue);
+	_build_groups(job_queue);
+	worker_cnt = MIN(bf_threads, bf_group_cnt);
+	bf_group_next = worker_cnt;
+	bf_worker_active = worker_cnt;
+	bf_worker_paused = 0;
+	bf_yield_pending = false;
+	bf_stop_cycle = false;
+	bf_cycle_rc = 0;
+
+	worker = xmalloc(sizeof(bf_worker_t) * worker_cnt);
+	for (i = 0; i < worker_cnt; i++)
+		worker[i].first_group = i;
+	if (worker_cnt == 1) {
+		(void) _bf_worker(worker);
+	} else {
+		worker_tid = xmalloc(sizeof(pthread_t) * worker_cnt);
+		for (i = 0; i < worker_cnt; i++) {
+			slurm_attr_init(&attr);
+			while (pthread_create(&worker_tid[i], &attr,
+					      _bf_worker, &worker[i])) {
+				error("pthread_create error %m");
+				sleep(1);
+			}
+			slurm_attr_destroy(&attr);
+		}
+		for (i = 0; i < worker_cnt; i++)
+			pthread_join(worker_tid[i], NULL);
+		xfree(worker_tid);
+	}
+
+	slurmctld_diag_stats.bf_group_cnt = bf_group_cnt;
+	slurmctld_diag_stats.bf_worker_cnt = worker_cnt;
+	for (i = 0; i < worker_cnt; i++) {
+		slurmctld_diag_stats.bf_worker_group_cnt[i] =
+			worker[i].group_cnt;
+		slurmctld_diag_stats.bf_worker_depth[i] = worker[i].depth;
+		slurmctld_diag_stats.bf_worker_depth_try[i] =
+			worker[i].depth_try;
+		slurmctld_diag_stats.bf_worker_test_time[i] =
+			worker[i].test_time;
+		slurmctld_diag_stats.bf_worker_overlap[i] = worker[i].overlap;
+	}
+	xfree(worker);
+	for (i = 0; i < bf_group_cnt; i++)
+		FREE_NULL_LIST(bf_group_queue[i]);
+	xfree(bf_group_queue);
+	bf_group_cnt = 0;
 	xfree(bf_part_jobs);
 	xfree(bf_part_resv);
 	xfree(bf_part_ptr);
 	xfree(uid);
 	xfree(njobs);
-	FREE_NULL_BITMAP(avail_bitmap);
-	FREE_NULL_BITMAP(exc_core_bitmap);
-	FREE_NULL_BITMAP(resv_bitmap);
 
-	for (i=0; ; ) {
-		FREE_NULL_BITMAP(node_space[i].avail_bitmap);
-		if ((i = node_space[i].next) == 0)
-			break;
-	}
-	xfree(node_space);
-	FREE_NULL_LIST(job_queue);
 	gettimeofday(&bf_time2, NULL);
 	_do_diag_stats(&bf_time1, &bf_time2);
 	if (debug_flags & DEBUG_FLAG_BACKFILL) {
@@ -1829,7 +2172,7 @@ next_task:
 		     "configuring max_rpc_cnt",
 		     slurmctld_config.server_thread_count);
 	}
-	return rc;
+	return bf_cycle_rc;
 }
 
 /* Try to start the job on any non-reserved nodes */
@@ -1917,23 +2260,23 @@ static int _start_job(struct job_record *job_ptr, bitstr_t *resv_bitmap)
 static void _reset_job_time_limit(struct job_record *job_ptr, time_t now,
 				  node_space_map_t *node_space)
 {
-	int32_t j, resv_delay;
+	node_space_slice_t *slice;
+	int32_t resv_delay;
 	uint32_t orig_time_limit = job_ptr->time_limit;
 	uint32_t new_time_limit;
 
-	for (j=0; ; ) {
-		if ((node_space[j].begin_time != now) &&
-		    (node_space[j].begin_time < job_ptr->end_time) &&
+	for (slice = node_space_first(node_space);
+	     slice && (slice->begin_time < job_ptr->end_time);
+	     slice = slice->next) {
+		if ((slice->begin_time != now) &&
 		    (!bit_super_set(job_ptr->node_bitmap,
-				    node_space[j].avail_bitmap))) {
+				    slice->avail_bitmap))) {
 			/* Job overlaps pending job's resource reservation */
-			resv_delay = difftime(node_space[j].begin_time, now);
+			resv_delay = difftime(slice->begin_time, now);
 			resv_delay /= 60;	/* seconds to minutes */
 			if (resv_delay < job_ptr->time_limit)
 				job_ptr->time_limit = resv_delay;
 		}
-		if ((j = node_space[j].next) == 0)
-			break;
 	}
 	new_time_limit = MAX(job_ptr->time_min, job_ptr->time_limit);
 	acct_policy_alter_job(job_ptr, new_time_limit);
@@ -1963,98 +2306,6 @@ static bool _more_work (time_t last_backfill_time)
 	return rc;
 }
 
-/* Create a reservation for a job in the future */
-static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
-			     bitstr_t *res_bitmap,
-			     node_space_map_t *node_space,
-			     int *node_space_recs)
-{
-	bool placed = false;
-	int i, j;
-
-#if 0	
-	info("add job start:%u end:%u", start_time, end_reserve);
-	for (j = 0; ; ) {
-		info("node start:%u end:%u",
-		     (uint32_t) node_space[j].begin_time,
-		     (uint32_t) node_space[j].end_time);
-		if ((j = node_space[j].next) == 0)
-			break;
-	}
-#endif
-
-	start_time = MAX(start_time, node_space[0].begin_time);
-	for (j = 0; ; ) {
-		if (node_space[j].end_time > start_time) {
-			/* insert start entry record */
-			i = *node_space_recs;
-			node_space[i].begin_time = start_time;
-			node_space[i].end_time = node_space[j].end_time;
-			node_space[j].end_time = start_time;
-			node_space[i].avail_bitmap =
-				bit_copy(node_space[j].avail_bitmap);
-			node_space[i].next = node_space[j].next;
-			node_space[j].next = i;
-			(*node_space_recs)++;
-			placed = true;
-		}
-		if (node_space[j].end_time == start_time) {
-			/* no need to insert new start entry record */
-			placed = true;
-		}
-		if (placed == true) {
-			while ((j = node_space[j].next)) {
-				if (end_reserve < node_space[j].end_time) {
-					/* insert end entry record */
-					i = *node_space_recs;
-					node_space[i].begin_time = end_reserve;
-					node_space[i].end_time = node_space[j].
-								 end_time;
-					node_space[j].end_time = end_reserve;
-					node_space[i].avail_bitmap =
-						bit_copy(node_space[j].
-							 avail_bitmap);
-					node_space[i].next = node_space[j].next;
-					node_space[j].next = i;
-					(*node_space_recs)++;
-					break;
-				}
-				if (end_reserve == node_space[j].end_time) {
-					break;
-				}
-			}
-			break;
-		}
-		if ((j = node_space[j].next) == 0)
-			break;
-	}
-
-	for (j = 0; ; ) {
-		if ((node_space[j].begin_time >= start_time) &&
-		    (node_space[j].end_time <= end_reserve))
-			bit_and(node_space[j].avail_bitmap, res_bitmap);
-		if ((node_space[j].begin_time >= end_reserve) ||
-		    ((j = node_space[j].next) == 0))
-			break;
-	}
-
-	/* Drop records with identical bitmaps (up to one record).
-	 * This can significantly improve performance of the backfill tests. */
-	for (i = 0; ; ) {
-		if ((j = node_space[i].next) == 0)
-			break;
-		if (!bit_equal(node_space[i].avail_bitmap,
-			       node_space[j].avail_bitmap)) {
-			i = j;
-			continue;
-		}
-		node_space[i].end_time = node_space[j].end_time;
-		node_space[i].next = node_space[j].next;
-		FREE_NULL_BITMAP(node_space[j].avail_bitmap);
-		break;
-	}
-}
-
 /*
  * Determine if the resource specification for a new job overlaps with a
  *	reservation that the backfill scheduler has made for a job to be
@@ -2067,18 +2318,16 @@ static bool _test_resv_overlap(node_space_map_t *node_space,
 			       bitstr_t *use_bitmap, uint32_t start_time,
 			       uint32_t end_reserve)
 {
+	node_space_slice_t *slice;
 	bool overlap = false;
-	int j;
 
-	for (j=0; ; ) {
-		if ((node_space[j].end_time   > start_time) &&
-		    (node_space[j].begin_time < end_reserve) &&
-		    (!bit_super_set(use_bitmap, node_space[j].avail_bitmap))) {
+	for (slice = node_space_find(node_space, start_time);
+	     slice && (slice->begin_time < end_reserve);
+	     slice = slice->next) {
+		if (!bit_super_set(use_bitmap, slice->avail_bitmap)) {
 			overlap = true;
 			break;
 		}
-		if ((j = node_space[j].next) == 0)
-			break;
 	}
 	return overlap;
 }
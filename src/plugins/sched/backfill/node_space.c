@@ -0,0 +1,273 @@
+/*****************************************************************************\
+ *  node_space.c - timeline of future node availability for the backfill
+ *	scheduler, kept as a skip list of time slices.
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+/*
+ * Slices are linked in time order on level zero of a skip list, so the slice
+ * covering any time is found in logarithmic time and a reservation only
+ * visits the slices it overlaps. Splitting a slice does not copy its bitmap,
+ * both halves share it until one of them is modified. Neighbouring slices
+ * with the same available nodes are merged after each reservation.
+ */
+
+#include "src/common/macros.h"
+#include "src/common/xassert.h"
+#include "src/common/xmalloc.h"
+
+#include "node_space.h"
+
+struct node_space_map {
+	node_space_slice_t head;	/* links to first slice of each level */
+	int level;			/* levels in use */
+	uint32_t seed;			/* for slice levels */
+	int rec_cnt;			/* slices created */
+};
+
+static node_space_slice_t **_link(node_space_slice_t *slice, int level)
+{
+	if (level == 0)
+		return &slice->next;
+	return &slice->skip[level - 1];
+}
+
+/* Each slice is linked at one more level with probability 1/4 */
+static int _random_level(node_space_map_t *map)
+{
+	uint32_t bits;
+	int level = 1;
+
+	map->seed ^= map->seed << 13;
+	map->seed ^= map->seed >> 17;
+	map->seed ^= map->seed << 5;
+	bits = map->seed;
+	while ((level < NODE_SPACE_MAX_LEVEL) && ((bits & 3) == 0)) {
+		level++;
+		bits >>= 2;
+	}
+	return level;
+}
+
+/* Return the last slice beginning at or before the given time, or the map's
+ * head if none. If update is set, fill in the last such slice at each level */
+static node_space_slice_t *_find_le(node_space_map_t *map, time_t when,
+				    node_space_slice_t **update)
+{
+	node_space_slice_t *slice = &map->head, *next;
+	int i;
+
+	for (i = map->level - 1; i >= 0; i--) {
+		while ((next = *_link(slice, i)) && (next->begin_time <= when))
+			slice = next;
+		if (update)
+			update[i] = slice;
+	}
+	return slice;
+}
+
+static void _release_bitmap(node_space_slice_t *slice)
+{
+	if (--(*slice->ref_cnt) == 0) {
+		FREE_NULL_BITMAP(slice->avail_bitmap);
+		xfree(slice->ref_cnt);
+	}
+	slice->avail_bitmap = NULL;
+	slice->ref_cnt = NULL;
+}
+
+static void _share_bitmap(node_space_slice_t *dest, node_space_slice_t *src)
+{
+	if (dest->ref_cnt)
+		_release_bitmap(dest);
+	dest->avail_bitmap = src->avail_bitmap;
+	dest->ref_cnt = src->ref_cnt;
+	(*dest->ref_cnt)++;
+}
+
+/* Give a slice its own copy of its bitmap so that it can be modified */
+static void _unshare_bitmap(node_space_slice_t *slice)
+{
+	if (*slice->ref_cnt == 1)
+		return;
+	(*slice->ref_cnt)--;
+	slice->avail_bitmap = bit_copy(slice->avail_bitmap);
+	slice->ref_cnt = xmalloc(sizeof(uint32_t));
+	*slice->ref_cnt = 1;
+}
+
+/* Split the slice covering the given time so that a slice begins then */
+static void _split(node_space_map_t *map, time_t when)
+{
+	node_space_slice_t *update[NODE_SPACE_MAX_LEVEL], *slice, *new_slice;
+	int i;
+
+	slice = _find_le(map, when, update);
+	if ((slice == &map->head) || (slice->begin_time == when) ||
+	    (slice->end_time <= when))
+		return;
+
+	new_slice = xmalloc(sizeof(node_space_slice_t));
+	new_slice->begin_time = when;
+	new_slice->end_time = slice->end_time;
+	slice->end_time = when;
+	_share_bitmap(new_slice, slice);
+	new_slice->level = _random_level(map);
+	for (i = map->level; i < new_slice->level; i++)
+		update[i] = &map->head;
+	map->level = MAX(map->level, new_slice->level);
+	for (i = 0; i < new_slice->level; i++) {
+		*_link(new_slice, i) = *_link(update[i], i);
+		*_link(update[i], i) = new_slice;
+	}
+	map->rec_cnt++;
+}
+
+/* Merge a slice with the one following it */
+static void _merge_next(node_space_map_t *map, node_space_slice_t *slice)
+{
+	node_space_slice_t *update[NODE_SPACE_MAX_LEVEL], *next = slice->next;
+	int i;
+
+	(void) _find_le(map, next->begin_time - 1, update);
+	for (i = 0; i < next->level; i++) {
+		xassert(*_link(update[i], i) == next);
+		*_link(update[i], i) = *_link(next, i);
+	}
+	while ((map->level > 1) && !*_link(&map->head, map->level - 1))
+		map->level--;
+
+	slice->end_time = next->end_time;
+	_release_bitmap(next);
+	xfree(next);
+}
+
+extern node_space_map_t *node_space_create(time_t begin_time, time_t end_time,
+					   bitstr_t *avail_bitmap)
+{
+	node_space_map_t *map = xmalloc(sizeof(node_space_map_t));
+	node_space_slice_t *slice = xmalloc(sizeof(node_space_slice_t));
+
+	map->head.level = NODE_SPACE_MAX_LEVEL;
+	map->level = 1;
+	map->seed = 2463534242U;
+	map->rec_cnt = 1;
+
+	slice->begin_time = begin_time;
+	slice->end_time = end_time;
+	slice->avail_bitmap = bit_copy(avail_bitmap);
+	slice->ref_cnt = xmalloc(sizeof(uint32_t));
+	*slice->ref_cnt = 1;
+	slice->level = 1;
+	map->head.next = slice;
+
+	return map;
+}
+
+extern void node_space_destroy(node_space_map_t *map)
+{
+	node_space_slice_t *slice, *next;
+
+	if (!map)
+		return;
+	for (slice = map->head.next; slice; slice = next) {
+		next = slice->next;
+		_release_bitmap(slice);
+		xfree(slice);
+	}
+	xfree(map);
+}
+
+extern node_space_slice_t *node_space_first(node_space_map_t *map)
+{
+	return map->head.next;
+}
+
+extern node_space_slice_t *node_space_find(node_space_map_t *map,
+					   time_t when)
+{
+	node_space_slice_t *slice = _find_le(map, when, NULL);
+
+	if (slice == &map->head)
+		return map->head.next;
+	if (slice->end_time > when)
+		return slice;
+	return slice->next;
+}
+
+extern void node_space_reserve(node_space_map_t *map, time_t start_time,
+			       time_t end_time, bitstr_t *res_bitmap)
+{
+	node_space_slice_t *first, *slice, *prev = NULL;
+	bitstr_t *orig_bitmap = NULL;
+
+	start_time = MAX(start_time, map->head.next->begin_time);
+	if (start_time >= end_time)
+		return;
+	_split(map, start_time);
+	_split(map, end_time);
+
+	first = node_space_find(map, start_time);
+	for (slice = first; slice && (slice->begin_time < end_time);
+	     slice = slice->next) {
+		if (prev && (slice->avail_bitmap == orig_bitmap)) {
+			/* Had the same nodes as the previous slice */
+			_share_bitmap(slice, prev);
+			prev = slice;
+			continue;
+		}
+		orig_bitmap = slice->avail_bitmap;
+		prev = slice;
+		if ((*slice->ref_cnt > 1) &&
+		    bit_super_set(slice->avail_bitmap, res_bitmap))
+			continue;	/* Nodes already reserved, keep sharing */
+		_unshare_bitmap(slice);
+		bit_and(slice->avail_bitmap, res_bitmap);
+	}
+
+	/* Merge slices with the same nodes, starting with the one before
+	 * the reservation and ending with the one after it */
+	slice = _find_le(map, start_time - 1, NULL);
+	if (slice == &map->head)
+		slice = first;
+	while (slice && slice->next && (slice->begin_time < end_time)) {
+		if ((slice->avail_bitmap == slice->next->avail_bitmap) ||
+		    bit_equal(slice->avail_bitmap, slice->next->avail_bitmap))
+			_merge_next(map, slice);
+		else
+			slice = slice->next;
+	}
+}
+
+extern int node_space_rec_cnt(node_space_map_t *map)
+{
+	return map->rec_cnt;
+}
@@ -0,0 +1,95 @@
+/*****************************************************************************\
+ *  node_space.h - timeline of future node availability for the backfill
+ *	scheduler, kept as a skip list of time slices.
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURM_BACKFILL_NODE_SPACE_H
+#define _SLURM_BACKFILL_NODE_SPACE_H
+
+#include <time.h>
+
+#include "src/common/bitstring.h"
+
+#define NODE_SPACE_MAX_LEVEL	12
+
+/* A period of time during which the available nodes do not change.
+ * Slices are contiguous and ordered by time. */
+typedef struct node_space_slice {
+	time_t begin_time;
+	time_t end_time;
+	bitstr_t *avail_bitmap;		/* may be shared with other slices,
+					 * do not modify */
+	struct node_space_slice *next;	/* next slice by time, NULL if last */
+
+	/* Private to node_space.c */
+	uint32_t *ref_cnt;		/* slices sharing avail_bitmap */
+	int level;			/* skip list levels linked */
+	struct node_space_slice *skip[NODE_SPACE_MAX_LEVEL - 1];
+} node_space_slice_t;
+
+typedef struct node_space_map node_space_map_t;
+
+/*
+ * node_space_create - create a timeline with a single slice
+ * IN begin_time, end_time - period covered by the timeline
+ * IN avail_bitmap - nodes available over the whole period, copied
+ * RET the timeline, release using node_space_destroy()
+ */
+extern node_space_map_t *node_space_create(time_t begin_time, time_t end_time,
+					   bitstr_t *avail_bitmap);
+
+/* Free a timeline and its slices */
+extern void node_space_destroy(node_space_map_t *map);
+
+/* Return the earliest slice of a timeline */
+extern node_space_slice_t *node_space_first(node_space_map_t *map);
+
+/* Return the first slice ending after the given time, NULL if none */
+extern node_space_slice_t *node_space_find(node_space_map_t *map,
+					   time_t when);
+
+/*
+ * node_space_reserve - reserve nodes over a period of the timeline,
+ *	splitting slices at the period's start and end as needed
+ * IN map - timeline
+ * IN start_time, end_time - period of the reservation
+ * IN res_bitmap - nodes which remain available over the period (the
+ *	complement of the nodes reserved)
+ */
+extern void node_space_reserve(node_space_map_t *map, time_t start_time,
+			       time_t end_time, bitstr_t *res_bitmap);
+
+/* Return the number of slices created in a timeline, including those since
+ * merged with a neighbour having the same available nodes */
+extern int node_space_rec_cnt(node_space_map_t *map);
+
+#endif /* !_SLURM_BACKFILL_NODE_SPACE_H */
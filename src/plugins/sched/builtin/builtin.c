@@ -77,7 +77,6 @@ static pthread_cond_t  term_cond = PTHREAD_COND_INITIALIZER;
 static bool config_flag = false;
 static int builtin_interval = BACKFILL_INTERVAL;
 static int max_sched_job_cnt = 50;
-static int sched_timeout = 0;
 
 /*********************** local functions *********************/
 static void _compute_start_times(void);
@@ -111,10 +110,6 @@ static void _load_config(void)
 {
 	char *sched_params, *select_type, *tmp_ptr;
 
-	sched_timeout = slurm_get_msg_timeout() / 2;
-	sched_timeout = MAX(sched_timeout, 1);
-	sched_timeout = MIN(sched_timeout, 10);
-
 	sched_params = slurm_get_sched_params();
 
 	if (sched_params && (tmp_ptr=strstr(sched_params, "interval=")))
@@ -146,23 +141,35 @@ static void _load_config(void)
 	xfree(select_type);
 }
 
+static void _will_run_free(void *x)
+{
+	select_will_run_t *will_run = (select_will_run_t *) x;
+
+	if (will_run) {
+		FREE_NULL_BITMAP(will_run->avail_nodes);
+		FREE_NULL_BITMAP(will_run->exc_core_bitmap);
+		xfree(will_run);
+	}
+}
+
 static void _compute_start_times(void)
 {
-	int j, rc = SLURM_SUCCESS, job_cnt = 0;
-	List job_queue;
+	int j, job_cnt = 0;
+	List job_queue, will_run_list;
+	ListIterator will_run_iter;
 	job_queue_rec_t *job_queue_rec;
-	List preemptee_candidates = NULL;
+	select_will_run_t *will_run;
 	struct job_record *job_ptr;
 	struct part_record *part_ptr;
 	bitstr_t *alloc_bitmap = NULL, *avail_bitmap = NULL;
 	bitstr_t *exc_core_bitmap = NULL;
 	uint32_t max_nodes, min_nodes, req_nodes, time_limit;
-	time_t now = time(NULL), sched_start, last_job_alloc;
+	time_t now = time(NULL), last_job_alloc;
 	bool resv_overlap = false;
 
-	sched_start = now;
 	last_job_alloc = now - 1;
 	alloc_bitmap = bit_alloc(node_record_count);
+	will_run_list = list_create(_will_run_free);
 	job_queue = build_job_queue(true, false);
 	sort_job_queue(job_queue);
 	while ((job_queue_rec = (job_queue_rec_t *) list_pop(job_queue))) {
@@ -210,39 +217,51 @@ static void _compute_start_times(void)
 			continue;
 		}
 
-		rc = select_g_job_test(job_ptr, avail_bitmap,
-				       min_nodes, max_nodes, req_nodes,
-				       SELECT_MODE_WILL_RUN,
-				       preemptee_candidates, NULL,
-				       exc_core_bitmap);
-		if (rc == SLURM_SUCCESS) {
-			last_job_update = now;
-			if (job_ptr->time_limit == INFINITE)
-				time_limit = 365 * 24 * 60 * 60;
-			else if (job_ptr->time_limit != NO_VAL)
-				time_limit = job_ptr->time_limit * 60;
-			else if (job_ptr->part_ptr &&
-				 (job_ptr->part_ptr->max_time != INFINITE))
-				time_limit = job_ptr->part_ptr->max_time * 60;
-			else
-				time_limit = 365 * 24 * 60 * 60;
-			if (bit_overlap(alloc_bitmap, avail_bitmap) &&
-			    (job_ptr->start_time <= last_job_alloc)) {
-				job_ptr->start_time = last_job_alloc;
-			}
-			bit_or(alloc_bitmap, avail_bitmap);
-			last_job_alloc = job_ptr->start_time + time_limit;
-		}
-		FREE_NULL_BITMAP(avail_bitmap);
-		FREE_NULL_BITMAP(exc_core_bitmap);
+		will_run = xmalloc(sizeof(select_will_run_t));
+		will_run->avail_nodes = avail_bitmap;
+		will_run->exc_core_bitmap = exc_core_bitmap;
+		will_run->job_ptr = job_ptr;
+		will_run->max_nodes = max_nodes;
+		will_run->min_nodes = min_nodes;
+		will_run->req_nodes = req_nodes;
+		list_append(will_run_list, will_run);
+		avail_bitmap = NULL;
+		exc_core_bitmap = NULL;
+	}
+	FREE_NULL_LIST(job_queue);
 
-		if ((time(NULL) - sched_start) >= sched_timeout) {
-			debug2("scheduling loop exiting after %d jobs",
-			       max_sched_job_cnt);
-			break;
+	/* Test all of the jobs in a single pass over the running jobs */
+	if (select_g_job_list_test(will_run_list) != SLURM_SUCCESS) {
+		FREE_NULL_LIST(will_run_list);
+		FREE_NULL_BITMAP(alloc_bitmap);
+		return;
+	}
+
+	will_run_iter = list_iterator_create(will_run_list);
+	while ((will_run = (select_will_run_t *) list_next(will_run_iter))) {
+		if (will_run->rc != SLURM_SUCCESS)
+			continue;
+		job_ptr = will_run->job_ptr;
+		avail_bitmap = will_run->avail_nodes;
+		last_job_update = now;
+		if (job_ptr->time_limit == INFINITE)
+			time_limit = 365 * 24 * 60 * 60;
+		else if (job_ptr->time_limit != NO_VAL)
+			time_limit = job_ptr->time_limit * 60;
+		else if (job_ptr->part_ptr &&
+			 (job_ptr->part_ptr->max_time != INFINITE))
+			time_limit = job_ptr->part_ptr->max_time * 60;
+		else
+			time_limit = 365 * 24 * 60 * 60;
+		if (bit_overlap(alloc_bitmap, avail_bitmap) &&
+		    (job_ptr->start_time <= last_job_alloc)) {
+			job_ptr->start_time = last_job_alloc;
 		}
+		bit_or(alloc_bitmap, avail_bitmap);
+		last_job_alloc = job_ptr->start_time + time_limit;
 	}
-	FREE_NULL_LIST(job_queue);
+	list_iterator_destroy(will_run_iter);
+	FREE_NULL_LIST(will_run_list);
 	FREE_NULL_BITMAP(alloc_bitmap);
 }
 
@@ -323,6 +323,33 @@ extern int select_p_job_test(struct job_record *job_ptr, bitstr_t *bitmap,
 			      preemptee_job_list, exc_core_bitmap);
 }
 
+extern int select_p_job_list_test(List req_list)
+{
+	ListIterator iter;
+	select_will_run_t *will_run;
+	struct job_record *job_ptr;
+
+	iter = list_iterator_create(req_list);
+	while ((will_run = (select_will_run_t *) list_next(iter))) {
+		job_ptr = will_run->job_ptr;
+		if (!job_ptr->details)
+			continue;
+		if (will_run->min_nodes == 0) {
+			/* Allocate resources only on a front-end node */
+			job_ptr->details->min_cpus = 0;
+		}
+		if (job_ptr->details->core_spec != (uint16_t) NO_VAL) {
+			verbose("select/alps: job %u core_spec(%u) not "
+				"supported", job_ptr->job_id,
+				job_ptr->details->core_spec);
+			job_ptr->details->core_spec = (uint16_t) NO_VAL;
+		}
+	}
+	list_iterator_destroy(iter);
+
+	return other_job_list_test(req_list);
+}
+
 extern int select_p_job_begin(struct job_record *job_ptr)
 {
 	xassert(job_ptr);
@@ -895,6 +922,11 @@ extern int select_p_get_info_from_plugin(enum select_plugindata_info dinfo,
 					 struct job_record *job_ptr,
 					 void *data)
 {
+	if (dinfo == SELECT_WILL_RUN_REENTRANT) {
+		/* Not known for the plugin's own job tests */
+		*(uint32_t *) data = 0;
+		return SLURM_SUCCESS;
+	}
 	return other_get_info_from_plugin(dinfo, job_ptr, data);
 }
 
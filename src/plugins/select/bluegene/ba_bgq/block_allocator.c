@@ -1090,9 +1090,7 @@ extern int ba_sub_block_in_bitmap_clear(
 	/* use units_avail here instead of units_used so it works for
 	   both jobs and steps with no other code.
 	*/
-	bit_not(jobinfo->units_avail);
-	bit_and(usable_bitmap, jobinfo->units_avail);
-	bit_not(jobinfo->units_avail);
+	bit_and_not(usable_bitmap, jobinfo->units_avail);
 
 	if (bg_conf->slurm_debug_flags & DEBUG_FLAG_BG_ALGO) {
 		tmp_char = ba_node_map_ranged_hostlist(
@@ -1661,9 +1659,7 @@ extern struct job_record *ba_remove_job_in_block_job_list(
 		/* Take out the part (if any) of the midplane that
 		   isn't part of the block.
 		*/
-		bit_not(ba_mp->cnode_usable_bitmap);
-		bit_and(used_cnodes, ba_mp->cnode_usable_bitmap);
-		bit_not(ba_mp->cnode_usable_bitmap);
+		bit_and_not(used_cnodes, ba_mp->cnode_usable_bitmap);
 	}
 again:
 	itr = list_iterator_create(bg_record->job_list);
@@ -1681,9 +1677,7 @@ again:
 				      "continuing");
 				continue;
 			}
-			bit_not(jobinfo->units_avail);
-			bit_and(used_cnodes, jobinfo->units_avail);
-			bit_not(jobinfo->units_avail);
+			bit_and_not(used_cnodes, jobinfo->units_avail);
 
 			continue;
 		}
@@ -1744,9 +1738,7 @@ again:
 
 		num_unused_cpus += current_cnode_cnt * bg_conf->cpu_ratio;
 
-		bit_not(used_cnodes);
-		bit_and(ba_mp->cnode_bitmap, used_cnodes);
-		bit_not(used_cnodes);
+		bit_and_not(ba_mp->cnode_bitmap, used_cnodes);
 		if (bg_conf->slurm_debug_flags & DEBUG_FLAG_SELECT_TYPE) {
 			debug("ba_remove_job_in_block_job_list: "
 			      "Removing old sub-block job using %d cnodes "
@@ -1770,9 +1762,7 @@ again:
 		used_cnodes = jobinfo->units_avail;
 	}
 
-	bit_not(used_cnodes);
-	bit_and(ba_mp->cnode_bitmap, used_cnodes);
-	bit_not(used_cnodes);
+	bit_and_not(ba_mp->cnode_bitmap, used_cnodes);
 
 	if (bg_conf->slurm_debug_flags & DEBUG_FLAG_BG_ALGO) {
 		bitstr_t *total_bitmap = bit_copy(ba_mp->cnode_bitmap);
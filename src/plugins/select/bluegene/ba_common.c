@@ -1331,9 +1331,7 @@ extern void ba_node_map_rm(bitstr_t *node_bitmap, bitstr_t *alloc_bitmap,
 {
 	xassert(bit_size(node_bitmap) == my_geo_system->total_size);
 	xassert(bit_size(alloc_bitmap) == my_geo_system->total_size);
-	bit_not(alloc_bitmap);
-	bit_and(node_bitmap, alloc_bitmap);
-	bit_not(alloc_bitmap);
+	bit_and_not(node_bitmap, alloc_bitmap);
 }
 
 /*
@@ -1966,13 +1966,9 @@ extern int submit_job(struct job_record *job_ptr, bitstr_t *slurm_block_bitmap,
 						xassert(ba_mp);
 						xassert(ba_mp->cnode_bitmap);
 
-						bit_not(found_jobinfo->
-							units_avail);
-						bit_and(ba_mp->cnode_bitmap,
-							found_jobinfo->
-							units_avail);
-						bit_not(found_jobinfo->
-							units_avail);
+						bit_and_not(ba_mp->cnode_bitmap,
+							    found_jobinfo->
+							    units_avail);
 
 						if (bg_conf->slurm_debug_flags
 						    & DEBUG_FLAG_BG_PICK)
@@ -1640,6 +1640,27 @@ extern int select_p_job_test(struct job_record *job_ptr, bitstr_t *bitmap,
 #endif
 }
 
+extern int select_p_job_list_test(List req_list)
+{
+	ListIterator iter;
+	select_will_run_t *will_run;
+
+	iter = list_iterator_create(req_list);
+	while ((will_run = (select_will_run_t *) list_next(iter))) {
+		will_run->rc = select_p_job_test(will_run->job_ptr,
+						 will_run->avail_nodes,
+						 will_run->min_nodes,
+						 will_run->max_nodes,
+						 will_run->req_nodes,
+						 SELECT_MODE_WILL_RUN,
+						 NULL, NULL,
+						 will_run->exc_core_bitmap);
+	}
+	list_iterator_destroy(iter);
+
+	return SLURM_SUCCESS;
+}
+
 extern int select_p_job_begin(struct job_record *job_ptr)
 {
 #ifdef HAVE_BG
@@ -2970,6 +2991,9 @@ extern int select_p_get_info_from_plugin (enum select_plugindata_info dinfo,
 	case SELECT_CONFIG_INFO:
 		*tmp_list = _get_config();
 		break;
+	case SELECT_WILL_RUN_REENTRANT:
+		*tmp32 = 0;
+		break;
 	default:
 		error("select_p_get_info_from_plugin info %d invalid",
 		      dinfo);
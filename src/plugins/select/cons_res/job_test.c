@@ -724,14 +724,23 @@ uint16_t _can_job_run_on_node(struct job_record *job_ptr, bitstr_t *core_map,
  * the job was submitted to a single-row partition which does not share
  * allocated CPUs with multi-row partitions.
  */
-static int _is_node_busy(struct part_res_record *p_ptr, uint32_t node_i,
+static int _is_node_busy(struct part_res_record *p_ptr,
+			 struct node_use_record *node_usage, uint32_t node_i,
 			 int sharing_only, struct part_record *my_part_ptr,
 			 bool qos_preemptor)
 {
-	uint32_t r, cpu_begin = cr_get_coremap_offset(node_i);
-	uint32_t i, cpu_end   = cr_get_coremap_offset(node_i+1);
+	uint32_t r, cpu_begin, cpu_end, i;
 	uint16_t num_rows;
 
+	/* row_core_cnt counts the node's cores in the rows of all partitions,
+	 * so the rows need only be searched if some are to be ignored */
+	if (node_usage[node_i].row_core_cnt == 0)
+		return 0;
+	if (!sharing_only && (!preempt_by_qos || qos_preemptor))
+		return 1;
+
+	cpu_begin = cr_get_coremap_offset(node_i);
+	cpu_end   = cr_get_coremap_offset(node_i+1);
 	for (; p_ptr; p_ptr = p_ptr->next) {
 		num_rows = p_ptr->num_rows;
 		if (preempt_by_qos && !qos_preemptor)
@@ -882,7 +891,7 @@ static int _verify_node_state(struct part_res_record *cr_part_ptr,
 			}
 			/* cannot use this node if it is running jobs
 			 * in sharing partitions */
-			if (_is_node_busy(cr_part_ptr, i, 1,
+			if (_is_node_busy(cr_part_ptr, node_usage, i, 1,
 					  job_ptr->part_ptr, qos_preemptor)) {
 				debug3("cons_res: _vns: node %s sharing?",
 				       node_ptr->name);
@@ -892,8 +901,8 @@ static int _verify_node_state(struct part_res_record *cr_part_ptr,
 		/* node is NODE_CR_AVAILABLE - check job request */
 		} else {
 			if (job_node_req == NODE_CR_RESERVED) {
-				if (_is_node_busy(cr_part_ptr, i, 0,
-						  job_ptr->part_ptr,
+				if (_is_node_busy(cr_part_ptr, node_usage,
+						  i, 0, job_ptr->part_ptr,
 						  qos_preemptor)) {
 					debug3("cons_res: _vns: node %s busy",
 					       node_ptr->name);
@@ -902,8 +911,8 @@ static int _verify_node_state(struct part_res_record *cr_part_ptr,
 			} else if (job_node_req == NODE_CR_ONE_ROW) {
 				/* cannot use this node if it is running jobs
 				 * in sharing partitions */
-				if (_is_node_busy(cr_part_ptr, i, 1,
-						  job_ptr->part_ptr,
+				if (_is_node_busy(cr_part_ptr, node_usage,
+						  i, 1, job_ptr->part_ptr,
 						  qos_preemptor)) {
 					debug3("cons_res: _vns: node %s vbusy",
 					       node_ptr->name);
@@ -951,6 +960,7 @@ extern bitstr_t *make_core_bitmap(bitstr_t *node_map, uint16_t core_spec)
 	    (core_spec & CORE_SPEC_THREAD))	/* Reserving threads */
 		core_spec = (uint16_t) NO_VAL;	/* Don't remove cores */
 
+	use_spec_cores = slurm_get_use_spec_resources();
 	n_first = bit_ffs(node_map);
 	if (n_first == -1)
 		n_last = -2;
@@ -969,7 +979,6 @@ extern bitstr_t *make_core_bitmap(bitstr_t *node_map, uint16_t core_spec)
 		bit_nset(core_map, c, coff - 1);
 
 		node_ptr = select_node_record[n].node_ptr;
-		use_spec_cores =  slurm_get_use_spec_resources();
 		if (use_spec_cores && (core_spec == 0))
 			continue;
 
@@ -1177,11 +1186,16 @@ static void _get_res_usage(struct job_record *job_ptr, bitstr_t *node_map,
 			   bool test_only, bitstr_t *part_core_map)
 {
 	uint16_t *cpu_cnt;
-	uint32_t n;
+	int n, n_first, n_last;
 	uint32_t s_p_n = _socks_per_node(job_ptr);
 
 	cpu_cnt = xmalloc(cr_node_cnt * sizeof(uint16_t));
-	for (n = 0; n < cr_node_cnt; n++) {
+	n_first = bit_ffs(node_map);
+	if (n_first == -1)
+		n_last = -2;
+	else
+		n_last = bit_fls(node_map);
+	for (n = n_first; n <= n_last; n++) {
 		if (!bit_test(node_map, n))
 			continue;
 		cpu_cnt[n] = _can_job_run_on_node(job_ptr, core_map, n, s_p_n,
@@ -3113,10 +3127,8 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *node_bitmap,
 			bitstr_t *exc_core_bitmap, bool prefer_alloc_nodes,
 			bool qos_preemptor, bool preempt_mode)
 {
-	static int gang_mode = -1;
 	int error_code = SLURM_SUCCESS;
 	bitstr_t *orig_map, *avail_cores, *free_cores, *part_core_map = NULL;
-	bitstr_t *tmpcore = NULL;
 	bool test_only;
 	uint32_t c, j, k, n, csize, total_cpus;
 	uint64_t save_mem = 0;
@@ -3127,13 +3139,6 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *node_bitmap,
 	uint16_t *cpu_count;
 	int i, first, last;
 
-	if (gang_mode == -1) {
-		if (slurm_get_preempt_mode() & PREEMPT_MODE_GANG)
-			gang_mode = 1;
-		else
-			gang_mode = 0;
-	}
-
 	details_ptr = job_ptr->details;
 
 	free_job_resources(&job_ptr->job_resrcs);
@@ -3291,22 +3296,17 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *node_bitmap,
 		bit_fmt(str, (sizeof(str) - 1), exc_core_bitmap);
 		debug2("excluding cores reserved: %s", str);
 #endif
-		bit_not(exc_core_bitmap);
-		bit_and(free_cores, exc_core_bitmap);
-		bit_not(exc_core_bitmap);
+		bit_and_not(free_cores, exc_core_bitmap);
 	}
 
 	/* remove all existing allocations from free_cores */
-	tmpcore = bit_copy(free_cores);
 	for (p_ptr = cr_part_ptr; p_ptr; p_ptr = p_ptr->next) {
 		if (!p_ptr->row)
 			continue;
 		for (i = 0; i < p_ptr->num_rows; i++) {
 			if (!p_ptr->row[i].row_bitmap)
 				continue;
-			bit_copybits(tmpcore, p_ptr->row[i].row_bitmap);
-			bit_not(tmpcore); /* set bits now "free" resources */
-			bit_and(free_cores, tmpcore);
+			bit_and_not(free_cores, p_ptr->row[i].row_bitmap);
 			if (p_ptr->part_ptr != job_ptr->part_ptr)
 				continue;
 			if (part_core_map) {
@@ -3334,7 +3334,7 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *node_bitmap,
 		goto alloc_job;
 	}
 
-	if ((gang_mode == 0) && (job_node_req == NODE_CR_ONE_ROW)) {
+	if (!gang_mode && (job_node_req == NODE_CR_ONE_ROW)) {
 		/* This job CANNOT share CPUs regardless of priority,
 		 * so we fail here. Note that Shared=EXCLUSIVE was already
 		 * addressed in _verify_node_state() and job preemption
@@ -3355,9 +3355,7 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *node_bitmap,
 	bit_copybits(free_cores, avail_cores);
 
 	if (exc_core_bitmap) {
-		bit_not(exc_core_bitmap);
-		bit_and(free_cores, exc_core_bitmap);
-		bit_not(exc_core_bitmap);
+		bit_and_not(free_cores, exc_core_bitmap);
 	}
 
 	for (jp_ptr = cr_part_ptr; jp_ptr; jp_ptr = jp_ptr->next) {
@@ -3397,9 +3395,8 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *node_bitmap,
 			for (i = 0; i < p_ptr->num_rows; i++) {
 				if (!p_ptr->row[i].row_bitmap)
 					continue;
-				bit_copybits(tmpcore, p_ptr->row[i].row_bitmap);
-				bit_not(tmpcore); /* add to "free" resources */
-				bit_and(free_cores, tmpcore);
+				bit_and_not(free_cores,
+					    p_ptr->row[i].row_bitmap);
 			}
 		}
 	}
@@ -3442,9 +3439,7 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *node_bitmap,
 		for (i = 0; i < p_ptr->num_rows; i++) {
 			if (!p_ptr->row[i].row_bitmap)
 				continue;
-			bit_copybits(tmpcore, p_ptr->row[i].row_bitmap);
-			bit_not(tmpcore); /* set bits now "free" resources */
-			bit_and(free_cores, tmpcore);
+			bit_and_not(free_cores, p_ptr->row[i].row_bitmap);
 		}
 	}
 
@@ -3476,7 +3471,6 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *node_bitmap,
 	/*** Step 4 ***/
 	/* try to fit the job into an existing row
 	 *
-	 * tmpcore = worker core_bitmap
 	 * free_cores = core_bitmap to be built
 	 * avail_cores = static core_bitmap of all available cores
 	 */
@@ -3514,9 +3508,7 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *node_bitmap,
 			break;
 		bit_copybits(node_bitmap, orig_map);
 		bit_copybits(free_cores, avail_cores);
-		bit_copybits(tmpcore, jp_ptr->row[i].row_bitmap);
-		bit_not(tmpcore);
-		bit_and(free_cores, tmpcore);
+		bit_and_not(free_cores, jp_ptr->row[i].row_bitmap);
 
 		if (job_ptr->details->whole_node == 1)
 			_block_whole_nodes(node_bitmap, avail_cores,
@@ -3582,7 +3574,6 @@ alloc_job:
 	 * distribute the job on the bits, and exit
 	 */
 	FREE_NULL_BITMAP(orig_map);
-	FREE_NULL_BITMAP(tmpcore);
 	FREE_NULL_BITMAP(part_core_map);
 	if ((!cpu_count) || (!job_ptr->best_switch)) {
 		/* we were sent here to cleanup and exit */
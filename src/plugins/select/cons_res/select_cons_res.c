@@ -177,6 +177,7 @@ const uint32_t pstate_version = 7;	/* version control on saved state */
 uint16_t cr_type = CR_CPU; /* cr_type is overwritten in init() */
 
 bool     backfill_busy_nodes  = false;
+bool     gang_mode            = false;
 bool     have_dragonfly       = false;
 bool     pack_serial_at_end   = false;
 bool     preempt_by_part      = false;
@@ -232,6 +233,7 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 			  uint32_t req_nodes, uint16_t job_node_req,
 			  List preemptee_candidates, List *preemptee_job_list,
 			  bitstr_t *exc_core_bitmap);
+static int _will_run_list_test(List req_list);
 
 struct sort_support {
 	int jstart;
@@ -339,7 +341,9 @@ static struct part_row_data *_dup_row_data(struct part_row_data *orig_row,
 }
 
 
-/* Create a duplicate part_res_record list */
+/* Create a duplicate part_res_record list for simulating the termination of
+ * jobs. The row bitmaps and job lists of the copy are shared with the
+ * original until _unshare_rows() is called before a job is removed. */
 static struct part_res_record *_dup_part_data(struct part_res_record *orig_ptr)
 {
 	struct part_res_record *new_part_ptr, *new_ptr;
@@ -353,8 +357,15 @@ static struct part_res_record *_dup_part_data(struct part_res_record *orig_ptr)
 	while (orig_ptr) {
 		new_ptr->part_ptr = orig_ptr->part_ptr;
 		new_ptr->num_rows = orig_ptr->num_rows;
-		new_ptr->row = _dup_row_data(orig_ptr->row,
-					     orig_ptr->num_rows);
+		if (orig_ptr->row) {
+			/* Own the array, rows may be sorted by cr_job_test */
+			new_ptr->row = xmalloc(orig_ptr->num_rows *
+					       sizeof(struct part_row_data));
+			memcpy(new_ptr->row, orig_ptr->row,
+			       orig_ptr->num_rows *
+			       sizeof(struct part_row_data));
+			new_ptr->rows_shared = true;
+		}
 		if (orig_ptr->next) {
 			new_ptr->next = xmalloc(sizeof(struct part_res_record));
 			new_ptr = new_ptr->next;
@@ -365,7 +376,22 @@ static struct part_res_record *_dup_part_data(struct part_res_record *orig_ptr)
 }
 
 
-/* Create a duplicate part_res_record list */
+/* Replace the row bitmaps and job lists shared with another partition
+ * record by copies, which can then be modified */
+static void _unshare_rows(struct part_res_record *p_ptr)
+{
+	struct part_row_data *shared_row = p_ptr->row;
+
+	if (!p_ptr->rows_shared)
+		return;
+	p_ptr->row = _dup_row_data(shared_row, p_ptr->num_rows);
+	p_ptr->rows_shared = false;
+	xfree(shared_row);
+}
+
+/* Create a duplicate node_use_record array for simulating the termination of
+ * jobs. The gres lists of the copy are shared with the original until a job
+ * is removed from the node. */
 static struct node_use_record *_dup_node_usage(struct node_use_record *orig_ptr)
 {
 	struct node_use_record *new_use_ptr, *new_ptr;
@@ -381,15 +407,33 @@ static struct node_use_record *_dup_node_usage(struct node_use_record *orig_ptr)
 	for (i = 0; i < select_node_cnt; i++) {
 		new_ptr[i].node_state   = orig_ptr[i].node_state;
 		new_ptr[i].alloc_memory = orig_ptr[i].alloc_memory;
+		new_ptr[i].row_core_cnt = orig_ptr[i].row_core_cnt;
 		if (orig_ptr[i].gres_list)
 			gres_list = orig_ptr[i].gres_list;
 		else
 			gres_list = node_record_table_ptr[i].gres_list;
-		new_ptr[i].gres_list = gres_plugin_node_state_dup(gres_list);
+		new_ptr[i].gres_list = gres_list;
+		new_ptr[i].gres_shared = true;
 	}
 	return new_use_ptr;
 }
 
+/* Return the gres_list of a node to be modified, replacing one shared with
+ * another node_use_record array by a copy */
+static List _own_gres_list(struct node_use_record *node_usage, int node_inx)
+{
+	struct node_use_record *use_ptr = node_usage + node_inx;
+
+	if (use_ptr->gres_shared) {
+		use_ptr->gres_list =
+			gres_plugin_node_state_dup(use_ptr->gres_list);
+		use_ptr->gres_shared = false;
+	}
+	if (use_ptr->gres_list)
+		return use_ptr->gres_list;
+	return node_record_table_ptr[node_inx].gres_list;
+}
+
 /* delete the given row data */
 static void _destroy_row_data(struct part_row_data *row, uint16_t num_rows) {
 	uint16_t i;
@@ -408,7 +452,9 @@ static void _destroy_part_data(struct part_res_record *this_ptr)
 		this_ptr = this_ptr->next;
 		tmp->part_ptr = NULL;
 
-		if (tmp->row) {
+		if (tmp->rows_shared) {
+			xfree(tmp->row);
+		} else if (tmp->row) {
 			_destroy_row_data(tmp->row, tmp->num_rows);
 			tmp->row = NULL;
 		}
@@ -480,7 +526,8 @@ static void _destroy_node_data(struct node_use_record *node_usage,
 	xfree(node_data);
 	if (node_usage) {
 		for (i = 0; i < select_node_cnt; i++) {
-			FREE_NULL_LIST(node_usage[i].gres_list);
+			if (!node_usage[i].gres_shared)
+				FREE_NULL_LIST(node_usage[i].gres_list);
 		}
 		xfree(node_usage);
 	}
@@ -519,6 +566,39 @@ static int _can_job_fit_in_row(struct job_resources *job,
 }
 
 
+/* Add the cores allocated to a job on each of its nodes to (add = true) or
+ * remove them from (add = false) the row_core_cnt of node_usage as the job is
+ * added to or removed from a partition row. Jobs in one row never share
+ * cores, so row_core_cnt is zero only if no row has a core of the node. */
+static void _add_job_row_cores(struct node_use_record *node_usage,
+			       struct job_resources *job, bool add)
+{
+	int i, i_first, i_last, n;
+	uint32_t cores;
+
+	i_first = bit_ffs(job->node_bitmap);
+	if (i_first == -1)
+		return;
+	i_last = bit_fls(job->node_bitmap);
+	for (i = i_first, n = -1; i <= i_last; i++) {
+		if (!bit_test(job->node_bitmap, i))
+			continue;
+		n++;
+		/* Same cores as add_job_to_cores() */
+		if (job->whole_node == 1)
+			cores = cr_node_num_cores[i];
+		else
+			cores = count_job_resources_node(job, n);
+		if (add)
+			node_usage[i].row_core_cnt += cores;
+		else if (node_usage[i].row_core_cnt >= cores)
+			node_usage[i].row_core_cnt -= cores;
+		else
+			node_usage[i].row_core_cnt = 0;
+	}
+}
+
+
 /* helper script for cr_sort_part_rows() */
 static void _swap_rows(struct part_row_data *a, struct part_row_data *b)
 {
@@ -889,6 +969,7 @@ static int _add_job_to_res(struct job_record *job_ptr, int action)
 			debug3("cons_res: adding job %u to part %s row %u",
 			       job_ptr->job_id, p_ptr->part_ptr->name, i);
 			_add_job_to_row(job, &(p_ptr->row[i]));
+			_add_job_row_cores(select_node_usage, job, true);
 			break;
 		}
 		if (i >= p_ptr->num_rows) {
@@ -1189,10 +1270,7 @@ static int _rm_job_from_res(struct part_res_record *part_record_ptr,
 
 		node_ptr = node_record_table_ptr + i;
 		if (action != 2) {
-			if (node_usage[i].gres_list)
-				gres_list = node_usage[i].gres_list;
-			else
-				gres_list = node_ptr->gres_list;
+			gres_list = _own_gres_list(node_usage, i);
 			gres_plugin_job_dealloc(job_ptr->gres_list, gres_list,
 						n, job_ptr->job_id,
 						node_ptr->name);
@@ -1245,6 +1323,7 @@ static int _rm_job_from_res(struct part_res_record *part_record_ptr,
 
 		if (!p_ptr->row)
 			return SLURM_SUCCESS;
+		_unshare_rows(p_ptr);
 
 		/* remove the job from the job_list */
 		n = 0;
@@ -1271,6 +1350,7 @@ static int _rm_job_from_res(struct part_res_record *part_record_ptr,
 		}
 		if (n) {
 			/* job was found and removed, so refresh the bitmaps */
+			_add_job_row_cores(node_usage, job, false);
 			_build_row_bitmaps(p_ptr, job_ptr);
 			/* Adjust the node_state of all nodes affected by
 			 * the removal of this job. If all cores are now
@@ -1313,6 +1393,7 @@ static int _rm_job_from_one_node(struct job_record *job_ptr,
 	struct part_res_record *p_ptr;
 	int first_bit, last_bit;
 	int i, node_inx, n;
+	uint32_t row_cores = 0;
 	List gres_list;
 
 	if (!job || !job->core_bitmap) {
@@ -1361,6 +1442,10 @@ static int _rm_job_from_one_node(struct job_record *job_ptr,
 		} else
 			node_usage[i].alloc_memory -= job->memory_allocated[n];
 
+		if (job->whole_node == 1)
+			row_cores = cr_node_num_cores[i];
+		else
+			row_cores = count_job_resources_node(job, n);
 		extract_job_resources_node(job, n);
 
 		break;
@@ -1412,6 +1497,10 @@ static int _rm_job_from_one_node(struct job_record *job_ptr,
 
 
 	/* some node of job removed from core-bitmap, so refresh CR bitmaps */
+	if (node_usage[node_inx].row_core_cnt >= row_cores)
+		node_usage[node_inx].row_core_cnt -= row_cores;
+	else
+		node_usage[node_inx].row_core_cnt = 0;
 	_build_row_bitmaps(p_ptr, NULL);
 
 	/* Adjust the node_state of the node removed from this job.
@@ -1693,8 +1782,8 @@ top:	orig_map = bit_copy(save_bitmap);
 				    (mode != PREEMPT_MODE_CHECKPOINT) &&
 				    (mode != PREEMPT_MODE_CANCEL))
 					continue;
-				if (bit_overlap(bitmap,
-						tmp_job_ptr->node_bitmap) == 0)
+				if (!bit_overlap_any(bitmap,
+						     tmp_job_ptr->node_bitmap))
 					continue;
 				list_append(*preemptee_job_list,
 					    tmp_job_ptr);
@@ -1758,6 +1847,24 @@ static bool _job_cleaning(struct job_record *job_ptr)
 	return false;
 }
 
+/* Apply core specialization and default multi-core options to a job about
+ * to be tested and return its node sharing requirement */
+static uint16_t _job_test_prep(struct job_record *job_ptr)
+{
+	if (slurm_get_use_spec_resources() == 0)
+		job_ptr->details->core_spec = (uint16_t) NO_VAL;
+	if ((job_ptr->details->core_spec != (uint16_t) NO_VAL) &&
+	    (job_ptr->details->whole_node != 1)) {
+		info("Setting Exclusive mode for job %u with CoreSpec=%u",
+		      job_ptr->job_id, job_ptr->details->core_spec);
+		job_ptr->details->whole_node = 1;
+	}
+
+	if (!job_ptr->details->mc_ptr)
+		job_ptr->details->mc_ptr = _create_default_mc();
+	return _get_job_node_req(job_ptr);
+}
+
 /* _will_run_test - determine when and where a pending job can start, removes
  *	jobs from node table at termination time and run _test_job() after
  *	each job (or a few jobs that end close in time). Used by SLURM's
@@ -1791,13 +1898,23 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 		}
 	}
 
+	/* The partition data is copied before any test: cr_job_test() sorts
+	 * the rows of the copy, not those of select_part_record, so that
+	 * sched/backfill can run several will-run tests at the same time */
+	future_part = _dup_part_data(select_part_record);
+	if (future_part == NULL) {
+		FREE_NULL_BITMAP(orig_map);
+		return SLURM_ERROR;
+	}
+
 	/* Try to run with currently available nodes */
 	rc = cr_job_test(job_ptr, bitmap, min_nodes, max_nodes, req_nodes,
 			 SELECT_MODE_WILL_RUN, tmp_cr_type, job_node_req,
-			 select_node_cnt, select_part_record,
+			 select_node_cnt, future_part,
 			 select_node_usage, exc_core_bitmap, false, false,
 			 false);
 	if (rc == SLURM_SUCCESS) {
+		_destroy_part_data(future_part);
 		FREE_NULL_BITMAP(orig_map);
 		job_ptr->start_time = now;
 		return SLURM_SUCCESS;
@@ -1805,11 +1922,6 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 
 	/* Job is still pending. Simulate termination of jobs one at a time
 	 * to determine when and where the job can start. */
-	future_part = _dup_part_data(select_part_record);
-	if (future_part == NULL) {
-		FREE_NULL_BITMAP(orig_map);
-		return SLURM_ERROR;
-	}
 	future_usage = _dup_node_usage(select_node_usage);
 	if (future_usage == NULL) {
 		_destroy_part_data(future_part);
@@ -1976,8 +2088,8 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 		preemptee_iterator =list_iterator_create(preemptee_candidates);
 		while ((tmp_job_ptr = (struct job_record *)
 			list_next(preemptee_iterator))) {
-			if (bit_overlap(bitmap,
-					tmp_job_ptr->node_bitmap) == 0)
+			if (!bit_overlap_any(bitmap,
+					     tmp_job_ptr->node_bitmap))
 				continue;
 			list_append(*preemptee_job_list, tmp_job_ptr);
 		}
@@ -1991,6 +2103,206 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 	return rc;
 }
 
+/* Per request state for _will_run_list_test() */
+typedef struct will_run_req {
+	select_will_run_t *will_run;
+	bitstr_t *orig_map;		/* nodes usable by the job */
+	uint16_t cr_type;
+	uint16_t job_node_req;
+	struct job_record *last_job_ptr; /* last job removed from the
+					  * current group on orig_map */
+	bool pending;
+} will_run_req_t;
+
+/* _will_run_list_test - determine when and where each of several pending
+ *	jobs can start. Equivalent to calling _will_run_test() without
+ *	preemptee candidates for each job, except that the state is copied
+ *	and the running jobs are sorted by end time only once. The removal of
+ *	running jobs is replayed once for all of the pending jobs and each job
+ *	is tested only after a group of removals freed some of its nodes.
+ * IN/OUT req_list - list of select_will_run_t, see select_p_job_list_test
+ * RET SLURM_SUCCESS or error code */
+static int _will_run_list_test(List req_list)
+{
+	struct part_res_record *future_part;
+	struct node_use_record *future_usage;
+	struct job_record *job_ptr, *tmp_job_ptr;
+	struct job_record *first_job_ptr, *next_job_ptr;
+	select_will_run_t *will_run;
+	will_run_req_t *reqs, *req;
+	List cr_job_list;
+	ListIterator job_iterator;
+	int i, req_cnt, pend_cnt = 0, rc, rm_job_cnt, time_window = 30;
+	bool more_jobs = true, timed_out = false;
+	time_t now = time(NULL);
+	DEF_TIMERS;
+
+	req_cnt = list_count(req_list);
+	if (req_cnt == 0)
+		return SLURM_SUCCESS;
+	reqs = xmalloc(sizeof(will_run_req_t) * req_cnt);
+
+	/* Try to run each job with currently available nodes */
+	i = 0;
+	job_iterator = list_iterator_create(req_list);
+	while ((will_run = (select_will_run_t *) list_next(job_iterator))) {
+		req = &reqs[i++];
+		req->will_run = will_run;
+		job_ptr = will_run->job_ptr;
+		if (!job_ptr->details) {
+			will_run->rc = EINVAL;
+			continue;
+		}
+		req->job_node_req = _job_test_prep(job_ptr);
+		req->cr_type = cr_type;
+		if (job_ptr->part_ptr->cr_type) {
+			if ((cr_type & CR_SOCKET) || (cr_type & CR_CORE)) {
+				req->cr_type &= ~(CR_SOCKET | CR_CORE |
+						  CR_MEMORY);
+				req->cr_type |= job_ptr->part_ptr->cr_type;
+			} else {
+				info("cons_res: Can't use Partition SelectType "
+				     "unless using CR_Socket or CR_Core");
+			}
+		}
+		req->orig_map = bit_copy(will_run->avail_nodes);
+		will_run->rc = cr_job_test(job_ptr, will_run->avail_nodes,
+					   will_run->min_nodes,
+					   will_run->max_nodes,
+					   will_run->req_nodes,
+					   SELECT_MODE_WILL_RUN, req->cr_type,
+					   req->job_node_req, select_node_cnt,
+					   select_part_record,
+					   select_node_usage,
+					   will_run->exc_core_bitmap, false,
+					   false, false);
+		if (will_run->rc == SLURM_SUCCESS)
+			job_ptr->start_time = now;
+		else if ((job_ptr->bit_flags & TEST_NOW_ONLY) == 0) {
+			req->pending = true;
+			pend_cnt++;
+		}
+	}
+	list_iterator_destroy(job_iterator);
+
+	if (pend_cnt == 0)
+		goto fini;
+
+	/* Jobs are still pending. Simulate termination of running jobs one
+	 * time for all of them to determine when and where they can start. */
+	future_part = _dup_part_data(select_part_record);
+	if (future_part == NULL)
+		goto fini;
+	future_usage = _dup_node_usage(select_node_usage);
+	if (future_usage == NULL) {
+		_destroy_part_data(future_part);
+		goto fini;
+	}
+
+	/* Build list of running and suspended jobs */
+	cr_job_list = list_create(NULL);
+	job_iterator = list_iterator_create(job_list);
+	while ((tmp_job_ptr = (struct job_record *) list_next(job_iterator))) {
+		if (!IS_JOB_RUNNING(tmp_job_ptr) &&
+		    !IS_JOB_SUSPENDED(tmp_job_ptr) &&
+		    !_job_cleaning(tmp_job_ptr))
+			continue;
+		if ((tmp_job_ptr->end_time == 0) ||
+		    (tmp_job_ptr->node_bitmap == NULL))
+			continue;	/* Logged by _will_run_test() */
+		list_append(cr_job_list, tmp_job_ptr);
+	}
+	list_iterator_destroy(job_iterator);
+	list_sort(cr_job_list, _cr_job_list_sort);
+
+	/* Remove the running jobs from future_part and future_usage in groups
+	 * that end close in time, then try scheduling the pending jobs whose
+	 * nodes were touched by the group. */
+	START_TIMER;
+	job_iterator = list_iterator_create(cr_job_list);
+	while (more_jobs && (pend_cnt > 0)) {
+		first_job_ptr = NULL;
+		rm_job_cnt = 0;
+		while (true) {
+			tmp_job_ptr = list_next(job_iterator);
+			if (!tmp_job_ptr) {
+				more_jobs = false;
+				break;
+			}
+			for (i = 0; i < req_cnt; i++) {
+				if (reqs[i].pending &&
+				    bit_overlap_any(reqs[i].orig_map,
+						    tmp_job_ptr->node_bitmap))
+					reqs[i].last_job_ptr = tmp_job_ptr;
+			}
+			if (!first_job_ptr)
+				first_job_ptr = tmp_job_ptr;
+			_rm_job_from_res(future_part, future_usage,
+					 tmp_job_ptr, 0);
+			if (timed_out)
+				continue;
+			if (rm_job_cnt++ > 200)
+				break;
+			next_job_ptr = list_peek_next(job_iterator);
+			if (!next_job_ptr) {
+				more_jobs = false;
+				break;
+			} else if (next_job_ptr->end_time >
+				   (first_job_ptr->end_time + time_window)) {
+				break;
+			}
+		}
+		time_window *= 2;
+		for (i = 0; i < req_cnt; i++) {
+			req = &reqs[i];
+			if (!req->pending || !req->last_job_ptr)
+				continue;
+			will_run = req->will_run;
+			bit_copybits(will_run->avail_nodes, req->orig_map);
+			rc = cr_job_test(will_run->job_ptr,
+					 will_run->avail_nodes,
+					 will_run->min_nodes, will_run->max_nodes,
+					 will_run->req_nodes, SELECT_MODE_WILL_RUN,
+					 req->cr_type, req->job_node_req,
+					 select_node_cnt, future_part,
+					 future_usage, will_run->exc_core_bitmap,
+					 backfill_busy_nodes, false, true);
+			if (rc == SLURM_SUCCESS) {
+				tmp_job_ptr = req->last_job_ptr;
+				if (tmp_job_ptr->end_time <= now) {
+					will_run->job_ptr->start_time =
+						_guess_job_end(tmp_job_ptr,
+							       now);
+				} else {
+					will_run->job_ptr->start_time =
+						tmp_job_ptr->end_time;
+				}
+				will_run->rc = SLURM_SUCCESS;
+				req->pending = false;
+				pend_cnt--;
+			}
+			req->last_job_ptr = NULL;
+		}
+		/* After 1 second of iterating over groups of running jobs,
+		 * simulate the termination of all remaining jobs in order to
+		 * determine if the pending jobs can ever run */
+		END_TIMER;
+		if (DELTA_TIMER >= 1000000)
+			timed_out = true;
+	}
+	list_iterator_destroy(job_iterator);
+
+	FREE_NULL_LIST(cr_job_list);
+	_destroy_part_data(future_part);
+	_destroy_node_data(future_usage, NULL);
+
+fini:
+	for (i = 0; i < req_cnt; i++)
+		FREE_NULL_BITMAP(reqs[i].orig_map);
+	xfree(reqs);
+	return SLURM_SUCCESS;
+}
+
 static int
 _compare_support(const void *v, const void *v1)
 {
@@ -2146,6 +2458,10 @@ extern int select_p_node_init(struct node_record *node_ptr, int node_cnt)
 		backfill_busy_nodes = false;
 	xfree(sched_params);
 
+	if (slurm_get_preempt_mode() & PREEMPT_MODE_GANG)
+		gang_mode = true;
+	else
+		gang_mode = false;
 	preempt_type = slurm_get_preempt_type();
 	preempt_by_part = false;
 	preempt_by_qos = false;
@@ -2253,32 +2569,15 @@ extern int select_p_job_test(struct job_record *job_ptr, bitstr_t * bitmap,
 {
 	int rc = EINVAL;
 	uint16_t job_node_req;
-	static bool debug_cpu_bind = false, debug_check = false;
 
 	xassert(bitmap);
 
 	debug2("select_p_job_test for job %u", job_ptr->job_id);
-	if (!debug_check) {
-		debug_check = true;
-		if (slurm_get_debug_flags() & DEBUG_FLAG_SELECT_TYPE)
-			debug_cpu_bind = true;
-	}
 
 	if (!job_ptr->details)
 		return EINVAL;
 
-	if (slurm_get_use_spec_resources() == 0)
-		job_ptr->details->core_spec = (uint16_t) NO_VAL;
-	if ((job_ptr->details->core_spec != (uint16_t) NO_VAL) &&
-	    (job_ptr->details->whole_node != 1)) {
-		info("Setting Exclusive mode for job %u with CoreSpec=%u",
-		      job_ptr->job_id, job_ptr->details->core_spec);
-		job_ptr->details->whole_node = 1;
-	}
-
-	if (!job_ptr->details->mc_ptr)
-		job_ptr->details->mc_ptr = _create_default_mc();
-	job_node_req = _get_job_node_req(job_ptr);
+	job_node_req = _job_test_prep(job_ptr);
 
 	if (select_debug_flags & DEBUG_FLAG_SELECT_TYPE) {
 		info("cons_res: select_p_job_test: job %u node_req %u mode %d",
@@ -2311,13 +2610,34 @@ extern int select_p_job_test(struct job_record *job_ptr, bitstr_t * bitmap,
 			info("no job_resources info for job %u rc=%d",
 			     job_ptr->job_id, rc);
 		}
-	} else if (debug_cpu_bind && job_ptr->job_resrcs) {
+	} else if ((select_debug_flags & DEBUG_FLAG_SELECT_TYPE) &&
+		   job_ptr->job_resrcs) {
 		log_job_resources(job_ptr->job_id, job_ptr->job_resrcs);
 	}
 
 	return rc;
 }
 
+/*
+ * select_p_job_list_test - Determine when and where each of several pending
+ *	jobs can start, as select_p_job_test() with SELECT_MODE_WILL_RUN and
+ *	no preemptee candidates would for each of them, but copy the
+ *	resource state and replay the termination of running jobs only once.
+ * IN/OUT req_list - list of select_will_run_t. On return, rc of each record
+ *	is the result of its test, avail_nodes is set as the bitmap by
+ *	select_p_job_test() and start_time of the job is set on success.
+ * RET SLURM_SUCCESS or error code
+ */
+extern int select_p_job_list_test(List req_list)
+{
+	if (select_debug_flags & DEBUG_FLAG_SELECT_TYPE) {
+		info("cons_res: select_p_job_list_test: %d jobs",
+		     list_count(req_list));
+		_dump_state(select_part_record);
+	}
+	return _will_run_list_test(req_list);
+}
+
 extern int select_p_job_begin(struct job_record *job_ptr)
 {
 	return SLURM_SUCCESS;
@@ -2840,6 +3160,10 @@ extern int select_p_get_info_from_plugin(enum select_plugindata_info info,
 	case SELECT_CONFIG_INFO:
 		*tmp_list = NULL;
 		break;
+	case SELECT_WILL_RUN_REENTRANT:
+		/* _will_run_test() only modifies copies of the state */
+		*tmp_32 = 1;
+		break;
 	default:
 		error("select_p_get_info_from_plugin info %d invalid",
 		      info);
@@ -3352,9 +3676,7 @@ extern bitstr_t * select_p_resv_test(resv_desc_msg_t *resv_desc_ptr,
 			_make_core_bitmap_filtered(switches_bitmap[i], 1);
 
 		if (*core_bitmap) {
-			bit_not(*core_bitmap);
-			bit_and(switches_core_bitmap[i], *core_bitmap);
-			bit_not(*core_bitmap);
+			bit_and_not(switches_core_bitmap[i], *core_bitmap);
 		}
 		bit_fmt(str, sizeof(str), switches_core_bitmap[i]);
 		switches_cpu_cnt[i] = bit_set_count(switches_core_bitmap[i]);
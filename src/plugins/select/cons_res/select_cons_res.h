@@ -79,6 +79,8 @@ struct part_res_record {
 	uint16_t num_rows;		/* Number of elements in "row" array */
 	struct part_record *part_ptr;   /* controller part record pointer */
 	struct part_row_data *row;	/* array of rows containing jobs */
+	bool rows_shared;		/* row bitmaps and job lists belong to
+					 * the record this was copied from */
 };
 
 /* per-node resource data */
@@ -101,10 +103,15 @@ struct node_use_record {
 					 * scheduled jobs */
 	List gres_list;			/* list of gres state info managed by 
 					 * plugins */
+	bool gres_shared;		/* gres_list belongs to the record this
+					 * was copied from */
 	uint16_t node_state;		/* see node_cr_state comments */
+	uint32_t row_core_cnt;		/* cores allocated to jobs in partition
+					 * rows, summed over all rows */
 };
 
 extern bool     backfill_busy_nodes;
+extern bool     gang_mode;
 extern bool     have_dragonfly;
 extern bool     pack_serial_at_end;
 extern bool     preempt_by_part;
@@ -1818,6 +1818,42 @@ extern int select_p_block_init(List part_list)
 	return other_block_init(part_list);
 }
 
+/* Remove nodes from bitmap which can not be used by the job because of the
+ * network performance counters in use */
+static void _npc_filter(struct job_record *job_ptr, bitstr_t *bitmap,
+			uint16_t mode)
+{
+	select_jobinfo_t *jobinfo = job_ptr->select_jobinfo->data;
+	slurm_mutex_lock(&blade_mutex);
+
+	if (jobinfo->npc != NPC_NONE) {
+		/* If looking for network performance counters unmark
+		   all the nodes that are in use since they cannot be used.
+		*/
+		if (mode != SELECT_MODE_TEST_ONLY) {
+			if (jobinfo->npc == NPC_SYS) {
+				/* All the nodes have to be free of
+				 * network performance counters to run
+				 * NPC_SYS.
+				 */
+				if (bit_ffs(blade_nodes_running_npc) != -1)
+					bit_nclear(bitmap, 0,
+						   bit_size(bitmap) - 1);
+			} else {
+				bit_and_not(bitmap, blade_nodes_running_npc);
+			}
+		}
+	}
+
+	/* char *tmp = bitmap2node_name(bitmap); */
+	/* char *tmp3 = bitmap2node_name(blade_nodes_running_npc); */
+
+	/* info("trying %u on %s '%s'", job_ptr->job_id, tmp, tmp3); */
+	/* xfree(tmp); */
+	/* xfree(tmp3); */
+	slurm_mutex_unlock(&blade_mutex);
+}
+
 /*
  * select_p_job_test - Given a specification of scheduling requirements,
  *	identify the nodes which "best" satisfy the request.
@@ -1863,41 +1899,31 @@ extern int select_p_job_test(struct job_record *job_ptr, bitstr_t *bitmap,
 		_start_aeld_thread();
 #endif
 
-	select_jobinfo_t *jobinfo = job_ptr->select_jobinfo->data;
-	slurm_mutex_lock(&blade_mutex);
+	_npc_filter(job_ptr, bitmap, mode);
+	return other_job_test(job_ptr, bitmap, min_nodes, max_nodes,
+			      req_nodes, mode, preemptee_candidates,
+			      preemptee_job_list, exc_core_bitmap);
+}
 
-	if (jobinfo->npc != NPC_NONE) {
-		/* If looking for network performance counters unmark
-		   all the nodes that are in use since they cannot be used.
-		*/
-		if (mode != SELECT_MODE_TEST_ONLY) {
-			if (jobinfo->npc == NPC_SYS) {
-				/* All the nodes have to be free of
-				 * network performance counters to run
-				 * NPC_SYS.
-				 */
-				if (bit_ffs(blade_nodes_running_npc) != -1)
-					bit_nclear(bitmap, 0,
-						   bit_size(bitmap) - 1);
-			} else {
-				bit_not(blade_nodes_running_npc);
-				bit_and(bitmap, blade_nodes_running_npc);
-				bit_not(blade_nodes_running_npc);
-			}
-		}
-	}
+extern int select_p_job_list_test(List req_list)
+{
+	ListIterator iter;
+	select_will_run_t *will_run;
 
-	/* char *tmp = bitmap2node_name(bitmap); */
-	/* char *tmp3 = bitmap2node_name(blade_nodes_running_npc); */
+#ifdef HAVE_NATIVE_CRAY
+	/* Restart if the thread ever has an unrecoverable error and exits. */
+	if (!aeld_running)
+		_start_aeld_thread();
+#endif
 
-	/* info("trying %u on %s '%s'", job_ptr->job_id, tmp, tmp3); */
-	/* xfree(tmp); */
-	/* xfree(tmp3); */
-	slurm_mutex_unlock(&blade_mutex);
+	iter = list_iterator_create(req_list);
+	while ((will_run = (select_will_run_t *) list_next(iter))) {
+		_npc_filter(will_run->job_ptr, will_run->avail_nodes,
+			    SELECT_MODE_WILL_RUN);
+	}
+	list_iterator_destroy(iter);
 
-	return other_job_test(job_ptr, bitmap, min_nodes, max_nodes,
-			      req_nodes, mode, preemptee_candidates,
-			      preemptee_job_list, exc_core_bitmap);
+	return other_job_list_test(req_list);
 }
 
 extern int select_p_job_begin(struct job_record *job_ptr)
@@ -2654,6 +2680,11 @@ extern int select_p_get_info_from_plugin(enum select_plugindata_info dinfo,
 					 struct job_record *job_ptr,
 					 void *data)
 {
+	if (dinfo == SELECT_WILL_RUN_REENTRANT) {
+		/* Not known for the plugin's own job tests */
+		*(uint32_t *) data = 0;
+		return SLURM_SUCCESS;
+	}
 	return other_get_info_from_plugin(dinfo, job_ptr, data);
 }
 
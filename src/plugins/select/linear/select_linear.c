@@ -3327,8 +3327,8 @@ top:	if ((rc != SLURM_SUCCESS) && preemptee_candidates &&
 				preemptee_candidates);
 			while ((tmp_job_ptr = (struct job_record *)
 				list_next(preemptee_iterator))) {
-				if (bit_overlap(bitmap,
-						tmp_job_ptr->node_bitmap) == 0)
+				if (!bit_overlap_any(bitmap,
+						     tmp_job_ptr->node_bitmap))
 					continue;
 				if (tmp_job_ptr->details->usable_nodes == 0)
 					continue;
@@ -3473,7 +3473,7 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 		preemptee_iterator =list_iterator_create(preemptee_candidates);
 		while ((tmp_job_ptr = (struct job_record *)
 			list_next(preemptee_iterator))) {
-			if (bit_overlap(bitmap, tmp_job_ptr->node_bitmap) == 0)
+			if (!bit_overlap_any(bitmap, tmp_job_ptr->node_bitmap))
 				continue;
 
 			list_append(*preemptee_job_list, tmp_job_ptr);
@@ -3689,6 +3689,27 @@ extern int select_p_job_test(struct job_record *job_ptr, bitstr_t *bitmap,
 	return rc;
 }
 
+extern int select_p_job_list_test(List req_list)
+{
+	ListIterator iter;
+	select_will_run_t *will_run;
+
+	iter = list_iterator_create(req_list);
+	while ((will_run = (select_will_run_t *) list_next(iter))) {
+		will_run->rc = select_p_job_test(will_run->job_ptr,
+						 will_run->avail_nodes,
+						 will_run->min_nodes,
+						 will_run->max_nodes,
+						 will_run->req_nodes,
+						 SELECT_MODE_WILL_RUN,
+						 NULL, NULL,
+						 will_run->exc_core_bitmap);
+	}
+	list_iterator_destroy(iter);
+
+	return SLURM_SUCCESS;
+}
+
 /*
  * Note initiation of job is about to begin. Called immediately
  * after select_p_job_test(). Executed from slurmctld.
@@ -169,6 +169,13 @@ extern int other_job_test(struct job_record *job_ptr, bitstr_t *bitmap,
 			  List preemptee_candidates, List *preemptee_job_list,
 			  bitstr_t *exc_core_bitmap);
 
+/*
+ * Determine when and where each of several pending jobs can start
+ * IN/OUT req_list - list of select_will_run_t records
+ * RET SLURM_SUCCESS or error code
+ */
+extern int other_job_list_test(List req_list);
+
 /*
  * Note initiation of job is about to begin. Called immediately
  * after other_job_test(). Executed from slurmctld.
@@ -59,6 +59,8 @@ bool sort_by_time2 = false;
 stats_info_response_msg_t *buf;
 uint32_t *rpc_type_ave_time = NULL, *rpc_user_ave_time = NULL;
 
+static char *_lock_name(int inx);
+static char *_rpc_prio_name(int inx);
 static int  _print_stats(void);
 static void _sort_rpc(void);
 
@@ -121,6 +123,33 @@ static int _print_stats(void)
 	printf("Jobs completed: %d\n", buf->jobs_completed);
 	printf("Jobs canceled:  %d\n", buf->jobs_canceled);
 	printf("Jobs failed:    %d\n", buf->jobs_failed);
+	printf("\nJob info snapshot cache statistics:\n");
+	printf("\tHits:   %u\n", buf->job_info_cache_hits);
+	printf("\tMisses: %u\n", buf->job_info_cache_misses);
+	printf("\nJob state save statistics:\n");
+	printf("\tCheckpoints written:     %u\n", buf->job_state_ckpt_cnt);
+	printf("\tJournal records written: %u\n",
+	       buf->job_state_journal_cnt);
+	printf("\tBytes written:           %"PRIu64"\n",
+	       buf->job_state_bytes);
+	if (buf->req_time > buf->req_time_start) {
+		printf("\tBytes written per hour:  %"PRIu64"\n",
+		       buf->job_state_bytes * 3600 /
+		       (buf->req_time - buf->req_time_start));
+	}
+	printf("\tJournal size:            %u\n", buf->job_state_journal_size);
+	printf("\tLoad time (usec):        %u\n", buf->job_state_load_time);
+	if (buf->prio_calc_cnt) {
+		printf("\nPriority calculation statistics (microseconds):\n");
+		printf("\tTotal calculations: %u\n", buf->prio_calc_cnt);
+		printf("\tLast jobs:          %u\n", buf->prio_calc_jobs);
+		printf("\tLast threads:       %u\n", buf->prio_calc_threads);
+		printf("\tLast decay:         %u\n", buf->prio_decay_time);
+		printf("\tLast job usage:     %u\n", buf->prio_usage_time);
+		printf("\tLast fair share:    %u\n", buf->prio_fs_time);
+		printf("\tLast job factors:   %u\n", buf->prio_factor_time);
+		printf("\tLast job store:     %u\n", buf->prio_store_time);
+	}
 	printf("\nMain schedule statistics (microseconds):\n");
 	printf("\tLast cycle:   %u\n", buf->schedule_cycle_last);
 	printf("\tMax cycle:    %u\n", buf->schedule_cycle_max);
@@ -169,14 +198,36 @@ static int _print_stats(void)
 		printf("\tQueue length mean: %u\n",
 		       buf->bf_queue_len_sum / buf->bf_cycle_counter);
 	}
+	if (buf->bf_worker_cnt > 1) {
+		printf("\tLast cycle node set groups: %u\n", buf->bf_group_cnt);
+		printf("\t%-8s %8s %8s %10s %12s %8s\n",
+		       "WORKER", "GROUPS", "DEPTH", "DEPTH_TRY", "TEST_TIME",
+		       "OVERLAP");
+		for (i = 0; i < buf->bf_worker_cnt; i++) {
+			printf("\t%-8d %8u %8u %10u %12"PRIu64" %8u\n", i,
+			       buf->bf_worker_group_cnt[i],
+			       buf->bf_worker_depth[i],
+			       buf->bf_worker_depth_try[i],
+			       buf->bf_worker_test_time[i],
+			       buf->bf_worker_overlap[i]);
+		}
+	}
 
 	printf("\nRemote Procedure Call statistics by message type\n");
 	for (i = 0; i < buf->rpc_type_size; i++) {
+		uint64_t ave_queue = 0;
+
+		if (buf->rpc_type_cnt[i]) {
+			ave_queue = buf->rpc_type_queue_time[i] /
+				    buf->rpc_type_cnt[i];
+		}
 		printf("\t%-40s(%5u) count:%-6u "
-		       "ave_time:%-6u total_time:%"PRIu64"\n",
+		       "ave_time:%-6u total_time:%-10"PRIu64" "
+		       "ave_queue_time:%"PRIu64"\n",
 		       rpc_num2string(buf->rpc_type_id[i]),
 		       buf->rpc_type_id[i], buf->rpc_type_cnt[i],
-		       rpc_type_ave_time[i], buf->rpc_type_time[i]);
+		       rpc_type_ave_time[i], buf->rpc_type_time[i],
+		       ave_queue);
 	}
 
 	printf("\nRemote Procedure Call statistics by user\n");
@@ -188,15 +239,78 @@ static int _print_stats(void)
 		       rpc_user_ave_time[i], buf->rpc_user_time[i]);
 	}
 
+	if (buf->rpc_queue_size) {
+		printf("\nRPC queue statistics (microseconds)\n");
+		printf("\tWorker threads: %u (busy: %u)\n",
+		       buf->rpc_worker_cnt, buf->rpc_worker_busy);
+		printf("\t%-8s %8s %10s %10s %10s\n",
+		       "PRIORITY", "DEPTH", "MAX_DEPTH", "COUNT", "AVE_WAIT");
+	}
+	for (i = 0; i < buf->rpc_queue_size; i++) {
+		uint64_t ave_wait = 0;
+
+		if (buf->rpc_queue_cnt[i]) {
+			ave_wait = buf->rpc_queue_wait_time[i] /
+				   buf->rpc_queue_cnt[i];
+		}
+		printf("\t%-8s %8u %10u %10u %10"PRIu64"\n",
+		       _rpc_prio_name(i), buf->rpc_queue_depth[i],
+		       buf->rpc_queue_depth_max[i], buf->rpc_queue_cnt[i],
+		       ave_wait);
+	}
+
+	if (buf->lock_stat_size) {
+		printf("\nLock wait statistics (microseconds)\n");
+		printf("\t%-16s %10s %12s %10s  wait histogram "
+		       "(none <10u <100u <1m <10m <100m <1s >=1s)\n",
+		       "LOCK", "COUNT", "TOTAL_WAIT", "MAX_WAIT");
+	}
+	for (i = 0; i < buf->lock_stat_size; i++) {
+		uint32_t *hist = buf->lock_wait_hist +
+				 (i * buf->lock_hist_size);
+		char name[32];
+		int j;
+
+		snprintf(name, sizeof(name), "%s(%s)",
+			 _lock_name(i / 2), (i % 2) ? "write" : "read");
+		printf("\t%-16s %10"PRIu64" %12"PRIu64" %10"PRIu64" ", name,
+		       buf->lock_cnt[i], buf->lock_wait_time[i],
+		       buf->lock_wait_max[i]);
+		for (j = 0; j < buf->lock_hist_size; j++)
+			printf(" %u", hist[j]);
+		printf("\n");
+	}
+
 	return 0;
 }
 
+static char *_lock_name(int inx)
+{
+	static char *lock_names[] = {
+		"config", "job", "node", "partition", "federation" };
+
+	if ((inx >= 0) &&
+	    (inx < (sizeof(lock_names) / sizeof(lock_names[0]))))
+		return lock_names[inx];
+	return "unknown";
+}
+
+static char *_rpc_prio_name(int inx)
+{
+	static char *prio_names[] = { "high", "normal", "low" };
+
+	if ((inx >= 0) &&
+	    (inx < (sizeof(prio_names) / sizeof(prio_names[0]))))
+		return prio_names[inx];
+	return "unknown";
+}
+
 static void _sort_rpc(void)
 {
 	int i, j;
 	uint16_t type_id;
 	uint32_t type_ave, type_cnt, user_ave, user_cnt, user_id;
-	uint64_t type_time, user_time;
+	uint64_t type_time, type_queue, user_time;
 
 	rpc_type_ave_time = xmalloc(sizeof(uint32_t) * buf->rpc_type_size);
 	rpc_user_ave_time = xmalloc(sizeof(uint32_t) * buf->rpc_user_size);
@@ -209,12 +323,16 @@ static void _sort_rpc(void)
 				type_id   = buf->rpc_type_id[i];
 				type_cnt  = buf->rpc_type_cnt[i];
 				type_time = buf->rpc_type_time[i];
+				type_queue = buf->rpc_type_queue_time[i];
 				buf->rpc_type_id[i]   = buf->rpc_type_id[j];
 				buf->rpc_type_cnt[i]  = buf->rpc_type_cnt[j];
 				buf->rpc_type_time[i] = buf->rpc_type_time[j];
+				buf->rpc_type_queue_time[i] =
+					buf->rpc_type_queue_time[j];
 				buf->rpc_type_id[j]   = type_id;
 				buf->rpc_type_cnt[j]  = type_cnt;
 				buf->rpc_type_time[j] = type_time;
+				buf->rpc_type_queue_time[j] = type_queue;
 			}
 			if (buf->rpc_type_cnt[i]) {
 				rpc_type_ave_time[i] = buf->rpc_type_time[i] /
@@ -248,12 +366,16 @@ static void _sort_rpc(void)
 				type_id   = buf->rpc_type_id[i];
 				type_cnt  = buf->rpc_type_cnt[i];
 				type_time = buf->rpc_type_time[i];
+				type_queue = buf->rpc_type_queue_time[i];
 				buf->rpc_type_id[i]   = buf->rpc_type_id[j];
 				buf->rpc_type_cnt[i]  = buf->rpc_type_cnt[j];
 				buf->rpc_type_time[i] = buf->rpc_type_time[j];
+				buf->rpc_type_queue_time[i] =
+					buf->rpc_type_queue_time[j];
 				buf->rpc_type_id[j]   = type_id;
 				buf->rpc_type_cnt[j]  = type_cnt;
 				buf->rpc_type_time[j] = type_time;
+				buf->rpc_type_queue_time[j] = type_queue;
 			}
 			if (buf->rpc_type_cnt[i]) {
 				rpc_type_ave_time[i] = buf->rpc_type_time[i] /
@@ -294,14 +416,18 @@ static void _sort_rpc(void)
 				type_id   = buf->rpc_type_id[i];
 				type_cnt  = buf->rpc_type_cnt[i];
 				type_time = buf->rpc_type_time[i];
+				type_queue = buf->rpc_type_queue_time[i];
 				rpc_type_ave_time[i]  = rpc_type_ave_time[j];
 				buf->rpc_type_id[i]   = buf->rpc_type_id[j];
 				buf->rpc_type_cnt[i]  = buf->rpc_type_cnt[j];
 				buf->rpc_type_time[i] = buf->rpc_type_time[j];
+				buf->rpc_type_queue_time[i] =
+					buf->rpc_type_queue_time[j];
 				rpc_type_ave_time[j]  = type_ave;
 				buf->rpc_type_id[j]   = type_id;
 				buf->rpc_type_cnt[j]  = type_cnt;
 				buf->rpc_type_time[j] = type_time;
+				buf->rpc_type_queue_time[j] = type_queue;
 			}
 		}
 		for (i = 0; i < buf->rpc_user_size; i++) {
@@ -336,12 +462,16 @@ static void _sort_rpc(void)
 				type_id   = buf->rpc_type_id[i];
 				type_cnt  = buf->rpc_type_cnt[i];
 				type_time = buf->rpc_type_time[i];
+				type_queue = buf->rpc_type_queue_time[i];
 				buf->rpc_type_id[i]   = buf->rpc_type_id[j];
 				buf->rpc_type_cnt[i]  = buf->rpc_type_cnt[j];
 				buf->rpc_type_time[i] = buf->rpc_type_time[j];
+				buf->rpc_type_queue_time[i] =
+					buf->rpc_type_queue_time[j];
 				buf->rpc_type_id[j]   = type_id;
 				buf->rpc_type_cnt[j]  = type_cnt;
 				buf->rpc_type_time[j] = type_time;
+				buf->rpc_type_queue_time[j] = type_queue;
 			}
 			if (buf->rpc_type_cnt[i]) {
 				rpc_type_ave_time[i] = buf->rpc_type_time[i] /
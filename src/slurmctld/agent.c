@@ -51,15 +51,19 @@
  *  be possible to execute the agent as an pthread, process, or even a daemon
  *  on some other computer.
  *
- *  The main agent thread creates a separate thread for each node to be
- *  communicated with up to AGENT_THREAD_COUNT. A special watchdog thread
- *  sends SIGLARM to any threads that have been active (in DSH_ACTIVE state)
- *  for more than MessageTimeout seconds.
+ *  The main agent thread sends the RPC to every node itself, multiplexing
+ *  all of its connections over non-blocking sockets with poll() rather
+ *  than creating a thread per node. Up to AGENT_CONN_COUNT connections
+ *  are open at once, and up to AGENT_CONN_TOTAL for all agents together.
+ *  When a reply is expected, the message goes to the first node of each
+ *  branch of the route plugin's tree, which forwards it to the rest of its
+ *  branch and returns all of their responses. Each connection has its own
+ *  deadline for connecting and for the response.
  *  The agent responds to slurmctld via a function call or an RPC as required.
  *  For example, informing slurmctld that some node is not responding.
  *
- *  All the state for each thread is maintained in thd_t struct, which is
- *  used by the watchdog thread as well as the communication threads.
+ *  All the state for each connection is maintained in thd_t struct, one per
+ *  node or branch of the tree the message is sent to.
 \*****************************************************************************/
 
 #include "config.h"
@@ -68,26 +72,33 @@
 #include <sys/prctl.h>
 #endif
 
+#include <arpa/inet.h>
 #include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
 #include <pthread.h>
 #include <pwd.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include "src/common/fd.h"
 #include "src/common/forward.h"
 #include "src/common/list.h"
 #include "src/common/log.h"
 #include "src/common/macros.h"
 #include "src/common/node_select.h"
+#include "src/common/pack.h"
 #include "src/common/parse_time.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_protocol_interface.h"
+#include "src/common/slurm_route.h"
 #include "src/common/uid.h"
-#include "src/common/xsignal.h"
 #include "src/common/xassert.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
@@ -100,11 +111,16 @@
 #include "src/slurmctld/state_save.h"
 #include "src/slurmctld/srun_comm.h"
 
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
 #define MAX_RETRIES		100
 
 typedef enum {
 	DSH_NEW,        /* Request not yet started */
 	DSH_ACTIVE,     /* Request in progress */
+	DSH_ENDED,      /* Connection closed, outcome not yet processed */
 	DSH_DONE,       /* Request completed normally */
 	DSH_NO_RESP,    /* Request timed out */
 	DSH_FAILED,     /* Request resulted in error */
@@ -112,53 +128,52 @@ typedef enum {
 } state_t;
 
 typedef struct thd_complete {
-	bool work_done; 	/* assume all threads complete */
 	int fail_cnt;		/* assume no threads failures */
 	int no_resp_cnt;	/* assume all threads respond */
 	int retry_cnt;		/* assume no required retries */
 	int max_delay;
-	time_t now;
 } thd_complete_t;
 
 typedef struct thd {
-	pthread_t thread;		/* thread ID */
-	pthread_attr_t attr;		/* thread attributes */
-	state_t state;			/* thread state */
+	state_t state;			/* connection state */
 	time_t start_time;		/* start time */
-	time_t end_time;		/* end time or delta time
-					 * upon termination */
+	time_t end_time;		/* delta time upon termination */
 	slurm_addr_t *addr;		/* specific addr to send to
 					 * will not do nodelist if set */
 	char *nodelist;			/* list of nodes to send to */
 	List ret_list;
+	hostlist_t hl;			/* nodes not yet sent to */
+	char *name;			/* node connected to */
+	slurm_addr_t conn_addr;		/* its address */
+	int fd;				/* socket, -1 if none */
+	bool connected;			/* connection established */
+	bool reading;			/* message sent, reading response */
+	uint16_t conn_tries;		/* refused connection attempts */
+	int fwd_cnt;			/* nodes it forwards the message to */
+	int timeout;			/* seconds to send and get response */
+	time_t deadline;		/* time to give up, or to connect
+					 * again if fd is -1 */
+	uint32_t msg_len;		/* message length, network order */
+	uint32_t offset;		/* bytes of msg_len and buffer done */
+	Buf buffer;			/* message sent or received */
+	int err;			/* error which ended the connection */
 } thd_t;
 
 typedef struct agent_info {
-	pthread_mutex_t thread_mutex;	/* agent specific mutex */
-	pthread_cond_t thread_cond;	/* agent specific condition */
-	uint32_t thread_count;		/* number of threads records */
-	uint32_t threads_active;	/* currently active threads */
+	uint32_t thread_count;		/* number of thd_t records */
+	uint32_t thread_max;		/* thd_t records allocated */
+	uint32_t conn_count;		/* currently active connections */
 	uint16_t retry;			/* if set, keep trying */
-	thd_t *thread_struct;		/* thread structures */
+	thd_t *thread_struct;		/* connection structures */
 	bool get_reply;			/* flag if reply expected */
 	slurm_msg_type_t msg_type;	/* RPC to be issued */
 	void **msg_args_pptr;		/* RPC data to be used */
 	uint16_t protocol_version;	/* if set, use this version */
+	uint16_t msg_timeout;		/* MessageTimeout, seconds */
+	uint16_t tcp_timeout;		/* TCPTimeout, seconds */
+	uint16_t conn_retries;		/* retries of refused connections */
 } agent_info_t;
 
-typedef struct task_info {
-	pthread_mutex_t *thread_mutex_ptr; /* pointer to agent specific
-					    * mutex */
-	pthread_cond_t *thread_cond_ptr;/* pointer to agent specific
-					 * condition */
-	uint32_t *threads_active_ptr;	/* currently active thread ptr */
-	thd_t *thread_struct_ptr;	/* thread structures ptr */
-	bool get_reply;			/* flag if reply expected */
-	slurm_msg_type_t msg_type;	/* RPC to be issued */
-	void *msg_args_ptr;		/* ptr to RPC data to be used */
-	uint16_t protocol_version;	/* if set, use this version */
-} task_info_t;
-
 typedef struct queued_request {
 	agent_arg_t* agent_arg_ptr;	/* The queued request */
 	time_t       first_attempt;	/* Time of first check for batch
@@ -171,23 +186,36 @@ typedef struct mail_info {
 	char *message;
 } mail_info_t;
 
-static void _sig_handler(int dummy);
+static void _agent_complete(agent_info_t *agent_ptr);
+static void _agent_poll(agent_info_t *agent_ptr);
 static int  _batch_launch_defer(queued_request_t *queued_req_ptr);
 static inline int _comm_err(char *node_name, slurm_msg_type_t msg_type);
+static void _conn_connect(agent_info_t *agent_ptr, thd_t *thread_ptr,
+			  time_t now);
+static void _conn_end(agent_info_t *agent_ptr, thd_t *thread_ptr,
+		      List ret_list, int err);
+static void _conn_error(agent_info_t *agent_ptr, thd_t *thread_ptr,
+			int err, time_t now);
+static void _conn_finish(agent_info_t *agent_ptr, thd_t *thread_ptr);
+static bool _conn_reserve(void);
+static void _conn_read(agent_info_t *agent_ptr, thd_t *thread_ptr);
+static void _conn_start(agent_info_t *agent_ptr, thd_t *thread_ptr,
+			time_t now);
+static void _conn_write(agent_info_t *agent_ptr, thd_t *thread_ptr,
+			time_t now);
 static void _list_delete_retry(void *retry_entry);
 static agent_info_t *_make_agent_info(agent_arg_t *agent_arg_ptr);
-static task_info_t *_make_task_data(agent_info_t *agent_info_ptr, int inx);
 static void _notify_slurmctld_jobs(agent_info_t *agent_ptr);
 static void _notify_slurmctld_nodes(agent_info_t *agent_ptr,
 		int no_resp_cnt, int retry_cnt);
+static state_t _proc_ret_list(agent_info_t *agent_ptr, thd_t *thread_ptr);
 static void _purge_agent_args(agent_arg_t *agent_arg_ptr);
 static void _queue_agent_retry(agent_info_t * agent_info_ptr, int count);
 static int _setup_requeue(agent_arg_t *agent_arg_ptr, thd_t *thread_ptr,
 			  int *count, int *spot);
 static void _spawn_retry_agent(agent_arg_t * agent_arg_ptr);
-static void *_thread_per_group_rpc(void *args);
+static bool _srun_rpc(slurm_msg_type_t msg_type);
 static int   _valid_agent_arg(agent_arg_t *agent_arg_ptr);
-static void *_wdog(void *args);
 
 static mail_info_t *_mail_alloc(void);
 static void  _mail_free(void *arg);
@@ -203,7 +231,8 @@ static pthread_mutex_t agent_cnt_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  agent_cnt_cond  = PTHREAD_COND_INITIALIZER;
 static int agent_cnt = 0;
 static int agent_thread_cnt = 0;
-static uint16_t message_timeout = (uint16_t) NO_VAL;
+static int agent_conn_cnt = 0;		/* connections of all agents */
+static int agent_conn_max = -1;		/* limit of agent_conn_cnt */
 
 static bool run_scheduler    = false;
 
@@ -217,16 +246,11 @@ static bool run_scheduler    = false;
  */
 void *agent(void *args)
 {
-	int i, delay, rc, retries = 0;
-	pthread_attr_t attr_wdog;
-	pthread_t thread_wdog = 0;
+	int delay;
 	agent_arg_t *agent_arg_ptr = args;
 	agent_info_t *agent_info_ptr = NULL;
-	thd_t *thread_ptr;
-	task_info_t *task_specific_ptr;
 	time_t begin_time;
 	bool spawn_retry_agent = false;
-	int rpc_thread_cnt;
 
 #if HAVE_SYS_PRCTL_H
 	if (prctl(PR_SET_NAME, "agent", NULL, NULL, NULL) < 0) {
@@ -241,12 +265,11 @@ void *agent(void *args)
 #endif
 	slurm_mutex_lock(&agent_cnt_mutex);
 
-	rpc_thread_cnt = 2 + MIN(agent_arg_ptr->node_count, AGENT_THREAD_COUNT);
 	while (1) {
 		if (slurmctld_config.shutdown_time ||
-		    ((agent_thread_cnt+rpc_thread_cnt) <= MAX_SERVER_THREADS)) {
+		    (agent_thread_cnt < MAX_SERVER_THREADS)) {
 			agent_cnt++;
-			agent_thread_cnt += rpc_thread_cnt;
+			agent_thread_cnt++;
 			break;
 		} else {	/* wait for state change and retry */
 			slurm_cond_wait(&agent_cnt_cond, &agent_cnt_mutex);
@@ -263,76 +286,16 @@ void *agent(void *args)
 
 	/* initialize the agent data structures */
 	agent_info_ptr = _make_agent_info(agent_arg_ptr);
-	thread_ptr = agent_info_ptr->thread_struct;
-
-	/* start the watchdog thread */
-	slurm_attr_init(&attr_wdog);
-	if (pthread_attr_setdetachstate
-	    (&attr_wdog, PTHREAD_CREATE_JOINABLE))
-		error("pthread_attr_setdetachstate error %m");
-	while (pthread_create(&thread_wdog, &attr_wdog, _wdog,
-			      (void *) agent_info_ptr)) {
-		error("pthread_create error %m");
-		if (++retries > MAX_RETRIES)
-			fatal("Can't create pthread");
-		usleep(10000);	/* sleep and retry */
-	}
-	slurm_attr_destroy(&attr_wdog);
-
-	debug2("got %d threads to send out", agent_info_ptr->thread_count);
-	/* start all the other threads (up to AGENT_THREAD_COUNT active) */
-	for (i = 0; i < agent_info_ptr->thread_count; i++) {
-
-		/* wait until "room" for another thread */
-		slurm_mutex_lock(&agent_info_ptr->thread_mutex);
-		while (agent_info_ptr->threads_active >=
-		       AGENT_THREAD_COUNT) {
-			slurm_cond_wait(&agent_info_ptr->thread_cond,
-					&agent_info_ptr->thread_mutex);
-		}
 
-		/* create thread specific data, NOTE: freed from
-		 *      _thread_per_group_rpc() */
-		task_specific_ptr = _make_task_data(agent_info_ptr, i);
+	debug2("got %d connections to make", agent_info_ptr->thread_count);
+	_agent_poll(agent_info_ptr);
+	_agent_complete(agent_info_ptr);
 
-		slurm_attr_init(&thread_ptr[i].attr);
-		if (pthread_attr_setdetachstate(&thread_ptr[i].attr,
-						PTHREAD_CREATE_DETACHED))
-			error("pthread_attr_setdetachstate error %m");
-		while ((rc = pthread_create(&thread_ptr[i].thread,
-					    &thread_ptr[i].attr,
-					    _thread_per_group_rpc,
-					    (void *) task_specific_ptr))) {
-			error("pthread_create error %m");
-			if (agent_info_ptr->threads_active)
-				slurm_cond_wait(&agent_info_ptr->thread_cond,
-						&agent_info_ptr->thread_mutex);
-			else {
-				slurm_mutex_unlock(&agent_info_ptr->
-						     thread_mutex);
-				usleep(10000);	/* sleep and retry */
-				slurm_mutex_lock(&agent_info_ptr->
-						   thread_mutex);
-			}
-		}
-		slurm_attr_destroy(&thread_ptr[i].attr);
-		agent_info_ptr->threads_active++;
-		slurm_mutex_unlock(&agent_info_ptr->thread_mutex);
-	}
-
-	/* Wait for termination of remaining threads */
-	pthread_join(thread_wdog, NULL);
 	delay = (int) difftime(time(NULL), begin_time);
 	if (delay > (slurm_get_msg_timeout() * 2)) {
 		info("agent msg_type=%u ran for %d seconds",
 			agent_arg_ptr->msg_type,  delay);
 	}
-	slurm_mutex_lock(&agent_info_ptr->thread_mutex);
-	while (agent_info_ptr->threads_active != 0) {
-		slurm_cond_wait(&agent_info_ptr->thread_cond,
-				&agent_info_ptr->thread_mutex);
-	}
-	slurm_mutex_unlock(&agent_info_ptr->thread_mutex);
 
       cleanup:
 	_purge_agent_args(agent_arg_ptr);
@@ -349,14 +312,14 @@ void *agent(void *args)
 		error("agent_cnt underflow");
 		agent_cnt = 0;
 	}
-	if (agent_thread_cnt >= rpc_thread_cnt) {
-		agent_thread_cnt -= rpc_thread_cnt;
+	if (agent_thread_cnt > 0) {
+		agent_thread_cnt--;
 	} else {
 		error("agent_thread_cnt underflow");
 		agent_thread_cnt = 0;
 	}
 
-	if ((agent_thread_cnt + AGENT_THREAD_COUNT + 2) < MAX_SERVER_THREADS)
+	if ((agent_thread_cnt + 1) < MAX_SERVER_THREADS)
 		spawn_retry_agent = true;
 
 	slurm_cond_broadcast(&agent_cnt_cond);
@@ -387,28 +350,38 @@ static int _valid_agent_arg(agent_arg_t *agent_arg_ptr)
 	return SLURM_SUCCESS;
 }
 
+static void _thd_init(thd_t *thread_ptr, slurm_addr_t *addr, hostlist_t hl)
+{
+	thread_ptr->state    = DSH_NEW;
+	thread_ptr->addr     = addr;
+	thread_ptr->fd       = -1;
+	thread_ptr->hl       = hl;
+	hostlist_uniq(hl);
+	thread_ptr->nodelist = hostlist_ranged_string_xmalloc(hl);
+}
+
 static agent_info_t *_make_agent_info(agent_arg_t *agent_arg_ptr)
 {
-	int i = 0, j = 0;
+	int i = 0;
 	agent_info_t *agent_info_ptr = NULL;
 	thd_t *thread_ptr = NULL;
-	int *span = NULL;
+	hostlist_t *sp_hl = NULL;
+	int hl_count = 0;
 	int thr_count = 0;
-	hostlist_t hl = NULL;
 	char *name = NULL;
 
 	agent_info_ptr = xmalloc(sizeof(agent_info_t));
-	slurm_mutex_init(&agent_info_ptr->thread_mutex);
-	slurm_cond_init(&agent_info_ptr->thread_cond, NULL);
-	agent_info_ptr->thread_count   = agent_arg_ptr->node_count;
 	agent_info_ptr->retry          = agent_arg_ptr->retry;
-	agent_info_ptr->threads_active = 0;
-	thread_ptr = xmalloc(agent_info_ptr->thread_count * sizeof(thd_t));
-	memset(thread_ptr, 0, (agent_info_ptr->thread_count * sizeof(thd_t)));
+	/* Each node is the first one sent to of at most one connection */
+	thread_ptr = xmalloc(agent_arg_ptr->node_count * sizeof(thd_t));
+	agent_info_ptr->thread_max     = agent_arg_ptr->node_count;
 	agent_info_ptr->thread_struct  = thread_ptr;
 	agent_info_ptr->msg_type       = agent_arg_ptr->msg_type;
 	agent_info_ptr->msg_args_pptr  = &agent_arg_ptr->msg_args;
 	agent_info_ptr->protocol_version = agent_arg_ptr->protocol_version;
+	agent_info_ptr->msg_timeout    = slurm_get_msg_timeout();
+	agent_info_ptr->tcp_timeout    = slurm_get_tcp_timeout();
+	agent_info_ptr->conn_retries   = MIN(agent_info_ptr->msg_timeout, 10);
 
 	if ((agent_arg_ptr->msg_type != REQUEST_JOB_NOTIFY)	&&
 	    (agent_arg_ptr->msg_type != REQUEST_REBOOT_NODES)	&&
@@ -422,99 +395,488 @@ static agent_info_t *_make_agent_info(agent_arg_t *agent_arg_ptr)
 	    (agent_arg_ptr->msg_type != SRUN_STEP_MISSING)	&&
 	    (agent_arg_ptr->msg_type != SRUN_STEP_SIGNAL)	&&
 	    (agent_arg_ptr->msg_type != SRUN_JOB_COMPLETE)) {
-#ifdef HAVE_FRONT_END
-		span = set_span(agent_arg_ptr->node_count,
-				agent_arg_ptr->node_count);
-#else
+#ifndef HAVE_FRONT_END
 		/* Sending message to a possibly large number of slurmd.
-		 * Push all message forwarding to slurmd in order to
+		 * Send it to the first node of each branch of the tree
+		 * and push all further forwarding to slurmd in order to
 		 * offload as much work from slurmctld as possible. */
-		span = set_span(agent_arg_ptr->node_count, 1);
+		if (!agent_arg_ptr->addr &&
+		    route_g_split_hostlist(agent_arg_ptr->hostlist, &sp_hl,
+					   &hl_count, 0)) {
+			error("%s: unable to split forward hostlist",
+			      __func__);
+			hl_count = 0;
+		}
 #endif
 		agent_info_ptr->get_reply = true;
+	}
+	/* Otherwise the message is going to one node (for srun) or we
+	 * want it to get processed ASAP (SHUTDOWN or RECONFIGURE).
+	 * Send the message directly to each node. */
+	for (i = 0; i < hl_count; i++) {
+		if (!hostlist_count(sp_hl[i])) {
+			hostlist_destroy(sp_hl[i]);
+			continue;
+		}
+		_thd_init(&thread_ptr[thr_count++], NULL, sp_hl[i]);
+	}
+	xfree(sp_hl);
+	while ((thr_count < agent_arg_ptr->node_count) &&
+	       (name = hostlist_shift(agent_arg_ptr->hostlist))) {
+		_thd_init(&thread_ptr[thr_count++], agent_arg_ptr->addr,
+			  hostlist_create(name));
+		free(name);
+	}
+	agent_info_ptr->thread_count = thr_count;
+	return agent_info_ptr;
+}
+
+/*
+ * _conn_start - start sending the RPC to the first node of a connection's
+ *	hostlist, packing the message for it to forward to the others
+ */
+static void _conn_start(agent_info_t *agent_ptr, thd_t *thread_ptr,
+			time_t now)
+{
+	slurm_msg_t msg;
+	char *name;
+	int steps;
+
+	thread_ptr->state = DSH_ACTIVE;
+	thread_ptr->start_time = now;
+	agent_ptr->conn_count++;
+
+	name = hostlist_shift(thread_ptr->hl);
+	thread_ptr->name = xstrdup(name);
+	free(name);
+
+	if (thread_ptr->addr) {
+		thread_ptr->conn_addr = *thread_ptr->addr;
+	} else if (slurm_conf_get_addr(thread_ptr->name,
+				       &thread_ptr->conn_addr) ==
+		   SLURM_ERROR) {
+		error("%s: can't find address for host %s, check slurm.conf",
+		      __func__, thread_ptr->name);
+		_conn_end(agent_ptr, thread_ptr, NULL,
+			  SLURM_UNKNOWN_FORWARD_ADDR);
+		return;
+	}
+
+	slurm_msg_t_init(&msg);
+	if (agent_ptr->protocol_version)
+		msg.protocol_version = agent_ptr->protocol_version;
+	msg.msg_type = agent_ptr->msg_type;
+	msg.data     = *agent_ptr->msg_args_pptr;
+
+	/* Like slurm_send_recv_msgs(), wait MessageTimeout for each step
+	 * down the tree and for the children to time out */
+	thread_ptr->timeout = agent_ptr->msg_timeout;
+	if (agent_ptr->get_reply) {
+		msg.forward.timeout = agent_ptr->msg_timeout * 1000;
+		msg.forward.tree_width = slurm_get_tree_width();
+		if ((msg.forward.cnt = hostlist_count(thread_ptr->hl))) {
+			msg.forward.nodelist =
+				hostlist_ranged_string_xmalloc(thread_ptr->hl);
+			debug3("Tree sending to %s along with %s",
+			       thread_ptr->name, msg.forward.nodelist);
+			steps = msg.forward.cnt + 1;
+			if (msg.forward.tree_width)
+				steps /= msg.forward.tree_width;
+			thread_ptr->timeout *= (steps * 2) + 1;
+		}
+		thread_ptr->fwd_cnt = msg.forward.cnt;
+	}
+
+	thread_ptr->buffer = slurm_pack_node_msg(&msg);
+	destroy_forward(&msg.forward);
+	if (!thread_ptr->buffer) {
+		_conn_end(agent_ptr, thread_ptr, NULL, errno);
+		return;
+	}
+	thread_ptr->msg_len = htonl(get_buf_offset(thread_ptr->buffer));
+	thread_ptr->offset = 0;
+
+	_conn_connect(agent_ptr, thread_ptr, now);
+}
+
+/* Start a non-blocking connection, completed in _conn_write() */
+static void _conn_connect(agent_info_t *agent_ptr, thd_t *thread_ptr,
+			  time_t now)
+{
+	int rc;
+
+	thread_ptr->fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (thread_ptr->fd < 0) {
+		error("%s: socket: %m", __func__);
+		_conn_end(agent_ptr, thread_ptr, NULL,
+			  SLURM_COMMUNICATIONS_CONNECTION_ERROR);
+		return;
+	}
+	fd_set_nonblocking(thread_ptr->fd);
+	fd_set_close_on_exec(thread_ptr->fd);
+
+	thread_ptr->connected = false;
+	thread_ptr->deadline = now + agent_ptr->tcp_timeout;
+	rc = connect(thread_ptr->fd, (struct sockaddr *) &thread_ptr->conn_addr,
+		     sizeof(thread_ptr->conn_addr));
+	if ((rc < 0) && (errno != EINPROGRESS))
+		_conn_error(agent_ptr, thread_ptr, errno, now);
+}
+
+/*
+ * _conn_error - handle a failure to connect. A refused connection is tried
+ *	again once a second, up to conn_retries times, so that hierarchical
+ *	communications survive slurmd restarts.
+ */
+static void _conn_error(agent_info_t *agent_ptr, thd_t *thread_ptr,
+			int err, time_t now)
+{
+	errno = err;
+	debug2("%s: connect to %s failed: %m", __func__, thread_ptr->name);
+
+	if ((err == ECONNREFUSED) && agent_ptr->get_reply &&
+	    (thread_ptr->conn_tries < agent_ptr->conn_retries)) {
+		if (thread_ptr->conn_tries++ == 0)
+			debug3("connect refused, retrying");
+		close(thread_ptr->fd);
+		thread_ptr->fd = -1;
+		thread_ptr->deadline = now + 1;
+		return;
+	}
+	_conn_end(agent_ptr, thread_ptr, NULL,
+		  SLURM_COMMUNICATIONS_CONNECTION_ERROR);
+}
+
+/* Complete the connection if needed and send as much of the message as
+ * the socket takes. Start reading once all of it is sent. */
+static void _conn_write(agent_info_t *agent_ptr, thd_t *thread_ptr,
+			time_t now)
+{
+	uint32_t size = get_buf_offset(thread_ptr->buffer);
+	socklen_t optlen;
+	size_t len;
+	ssize_t rc;
+	char *data;
+	int err = 0;
+
+	if (!thread_ptr->connected) {
+		optlen = sizeof(err);
+		if (getsockopt(thread_ptr->fd, SOL_SOCKET, SO_ERROR, &err,
+			       &optlen) < 0)
+			err = errno;
+		if (err) {
+			_conn_error(agent_ptr, thread_ptr, err, now);
+			return;
+		}
+		thread_ptr->connected = true;
+		thread_ptr->deadline = now + thread_ptr->timeout;
+	}
+
+	while (thread_ptr->offset < (sizeof(uint32_t) + size)) {
+		/* the length first, then the message itself */
+		if (thread_ptr->offset < sizeof(uint32_t)) {
+			data = (char *) &thread_ptr->msg_len +
+			       thread_ptr->offset;
+			len = sizeof(uint32_t) - thread_ptr->offset;
+		} else {
+			data = get_buf_data(thread_ptr->buffer) +
+			       (thread_ptr->offset - sizeof(uint32_t));
+			len = sizeof(uint32_t) + size - thread_ptr->offset;
+		}
+		rc = send(thread_ptr->fd, data, len, MSG_NOSIGNAL);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				return;
+			debug2("%s: send to %s failed: %m",
+			       __func__, thread_ptr->name);
+			_conn_end(agent_ptr, thread_ptr, NULL,
+				  SLURM_COMMUNICATIONS_SEND_ERROR);
+			return;
+		}
+		thread_ptr->offset += rc;
+	}
+
+	free_buf(thread_ptr->buffer);
+	thread_ptr->buffer = NULL;
+	if (!agent_ptr->get_reply) {
+		_conn_end(agent_ptr, thread_ptr, NULL, SLURM_SUCCESS);
+		return;
+	}
+	thread_ptr->reading = true;
+	thread_ptr->offset = 0;
+}
+
+/* Read as much of the response as is available and unpack it once
+ * complete */
+static void _conn_read(agent_info_t *agent_ptr, thd_t *thread_ptr)
+{
+	uint32_t size;
+	size_t len;
+	ssize_t rc;
+	char *data;
+	List ret_list;
+
+	while (1) {
+		/* the length first, then the message itself */
+		if (thread_ptr->offset < sizeof(uint32_t)) {
+			data = (char *) &thread_ptr->msg_len +
+			       thread_ptr->offset;
+			len = sizeof(uint32_t) - thread_ptr->offset;
+		} else {
+			if (!thread_ptr->buffer) {
+				size = ntohl(thread_ptr->msg_len);
+				if (!size || (size > MAX_BUF_SIZE)) {
+					error("%s: invalid message length %u from %s",
+					      __func__, size, thread_ptr->name);
+					_conn_end(agent_ptr, thread_ptr, NULL,
+					SLURM_PROTOCOL_INSANE_MSG_LENGTH);
+					return;
+				}
+				thread_ptr->buffer =
+					create_buf(xmalloc_nz(size), size);
+			}
+			size = size_buf(thread_ptr->buffer);
+			if (thread_ptr->offset == (sizeof(uint32_t) + size))
+				break;
+			data = get_buf_data(thread_ptr->buffer) +
+			       (thread_ptr->offset - sizeof(uint32_t));
+			len = sizeof(uint32_t) + size - thread_ptr->offset;
+		}
+		rc = recv(thread_ptr->fd, data, len, 0);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				return;
+		}
+		if (rc <= 0) {
+			debug2("%s: recv from %s failed: %m",
+			       __func__, thread_ptr->name);
+			_conn_end(agent_ptr, thread_ptr, NULL,
+				  SLURM_COMMUNICATIONS_RECEIVE_ERROR);
+			return;
+		}
+		thread_ptr->offset += rc;
+	}
+
+	ret_list = slurm_unpack_received_msgs(thread_ptr->fd,
+					      thread_ptr->buffer);
+	thread_ptr->buffer = NULL;
+	_conn_end(agent_ptr, thread_ptr, ret_list, errno);
+}
+
+/*
+ * _conn_end - close a connection and record the responses in ret_list,
+ *	or the failure err of the node connected to. The nodes it was to
+ *	forward the message to and which did not respond are each sent it
+ *	directly by a connection of their own, so that one bad node does
+ *	not fail its whole branch of the tree. The outcome is processed by
+ *	_conn_finish() once the sockets ready to read have been served.
+ */
+static void _conn_end(agent_info_t *agent_ptr, thd_t *thread_ptr,
+		      List ret_list, int err)
+{
+	ret_data_info_t *ret_data_info;
+	ListIterator itr;
+	thd_t *new_thd;
+	char *name;
+	int ret_cnt;
+
+	if (thread_ptr->fd >= 0) {
+		close(thread_ptr->fd);
+		thread_ptr->fd = -1;
+	}
+	if (thread_ptr->buffer) {
+		free_buf(thread_ptr->buffer);
+		thread_ptr->buffer = NULL;
+	}
+	agent_ptr->conn_count--;
+	slurm_mutex_lock(&agent_cnt_mutex);
+	agent_conn_cnt--;
+	slurm_mutex_unlock(&agent_cnt_mutex);
+	thread_ptr->end_time = (time_t) difftime(time(NULL),
+						 thread_ptr->start_time);
+	thread_ptr->err = err;
+	thread_ptr->state = DSH_ENDED;
+
+	if (!agent_ptr->get_reply)
+		return;
+
+	if (!ret_list) {
+		mark_as_failed_forward(&thread_ptr->ret_list, thread_ptr->name,
+				       err);
 	} else {
-		/* Message is going to one node (for srun) or we want
-		 * it to get processed ASAP (SHUTDOWN or RECONFIGURE).
-		 * Send the message directly to each node. */
-		span = set_span(agent_arg_ptr->node_count,
-				agent_arg_ptr->node_count);
-	}
-	i = 0;
-	while (i < agent_info_ptr->thread_count) {
-		thread_ptr[thr_count].state      = DSH_NEW;
-		thread_ptr[thr_count].addr = agent_arg_ptr->addr;
-		name = hostlist_shift(agent_arg_ptr->hostlist);
-		if (!name) {
-			debug3("no more nodes to send to");
-			break;
+		ret_cnt = list_count(ret_list);
+		if (ret_cnt <= thread_ptr->fwd_cnt) {
+			error("%s: %s failed to forward the message, "
+			      "expecting %d ret got only %d", __func__,
+			      thread_ptr->name, thread_ptr->fwd_cnt + 1,
+			      ret_cnt);
 		}
-		hl = hostlist_create(name);
-		if (thread_ptr[thr_count].addr && span[thr_count]) {
-			debug("warning: you will only be sending this to %s",
-			      name);
-			span[thr_count] = 0;
+		itr = list_iterator_create(ret_list);
+		while ((ret_data_info = list_next(itr))) {
+			if (!ret_data_info->node_name) {
+				ret_data_info->node_name =
+					xstrdup(thread_ptr->name);
+			} else {
+				hostlist_delete_host(thread_ptr->hl,
+						     ret_data_info->node_name);
+			}
 		}
+		list_iterator_destroy(itr);
+		if (thread_ptr->ret_list) {
+			list_transfer(thread_ptr->ret_list, ret_list);
+			FREE_NULL_LIST(ret_list);
+		} else
+			thread_ptr->ret_list = ret_list;
+	}
+
+	while ((name = hostlist_shift(thread_ptr->hl))) {
+		xassert(agent_ptr->thread_count < agent_ptr->thread_max);
+		new_thd = &agent_ptr->thread_struct[agent_ptr->thread_count++];
+		_thd_init(new_thd, thread_ptr->addr, hostlist_create(name));
 		free(name);
-		i++;
-		for (j = 0; j < span[thr_count]; j++) {
-			name = hostlist_shift(agent_arg_ptr->hostlist);
-			if (!name)
-				break;
-			hostlist_push_host(hl, name);
-			free(name);
-			i++;
+	}
+}
+
+/* Act on the outcome of an ended connection, which takes slurmctld locks */
+static void _conn_finish(agent_info_t *agent_ptr, thd_t *thread_ptr)
+{
+	/* Lock: Read node */
+	slurmctld_lock_t node_read_lock = {
+		NO_LOCK, NO_LOCK, READ_LOCK, NO_LOCK, NO_LOCK };
+
+	if (agent_ptr->get_reply) {
+		thread_ptr->state = _proc_ret_list(agent_ptr, thread_ptr);
+	} else if (thread_ptr->err == SLURM_SUCCESS) {
+		thread_ptr->state = DSH_DONE;
+	} else {
+		thread_ptr->state = DSH_NO_RESP;
+		if (!_srun_rpc(agent_ptr->msg_type)) {
+			errno = thread_ptr->err;
+			lock_slurmctld(node_read_lock);
+			_comm_err(thread_ptr->name, agent_ptr->msg_type);
+			unlock_slurmctld(node_read_lock);
 		}
-		hostlist_uniq(hl);
-		thread_ptr[thr_count].nodelist =
-			hostlist_ranged_string_xmalloc(hl);
-		hostlist_destroy(hl);
-#if 0
-		info("sending msg_type %u to nodes %s",
-		     agent_arg_ptr->msg_type, thread_ptr[thr_count].nodelist);
-#endif
-		thr_count++;
 	}
-	xfree(span);
-	agent_info_ptr->thread_count = thr_count;
-	return agent_info_ptr;
+	xfree(thread_ptr->name);
 }
 
-static task_info_t *_make_task_data(agent_info_t *agent_info_ptr, int inx)
+/*
+ * _conn_reserve - count a new connection against the limit for all agents,
+ *	which leaves half of the file count limit to the rest of slurmctld
+ * RET true if the connection may be started
+ */
+static bool _conn_reserve(void)
 {
-	task_info_t *task_info_ptr;
-	task_info_ptr = xmalloc(sizeof(task_info_t));
-
-	task_info_ptr->thread_mutex_ptr  = &agent_info_ptr->thread_mutex;
-	task_info_ptr->thread_cond_ptr   = &agent_info_ptr->thread_cond;
-	task_info_ptr->threads_active_ptr= &agent_info_ptr->threads_active;
-	task_info_ptr->thread_struct_ptr = &agent_info_ptr->thread_struct[inx];
-	task_info_ptr->get_reply         = agent_info_ptr->get_reply;
-	task_info_ptr->msg_type          = agent_info_ptr->msg_type;
-	task_info_ptr->msg_args_ptr      = *agent_info_ptr->msg_args_pptr;
-	task_info_ptr->protocol_version  = agent_info_ptr->protocol_version;
-
-	return task_info_ptr;
+	struct rlimit rlim;
+	bool rc = false;
+
+	slurm_mutex_lock(&agent_cnt_mutex);
+	if (agent_conn_max == -1) {
+		agent_conn_max = AGENT_CONN_TOTAL;
+		if ((getrlimit(RLIMIT_NOFILE, &rlim) == 0) &&
+		    (rlim.rlim_cur != RLIM_INFINITY) &&
+		    (agent_conn_max > (rlim.rlim_cur / 2))) {
+			agent_conn_max = MAX(rlim.rlim_cur / 2, 1);
+			info("Reducing agent connection limit to %d due to "
+			     "file count limit of %u", agent_conn_max,
+			     (uint32_t) rlim.rlim_cur);
+		}
+	}
+	if (agent_conn_cnt < agent_conn_max) {
+		agent_conn_cnt++;
+		rc = true;
+	}
+	slurm_mutex_unlock(&agent_cnt_mutex);
+
+	return rc;
 }
 
-static void _update_wdog_state(thd_t *thread_ptr,
-			       state_t *state,
-			       thd_complete_t *thd_comp)
+/*
+ * _agent_poll - send the RPC to every node and collect the responses,
+ *	multiplexing the connections with poll(). Connections which miss
+ *	their deadline without being ready are ended as not responding.
+ */
+static void _agent_poll(agent_info_t *agent_ptr)
 {
-	switch (*state) {
-	case DSH_ACTIVE:
-		thd_comp->work_done = false;
-		if (thread_ptr->end_time <= thd_comp->now) {
-			debug3("agent thread %lu timed out",
-			       (unsigned long) thread_ptr->thread);
-			if (pthread_kill(thread_ptr->thread, SIGUSR1) == ESRCH)
-				*state = DSH_NO_RESP;
-			else
-				thread_ptr->end_time += message_timeout;
+	struct pollfd *pfds;
+	int *pinx;
+	thd_t *thread_ptr;
+	int active, i, n;
+	time_t now;
+
+	pfds = xmalloc(sizeof(struct pollfd) * AGENT_CONN_COUNT);
+	pinx = xmalloc(sizeof(int) * AGENT_CONN_COUNT);
+
+	while (1) {
+		now = time(NULL);
+		active = 0;
+		n = 0;
+		/* thread_count grows as branches are split in _conn_end() */
+		for (i = 0; i < agent_ptr->thread_count; i++) {
+			thread_ptr = &agent_ptr->thread_struct[i];
+			if (thread_ptr->state == DSH_NEW) {
+				if ((agent_ptr->conn_count >=
+				     AGENT_CONN_COUNT) || !_conn_reserve()) {
+					active++;
+					continue;
+				}
+				_conn_start(agent_ptr, thread_ptr, now);
+			}
+			if ((thread_ptr->state == DSH_ACTIVE) &&
+			    (thread_ptr->fd < 0) &&
+			    (now >= thread_ptr->deadline)) {
+				/* connection refused, try again */
+				_conn_connect(agent_ptr, thread_ptr, now);
+			}
+			if (thread_ptr->state == DSH_ENDED)
+				_conn_finish(agent_ptr, thread_ptr);
+			if (thread_ptr->state != DSH_ACTIVE)
+				continue;
+			active++;
+			if (thread_ptr->fd < 0)
+				continue;
+			pfds[n].fd = thread_ptr->fd;
+			pfds[n].events = thread_ptr->reading ? POLLIN : POLLOUT;
+			pfds[n].revents = 0;
+			pinx[n++] = i;
 		}
-		break;
-	case DSH_NEW:
-		thd_comp->work_done = false;
-		break;
+		if (!active)
+			break;
+
+		if ((poll(pfds, n, 1000) < 0) && (errno != EINTR))
+			error("%s: poll: %m", __func__);
+		/* Serve every ready socket before timing out the others, the
+		 * time spent in _conn_finish() must not fail responses which
+		 * are already waiting to be read */
+		now = time(NULL);
+		for (i = 0; i < n; i++) {
+			thread_ptr = &agent_ptr->thread_struct[pinx[i]];
+			if (pfds[i].revents) {
+				if (thread_ptr->reading)
+					_conn_read(agent_ptr, thread_ptr);
+				else
+					_conn_write(agent_ptr, thread_ptr, now);
+			} else if (now >= thread_ptr->deadline) {
+				debug2("%s: %s timed out", __func__,
+				       thread_ptr->name);
+				_conn_end(agent_ptr, thread_ptr, NULL,
+					  SLURM_PROTOCOL_SOCKET_IMPL_TIMEOUT);
+			}
+		}
+	}
+
+	xfree(pfds);
+	xfree(pinx);
+}
+
+static void _update_thd_comp(thd_t *thread_ptr, state_t state,
+			     thd_complete_t *thd_comp)
+{
+	switch (state) {
 	case DSH_DONE:
 		if (thd_comp->max_delay < (int)thread_ptr->end_time)
 			thd_comp->max_delay = (int)thread_ptr->end_time;
@@ -527,22 +889,23 @@ static void _update_wdog_state(thd_t *thread_ptr,
 	case DSH_DUP_JOBID:
 		thd_comp->fail_cnt++;
 		break;
+	default:
+		error("%s: connection to %s still in state %d",
+		      __func__, thread_ptr->nodelist, state);
+		break;
 	}
 }
 
 /*
- * _wdog - Watchdog thread. Send SIGUSR1 to threads which have been active
- *	for too long.
- * IN args - pointer to agent_info_t with info on threads to watch
- * Sleep between polls with exponential times (from 0.125 to 1.0 second)
+ * _agent_complete - notify slurmctld of the outcome of every connection
+ *	once all of them are complete and free their records
+ * IN agent_ptr - pointer to agent_info_t with info on the connections
  */
-static void *_wdog(void *args)
+static void _agent_complete(agent_info_t *agent_ptr)
 {
 	bool srun_agent = false;
 	int i;
-	agent_info_t *agent_ptr = (agent_info_t *) args;
 	thd_t *thread_ptr = agent_ptr->thread_struct;
-	unsigned long usec = 5000;
 	ListIterator itr;
 	thd_complete_t thd_comp;
 	ret_data_info_t *ret_data_info = NULL;
@@ -559,40 +922,20 @@ static void *_wdog(void *args)
 	     (agent_ptr->msg_type == RESPONSE_RESOURCE_ALLOCATION) )
 		srun_agent = true;
 
-	thd_comp.max_delay = 0;
-
-	while (1) {
-		thd_comp.work_done   = true;/* assume all threads complete */
-		thd_comp.fail_cnt    = 0;   /* assume no threads failures */
-		thd_comp.no_resp_cnt = 0;   /* assume all threads respond */
-		thd_comp.retry_cnt   = 0;   /* assume no required retries */
-		thd_comp.now         = time(NULL);
-
-		usleep(usec);
-		usec = MIN((usec * 2), 1000000);
-
-		slurm_mutex_lock(&agent_ptr->thread_mutex);
-		for (i = 0; i < agent_ptr->thread_count; i++) {
-			//info("thread name %s",thread_ptr[i].node_name);
-			if (!thread_ptr[i].ret_list) {
-				_update_wdog_state(&thread_ptr[i],
-						   &thread_ptr[i].state,
-						   &thd_comp);
-			} else {
-				itr = list_iterator_create(
-					thread_ptr[i].ret_list);
-				while ((ret_data_info = list_next(itr))) {
-					_update_wdog_state(&thread_ptr[i],
-							   &ret_data_info->err,
-							   &thd_comp);
-				}
-				list_iterator_destroy(itr);
+	memset(&thd_comp, 0, sizeof(thd_complete_t));
+	for (i = 0; i < agent_ptr->thread_count; i++) {
+		if (!thread_ptr[i].ret_list) {
+			_update_thd_comp(&thread_ptr[i], thread_ptr[i].state,
+					 &thd_comp);
+		} else {
+			itr = list_iterator_create(thread_ptr[i].ret_list);
+			while ((ret_data_info = list_next(itr))) {
+				_update_thd_comp(&thread_ptr[i],
+						 ret_data_info->err,
+						 &thd_comp);
 			}
+			list_iterator_destroy(itr);
 		}
-		if (thd_comp.work_done)
-			break;
-
-		slurm_mutex_unlock(&agent_ptr->thread_mutex);
 	}
 
 	if (srun_agent) {
@@ -605,14 +948,12 @@ static void *_wdog(void *args)
 
 	for (i = 0; i < agent_ptr->thread_count; i++) {
 		FREE_NULL_LIST(thread_ptr[i].ret_list);
+		FREE_NULL_HOSTLIST(thread_ptr[i].hl);
 		xfree(thread_ptr[i].nodelist);
 	}
 
 	if (thd_comp.max_delay)
 		debug2("agent maximum delay %d seconds", thd_comp.max_delay);
-
-	slurm_mutex_unlock(&agent_ptr->thread_mutex);
-	return (void *) NULL;
 }
 
 static void _notify_slurmctld_jobs(agent_info_t *agent_ptr)
@@ -803,33 +1144,33 @@ static int _wif_status(void)
 	return rc;
 }
 
+/* Return true for RPCs to srun, whose failure says nothing of the nodes */
+static bool _srun_rpc(slurm_msg_type_t msg_type)
+{
+	return ((msg_type == SRUN_PING)			||
+		(msg_type == SRUN_EXEC)			||
+		(msg_type == SRUN_JOB_COMPLETE)		||
+		(msg_type == SRUN_STEP_MISSING)		||
+		(msg_type == SRUN_STEP_SIGNAL)		||
+		(msg_type == SRUN_TIMEOUT)		||
+		(msg_type == SRUN_USER_MSG)		||
+		(msg_type == RESPONSE_RESOURCE_ALLOCATION) ||
+		(msg_type == SRUN_NODE_FAIL));
+}
+
 /*
- * _thread_per_group_rpc - thread to issue an RPC for a group of nodes
- *                         sending message out to one and forwarding it to
- *                         others if necessary.
- * IN/OUT args - pointer to task_info_t, xfree'd on completion
+ * _proc_ret_list - act on the responses to an RPC for a group of nodes,
+ *	setting the err of each ret_data_info_t to its resulting state_t
+ * RET state of the connection
  */
-static void *_thread_per_group_rpc(void *args)
+static state_t _proc_ret_list(agent_info_t *agent_ptr, thd_t *thread_ptr)
 {
 	int rc = SLURM_SUCCESS;
-	slurm_msg_t msg;
-	task_info_t *task_ptr = (task_info_t *) args;
-	/* we cache some pointers from task_info_t because we need
-	 * to xfree args before being finished with their use. xfree
-	 * is required for timely termination of this pthread because
-	 * xfree could lock it at the end, preventing a timely
-	 * thread_exit */
-	pthread_mutex_t *thread_mutex_ptr   = task_ptr->thread_mutex_ptr;
-	pthread_cond_t  *thread_cond_ptr    = task_ptr->thread_cond_ptr;
-	uint32_t        *threads_active_ptr = task_ptr->threads_active_ptr;
-	thd_t           *thread_ptr         = task_ptr->thread_struct_ptr;
 	state_t thread_state = DSH_NO_RESP;
-	slurm_msg_type_t msg_type = task_ptr->msg_type;
+	slurm_msg_type_t msg_type = agent_ptr->msg_type;
 	bool is_kill_msg, srun_agent;
-	List ret_list = NULL;
 	ListIterator itr;
 	ret_data_info_t *ret_data_info = NULL;
-	int sig_array[2] = {SIGUSR1, 0};
 	/* Locks: Write job, write node */
 	slurmctld_lock_t job_write_lock = {
 		NO_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK, NO_LOCK };
@@ -840,91 +1181,13 @@ static void *_thread_per_group_rpc(void *args)
 	slurmctld_lock_t node_write_lock = {
 		NO_LOCK, NO_LOCK, WRITE_LOCK, NO_LOCK, NO_LOCK };
 
-	xassert(args != NULL);
-	xsignal(SIGUSR1, _sig_handler);
-	xsignal_unblock(sig_array);
 	is_kill_msg = (	(msg_type == REQUEST_KILL_TIMELIMIT)	||
 			(msg_type == REQUEST_KILL_PREEMPTED)	||
 			(msg_type == REQUEST_TERMINATE_JOB) );
-	srun_agent = (	(msg_type == SRUN_PING)			||
-			(msg_type == SRUN_EXEC)			||
-			(msg_type == SRUN_JOB_COMPLETE)		||
-			(msg_type == SRUN_STEP_MISSING)		||
-			(msg_type == SRUN_STEP_SIGNAL)		||
-			(msg_type == SRUN_TIMEOUT)		||
-			(msg_type == SRUN_USER_MSG)		||
-			(msg_type == RESPONSE_RESOURCE_ALLOCATION) ||
-			(msg_type == SRUN_NODE_FAIL) );
-
-	thread_ptr->start_time = time(NULL);
-
-	slurm_mutex_lock(thread_mutex_ptr);
-	thread_ptr->state = DSH_ACTIVE;
-	thread_ptr->end_time = thread_ptr->start_time + message_timeout;
-	slurm_mutex_unlock(thread_mutex_ptr);
-
-	/* send request message */
-	slurm_msg_t_init(&msg);
-
-	if (task_ptr->protocol_version)
-		msg.protocol_version = task_ptr->protocol_version;
+	srun_agent = _srun_rpc(msg_type);
 
-	msg.msg_type = msg_type;
-	msg.data     = task_ptr->msg_args_ptr;
-#if 0
- 	info("sending message type %u to %s", msg_type, thread_ptr->nodelist);
-#endif
-	if (task_ptr->get_reply) {
-		if (thread_ptr->addr) {
-			msg.address = *thread_ptr->addr;
-
-			if (!(ret_list = slurm_send_addr_recv_msgs(
-				     &msg, thread_ptr->nodelist, 0))) {
-				error("_thread_per_group_rpc: "
-				      "no ret_list given");
-				goto cleanup;
-			}
-
-
-		} else {
-			if (!(ret_list = slurm_send_recv_msgs(
-				     thread_ptr->nodelist,
-				     &msg, 0, true))) {
-				error("_thread_per_group_rpc: "
-				      "no ret_list given");
-				goto cleanup;
-			}
-		}
-	} else {
-		if (thread_ptr->addr) {
-			//info("got the address");
-			msg.address = *thread_ptr->addr;
-		} else {
-			//info("no address given");
-			if (slurm_conf_get_addr(thread_ptr->nodelist,
-					       &msg.address) == SLURM_ERROR) {
-				error("_thread_per_group_rpc: "
-				      "can't find address for host %s, "
-				      "check slurm.conf",
-				      thread_ptr->nodelist);
-				goto cleanup;
-			}
-		}
-		//info("sending %u to %s", msg_type, thread_ptr->nodelist);
-		if (slurm_send_only_node_msg(&msg) == SLURM_SUCCESS) {
-			thread_state = DSH_DONE;
-		} else {
-			if (!srun_agent) {
-				lock_slurmctld(node_read_lock);
-				_comm_err(thread_ptr->nodelist, msg_type);
-				unlock_slurmctld(node_read_lock);
-			}
-		}
-		goto cleanup;
-	}
-
-	//info("got %d messages back", list_count(ret_list));
-	itr = list_iterator_create(ret_list);
+	//info("got %d messages back", list_count(thread_ptr->ret_list));
+	itr = list_iterator_create(thread_ptr->ret_list);
 	while ((ret_data_info = list_next(itr)) != NULL) {
 		rc = slurm_get_return_code(ret_data_info->type,
 					   ret_data_info->data);
@@ -945,7 +1208,7 @@ static void *_thread_per_group_rpc(void *args)
 		    (rc == ESLURMD_KILL_JOB_ALREADY_COMPLETE)) {
 			kill_job_msg_t *kill_job;
 			kill_job = (kill_job_msg_t *)
-				task_ptr->msg_args_ptr;
+				*agent_ptr->msg_args_pptr;
 			rc = SLURM_SUCCESS;
 			lock_slurmctld(job_write_lock);
 			if (job_epilog_complete(kill_job->job_id,
@@ -971,7 +1234,7 @@ static void *_thread_per_group_rpc(void *args)
 		    (rc != ESLURM_DUPLICATE_JOB_ID) &&
 		    (ret_data_info->type != RESPONSE_FORWARD_FAILED)) {
 			batch_job_launch_msg_t *launch_msg_ptr =
-				task_ptr->msg_args_ptr;
+				*agent_ptr->msg_args_pptr;
 			uint32_t job_id = launch_msg_ptr->job_id;
 			info("Killing non-startable batch job %u: %s",
 			     job_id, slurm_strerror(rc));
@@ -988,7 +1251,7 @@ static void *_thread_per_group_rpc(void *args)
 			 * Cancel rather than leave a stray-but-empty job
 			 * behind on the allocated nodes. */
 			resource_allocation_response_msg_t *msg_ptr =
-				task_ptr->msg_args_ptr;
+				*agent_ptr->msg_args_pptr;
 			uint32_t job_id = msg_ptr->job_id;
 			info("Killing interactive job %u: %s",
 			     job_id, slurm_strerror(rc));
@@ -1070,29 +1333,7 @@ static void *_thread_per_group_rpc(void *args)
 	}
 	list_iterator_destroy(itr);
 
-cleanup:
-	xfree(args);
-
-	/* handled at end of thread just in case resend is needed */
-	destroy_forward(&msg.forward);
-	slurm_mutex_lock(thread_mutex_ptr);
-	thread_ptr->ret_list = ret_list;
-	thread_ptr->state = thread_state;
-	thread_ptr->end_time = (time_t) difftime(time(NULL),
-						 thread_ptr->start_time);
-	/* Signal completion so another thread can replace us */
-	(*threads_active_ptr)--;
-	slurm_cond_signal(thread_cond_ptr);
-	slurm_mutex_unlock(thread_mutex_ptr);
-	return (void *) NULL;
-}
-
-/*
- * Signal handler.  We are really interested in interrupting hung communictions
- * and causing them to return EINTR. Multiple interupts might be required.
- */
-static void _sig_handler(int dummy)
-{
+	return thread_state;
 }
 
 static int _setup_requeue(agent_arg_t *agent_arg_ptr, thd_t *thread_ptr,
@@ -1295,7 +1536,7 @@ extern int agent_retry (int min_wait, bool mail_too)
 	}
 
 	slurm_mutex_lock(&agent_cnt_mutex);
-	if (agent_thread_cnt + AGENT_THREAD_COUNT + 2 > MAX_SERVER_THREADS) {
+	if (agent_thread_cnt >= MAX_SERVER_THREADS) {
 		/* too much work already */
 		slurm_mutex_unlock(&agent_cnt_mutex);
 		slurm_mutex_unlock(&retry_mutex);
@@ -1406,13 +1647,6 @@ void agent_queue_request(agent_arg_t *agent_arg_ptr)
 {
 	queued_request_t *queued_req_ptr = NULL;
 
-	if ((AGENT_THREAD_COUNT + 2) >= MAX_SERVER_THREADS)
-		fatal("AGENT_THREAD_COUNT value is too low relative to MAX_SERVER_THREADS");
-
-	if (message_timeout == (uint16_t) NO_VAL) {
-		message_timeout = MAX(slurm_get_msg_timeout(), 30);
-	}
-
 	if (agent_arg_ptr->msg_type == REQUEST_SHUTDOWN) {
 		/* execute now */
 		pthread_attr_t attr_agent;
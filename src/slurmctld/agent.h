@@ -44,7 +44,10 @@
 
 #include "src/slurmctld/slurmctld.h"
 
-#define AGENT_THREAD_COUNT	10	/* maximum active threads per agent */
+#define AGENT_CONN_COUNT	128	/* maximum open connections per agent */
+#define AGENT_CONN_TOTAL	4096	/* maximum open connections of all
+					 * agents, at most half of the file
+					 * count limit */
 #define COMMAND_TIMEOUT 	30	/* command requeue or error, seconds */
 
 #define LOTS_OF_AGENTS_CNT 50
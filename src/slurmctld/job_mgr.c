@@ -67,6 +67,7 @@
 #include "src/common/forward.h"
 #include "src/common/gres.h"
 #include "src/common/hostlist.h"
+#include "src/common/id_hash.h"
 #include "src/common/node_features.h"
 #include "src/common/node_select.h"
 #include "src/common/parse_time.h"
@@ -93,6 +94,7 @@
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/node_scheduler.h"
 #include "src/slurmctld/preempt.h"
+#include "src/slurmctld/prio_queue.h"
 #include "src/slurmctld/proc_req.h"
 #include "src/slurmctld/reservation.h"
 #include "src/slurmctld/sched_plugin.h"
@@ -109,15 +111,16 @@
 #define TOP_PRIORITY 0xffff0000	/* large, but leave headroom for higher */
 #define ONE_YEAR	(365 * 24 * 60 * 60)
 
-#define JOB_HASH_INX(_job_id)	(_job_id % hash_table_size)
-#define JOB_ARRAY_HASH_INX(_job_id, _task_id) \
-	((_job_id + _task_id) % hash_table_size)
-
 /* No need to change we always pack SLURM_PROTOCOL_VERSION */
 #define JOB_STATE_VERSION       "PROTOCOL_VERSION"
 
 #define JOB_CKPT_VERSION      "PROTOCOL_VERSION"
 
+/* Job state journal records start with the size and hash of the rest */
+#define JOB_JOURNAL_REC_HDR_SIZE (sizeof(uint32_t) + sizeof(uint64_t))
+/* Journal size below which no new checkpoint is written */
+#define JOB_JOURNAL_MIN_SIZE	(1024 * 1024)
+
 typedef struct {
 	int resp_array_cnt;
 	int resp_array_size;
@@ -125,6 +128,60 @@ typedef struct {
 	bitstr_t **resp_array_task_id;
 } resp_array_struct_t;
 
+/* Shared snapshot of packed RESPONSE_JOB_INFO data, see
+ * pack_all_jobs_cached() */
+typedef struct {
+	char *buffer;		/* packed job records with header */
+	int buffer_size;	/* bytes in buffer */
+	uint32_t job_cnt;	/* job records in buffer */
+	uint32_t *job_id;	/* job ID of each record, in job_list order */
+	uint32_t *offset;	/* offset of each record in buffer, plus
+				 * offset[job_cnt] holding the buffer size */
+	time_t pack_time;	/* time packed, also the header time */
+	time_t job_update;	/* last_job_update when packed */
+	time_t part_update;	/* last_part_update when packed */
+	time_t conf_update;	/* slurmctld_conf.last_update when packed */
+	uint16_t show_flags;
+	uint16_t protocol_version;
+	int ref_cnt;		/* users, plus one while in the cache */
+	uint32_t seq;		/* generation number, see job_info_gen_t */
+	uint64_t *hash;		/* hash of each packed record */
+} job_info_cache_t;
+
+#define JOB_INFO_CACHE_SIZE 4
+
+/* Record hashes of the latest snapshot of each show_flags and
+ * protocol_version, with the generation in which each record last changed.
+ * Used to find the job records which changed since any earlier generation
+ * a client loaded, see pack_all_jobs_delta() */
+typedef struct {
+	uint32_t job_id;
+	uint64_t hash;
+	uint32_t change_seq;	/* generation in which the record changed */
+} job_info_gen_rec_t;
+
+typedef struct {
+	uint32_t seq;		/* latest snapshot generation, 0 if unused */
+	uint32_t reset_seq;	/* first generation comparable with seq */
+	time_t reset_time;	/* pack time of generation reset_seq */
+	time_t part_update;	/* last_part_update when packed */
+	time_t conf_update;	/* slurmctld_conf.last_update when packed */
+	uint16_t show_flags;
+	uint16_t protocol_version;
+	uint32_t rec_cnt;
+	job_info_gen_rec_t *rec; /* sorted by job_id */
+} job_info_gen_t;
+
+#define JOB_INFO_GEN_CNT JOB_INFO_CACHE_SIZE
+
+/* Job record in the job state save files, see dump_all_job_state() */
+typedef struct {
+	uint32_t job_id;
+	uint32_t offset;	/* offset of packed record in buffer */
+	uint32_t size;		/* size of packed record */
+	uint64_t hash;		/* hash of packed record */
+} job_state_rec_t;
+
 /* Global variables */
 List   job_list = NULL;		/* job_record list */
 time_t last_job_update;		/* time of last update to job records */
@@ -134,12 +191,11 @@ static int      bf_min_age_reserve = 0;
 static uint32_t delay_boot = 0;
 static uint32_t highest_prio = 0;
 static uint32_t lowest_prio  = TOP_PRIORITY;
-static int      hash_table_size = 0;
 static int      job_count = 0;		/* job's in the system */
 static uint32_t job_id_sequence = 0;	/* first job_id to assign new job */
-static struct   job_record **job_hash = NULL;
-static struct   job_record **job_array_hash_j = NULL;
-static struct   job_record **job_array_hash_t = NULL;
+static id_hash_t *job_hash = NULL;		/* by job_id */
+static id_hash_t *job_array_hash = NULL;	/* first task by array_job_id */
+static id_hash_t *job_array_task_hash = NULL;	/* by array job and task ID */
 static bool     kill_invalid_dep;
 static time_t   last_file_write_time = (time_t) 0;
 static uint32_t max_array_size = NO_VAL;
@@ -148,10 +204,22 @@ static struct timeval purge_start_time = {0, 0};
 static bitstr_t *requeue_exit = NULL;
 static bitstr_t *requeue_exit_hold = NULL;
 static int	select_serial = -1;
+static pthread_mutex_t job_info_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static job_info_cache_t *job_info_cache[JOB_INFO_CACHE_SIZE];
+static job_info_gen_t job_info_gen[JOB_INFO_GEN_CNT];
+static uint32_t job_info_seq = 0;
+static bool     job_state_ckpt_needed = true; /* next save writes all jobs */
+static uint32_t job_state_ckpt_size = 0;	/* bytes in job_state file */
+static job_state_rec_t *job_state_rec = NULL;	/* jobs saved, by job_id */
+static uint32_t job_state_rec_cnt = 0;
+static uint32_t job_state_seq = 0;	/* job_id_sequence saved */
+static uint32_t job_journal_size = 0;	/* bytes in job_state.journal */
+static uint64_t job_state_ckpt_id = 0;	/* ID of the last job_state file */
 
 /* Local functions */
 static void _add_job_hash(struct job_record *job_ptr);
 static void _add_job_array_hash(struct job_record *job_ptr);
+static struct job_record *_job_array_first(uint32_t array_job_id);
 static int  _checkpoint_job_record (struct job_record *job_ptr,
 				    char *image_dir);
 static void _clear_job_gres_details(struct job_record *job_ptr);
@@ -178,6 +246,7 @@ static void _free_job_fed_details(job_fed_details_t **fed_details_pptr);
 static void _get_batch_job_dir_ids(List batch_dirs);
 static time_t _get_last_state_write_time(void);
 static void _job_array_comp(struct job_record *job_ptr, bool was_running);
+static uint64_t _job_info_hash(char *data, uint32_t size);
 static int  _job_create(job_desc_msg_t * job_specs, int allocate, int will_run,
 			struct job_record **job_rec_ptr, uid_t submit_uid,
 			char **err_msg, uint16_t protocol_version);
@@ -189,6 +258,8 @@ static int  _list_find_job_id(void *job_entry, void *key);
 static int  _list_find_job_old(void *job_entry, void *key);
 static int  _load_job_details(struct job_record *job_ptr, Buf buffer,
 			      uint16_t protocol_version);
+static int  _load_job_journal(uint64_t ckpt_id, bool job_id_only,
+			      uint32_t *rec_cnt);
 static int  _load_job_state(Buf buffer,	uint16_t protocol_version);
 static bitstr_t *_make_requeue_array(char *conf_buf);
 static uint32_t _max_switch_wait(uint32_t input_wait);
@@ -211,8 +282,10 @@ static int  _read_data_array_from_file(int fd, char *file_name, char ***data,
 static int   _read_data_from_file(int fd, char *file_name, char **data);
 static char *_read_job_ckpt_file(char *ckpt_file, int *size_ptr);
 static void _remove_defunct_batch_dirs(List batch_dirs);
+static void _remove_job_array_hash(struct job_record *job_ptr);
 static void _remove_job_hash(struct job_record *job_ptr);
 static int  _reset_detail_bitmaps(struct job_record *job_ptr);
+static int  _reset_job_journal(char *state_dir, uint64_t ckpt_id);
 static void _reset_step_bitmaps(struct job_record *job_ptr);
 static void _resp_array_add(resp_array_struct_t **resp,
 			    struct job_record *job_ptr, uint32_t rc);
@@ -233,6 +306,8 @@ static void _suspend_job(struct job_record *job_ptr, uint16_t op,
 			 bool indf_susp);
 static int  _suspend_job_nodes(struct job_record *job_ptr, bool indf_susp);
 static bool _top_priority(struct job_record *job_ptr);
+static int  _write_job_state_data(int fd, char *file_name, char *data,
+				  uint32_t size);
 static int  _valid_job_part(job_desc_msg_t * job_desc,
 			    uid_t submit_uid, bitstr_t *req_bitmap,
 			    struct part_record **part_pptr,
@@ -643,24 +718,286 @@ static slurmdb_qos_rec_t *_determine_and_validate_qos(
 	return qos_ptr;
 }
 
+/* Return the ID of the next job_state file. IDs increase with each
+ * checkpoint, even several within a second, and do not repeat after a
+ * restart which lost the last job_state file. */
+static uint64_t _next_job_state_ckpt_id(time_t now)
+{
+	return MAX(job_state_ckpt_id + 1, ((uint64_t) now) << 20);
+}
+
+/* Write a job state checkpoint and start a new, empty journal
+ * buffer IN - packed state of all jobs
+ * state_dir IN - StateSaveLocation
+ * now IN - time stamp in the checkpoint header
+ * ckpt_id IN - ID in the checkpoint header
+ * RET 0 or error code */
+static int _write_job_state_ckpt(Buf buffer, char *state_dir, time_t now,
+				 uint64_t ckpt_id)
+{
+	int error_code = SLURM_SUCCESS, log_fd;
+	char *old_file, *new_file, *reg_file;
+	struct stat stat_buf;
+	uint32_t ckpt_size = get_buf_offset(buffer);
+
+	old_file = xstrdup_printf("%s/job_state.old", state_dir);
+	reg_file = xstrdup_printf("%s/job_state", state_dir);
+	new_file = xstrdup_printf("%s/job_state.new", state_dir);
+
+	if (stat(reg_file, &stat_buf) == 0) {
+		static time_t last_mtime = (time_t) 0;
+		int delta_t = difftime(stat_buf.st_mtime, last_mtime);
+		if (delta_t < -10) {
+			error("The modification time of %s moved backwards "
+			      "by %d seconds",
+			      reg_file, (0-delta_t));
+			error("The clock of the file system and this computer "
+			      "appear to not be synchronized");
+			/* It could be safest to exit here. We likely mounted
+			 * a different file system with the state save files */
+		}
+		last_mtime = time(NULL);
+	}
+
+	log_fd = creat(new_file, 0600);
+	if (log_fd < 0) {
+		error("Can't save state, create file %s error %m",
+		      new_file);
+		error_code = errno;
+	} else {
+		fd_set_close_on_exec(log_fd);
+		error_code = _write_job_state_data(log_fd, new_file,
+						   get_buf_data(buffer),
+						   ckpt_size);
+	}
+	if (error_code)
+		(void) unlink(new_file);
+	else {			/* file shuffle */
+		(void) unlink(old_file);
+		if (link(reg_file, old_file))
+			debug4("unable to create link for %s -> %s: %m",
+			       reg_file, old_file);
+		(void) unlink(reg_file);
+		if (link(new_file, reg_file))
+			debug4("unable to create link for %s -> %s: %m",
+			       new_file, reg_file);
+		(void) unlink(new_file);
+		last_file_write_time = now;
+		slurmctld_diag_stats.job_state_ckpt_cnt++;
+		slurmctld_diag_stats.job_state_bytes += ckpt_size;
+		job_state_ckpt_size = ckpt_size;
+		job_state_ckpt_id = ckpt_id;
+	}
+	xfree(old_file);
+	xfree(reg_file);
+	xfree(new_file);
+
+	/* Records in the journal are all older than this checkpoint */
+	if (!error_code)
+		error_code = _reset_job_journal(state_dir, ckpt_id);
+
+	return error_code;
+}
+
+/* Replace the job state journal with an empty one for the checkpoint
+ * with ID ckpt_id */
+static int _reset_job_journal(char *state_dir, uint64_t ckpt_id)
+{
+	int error_code = SLURM_SUCCESS, log_fd;
+	char *new_file, *reg_file;
+	Buf buffer = init_buf(128);
+
+	packstr(JOB_STATE_VERSION, buffer);
+	pack16(SLURM_PROTOCOL_VERSION, buffer);
+	pack64(ckpt_id, buffer);
+
+	reg_file = xstrdup_printf("%s/job_state.journal", state_dir);
+	new_file = xstrdup_printf("%s/job_state.journal.new", state_dir);
+	log_fd = creat(new_file, 0600);
+	if (log_fd < 0) {
+		error("Can't save state, create file %s error %m",
+		      new_file);
+		error_code = errno;
+	} else {
+		fd_set_close_on_exec(log_fd);
+		error_code = _write_job_state_data(log_fd, new_file,
+						   get_buf_data(buffer),
+						   get_buf_offset(buffer));
+	}
+	if (!error_code && (rename(new_file, reg_file) < 0)) {
+		error("Can't save state, rename %s to %s error %m",
+		      new_file, reg_file);
+		error_code = errno;
+	}
+	if (error_code) {
+		(void) unlink(new_file);
+	} else {
+		slurmctld_diag_stats.job_state_bytes += get_buf_offset(buffer);
+		job_journal_size = get_buf_offset(buffer);
+		slurmctld_diag_stats.job_state_journal_size = job_journal_size;
+	}
+	xfree(new_file);
+	xfree(reg_file);
+	free_buf(buffer);
+
+	return error_code;
+}
+
+/* Append the job records which changed since the last save to the job state
+ * journal as a single record, then fsync it
+ * buffer IN - packed state of all jobs
+ * state_dir IN - StateSaveLocation
+ * rec IN - the job records in buffer, sorted by job ID
+ * rec_cnt IN - count of records in rec
+ * job_id_seq IN - job_id_sequence in the buffer's header
+ * now IN - time of the save
+ * RET 0 or error code */
+static int _write_job_journal(Buf buffer, char *state_dir,
+			      job_state_rec_t *rec, uint32_t rec_cnt,
+			      uint32_t job_id_seq, time_t now)
+{
+	int error_code = SLURM_SUCCESS, log_fd;
+	char *reg_file, *data = get_buf_data(buffer);
+	uint32_t *removed, removed_cnt = 0, *changed, changed_cnt = 0;
+	uint32_t i = 0, j = 0, body_size;
+	Buf jbuf;
+
+	/* Both record lists are sorted by job ID */
+	removed = xmalloc(sizeof(uint32_t) * (job_state_rec_cnt + 1));
+	changed = xmalloc(sizeof(uint32_t) * (rec_cnt + 1));
+	while ((i < rec_cnt) || (j < job_state_rec_cnt)) {
+		if ((j >= job_state_rec_cnt) ||
+		    ((i < rec_cnt) &&
+		     (rec[i].job_id < job_state_rec[j].job_id))) {
+			changed[changed_cnt++] = i++;	/* new job */
+		} else if ((i >= rec_cnt) ||
+			   (rec[i].job_id > job_state_rec[j].job_id)) {
+			removed[removed_cnt++] = job_state_rec[j++].job_id;
+		} else {
+			if (rec[i].hash != job_state_rec[j].hash)
+				changed[changed_cnt++] = i;
+			i++;
+			j++;
+		}
+	}
+	if (!removed_cnt && !changed_cnt && (job_id_seq == job_state_seq)) {
+		xfree(removed);
+		xfree(changed);
+		return SLURM_SUCCESS;	/* Nothing to save */
+	}
+
+	jbuf = init_buf(BUF_SIZE);
+	pack32(0, jbuf);	/* body size, set below */
+	pack64(0, jbuf);	/* body hash, set below */
+	pack_time(now, jbuf);
+	pack32(job_id_seq, jbuf);
+	pack32_array(removed, removed_cnt, jbuf);
+	pack32(changed_cnt, jbuf);
+	for (i = 0; i < changed_cnt; i++) {
+		job_state_rec_t *rec_ptr = &rec[changed[i]];
+		pack32(rec_ptr->job_id, jbuf);
+		packmem_array(data + rec_ptr->offset, rec_ptr->size, jbuf);
+	}
+	xfree(removed);
+	xfree(changed);
+
+	body_size = get_buf_offset(jbuf) - JOB_JOURNAL_REC_HDR_SIZE;
+	i = get_buf_offset(jbuf);
+	set_buf_offset(jbuf, 0);
+	pack32(body_size, jbuf);
+	pack64(_job_info_hash(get_buf_data(jbuf) + JOB_JOURNAL_REC_HDR_SIZE,
+			      body_size), jbuf);
+	set_buf_offset(jbuf, i);
+
+	reg_file = xstrdup_printf("%s/job_state.journal", state_dir);
+	log_fd = open(reg_file, O_WRONLY | O_APPEND);
+	if (log_fd < 0) {
+		error("Can't save state, open file %s error %m", reg_file);
+		error_code = errno;
+	} else {
+		fd_set_close_on_exec(log_fd);
+		error_code = _write_job_state_data(log_fd, reg_file,
+						   get_buf_data(jbuf),
+						   get_buf_offset(jbuf));
+	}
+	if (!error_code) {
+		slurmctld_diag_stats.job_state_journal_cnt++;
+		slurmctld_diag_stats.job_state_bytes += get_buf_offset(jbuf);
+		job_journal_size += get_buf_offset(jbuf);
+		slurmctld_diag_stats.job_state_journal_size = job_journal_size;
+		debug2("%s: journaled %u changed and %u removed jobs",
+		       __func__, changed_cnt, removed_cnt);
+	}
+	xfree(reg_file);
+	free_buf(jbuf);
+
+	return error_code;
+}
+
+/* Write data to a state save file, then fsync and close it
+ * RET 0 or error code */
+static int _write_job_state_data(int fd, char *file_name, char *data,
+				 uint32_t size)
+{
+	int error_code = SLURM_SUCCESS, pos = 0, amount, rc;
+
+	while (size > 0) {
+		amount = write(fd, &data[pos], size);
+		if (amount < 0) {
+			if (errno == EINTR)
+				continue;
+			error("Error writing file %s, %m", file_name);
+			error_code = errno;
+			break;
+		}
+		size -= amount;
+		pos  += amount;
+	}
+
+	rc = fsync_and_close(fd, "job");
+	if (rc && !error_code)
+		error_code = rc;
+	return error_code;
+}
+
+static int _job_state_rec_cmp(const void *x, const void *y)
+{
+	const job_state_rec_t *rec1 = x, *rec2 = y;
+
+	if (rec1->job_id < rec2->job_id)
+		return -1;
+	if (rec1->job_id > rec2->job_id)
+		return 1;
+	return 0;
+}
+
 /*
  * dump_all_job_state - save the state of all jobs to file for checkpoint
  *	Changes here should be reflected in load_last_job_id() and
  *	load_all_job_state().
+ *	Only the jobs which changed since the last save are written, appended
+ *	to the job_state.journal file. Once the journal grows larger than the
+ *	job_state file, a new job_state file is written and the journal
+ *	emptied.
  * RET 0 or error code */
 int dump_all_job_state(void)
 {
 	/* Save high-water mark to avoid buffer growth with copies */
 	static int high_buffer_size = (1024 * 1024);
-	int error_code = SLURM_SUCCESS, log_fd;
-	char *old_file, *new_file, *reg_file;
-	struct stat stat_buf;
+	int error_code = SLURM_SUCCESS;
+	char *state_dir;
 	/* Locks: Read config and job */
 	slurmctld_lock_t job_read_lock =
 		{ READ_LOCK, READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
 	Buf buffer = init_buf(high_buffer_size);
 	time_t now = time(NULL);
 	time_t last_state_file_time;
+	ListIterator job_iterator;
+	struct job_record *job_ptr;
+	job_state_rec_t *rec;
+	uint32_t rec_cnt, i, job_id_seq;
+	uint64_t ckpt_id = _next_job_state_ckpt_id(now);
+	bool ckpt;
 	DEF_TIMERS;
 
 	START_TIMER;
@@ -691,87 +1028,75 @@ int dump_all_job_state(void)
 	 * This is needed so that the job id remains persistent even after
 	 * slurmctld is restarted.
 	 */
-	pack32( job_id_sequence, buffer);
+	job_id_seq = job_id_sequence;
+	pack32(job_id_seq, buffer);
 
 	debug3("Writing job id %u to header record of job_state file",
-	       job_id_sequence);
+	       job_id_seq);
 
-	/* write individual job records */
+	/* write header: ID of this file, which the journal names, so that a
+	 * journal is never replayed on top of a later job_state file. It is
+	 * only used if this buffer is written as a checkpoint. */
+	pack64(ckpt_id, buffer);
+
+	/* write individual job records, noting where each one is */
 	lock_slurmctld(job_read_lock);
-	list_for_each(job_list, _dump_job_state, buffer);
-
-	/* write the buffer to file */
-	old_file = xstrdup(slurmctld_conf.state_save_location);
-	xstrcat(old_file, "/job_state.old");
-	reg_file = xstrdup(slurmctld_conf.state_save_location);
-	xstrcat(reg_file, "/job_state");
-	new_file = xstrdup(slurmctld_conf.state_save_location);
-	xstrcat(new_file, "/job_state.new");
+	rec_cnt = list_count(job_list);
+	rec = xmalloc(sizeof(job_state_rec_t) * (rec_cnt + 1));
+	i = 0;
+	job_iterator = list_iterator_create(job_list);
+	while ((i < rec_cnt) &&
+	       (job_ptr = (struct job_record *) list_next(job_iterator))) {
+		rec[i].job_id = job_ptr->job_id;
+		rec[i].offset = get_buf_offset(buffer);
+		_dump_job_state(job_ptr, buffer);
+		rec[i].size = get_buf_offset(buffer) - rec[i].offset;
+		i++;
+	}
+	list_iterator_destroy(job_iterator);
+	rec_cnt = i;
+	state_dir = xstrdup(slurmctld_conf.state_save_location);
 	unlock_slurmctld(job_read_lock);
+	high_buffer_size = MAX(get_buf_offset(buffer), high_buffer_size);
 
-	if (stat(reg_file, &stat_buf) == 0) {
-		static time_t last_mtime = (time_t) 0;
-		int delta_t = difftime(stat_buf.st_mtime, last_mtime);
-		if (delta_t < -10) {
-			error("The modification time of %s moved backwards "
-			      "by %d seconds",
-			      reg_file, (0-delta_t));
-			error("The clock of the file system and this computer "
-			      "appear to not be synchronized");
-			/* It could be safest to exit here. We likely mounted
-			 * a different file system with the state save files */
-		}
-		last_mtime = time(NULL);
+	for (i = 0; i < rec_cnt; i++) {
+		rec[i].hash = _job_info_hash(get_buf_data(buffer) +
+					     rec[i].offset, rec[i].size);
+	}
+	qsort(rec, rec_cnt, sizeof(job_state_rec_t), _job_state_rec_cmp);
+
+	ckpt = job_state_ckpt_needed ||
+	       (job_journal_size > MAX(job_state_ckpt_size,
+				       JOB_JOURNAL_MIN_SIZE));
+	for (i = 1; (i < rec_cnt) && !ckpt; i++) {
+		/* Journal replay replaces records by job ID */
+		if (rec[i].job_id == rec[i - 1].job_id)
+			ckpt = true;
 	}
 
 	lock_state_files();
-	log_fd = creat(new_file, 0600);
-	if (log_fd < 0) {
-		error("Can't save state, create file %s error %m",
-		      new_file);
-		error_code = errno;
+	if (ckpt) {
+		error_code = _write_job_state_ckpt(buffer, state_dir, now,
+						   ckpt_id);
 	} else {
-		int pos = 0, nwrite, amount, rc;
-		char *data;
-
-		fd_set_close_on_exec(log_fd);
-		nwrite = get_buf_offset(buffer);
-		data = (char *)get_buf_data(buffer);
-		high_buffer_size = MAX(nwrite, high_buffer_size);
-		while (nwrite > 0) {
-			amount = write(log_fd, &data[pos], nwrite);
-			if ((amount < 0) && (errno != EINTR)) {
-				error("Error writing file %s, %m", new_file);
-				error_code = errno;
-				break;
-			}
-			nwrite -= amount;
-			pos    += amount;
-		}
-
-		rc = fsync_and_close(log_fd, "job");
-		if (rc && !error_code)
-			error_code = rc;
-	}
-	if (error_code)
-		(void) unlink(new_file);
-	else {			/* file shuffle */
-		(void) unlink(old_file);
-		if (link(reg_file, old_file))
-			debug4("unable to create link for %s -> %s: %m",
-			       reg_file, old_file);
-		(void) unlink(reg_file);
-		if (link(new_file, reg_file))
-			debug4("unable to create link for %s -> %s: %m",
-			       new_file, reg_file);
-		(void) unlink(new_file);
-		last_file_write_time = now;
+		error_code = _write_job_journal(buffer, state_dir, rec, rec_cnt,
+						job_id_seq, now);
 	}
-	xfree(old_file);
-	xfree(reg_file);
-	xfree(new_file);
 	unlock_state_files();
 
+	if (error_code) {
+		/* Journal may be incomplete, write everything next time */
+		job_state_ckpt_needed = true;
+		xfree(rec);
+	} else {
+		job_state_ckpt_needed = false;
+		xfree(job_state_rec);
+		job_state_rec = rec;
+		job_state_rec_cnt = rec_cnt;
+		job_state_seq = job_id_seq;
+	}
+	xfree(state_dir);
+
 	free_buf(buffer);
 	END_TIMER2("dump_all_job_state");
 	return error_code;
@@ -811,6 +1136,7 @@ static int _open_job_state_file(char **state_file)
 extern void backup_slurmctld_restart(void)
 {
 	last_file_write_time = (time_t) 0;
+	job_state_ckpt_needed = true;
 }
 
 /* Return the time stamp in the current job state save file */
@@ -884,13 +1210,20 @@ extern int load_all_job_state(void)
 	Buf buffer;
 	time_t buf_time;
 	uint32_t saved_job_id;
+	uint64_t ckpt_id = 0;
 	char *ver_str = NULL;
 	uint32_t ver_str_len;
 	uint16_t protocol_version = (uint16_t)NO_VAL;
+	uint32_t journal_cnt = 0;
 	assoc_mgr_lock_t locks = { READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
 				   READ_LOCK, NO_LOCK, NO_LOCK };
+	DEF_TIMERS;
+
+	/* Whatever was loaded, the next save must write all jobs */
+	job_state_ckpt_needed = true;
 
 	/* read the file */
+	START_TIMER;
 	lock_state_files();
 	state_fd = _open_job_state_file(&state_file);
 	if (state_fd < 0) {
@@ -945,6 +1278,9 @@ extern int load_all_job_state(void)
 	if (saved_job_id <= slurmctld_conf.max_job_id)
 		job_id_sequence = MAX(saved_job_id, job_id_sequence);
 	debug3("Job id in job_state header is %u", saved_job_id);
+	if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION)
+		safe_unpack64(&ckpt_id, buffer);
+	job_state_ckpt_id = MAX(job_state_ckpt_id, ckpt_id);
 
 	assoc_mgr_lock(&locks);
 	while (remaining_buf(buffer) > 0) {
@@ -953,11 +1289,16 @@ extern int load_all_job_state(void)
 			goto unpack_error;
 		job_cnt++;
 	}
+	if (ckpt_id)
+		(void) _load_job_journal(ckpt_id, false, &journal_cnt);
 	assoc_mgr_unlock(&locks);
 	debug3("Set job_id_sequence to %u", job_id_sequence);
 
 	free_buf(buffer);
-	info("Recovered information about %d jobs", job_cnt);
+	END_TIMER2("load_all_job_state");
+	slurmctld_diag_stats.job_state_load_time = DELTA_TIMER;
+	info("Recovered information about %d jobs, replayed %u job state "
+	     "journal records, %s", job_cnt, journal_cnt, TIME_STR);
 	return error_code;
 
 unpack_error:
@@ -968,6 +1309,151 @@ unpack_error:
 	return SLURM_FAILURE;
 }
 
+/* Read a state save file in its entirety
+ * RET buffer with file contents or NULL if none */
+static Buf _read_job_state_file(char *state_file)
+{
+	int data_allocated, data_read = 0, state_fd;
+	uint32_t data_size = 0;
+	char *data;
+
+	state_fd = open(state_file, O_RDONLY);
+	if (state_fd < 0)
+		return NULL;
+
+	data_allocated = BUF_SIZE;
+	data = xmalloc(data_allocated);
+	while (1) {
+		data_read = read(state_fd, &data[data_size], BUF_SIZE);
+		if (data_read < 0) {
+			if (errno == EINTR)
+				continue;
+			else {
+				error("Read error on %s: %m", state_file);
+				break;
+			}
+		} else if (data_read == 0)	/* eof */
+			break;
+		data_size      += data_read;
+		data_allocated += data_read;
+		xrealloc(data, data_allocated);
+	}
+	close(state_fd);
+
+	return create_buf(data, data_size);
+}
+
+/*
+ * _load_job_journal - replay the job state journal on top of the records
+ *	loaded from the job_state file
+ * IN ckpt_id - ID of the job_state file loaded, the journal is ignored
+ *	unless it was started for that same file
+ * IN job_id_only - only recover job_id_sequence, not the job records
+ * OUT rec_cnt - count of journal records replayed, may be NULL
+ * RET 0 or error code
+ */
+static int _load_job_journal(uint64_t ckpt_id, bool job_id_only,
+			     uint32_t *rec_cnt)
+{
+	char *state_file, *ver_str = NULL;
+	uint32_t ver_str_len, body_size, body_end, saved_job_id;
+	uint32_t *removed = NULL, removed_cnt, job_cnt, job_id, i;
+	uint16_t protocol_version = (uint16_t) NO_VAL;
+	uint64_t body_hash, journal_id;
+	time_t rec_time;
+	Buf buffer;
+	int error_code = SLURM_SUCCESS;
+
+	if (rec_cnt)
+		*rec_cnt = 0;
+
+	state_file = slurm_get_state_save_location();
+	xstrcat(state_file, "/job_state.journal");
+	lock_state_files();
+	buffer = _read_job_state_file(state_file);
+	unlock_state_files();
+	if (!buffer) {
+		debug("No job state journal (%s) to recover", state_file);
+		xfree(state_file);
+		return ENOENT;
+	}
+
+	safe_unpackstr_xmalloc(&ver_str, &ver_str_len, buffer);
+	if (ver_str && !xstrcmp(ver_str, JOB_STATE_VERSION))
+		safe_unpack16(&protocol_version, buffer);
+	xfree(ver_str);
+	if (protocol_version == (uint16_t) NO_VAL) {
+		error("Can not recover job state journal, incompatible version");
+		error_code = EFAULT;
+		goto fini;
+	}
+	safe_unpack64(&journal_id, buffer);
+	if (journal_id != ckpt_id) {
+		/* Written before the job_state file was, or for a backup */
+		info("Job state journal %s does not match job state file, "
+		     "ignored", state_file);
+		goto fini;
+	}
+
+	while (remaining_buf(buffer) > 0) {
+		if (remaining_buf(buffer) < JOB_JOURNAL_REC_HDR_SIZE) {
+			error("Incomplete job state journal record ignored");
+			break;
+		}
+		safe_unpack32(&body_size, buffer);
+		safe_unpack64(&body_hash, buffer);
+		if ((remaining_buf(buffer) < body_size) ||
+		    (_job_info_hash(get_buf_data(buffer) +
+				    get_buf_offset(buffer), body_size) !=
+		     body_hash)) {
+			/* Last write was interrupted */
+			error("Incomplete job state journal record ignored");
+			break;
+		}
+		body_end = get_buf_offset(buffer) + body_size;
+
+		safe_unpack_time(&rec_time, buffer);
+		safe_unpack32(&saved_job_id, buffer);
+		if (saved_job_id <= slurmctld_conf.max_job_id)
+			job_id_sequence = MAX(saved_job_id, job_id_sequence);
+		if (job_id_only) {
+			set_buf_offset(buffer, body_end);
+			continue;
+		}
+
+		safe_unpack32_array(&removed, &removed_cnt, buffer);
+		for (i = 0; i < removed_cnt; i++)
+			(void) _purge_job_record(removed[i]);
+		xfree(removed);
+
+		safe_unpack32(&job_cnt, buffer);
+		for (i = 0; i < job_cnt; i++) {
+			safe_unpack32(&job_id, buffer);
+			/* Replace any record loaded earlier */
+			(void) _purge_job_record(job_id);
+			if (_load_job_state(buffer, protocol_version))
+				goto unpack_error;
+		}
+		if (get_buf_offset(buffer) != body_end)
+			goto unpack_error;
+		debug3("Replayed job state journal record from %u: %u jobs "
+		       "changed, %u removed", (uint32_t) rec_time, job_cnt,
+		       removed_cnt);
+		if (rec_cnt)
+			(*rec_cnt)++;
+	}
+	goto fini;
+
+unpack_error:
+	error("Invalid job state journal %s", state_file);
+	xfree(removed);
+	error_code = SLURM_FAILURE;
+fini:
+	xfree(state_file);
+	free_buf(buffer);
+	return error_code;
+}
+
 /*
  * load_last_job_id - load only the last job ID from state save file.
  *	Changes here should be reflected in load_all_job_state().
@@ -981,6 +1467,7 @@ extern int load_last_job_id( void )
 	char *data = NULL, *state_file;
 	Buf buffer;
 	time_t buf_time;
+	uint64_t ckpt_id = 0;
 	char *ver_str = NULL;
 	uint32_t ver_str_len;
 	uint16_t protocol_version = (uint16_t)NO_VAL;
@@ -1039,8 +1526,13 @@ extern int load_last_job_id( void )
 	safe_unpack_time(&buf_time, buffer);
 	safe_unpack32( &job_id_sequence, buffer);
 	debug3("Job ID in job_state header is %u", job_id_sequence);
+	if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION)
+		safe_unpack64(&ckpt_id, buffer);
 
-	/* Ignore the state for individual jobs stored here */
+	/* Ignore the state for individual jobs stored here, but the journal
+	 * may hold a later job ID */
+	if (ckpt_id)
+		(void) _load_job_journal(ckpt_id, true, NULL);
 
 	xfree(ver_str);
 	free_buf(buffer);
@@ -2644,11 +3136,7 @@ unpack_error:
  */
 static void _add_job_hash(struct job_record *job_ptr)
 {
-	int inx;
-
-	inx = JOB_HASH_INX(job_ptr->job_id);
-	job_ptr->job_next = job_hash[inx];
-	job_hash[inx] = job_ptr;
+	id_hash_add(job_hash, job_ptr->job_id, job_ptr);
 }
 
 /* _remove_job_hash - remove a job hash entry for given job record, job_id must
@@ -2658,19 +3146,8 @@ static void _add_job_hash(struct job_record *job_ptr)
  */
 static void _remove_job_hash(struct job_record *job_entry)
 {
-	struct job_record *job_ptr, **job_pptr;
-
-	job_pptr = &job_hash[JOB_HASH_INX(job_entry->job_id)];
-	while ((job_pptr != NULL) &&
-	       ((job_ptr = *job_pptr) != job_entry)) {
-		job_pptr = &job_ptr->job_next;
-	}
-	if (job_pptr == NULL) {
+	if (!id_hash_remove(job_hash, job_entry->job_id, job_entry))
 		fatal("job hash error");
-		return; /* Fix CLANG false positive error */
-	}
-	*job_pptr = job_entry->job_next;
-	job_entry->job_next = NULL;
 }
 
 /* _add_job_array_hash - add a job hash entry for given job record,
@@ -2680,18 +3157,68 @@ static void _remove_job_hash(struct job_record *job_entry)
  */
 void _add_job_array_hash(struct job_record *job_ptr)
 {
-	int inx;
+	struct job_record *first_ptr;
+
+	if (job_ptr->array_task_id == NO_VAL)
+		return;	/* Not a job array */
+
+	first_ptr = id_hash_find(job_array_hash, job_ptr->array_job_id);
+	if (first_ptr) {
+		/* Link after the first task, leaving the hash entry as is */
+		job_ptr->job_array_prev_j = first_ptr;
+		job_ptr->job_array_next_j = first_ptr->job_array_next_j;
+		if (first_ptr->job_array_next_j)
+			first_ptr->job_array_next_j->job_array_prev_j = job_ptr;
+		first_ptr->job_array_next_j = job_ptr;
+	} else {
+		job_ptr->job_array_prev_j = NULL;
+		job_ptr->job_array_next_j = NULL;
+		id_hash_add(job_array_hash, job_ptr->array_job_id, job_ptr);
+	}
+
+	id_hash_add(job_array_task_hash,
+		    ID_HASH_KEY2(job_ptr->array_job_id, job_ptr->array_task_id),
+		    job_ptr);
+}
+
+/* _remove_job_array_hash - remove the job array hash entries for given job
+ *	record, if any
+ * IN job_ptr - pointer to job record
+ * Globals: hash tables updated
+ */
+static void _remove_job_array_hash(struct job_record *job_ptr)
+{
+	struct job_record *next_ptr = job_ptr->job_array_next_j;
+	struct job_record *prev_ptr = job_ptr->job_array_prev_j;
 
 	if (job_ptr->array_task_id == NO_VAL)
 		return;	/* Not a job array */
 
-	inx = JOB_HASH_INX(job_ptr->array_job_id);
-	job_ptr->job_array_next_j = job_array_hash_j[inx];
-	job_array_hash_j[inx] = job_ptr;
+	if (next_ptr)
+		next_ptr->job_array_prev_j = prev_ptr;
+	if (prev_ptr) {
+		prev_ptr->job_array_next_j = next_ptr;
+	} else if (!id_hash_remove(job_array_hash, job_ptr->array_job_id,
+				   job_ptr)) {
+		error("job array hash error");
+	} else if (next_ptr) {
+		id_hash_add(job_array_hash, job_ptr->array_job_id, next_ptr);
+	}
+	job_ptr->job_array_next_j = NULL;
+	job_ptr->job_array_prev_j = NULL;
+
+	if (!id_hash_remove(job_array_task_hash,
+			    ID_HASH_KEY2(job_ptr->array_job_id,
+					 job_ptr->array_task_id), job_ptr))
+		error("job array, task ID hash error");
+}
 
-	inx = JOB_ARRAY_HASH_INX(job_ptr->array_job_id,job_ptr->array_task_id);
-	job_ptr->job_array_next_t = job_array_hash_t[inx];
-	job_array_hash_t[inx] = job_ptr;
+/* Return the first of the job records for tasks of the given job array, the
+ * others follow it through job_array_next_j. The job array's META record
+ * (with array_task_id == NO_VAL) is not included. */
+static struct job_record *_job_array_first(uint32_t array_job_id)
+{
+	return id_hash_find(job_array_hash, array_job_id);
 }
 
 /* For the job array data structure, build the string representation of the
@@ -2734,7 +3261,6 @@ extern void build_array_str(struct job_record *job_ptr)
 extern bool test_job_array_complete(uint32_t array_job_id)
 {
 	struct job_record *job_ptr;
-	int inx;
 
 	job_ptr = find_job_record(array_job_id);
 	if (job_ptr) {
@@ -2745,8 +3271,7 @@ extern bool test_job_array_complete(uint32_t array_job_id)
 	}
 
 	/* Need to test individual job array records */
-	inx = JOB_HASH_INX(array_job_id);
-	job_ptr = job_array_hash_j[inx];
+	job_ptr = _job_array_first(array_job_id);
 	while (job_ptr) {
 		if (job_ptr->array_job_id == array_job_id) {
 			if (!IS_JOB_COMPLETE(job_ptr))
@@ -2761,7 +3286,6 @@ extern bool test_job_array_complete(uint32_t array_job_id)
 extern bool test_job_array_completed(uint32_t array_job_id)
 {
 	struct job_record *job_ptr;
-	int inx;
 
 	job_ptr = find_job_record(array_job_id);
 	if (job_ptr) {
@@ -2770,8 +3294,7 @@ extern bool test_job_array_completed(uint32_t array_job_id)
 	}
 
 	/* Need to test individual job array records */
-	inx = JOB_HASH_INX(array_job_id);
-	job_ptr = job_array_hash_j[inx];
+	job_ptr = _job_array_first(array_job_id);
 	while (job_ptr) {
 		if (job_ptr->array_job_id == array_job_id) {
 			if (!IS_JOB_COMPLETED(job_ptr))
@@ -2786,7 +3309,6 @@ extern bool test_job_array_completed(uint32_t array_job_id)
 extern bool test_job_array_finished(uint32_t array_job_id)
 {
 	struct job_record *job_ptr;
-	int inx;
 
 	job_ptr = find_job_record(array_job_id);
 	if (job_ptr) {
@@ -2795,8 +3317,7 @@ extern bool test_job_array_finished(uint32_t array_job_id)
 	}
 
 	/* Need to test individual job array records */
-	inx = JOB_HASH_INX(array_job_id);
-	job_ptr = job_array_hash_j[inx];
+	job_ptr = _job_array_first(array_job_id);
 	while (job_ptr) {
 		if (job_ptr->array_job_id == array_job_id) {
 			if (!IS_JOB_FINISHED(job_ptr))
@@ -2811,7 +3332,6 @@ extern bool test_job_array_finished(uint32_t array_job_id)
 extern bool test_job_array_pending(uint32_t array_job_id)
 {
 	struct job_record *job_ptr;
-	int inx;
 
 	job_ptr = find_job_record(array_job_id);
 	if (job_ptr) {
@@ -2822,8 +3342,7 @@ extern bool test_job_array_pending(uint32_t array_job_id)
 	}
 
 	/* Need to test individual job array records */
-	inx = JOB_HASH_INX(array_job_id);
-	job_ptr = job_array_hash_j[inx];
+	job_ptr = _job_array_first(array_job_id);
 	while (job_ptr) {
 		if (job_ptr->array_job_id == array_job_id) {
 			if (IS_JOB_PENDING(job_ptr))
@@ -2839,10 +3358,9 @@ extern bool test_job_array_pending(uint32_t array_job_id)
 extern int num_pending_job_array_tasks(uint32_t array_job_id)
 {
 	struct job_record *job_ptr;
-	int count = 0, inx;
+	int count = 0;
 
-	inx = JOB_HASH_INX(array_job_id);
-	job_ptr = job_array_hash_j[inx];
+	job_ptr = _job_array_first(array_job_id);
 	while (job_ptr) {
 		if ((job_ptr->array_job_id == array_job_id) &&
 		    IS_JOB_PENDING(job_ptr))
@@ -2878,8 +3396,7 @@ extern struct job_record *find_job_array_rec(uint32_t array_job_id,
 		    (job_ptr->array_job_id == array_job_id))
 			return job_ptr;
 
-		inx = JOB_HASH_INX(array_job_id);
-		job_ptr = job_array_hash_j[inx];
+		job_ptr = _job_array_first(array_job_id);
 		while (job_ptr) {
 			if (job_ptr->array_job_id == array_job_id) {
 				match_job_ptr = job_ptr;
@@ -2891,15 +3408,11 @@ extern struct job_record *find_job_array_rec(uint32_t array_job_id,
 		}
 		return match_job_ptr;
 	} else {		/* Find specific task ID */
-		inx = JOB_ARRAY_HASH_INX(array_job_id, array_task_id);
-		job_ptr = job_array_hash_t[inx];
-		while (job_ptr) {
-			if ((job_ptr->array_job_id == array_job_id) &&
-			    (job_ptr->array_task_id == array_task_id)) {
-				return job_ptr;
-			}
-			job_ptr = job_ptr->job_array_next_t;
-		}
+		job_ptr = id_hash_find(job_array_task_hash,
+				       ID_HASH_KEY2(array_job_id,
+						    array_task_id));
+		if (job_ptr)
+			return job_ptr;
 		/* Look for job record with all of the pending tasks */
 		job_ptr = find_job_record(array_job_id);
 		if (job_ptr && job_ptr->array_recs &&
@@ -2922,16 +3435,7 @@ extern struct job_record *find_job_array_rec(uint32_t array_job_id,
  */
 struct job_record *find_job_record(uint32_t job_id)
 {
-	struct job_record *job_ptr;
-
-	job_ptr = job_hash[JOB_HASH_INX(job_id)];
-	while (job_ptr) {
-		if (job_ptr->job_id == job_id)
-			return job_ptr;
-		job_ptr = job_ptr->job_next;
-	}
-
-	return NULL;
+	return id_hash_find(job_hash, job_id);
 }
 
 /* rebuild a job's partition name list based upon the contents of its
@@ -3177,6 +3681,7 @@ extern int kill_job_by_front_end_name(char *node_name)
 				job_ptr->job_state = JOB_PENDING;
 				if (job_ptr->node_cnt)
 					job_ptr->job_state |= JOB_COMPLETING;
+				prio_queue_update_job(job_ptr);
 
 				/* restart from periodic checkpoint */
 				if (job_ptr->ckpt_interval &&
@@ -3429,6 +3934,7 @@ extern int kill_running_job_by_node_name(char *node_name)
 				job_ptr->job_state = JOB_PENDING;
 				if (job_ptr->node_cnt)
 					job_ptr->job_state |= JOB_COMPLETING;
+				prio_queue_update_job(job_ptr);
 
 				/* restart from periodic checkpoint */
 				if (job_ptr->ckpt_interval &&
@@ -3762,26 +4268,17 @@ int init_job_conf(void)
 }
 
 /*
- * rehash_jobs - Create or rebuild the job hash table.
+ * rehash_jobs - Create the job hash tables.
+ * The tables grow as jobs are added, so there is no need to rebuild them
+ * if MaxJobCount changes.
  * NOTE: run lock_slurmctld before entry: Read config, write job
  */
 extern void rehash_jobs(void)
 {
 	if (job_hash == NULL) {
-		hash_table_size = slurmctld_conf.max_job_cnt;
-		job_hash = (struct job_record **)
-			xmalloc(hash_table_size * sizeof(struct job_record *));
-		job_array_hash_j = (struct job_record **)
-			xmalloc(hash_table_size * sizeof(struct job_record *));
-		job_array_hash_t = (struct job_record **)
-			xmalloc(hash_table_size * sizeof(struct job_record *));
-	} else if (hash_table_size < (slurmctld_conf.max_job_cnt / 2)) {
-		/* If the MaxJobCount grows by too much, the hash table will
-		 * be ineffective without rebuilding. We don't presently bother
-		 * to rebuild the hash table, but cut MaxJobCount back as
-		 * needed. */
-		error ("MaxJobCount reset too high, restart slurmctld");
-		slurmctld_conf.max_job_cnt = hash_table_size;
+		job_hash = id_hash_init(slurmctld_conf.max_job_cnt);
+		job_array_hash = id_hash_init(0);
+		job_array_task_hash = id_hash_init(0);
 	}
 }
 
@@ -3792,7 +4289,7 @@ extern void rehash_jobs(void)
  * RET - The new job record, which is the new META job record. */
 extern struct job_record *job_array_split(struct job_record *job_ptr)
 {
-	struct job_record *job_ptr_pend = NULL, *save_job_next;
+	struct job_record *job_ptr_pend = NULL;
 	struct job_details *job_details, *details_new, *save_details;
 	uint32_t save_job_id;
 	uint64_t save_db_index = job_ptr->db_index;
@@ -3823,14 +4320,12 @@ extern struct job_record *job_array_split(struct job_record *job_ptr)
 	/* Copy most of original job data.
 	 * This could be done in parallel, but performance was worse. */
 	save_job_id   = job_ptr_pend->job_id;
-	save_job_next = job_ptr_pend->job_next;
 	save_details  = job_ptr_pend->details;
 	save_prio_factors = job_ptr_pend->prio_factors;
 	save_step_list = job_ptr_pend->step_list;
 	memcpy(job_ptr_pend, job_ptr, sizeof(struct job_record));
 
 	job_ptr_pend->job_id   = save_job_id;
-	job_ptr_pend->job_next = save_job_next;
 	job_ptr_pend->details  = save_details;
 	job_ptr_pend->step_list = save_step_list;
 	job_ptr_pend->db_index = save_db_index;
@@ -3838,6 +4333,9 @@ extern struct job_record *job_array_split(struct job_record *job_ptr)
 	job_ptr_pend->prio_factors = save_prio_factors;
 	slurm_copy_priority_factors_object(job_ptr_pend->prio_factors,
 					   job_ptr->prio_factors);
+	job_ptr_pend->prio_queue_recs = NULL;
+	job_ptr_pend->prio_queue_cnt = 0;
+	job_ptr_pend->prio_queue_dirty = false;
 
 	job_ptr_pend->account = xstrdup(job_ptr->account);
 	job_ptr_pend->alias_list = xstrdup(job_ptr->alias_list);
@@ -3884,8 +4382,8 @@ extern struct job_record *job_array_split(struct job_record *job_ptr)
 	memcpy(job_ptr_pend->limit_set.tres, job_ptr->limit_set.tres,
 	       sizeof(uint16_t) * slurmctld_tres_cnt);
 
-	_add_job_hash(job_ptr);		/* Sets job_next */
-	_add_job_hash(job_ptr_pend);	/* Sets job_next */
+	_add_job_hash(job_ptr);
+	_add_job_hash(job_ptr_pend);
 	_add_job_array_hash(job_ptr);
 	job_ptr_pend->job_resrcs = NULL;
 
@@ -3992,6 +4490,9 @@ extern struct job_record *job_array_split(struct job_record *job_ptr)
 	details_new->std_in = xstrdup(job_details->std_in);
 	details_new->std_out = xstrdup(job_details->std_out);
 	details_new->work_dir = xstrdup(job_details->work_dir);
+	last_job_update = time(NULL);
+	prio_queue_update_job(job_ptr);
+	prio_queue_update_job(job_ptr_pend);
 
 	return job_ptr_pend;
 }
@@ -4302,6 +4803,8 @@ extern int job_allocate(job_desc_msg_t * job_specs, int immediate,
 	 */
 	if (job_ptr->priority == NO_VAL)
 		set_job_prio(job_ptr);
+	else
+		prio_queue_update_job(job_ptr);
 
 	if (independent &&
 	    (license_job_test(job_ptr, time(NULL)) != SLURM_SUCCESS))
@@ -4735,7 +5238,7 @@ extern int job_str_signal(char *job_id_str, uint16_t signal, uint16_t flags,
 		}
 
 		/* Signal all tasks of this job array */
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
+		job_ptr = _job_array_first(job_id);
 		if (!job_ptr && !job_ptr_done) {
 			info("%s: 2 invalid job id %u", __func__, job_id);
 			return ESLURM_INVALID_JOB_ID;
@@ -4788,7 +5291,7 @@ extern int job_str_signal(char *job_id_str, uint16_t signal, uint16_t flags,
 	/* Find some job record and validate the user signalling the job */
 	job_ptr = find_job_record(job_id);
 	if (job_ptr == NULL) {
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
+		job_ptr = _job_array_first(job_id);
 		while (job_ptr) {
 			if (job_ptr->array_job_id == job_id)
 				break;
@@ -5117,6 +5620,7 @@ extern int job_complete(uint32_t job_id, uid_t uid, bool requeue,
 			job_ptr->batch_flag = 1;
 			job_ptr->priority = 0;
 		}
+		prio_queue_update_job(job_ptr);
 	} else if (IS_JOB_PENDING(job_ptr) && job_ptr->details &&
 		   job_ptr->batch_flag) {
 		/* Possible failure mode with DOWN node and job requeue.
@@ -8144,7 +8648,6 @@ _validate_min_mem_partition(job_desc_msg_t *job_desc_msg,
 static void _list_delete_job(void *job_entry)
 {
 	struct job_record *job_ptr = (struct job_record *) job_entry;
-	struct job_record **job_pptr, *tmp_ptr;
 	int job_array_size, i;
 
 	xassert(job_entry);
@@ -8152,16 +8655,8 @@ static void _list_delete_job(void *job_entry)
 	job_ptr->magic = 0;	/* make sure we don't delete record twice */
 
 	/* Remove the record from job hash table */
-	job_pptr = &job_hash[JOB_HASH_INX(job_ptr->job_id)];
-	while ((job_pptr != NULL) && (*job_pptr != NULL) &&
-	       ((tmp_ptr = *job_pptr) != (struct job_record *) job_entry)) {
-		xassert(tmp_ptr->magic == JOB_MAGIC);
-		job_pptr = &tmp_ptr->job_next;
-	}
-	if (job_pptr == NULL)
+	if (!id_hash_remove(job_hash, job_ptr->job_id, job_ptr))
 		error("job hash error");
-	else
-		*job_pptr = job_ptr->job_next;
 
 	if (job_ptr->array_recs) {
 		job_array_size = MAX(1, job_ptr->array_recs->task_cnt);
@@ -8170,34 +8665,8 @@ static void _list_delete_job(void *job_entry)
 	}
 
 	/* Remove the record from job array hash tables, if applicable */
-	if (job_ptr->array_task_id != NO_VAL) {
-		job_pptr = &job_array_hash_j[
-			JOB_HASH_INX(job_ptr->array_job_id)];
-		while ((job_pptr != NULL) && (*job_pptr != NULL) &&
-		       ((tmp_ptr = *job_pptr) !=
-			(struct job_record *) job_entry)) {
-			xassert(tmp_ptr->magic == JOB_MAGIC);
-			job_pptr = &tmp_ptr->job_array_next_j;
-		}
-		if (job_pptr == NULL)
-			error("job array hash error");
-		else
-			*job_pptr = job_ptr->job_array_next_j;
-
-		job_pptr = &job_array_hash_t[
-			JOB_ARRAY_HASH_INX(job_ptr->array_job_id,
-					   job_ptr->array_task_id)];
-		while ((job_pptr != NULL) && (*job_pptr != NULL) &&
-		       ((tmp_ptr = *job_pptr) !=
-			(struct job_record *) job_entry)) {
-			xassert(tmp_ptr->magic == JOB_MAGIC);
-			job_pptr = &tmp_ptr->job_array_next_t;
-		}
-		if (job_pptr == NULL)
-			error("job array, task ID hash error");
-		else
-			*job_pptr = job_ptr->job_array_next_t;
-	}
+	_remove_job_array_hash(job_ptr);
+	prio_queue_remove_job(job_ptr);
 
 	delete_job_details(job_ptr);
 	xfree(job_ptr->account);
@@ -8367,18 +8836,22 @@ static int _list_find_job_old(void *job_entry, void *key)
 }
 
 /* Determine if ALL partitions associated with a job are hidden */
-static bool _all_parts_hidden(struct job_record *job_ptr)
+static bool _all_parts_hidden(struct job_record *job_ptr,
+			      struct part_record **hidden)
 {
 	bool rc;
 	ListIterator part_iterator;
 	struct part_record *part_ptr;
 
+	if (!hidden)
+		return false;
+
 	if (job_ptr->part_ptr_list) {
 		rc = true;
 		part_iterator = list_iterator_create(job_ptr->part_ptr_list);
 		while ((part_ptr = (struct part_record *)
 				   list_next(part_iterator))) {
-			if (!(part_ptr->flags & PART_FLAG_HIDDEN)) {
+			if (!part_is_hidden(part_ptr, hidden)) {
 				rc = false;
 				break;
 			}
@@ -8387,8 +8860,7 @@ static bool _all_parts_hidden(struct job_record *job_ptr)
 		return rc;
 	}
 
-	if ((job_ptr->part_ptr) &&
-	    (job_ptr->part_ptr->flags & PART_FLAG_HIDDEN))
+	if (job_ptr->part_ptr && part_is_hidden(job_ptr->part_ptr, hidden))
 		return true;
 	return false;
 }
@@ -8431,6 +8903,7 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 {
 	ListIterator job_iterator;
 	struct job_record *job_ptr;
+	struct part_record **hidden = NULL;
 	uint32_t jobs_packed = 0, tmp_offset;
 	Buf buffer;
 
@@ -8445,13 +8918,13 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 	pack_time(time(NULL), buffer);
 
 	/* write individual job records */
-	part_filter_set(uid);
+	if (((show_flags & SHOW_ALL) == 0) && (uid != 0))
+		hidden = part_hidden_build(uid);
 	job_iterator = list_iterator_create(job_list);
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		xassert (job_ptr->magic == JOB_MAGIC);
 
-		if (((show_flags & SHOW_ALL) == 0) && (uid != 0) &&
-		    _all_parts_hidden(job_ptr))
+		if (_all_parts_hidden(job_ptr, hidden))
 			continue;
 
 		if (_hide_job(job_ptr, uid, show_flags))
@@ -8464,7 +8937,7 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 		jobs_packed++;
 	}
 	list_iterator_destroy(job_iterator);
-	part_filter_clear();
+	xfree(hidden);
 
 	/* put the real record count in the message body header */
 	tmp_offset = get_buf_offset(buffer);
@@ -8476,6 +8949,560 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 	buffer_ptr[0] = xfer_buf_data(buffer);
 }
 
+static void _job_info_cache_unref(job_info_cache_t *cache_ptr)
+{
+	if (--cache_ptr->ref_cnt > 0)
+		return;
+	xfree(cache_ptr->buffer);
+	xfree(cache_ptr->job_id);
+	xfree(cache_ptr->offset);
+	xfree(cache_ptr->hash);
+	xfree(cache_ptr);
+}
+
+/* 64-bit FNV-1a hash of a packed job record */
+static uint64_t _job_info_hash(char *data, uint32_t size)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	uint32_t i;
+
+	for (i = 0; i < size; i++) {
+		hash ^= (uint8_t) data[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static int _job_info_gen_rec_cmp(const void *x, const void *y)
+{
+	const job_info_gen_rec_t *rec1 = x, *rec2 = y;
+
+	if (rec1->job_id < rec2->job_id)
+		return -1;
+	if (rec1->job_id > rec2->job_id)
+		return 1;
+	return 0;
+}
+
+/* Merge the record hashes of a new snapshot into the generation table of
+ * its show_flags and protocol_version, noting the records which changed.
+ * A table of other show_flags or protocol_version is replaced if none
+ * match, the one least recently updated first. A partition or
+ * configuration change resets the table, since record visibility may
+ * change with them. Caller holds job_info_cache_mutex. */
+static void _job_info_gen_add(job_info_cache_t *cache_ptr)
+{
+	job_info_gen_t *gen_ptr = NULL;
+	job_info_gen_rec_t *rec, *old_ptr;
+	uint32_t i, old_inx = 0;
+	bool reset = false;
+
+	for (i = 0; i < JOB_INFO_GEN_CNT; i++) {
+		if (job_info_gen[i].seq &&
+		    (job_info_gen[i].show_flags == cache_ptr->show_flags) &&
+		    (job_info_gen[i].protocol_version ==
+		     cache_ptr->protocol_version)) {
+			gen_ptr = &job_info_gen[i];
+			break;
+		}
+		if (job_info_gen[i].seq < job_info_gen[old_inx].seq)
+			old_inx = i;
+	}
+	if (!gen_ptr) {
+		gen_ptr = &job_info_gen[old_inx];
+		xfree(gen_ptr->rec);
+		gen_ptr->rec_cnt = 0;
+		gen_ptr->show_flags = cache_ptr->show_flags;
+		gen_ptr->protocol_version = cache_ptr->protocol_version;
+		reset = true;
+	} else if ((gen_ptr->part_update != cache_ptr->part_update) ||
+		   (gen_ptr->conf_update != slurmctld_conf.last_update)) {
+		reset = true;
+	}
+	if (reset) {
+		gen_ptr->reset_seq = cache_ptr->seq;
+		gen_ptr->reset_time = cache_ptr->pack_time;
+	}
+
+	rec = xmalloc(sizeof(job_info_gen_rec_t) * (cache_ptr->job_cnt + 1));
+	for (i = 0; i < cache_ptr->job_cnt; i++) {
+		rec[i].job_id = cache_ptr->job_id[i];
+		rec[i].hash   = cache_ptr->hash[i];
+	}
+	qsort(rec, cache_ptr->job_cnt, sizeof(job_info_gen_rec_t),
+	      _job_info_gen_rec_cmp);
+
+	/* Both record arrays are sorted by job_id */
+	old_ptr = gen_ptr->rec;
+	for (i = 0; i < cache_ptr->job_cnt; i++) {
+		while ((old_ptr < gen_ptr->rec + gen_ptr->rec_cnt) &&
+		       (old_ptr->job_id < rec[i].job_id))
+			old_ptr++;
+		if (!reset && (old_ptr < gen_ptr->rec + gen_ptr->rec_cnt) &&
+		    (old_ptr->job_id == rec[i].job_id) &&
+		    (old_ptr->hash == rec[i].hash))
+			rec[i].change_seq = old_ptr->change_seq;
+		else
+			rec[i].change_seq = cache_ptr->seq;
+	}
+
+	xfree(gen_ptr->rec);
+	gen_ptr->rec = rec;
+	gen_ptr->rec_cnt = cache_ptr->job_cnt;
+	gen_ptr->seq = cache_ptr->seq;
+	gen_ptr->part_update = cache_ptr->part_update;
+	gen_ptr->conf_update = slurmctld_conf.last_update;
+}
+
+/* Pack every job record into a new snapshot, recording where each record
+ * starts so that per-user views can be copied out without repacking.
+ * Jobs hidden only by SHOW_FED_TRACK are left out since show_flags is part
+ * of the snapshot key. */
+static job_info_cache_t *_job_info_cache_build(uint16_t show_flags,
+					       uint16_t protocol_version)
+{
+	job_info_cache_t *cache_ptr;
+	ListIterator job_iterator;
+	struct job_record *job_ptr;
+	uint32_t i, job_max, tmp_offset;
+	Buf buffer;
+
+	cache_ptr = xmalloc(sizeof(job_info_cache_t));
+	cache_ptr->pack_time = time(NULL);
+	cache_ptr->job_update = last_job_update;
+	cache_ptr->part_update = last_part_update;
+	cache_ptr->show_flags = show_flags;
+	cache_ptr->protocol_version = protocol_version;
+	cache_ptr->ref_cnt = 1;
+	if (++job_info_seq == 0)
+		job_info_seq = 1;
+	cache_ptr->seq = job_info_seq;
+
+	job_max = list_count(job_list);
+	cache_ptr->job_id = xmalloc(sizeof(uint32_t) * (job_max + 1));
+	cache_ptr->offset = xmalloc(sizeof(uint32_t) * (job_max + 1));
+	cache_ptr->hash   = xmalloc(sizeof(uint64_t) * (job_max + 1));
+
+	buffer = init_buf(BUF_SIZE);
+	pack32(0, buffer);
+	pack_time(cache_ptr->pack_time, buffer);
+
+	job_iterator = list_iterator_create(job_list);
+	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
+		xassert (job_ptr->magic == JOB_MAGIC);
+
+		if (!(show_flags & SHOW_FED_TRACK) && job_ptr->fed_details &&
+		    fed_mgr_is_tracker_only_job(job_ptr))
+			continue;
+		if (cache_ptr->job_cnt >= job_max)
+			break;	/* Should never happen under job read lock */
+
+		cache_ptr->job_id[cache_ptr->job_cnt] = job_ptr->job_id;
+		cache_ptr->offset[cache_ptr->job_cnt] = get_buf_offset(buffer);
+		pack_job(job_ptr, show_flags, buffer, protocol_version, 0);
+		cache_ptr->job_cnt++;
+	}
+	list_iterator_destroy(job_iterator);
+	cache_ptr->offset[cache_ptr->job_cnt] = get_buf_offset(buffer);
+
+	tmp_offset = get_buf_offset(buffer);
+	set_buf_offset(buffer, 0);
+	pack32(cache_ptr->job_cnt, buffer);
+	set_buf_offset(buffer, tmp_offset);
+
+	cache_ptr->buffer_size = get_buf_offset(buffer);
+	cache_ptr->buffer = xfer_buf_data(buffer);
+
+	for (i = 0; i < cache_ptr->job_cnt; i++) {
+		cache_ptr->hash[i] = _job_info_hash(
+			cache_ptr->buffer + cache_ptr->offset[i],
+			cache_ptr->offset[i + 1] - cache_ptr->offset[i]);
+	}
+	_job_info_gen_add(cache_ptr);
+
+	return cache_ptr;
+}
+
+/* Find a current snapshot matching the request or build a new one.
+ * RET snapshot with a reference held for the caller */
+static job_info_cache_t *_job_info_cache_get(uint16_t show_flags,
+					     uint16_t protocol_version)
+{
+	job_info_cache_t *cache_ptr = NULL;
+	time_t now = time(NULL);
+	int i, free_inx = -1, old_inx = 0;
+
+	slurm_mutex_lock(&job_info_cache_mutex);
+	for (i = 0; i < JOB_INFO_CACHE_SIZE; i++) {
+		if (!job_info_cache[i]) {
+			if (free_inx == -1)
+				free_inx = i;
+			continue;
+		}
+		/* Any change to jobs or partitions or a new second (some
+		 * fields are packed relative to the current time) makes
+		 * the snapshot stale */
+		if ((job_info_cache[i]->pack_time != now) ||
+		    (job_info_cache[i]->job_update != last_job_update) ||
+		    (job_info_cache[i]->part_update != last_part_update)) {
+			_job_info_cache_unref(job_info_cache[i]);
+			job_info_cache[i] = NULL;
+			if (free_inx == -1)
+				free_inx = i;
+			continue;
+		}
+		if ((job_info_cache[i]->show_flags == show_flags) &&
+		    (job_info_cache[i]->protocol_version == protocol_version)) {
+			cache_ptr = job_info_cache[i];
+			break;
+		}
+		if (job_info_cache[i]->pack_time <
+		    job_info_cache[old_inx]->pack_time)
+			old_inx = i;
+	}
+
+	if (cache_ptr) {
+		slurmctld_diag_stats.job_info_cache_hits++;
+	} else {
+		/* Build while holding the mutex so concurrent requests for
+		 * the same data wait for this snapshot instead of each
+		 * packing their own copy */
+		slurmctld_diag_stats.job_info_cache_misses++;
+		cache_ptr = _job_info_cache_build(show_flags,
+						  protocol_version);
+		if (free_inx == -1) {
+			free_inx = old_inx;
+			_job_info_cache_unref(job_info_cache[free_inx]);
+		}
+		job_info_cache[free_inx] = cache_ptr;
+	}
+	cache_ptr->ref_cnt++;
+	slurm_mutex_unlock(&job_info_cache_mutex);
+
+	return cache_ptr;
+}
+
+static void _job_info_cache_release(job_info_cache_t *cache_ptr)
+{
+	slurm_mutex_lock(&job_info_cache_mutex);
+	_job_info_cache_unref(cache_ptr);
+	slurm_mutex_unlock(&job_info_cache_mutex);
+}
+
+/* Determine which snapshot records are visible to a user.
+ * IN cache_ptr - snapshot built from the current job_list
+ * IN show_flags, uid, filter_uid - as for pack_all_jobs()
+ * OUT visible - set for each visible record, array of cache_ptr->job_cnt
+ * RET number of visible records or -1 if the job list no longer matches
+ *	the snapshot */
+static int _job_info_cache_visible(job_info_cache_t *cache_ptr,
+				   uint16_t show_flags, uid_t uid,
+				   uint32_t filter_uid, bool *visible)
+{
+	ListIterator job_iterator;
+	struct job_record *job_ptr;
+	struct part_record **hidden = NULL;
+	uint32_t i = 0;
+	int visible_cnt = 0;
+
+	if (((show_flags & SHOW_ALL) == 0) && (uid != 0))
+		hidden = part_hidden_build(uid);
+	job_iterator = list_iterator_create(job_list);
+	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
+		if (!(show_flags & SHOW_FED_TRACK) && job_ptr->fed_details &&
+		    fed_mgr_is_tracker_only_job(job_ptr))
+			continue;	/* Not in snapshot */
+		if ((i >= cache_ptr->job_cnt) ||
+		    (cache_ptr->job_id[i] != job_ptr->job_id)) {
+			visible_cnt = -1;
+			break;
+		}
+		if (_hide_job(job_ptr, uid, show_flags) ||
+		    _all_parts_hidden(job_ptr, hidden) ||
+		    ((filter_uid != NO_VAL) &&
+		     (filter_uid != job_ptr->user_id))) {
+			visible[i++] = false;
+		} else {
+			visible[i++] = true;
+			visible_cnt++;
+		}
+	}
+	list_iterator_destroy(job_iterator);
+	xfree(hidden);
+
+	if (i != cache_ptr->job_cnt) {
+		/* Job list was modified without updating last_job_update */
+		error("%s: job list does not match snapshot", __func__);
+		visible_cnt = -1;
+	}
+
+	return visible_cnt;
+}
+
+/* Copy the selected snapshot records into buffer, with adjacent records
+ * copied together.
+ * RET number of records copied */
+static uint32_t _job_info_cache_copy(job_info_cache_t *cache_ptr,
+				     bool *select, Buf buffer)
+{
+	uint32_t i, rec_cnt = 0, run_start = 0, run_end = 0;
+
+	for (i = 0; i < cache_ptr->job_cnt; i++) {
+		if (!select[i])
+			continue;
+		if (cache_ptr->offset[i] != run_end) {
+			if (run_end > run_start) {
+				packmem_array(cache_ptr->buffer + run_start,
+					      run_end - run_start, buffer);
+			}
+			run_start = cache_ptr->offset[i];
+		}
+		run_end = cache_ptr->offset[i + 1];
+		rec_cnt++;
+	}
+	if (run_end > run_start) {
+		packmem_array(cache_ptr->buffer + run_start,
+			      run_end - run_start, buffer);
+	}
+
+	return rec_cnt;
+}
+
+/*
+ * pack_all_jobs_cached - equivalent to pack_all_jobs(), but the job records
+ *	are packed once into a snapshot shared by all requests for the same
+ *	show_flags and protocol_version until job or partition records change.
+ *	Each user's view is built from the snapshot by copying the records
+ *	visible to that user, or by referencing the snapshot itself if every
+ *	record is visible.
+ * OUT buffer_ptr - the pointer is set to the response buffer
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN show_flags - job filtering options
+ * IN uid - uid of user making request (for partition filtering)
+ * IN filter_uid - pack only jobs belonging to this user if not NO_VAL
+ * IN protocol_version - slurm protocol version of client
+ * OUT cache_ref - reference to the snapshot used, if any
+ * NOTE: the buffer must be released with pack_all_jobs_free()
+ * NOTE: READ lock_slurmctld config, job and partition before entry
+ */
+extern void pack_all_jobs_cached(char **buffer_ptr, int *buffer_size,
+				 uint16_t show_flags, uid_t uid,
+				 uint32_t filter_uid, uint16_t protocol_version,
+				 void **cache_ref)
+{
+	job_info_cache_t *cache_ptr;
+	uint32_t jobs_packed, tmp_offset;
+	bool *visible;
+	int visible_cnt;
+	Buf buffer;
+
+	*cache_ref = NULL;
+
+	/* The batch script is only packed for its owner or an operator */
+	if (show_flags & SHOW_DETAIL2) {
+		pack_all_jobs(buffer_ptr, buffer_size, show_flags, uid,
+			      filter_uid, protocol_version);
+		return;
+	}
+
+	cache_ptr = _job_info_cache_get(show_flags, protocol_version);
+	visible = xmalloc(sizeof(bool) * (cache_ptr->job_cnt + 1));
+	visible_cnt = _job_info_cache_visible(cache_ptr, show_flags, uid,
+					      filter_uid, visible);
+	if (visible_cnt < 0) {
+		xfree(visible);
+		_job_info_cache_release(cache_ptr);
+		pack_all_jobs(buffer_ptr, buffer_size, show_flags, uid,
+			      filter_uid, protocol_version);
+		return;
+	}
+
+	if (visible_cnt == cache_ptr->job_cnt) {
+		/* Every record is visible, share the snapshot */
+		xfree(visible);
+		*buffer_ptr = cache_ptr->buffer;
+		*buffer_size = cache_ptr->buffer_size;
+		*cache_ref = cache_ptr;
+		return;
+	}
+
+	buffer = init_buf(BUF_SIZE);
+	pack32(0, buffer);
+	pack_time(cache_ptr->pack_time, buffer);
+	jobs_packed = _job_info_cache_copy(cache_ptr, visible, buffer);
+	xfree(visible);
+	_job_info_cache_release(cache_ptr);
+
+	tmp_offset = get_buf_offset(buffer);
+	set_buf_offset(buffer, 0);
+	pack32(jobs_packed, buffer);
+	set_buf_offset(buffer, tmp_offset);
+
+	*buffer_size = get_buf_offset(buffer);
+	*buffer_ptr = xfer_buf_data(buffer);
+}
+
+/*
+ * pack_all_jobs_free - release a buffer from pack_all_jobs_cached()
+ * IN buffer - response buffer
+ * IN cache_ref - snapshot reference from pack_all_jobs_cached()
+ */
+extern void pack_all_jobs_free(char *buffer, void *cache_ref)
+{
+	if (!cache_ref) {
+		xfree(buffer);
+		return;
+	}
+
+	_job_info_cache_release((job_info_cache_t *) cache_ref);
+}
+
+static int _job_id_cmp(const void *x, const void *y)
+{
+	uint32_t id1 = *(uint32_t *) x, id2 = *(uint32_t *) y;
+
+	if (id1 < id2)
+		return -1;
+	if (id1 > id2)
+		return 1;
+	return 0;
+}
+
+/*
+ * pack_all_jobs_delta - dump the job records which changed since a previous
+ *	response in machine independent form (for network transmission).
+ *	Changes are found from the generation in which each record last
+ *	changed. Only jobs the client holds are reported as removed. If the
+ *	client's generation can not be compared, all visible records are
+ *	packed and the response is flagged as complete.
+ * OUT buffer_ptr - the pointer is set to the allocated buffer.
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN req_ptr - generation and job IDs held by the client, show_flags
+ * IN uid - uid of user making request (for partition filtering)
+ * IN protocol_version - slurm protocol version of client
+ * NOTE: the buffer at *buffer_ptr must be xfreed by the caller
+ * NOTE: READ lock_slurmctld config, job and partition before entry
+ * NOTE: change _unpack_job_info_delta_msg() in common/slurm_protocol_pack.c
+ *	whenever the data format changes
+ */
+extern void pack_all_jobs_delta(char **buffer_ptr, int *buffer_size,
+				job_info_delta_request_msg_t *req_ptr,
+				uid_t uid, uint16_t protocol_version)
+{
+	job_info_cache_t *cache_ptr;
+	job_info_gen_t *gen_ptr = NULL;
+	job_info_gen_rec_t key, *rec_ptr;
+	uint32_t i, jobs_packed, removed_cnt = 0, tmp_offset;
+	uint32_t *held = NULL, *held_ptr, *removed = NULL;
+	uint32_t delta_seq = req_ptr->delta_seq;
+	uint16_t show_flags = req_ptr->show_flags;
+	bool *select, *found = NULL;
+	char *full_buffer = NULL;
+	int full_size = 0, visible_cnt;
+	Buf buffer;
+
+	buffer_ptr[0] = NULL;
+	*buffer_size = 0;
+
+	show_flags &= (~SHOW_DETAIL2);	/* Batch scripts are never sent */
+	cache_ptr = _job_info_cache_get(show_flags, protocol_version);
+	select = xmalloc(sizeof(bool) * (cache_ptr->job_cnt + 1));
+	visible_cnt = _job_info_cache_visible(cache_ptr, show_flags, uid,
+					      NO_VAL, select);
+	if (visible_cnt < 0) {
+		/* Send every job, packed directly from the job list */
+		xfree(select);
+		_job_info_cache_release(cache_ptr);
+		pack_all_jobs(&full_buffer, &full_size, show_flags, uid,
+			      NO_VAL, protocol_version);
+		buffer = init_buf(full_size + 64);
+		pack32(0, buffer);
+		pack16(JOB_INFO_DELTA_COMPLETE, buffer);
+		pack32_array(NULL, 0, buffer);
+		packmem_array(full_buffer, full_size, buffer);
+		xfree(full_buffer);
+		*buffer_size = get_buf_offset(buffer);
+		buffer_ptr[0] = xfer_buf_data(buffer);
+		return;
+	}
+
+	slurm_mutex_lock(&job_info_cache_mutex);
+	for (i = 0; delta_seq && (i < JOB_INFO_GEN_CNT); i++) {
+		if (job_info_gen[i].seq &&
+		    (job_info_gen[i].show_flags == show_flags) &&
+		    (job_info_gen[i].protocol_version == protocol_version)) {
+			gen_ptr = &job_info_gen[i];
+			break;
+		}
+	}
+	/* The client's generation must be from this slurmctld, no older than
+	 * the last partition or configuration change */
+	if (gen_ptr &&
+	    ((delta_seq < gen_ptr->reset_seq) ||
+	     (delta_seq > cache_ptr->seq) ||
+	     (req_ptr->last_update < gen_ptr->reset_time) ||
+	     (gen_ptr->part_update != cache_ptr->part_update) ||
+	     (gen_ptr->conf_update != slurmctld_conf.last_update)))
+		gen_ptr = NULL;
+	if (gen_ptr) {
+		/* Send visible records which are new to the client or changed
+		 * since its generation. Jobs held by the client which are
+		 * gone or no longer visible are sent as removed. */
+		held = xmalloc(sizeof(uint32_t) * (req_ptr->job_id_cnt + 1));
+		memcpy(held, req_ptr->job_id,
+		       sizeof(uint32_t) * req_ptr->job_id_cnt);
+		qsort(held, req_ptr->job_id_cnt, sizeof(uint32_t),
+		      _job_id_cmp);
+		found = xmalloc(sizeof(bool) * (req_ptr->job_id_cnt + 1));
+		for (i = 0; i < cache_ptr->job_cnt; i++) {
+			if (!select[i])
+				continue;
+			held_ptr = bsearch(&cache_ptr->job_id[i], held,
+					   req_ptr->job_id_cnt,
+					   sizeof(uint32_t), _job_id_cmp);
+			if (!held_ptr)
+				continue;
+			found[held_ptr - held] = true;
+			key.job_id = cache_ptr->job_id[i];
+			rec_ptr = bsearch(&key, gen_ptr->rec, gen_ptr->rec_cnt,
+					  sizeof(job_info_gen_rec_t),
+					  _job_info_gen_rec_cmp);
+			if (rec_ptr && (rec_ptr->change_seq <= delta_seq))
+				select[i] = false;
+		}
+		removed = xmalloc(sizeof(uint32_t) *
+				  (req_ptr->job_id_cnt + 1));
+		for (i = 0; i < req_ptr->job_id_cnt; i++) {
+			if (!found[i])
+				removed[removed_cnt++] = held[i];
+		}
+		xfree(found);
+		xfree(held);
+	}
+	slurm_mutex_unlock(&job_info_cache_mutex);
+
+	buffer = init_buf(BUF_SIZE);
+	pack32(cache_ptr->seq, buffer);
+	pack16(gen_ptr ? 0 : JOB_INFO_DELTA_COMPLETE, buffer);
+	pack32_array(removed, removed_cnt, buffer);
+	xfree(removed);
+
+	tmp_offset = get_buf_offset(buffer);
+	pack32(0, buffer);
+	pack_time(cache_ptr->pack_time, buffer);
+	jobs_packed = _job_info_cache_copy(cache_ptr, select, buffer);
+	xfree(select);
+	_job_info_cache_release(cache_ptr);
+
+	i = get_buf_offset(buffer);
+	set_buf_offset(buffer, tmp_offset);
+	pack32(jobs_packed, buffer);
+	set_buf_offset(buffer, i);
+
+	*buffer_size = get_buf_offset(buffer);
+	buffer_ptr[0] = xfer_buf_data(buffer);
+}
+
 /*
  * pack_one_job - dump information for one jobs in
  *	machine independent form (for network transmission)
@@ -8527,7 +9554,7 @@ extern int pack_one_job(char **buffer_ptr, int *buffer_size,
 			}
 		}
 
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
+		job_ptr = _job_array_first(job_id);
 		while (job_ptr) {
 			if ((job_ptr->job_id == job_id) && packed_head) {
 				;	/* Already packed */
@@ -9960,6 +10987,7 @@ extern void set_job_prio(struct job_record *job_ptr)
 		return;
 	job_ptr->priority = slurm_sched_g_initial_priority(lowest_prio,
 							   job_ptr);
+	prio_queue_update_job(job_ptr);
 	if ((job_ptr->priority == 0) || (job_ptr->direct_set_prio))
 		return;
 
@@ -12041,6 +13069,8 @@ fini:
 	if ((error_code == SLURM_SUCCESS) && (job_ptr->priority != 0) &&
 	    xstrcmp(slurmctld_conf.priority_type, "priority/basic"))
 		set_job_prio(job_ptr);
+	/* Priority, partitions, reservation or hold may have changed */
+	prio_queue_update_job(job_ptr);
 
 	return error_code;
 }
@@ -12140,7 +13170,7 @@ extern int update_job_str(slurm_msg_t *msg, uid_t uid)
 		}
 
 		/* Update all tasks of this job array */
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
+		job_ptr = _job_array_first(job_id);
 		if (!job_ptr && !job_ptr_done) {
 			info("update_job_str: invalid job id %u", job_id);
 			rc = ESLURM_INVALID_JOB_ID;
@@ -12198,10 +13228,8 @@ extern int update_job_str(slurm_msg_t *msg, uid_t uid)
 			/* Update the record with all pending tasks */
 			rc2 = _update_job(job_ptr, job_specs, uid);
 			_resp_array_add(&resp_array, job_ptr, rc2);
-			bit_not(job_ptr->array_recs->task_id_bitmap);
-			bit_and(array_bitmap,
-				job_ptr->array_recs->task_id_bitmap);
-			bit_not(job_ptr->array_recs->task_id_bitmap);
+			bit_and_not(array_bitmap,
+				    job_ptr->array_recs->task_id_bitmap);
 		} else {
 			/* Need to split out tasks to separate job records */
 			tmp_bitmap = bit_copy(job_ptr->array_recs->
@@ -12981,7 +14009,7 @@ static void _validate_job_files(List batch_dirs)
 		}
 		if (job_ptr && job_ptr->array_recs) { /* Update all tasks */
 			array_job_id = job_ptr->array_job_id;
-			job_ptr = job_array_hash_j[JOB_HASH_INX(array_job_id)];
+			job_ptr = _job_array_first(array_job_id);
 			while (job_ptr) {
 				if (job_ptr->array_job_id == array_job_id)
 					job_ptr->bit_flags |= HAS_STATE_DIR;
@@ -13293,10 +14321,33 @@ void batch_requeue_fini(struct job_record  *job_ptr)
 /* job_fini - free all memory associated with job records */
 void job_fini (void)
 {
+	int i;
+
+	slurm_mutex_lock(&job_info_cache_mutex);
+	for (i = 0; i < JOB_INFO_CACHE_SIZE; i++) {
+		if (job_info_cache[i]) {
+			_job_info_cache_unref(job_info_cache[i]);
+			job_info_cache[i] = NULL;
+		}
+	}
+	for (i = 0; i < JOB_INFO_GEN_CNT; i++) {
+		xfree(job_info_gen[i].rec);
+		job_info_gen[i].rec_cnt = 0;
+		job_info_gen[i].seq = 0;
+	}
+	slurm_mutex_unlock(&job_info_cache_mutex);
+
+	xfree(job_state_rec);
+	job_state_rec_cnt = 0;
+
 	FREE_NULL_LIST(job_list);
-	xfree(job_hash);
-	xfree(job_array_hash_j);
-	xfree(job_array_hash_t);
+	prio_queue_fini();
+	id_hash_free(job_hash);
+	job_hash = NULL;
+	id_hash_free(job_array_hash);
+	job_array_hash = NULL;
+	id_hash_free(job_array_task_hash);
+	job_array_task_hash = NULL;
 	FREE_NULL_BITMAP(requeue_exit);
 	FREE_NULL_BITMAP(requeue_exit_hold);
 }
@@ -13380,6 +14431,7 @@ extern void job_completion_logger(struct job_record *job_ptr, bool requeue)
 
 	xassert(job_ptr);
 
+	prio_queue_update_job(job_ptr);
 	acct_policy_remove_job_submit(job_ptr);
 	if (job_ptr->nodes) {
 		(void) bb_g_job_start_stage_out(job_ptr);
@@ -14135,7 +15187,7 @@ extern int job_suspend2(suspend_msg_t *sus_ptr, uid_t uid,
 		}
 
 		/* Suspend all tasks of this job array */
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
+		job_ptr = _job_array_first(job_id);
 		if (!job_ptr && !job_ptr_done) {
 			rc = ESLURM_INVALID_JOB_ID;
 			goto reply;
@@ -14375,6 +15427,7 @@ reply:
 				= xstrdup("job requeued in held state");
 		job_ptr->priority = 0;
 	}
+	prio_queue_update_job(job_ptr);
 
 	debug("%s: job %u state 0x%x reason %u priority %d", __func__,
 	      job_ptr->job_id, job_ptr->job_state,
@@ -14478,7 +15531,7 @@ extern int job_requeue2(uid_t uid, requeue_msg_t *req_ptr, slurm_msg_t *msg,
 		}
 
 		/* Requeue all tasks of this job array */
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
+		job_ptr = _job_array_first(job_id);
 		if (!job_ptr && !job_ptr_done) {
 			rc = ESLURM_INVALID_JOB_ID;
 			goto reply;
@@ -15679,6 +16732,7 @@ extern void build_cg_bitmap(struct job_record *job_ptr)
 		job_ptr->node_bitmap_cg = bit_alloc(node_record_count);
 		job_ptr->job_state &= (~JOB_COMPLETING);
 	}
+	prio_queue_update_job(job_ptr);
 }
 
 /* job_hold_requeue()
@@ -15743,6 +16797,7 @@ extern void job_hold_requeue(struct job_record *job_ptr)
 	}
 
 	job_ptr->job_state &= ~JOB_REQUEUE;
+	prio_queue_update_job(job_ptr);
 
 	debug("%s: job %u state 0x%x reason %u priority %d", __func__,
 	      job_ptr->job_id, job_ptr->job_state,
@@ -83,6 +83,7 @@
 #include "src/slurmctld/node_scheduler.h"
 #include "src/slurmctld/power_save.h"
 #include "src/slurmctld/preempt.h"
+#include "src/slurmctld/prio_queue.h"
 #include "src/slurmctld/proc_req.h"
 #include "src/slurmctld/reservation.h"
 #include "src/slurmctld/sched_plugin.h"
@@ -115,11 +116,13 @@ static bool	_job_runnable_test1(struct job_record *job_ptr,
 				    bool clear_start);
 static bool	_job_runnable_test2(struct job_record *job_ptr,
 				    bool check_min_time);
+static job_queue_rec_t *_prio_queue_next(prio_queue_iter_t iter);
 static void *	_run_epilog(void *arg);
 static void *	_run_prolog(void *arg);
 static bool	_scan_depend(List dependency_list, uint32_t job_id);
 static void *	_sched_agent(void *args);
 static int	_schedule(uint32_t job_limit);
+static void	_split_job_arrays(void);
 static int	_valid_feature_list(struct job_record *job_ptr,
 				    List feature_list);
 static int	_valid_node_feature(char *feature, bool can_reboot);
@@ -386,31 +389,16 @@ static int _delta_tv(struct timeval *tv)
 	delta_t += (now.tv_usec - tv->tv_usec);
 	return delta_t;
 }
-/*
- * build_job_queue - build (non-priority ordered) list of pending jobs
- * IN clear_start - if set then clear the start_time for pending jobs,
- *		    true when called from sched/backfill or sched/builtin
- * IN backfill - true if running backfill scheduler, enforce min time limit
- * RET the job queue
- * NOTE: the caller must call FREE_NULL_LIST() on RET value to free memory
- */
-extern List build_job_queue(bool clear_start, bool backfill)
+
+/* Create individual job records for pending job array tasks which need
+ * burst buffer staging or have a SLURM_DEPEND_AFTER_CORRESPOND dependency */
+static void _split_job_arrays(void)
 {
-	static time_t last_log_time = 0;
-	List job_queue;
-	ListIterator depend_iter, job_iterator, part_iterator;
+	ListIterator depend_iter, job_iterator;
 	struct job_record *job_ptr = NULL, *new_job_ptr;
-	struct part_record *part_ptr;
 	struct depend_spec *dep_ptr;
-	int i, pend_cnt, reason, dep_corr;
-	struct timeval start_tv = {0, 0};
-	int tested_jobs = 0;
+	int i, pend_cnt, dep_corr;
 	char jobid_buf[32];
-	int job_part_pairs = 0;
-	time_t now = time(NULL);
-
-	(void) _delta_tv(&start_tv);
-	job_queue = list_create(_job_queue_rec_del);
 
 	/* Create individual job records for job arrays that need burst buffer
 	 * staging */
@@ -501,6 +489,33 @@ extern List build_job_queue(bool clear_start, bool backfill)
 		}
 	}
 	list_iterator_destroy(job_iterator);
+}
+
+/*
+ * build_job_queue - build (non-priority ordered) list of pending jobs
+ * IN clear_start - if set then clear the start_time for pending jobs,
+ *		    true when called from sched/backfill or sched/builtin
+ * IN backfill - true if running backfill scheduler, enforce min time limit
+ * RET the job queue
+ * NOTE: the caller must call FREE_NULL_LIST() on RET value to free memory
+ */
+extern List build_job_queue(bool clear_start, bool backfill)
+{
+	static time_t last_log_time = 0;
+	List job_queue;
+	ListIterator job_iterator, part_iterator;
+	struct job_record *job_ptr = NULL;
+	struct part_record *part_ptr;
+	int reason;
+	struct timeval start_tv = {0, 0};
+	int tested_jobs = 0;
+	int job_part_pairs = 0;
+	time_t now = time(NULL);
+
+	(void) _delta_tv(&start_tv);
+	job_queue = list_create(_job_queue_rec_del);
+
+	_split_job_arrays();
 
 	job_iterator = list_iterator_create(job_list);
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
@@ -582,6 +597,49 @@ extern List build_job_queue(bool clear_start, bool backfill)
 	return job_queue;
 }
 
+/*
+ * _prio_queue_next - Return the next pending job/partition pair from the
+ *	persistent priority queue which passes the tests applied by
+ *	build_job_queue(). Only the jobs visited are tested.
+ * IN iter - iterator from prio_queue_iter_create()
+ * RET job queue record or NULL if none remain, the caller must xfree() it
+ */
+static job_queue_rec_t *_prio_queue_next(prio_queue_iter_t iter)
+{
+	job_queue_rec_t job_queue_rec, *job_queue_rec_ptr;
+	struct job_record *job_ptr;
+	int reason;
+	time_t now = time(NULL);
+
+	while (prio_queue_iter_next(iter, &job_queue_rec)) {
+		job_ptr = job_queue_rec.job_ptr;
+		if (job_ptr->state_reason != WAIT_NO_REASON)
+			job_ptr->state_reason_prev = job_ptr->state_reason;
+		if (!_job_runnable_test1(job_ptr, false))
+			continue;
+		job_ptr->part_ptr = job_queue_rec.part_ptr;
+		if (job_ptr->part_ptr_list) {
+			reason = job_limits_check(&job_ptr, false);
+			if ((reason != WAIT_NO_REASON) &&
+			    (reason != job_ptr->state_reason)) {
+				job_ptr->state_reason = reason;
+				xfree(job_ptr->state_desc);
+				last_job_update = now;
+			}
+			if (reason != WAIT_NO_REASON)
+				continue;
+		} else if (!_job_runnable_test2(job_ptr, false)) {
+			continue;
+		}
+		job_queue_rec_ptr = xmalloc(sizeof(job_queue_rec_t));
+		memcpy(job_queue_rec_ptr, &job_queue_rec,
+		       sizeof(job_queue_rec_t));
+		return job_queue_rec_ptr;
+	}
+
+	return NULL;
+}
+
 /*
  * job_is_completing - Determine if jobs are in the process of completing.
  * RET - True of any job is in the process of completing AND
@@ -857,8 +915,8 @@ next_part:		part_ptr = (struct part_record *)
 			continue;
 		}
 
-		if (bit_overlap(avail_node_bitmap,
-				job_ptr->part_ptr->node_bitmap) == 0) {
+		if (!bit_overlap_any(avail_node_bitmap,
+				     job_ptr->part_ptr->node_bitmap)) {
 			/* This node DRAIN or DOWN */
 			continue;
 		}
@@ -890,8 +948,8 @@ next_part:		part_ptr = (struct part_record *)
 		else
 			have_node_bitmaps = false;
 		if (have_node_bitmaps &&
-		    (bit_overlap(job_ptr->details->exc_node_bitmap,
-				 fini_job_ptr->job_resrcs->node_bitmap) != 0))
+		    bit_overlap_any(job_ptr->details->exc_node_bitmap,
+				    fini_job_ptr->job_resrcs->node_bitmap))
 			continue;
 
 		if (!job_ptr->batch_flag) {  /* Can't pull interactive jobs */
@@ -1173,6 +1231,7 @@ static int _schedule(uint32_t job_limit)
 {
 	ListIterator job_iterator = NULL, part_iterator = NULL;
 	List job_queue = NULL;
+	prio_queue_iter_t prio_iter = NULL;
 	int failed_part_cnt = 0, failed_resv_cnt = 0, job_cnt = 0;
 	int error_code, i, j, part_cnt, time_limit, pend_time;
 	uint32_t job_depth = 0, array_task_id;
@@ -1468,9 +1527,7 @@ static int _schedule(uint32_t job_limit)
 	bit_not(avail_node_bitmap);
 	unavail_node_str = bitmap2node_name(avail_node_bitmap);
 	bit_not(avail_node_bitmap);
-	bit_not(booting_node_bitmap);
-	bit_and(avail_node_bitmap, booting_node_bitmap);
-	bit_not(booting_node_bitmap);
+	bit_and_not(avail_node_bitmap, booting_node_bitmap);
 
 	if (max_jobs_per_part) {
 		ListIterator part_iterator;
@@ -1494,11 +1551,20 @@ static int _schedule(uint32_t job_limit)
 	 * If a job is submitted to multiple partitions then build_job_queue()
 	 * will return a separate record for each job:partition pair.
 	 *
-	 * In both cases, we test each partition associated with the job.
+	 * Unless preemption is enabled, whose plugins may reorder any pair of
+	 * jobs, the pairs are instead read in priority order from a queue kept
+	 * between passes. Only the jobs visited are tested, so the cost does
+	 * not grow with the number of pending jobs.
+	 *
+	 * In all cases, we test each partition associated with the job.
 	 */
 	if (fifo_sched) {
 		slurmctld_diag_stats.schedule_queue_len = list_count(job_list);
 		job_iterator = list_iterator_create(job_list);
+	} else if (!slurm_preemption_enabled()) {
+		_split_job_arrays();
+		prio_iter = prio_queue_iter_create();
+		slurmctld_diag_stats.schedule_queue_len = prio_queue_count();
 	} else {
 		job_queue = build_job_queue(false, false);
 		slurmctld_diag_stats.schedule_queue_len = list_count(job_queue);
@@ -1540,7 +1606,10 @@ next_part:			part_ptr = (struct part_record *)
 					continue;
 			}
 		} else {
-			job_queue_rec = list_pop(job_queue);
+			if (prio_iter)
+				job_queue_rec = _prio_queue_next(prio_iter);
+			else
+				job_queue_rec = list_pop(job_queue);
 			if (!job_queue_rec)
 				break;
 			array_task_id = job_queue_rec->array_task_id;
@@ -1843,10 +1912,8 @@ next_task:
 				       job_reason_string(job_ptr->
 							 state_reason),
 				       job_ptr->priority);
-				bit_not(job_ptr->resv_ptr->node_bitmap);
-				bit_and(avail_node_bitmap,
-					job_ptr->resv_ptr->node_bitmap);
-				bit_not(job_ptr->resv_ptr->node_bitmap);
+				bit_and_not(avail_node_bitmap,
+					    job_ptr->resv_ptr->node_bitmap);
 			} else {
 				/* The job has no reservation but requires
 				 * nodes that are currently in some reservation
@@ -1936,6 +2003,7 @@ next_task:
 			xfree(job_ptr->state_desc);
 			job_ptr->start_time = job_ptr->end_time = now;
 			job_ptr->priority = 0;
+			prio_queue_update_job(job_ptr);
 		}
 
 #ifdef HAVE_BG
@@ -1953,10 +2021,8 @@ next_task:
 			fail_by_part = false;
 			/* Do not schedule more jobs on nodes required by this
 			 * job, but don't block the entire queue/partition. */
-			bit_not(job_ptr->details->req_node_bitmap);
-			bit_and(avail_node_bitmap,
-				job_ptr->details->req_node_bitmap);
-			bit_not(job_ptr->details->req_node_bitmap);
+			bit_and_not(avail_node_bitmap,
+				    job_ptr->details->req_node_bitmap);
 		}
 #endif
 		if (fail_by_part && job_ptr->resv_name) {
@@ -1987,10 +2053,8 @@ next_task:
 		 	/* do not schedule more jobs in this partition or on
 			 * nodes in this partition */
 			failed_parts[failed_part_cnt++] = job_ptr->part_ptr;
-			bit_not(job_ptr->part_ptr->node_bitmap);
-			bit_and(avail_node_bitmap,
-				job_ptr->part_ptr->node_bitmap);
-			bit_not(job_ptr->part_ptr->node_bitmap);
+			bit_and_not(avail_node_bitmap,
+				    job_ptr->part_ptr->node_bitmap);
 		}
 
 		if ((reject_array_job_id == job_ptr->array_job_id) &&
@@ -2015,6 +2079,8 @@ next_task:
 			list_iterator_destroy(job_iterator);
 		if (part_iterator)
 			list_iterator_destroy(part_iterator);
+	} else if (prio_iter) {
+		prio_queue_iter_destroy(prio_iter);
 	} else if (job_queue) {
 		FREE_NULL_LIST(job_queue);
 	}
@@ -4246,6 +4312,7 @@ cleanup_completing(struct job_record *job_ptr)
 
 	delete_step_records(job_ptr);
 	job_ptr->job_state &= (~JOB_COMPLETING);
+	prio_queue_update_job(job_ptr);
 	job_hold_requeue(job_ptr);
 
 	slurm_sched_g_schedule();
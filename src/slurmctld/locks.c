@@ -40,18 +40,33 @@
 #include <errno.h>
 #include <pthread.h>
 #include <string.h>
+#include <sys/time.h>
 #include <sys/types.h>
 
+#include "src/common/pack.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
 
-static pthread_mutex_t locks_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t locks_cond = PTHREAD_COND_INITIALIZER;
+/* Each data type has its own mutex and condition variable so that a lock
+ * release on one entity (e.g. a node update) does not wake up every thread
+ * waiting on an unrelated entity (e.g. the job list). The counters for each
+ * data type in slurmctld_locks are only modified while holding that data
+ * type's mutex. */
+typedef struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+} lock_shard_t;
+
+static lock_shard_t lock_shards[ENTITY_COUNT];
 static pthread_mutex_t state_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 static slurmctld_lock_flags_t slurmctld_locks;
 static int kill_thread = 0;
 
+/* Lock wait time statistics, protected by each data type's shard mutex */
+static lock_stats_t lock_stats[ENTITY_COUNT][LOCK_STAT_MODES];
+
+static void _lock_stats_add(lock_stats_t *stats, struct timeval *tv_start);
 static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock);
 static void _wr_rdunlock(lock_datatype_t datatype);
 static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock);
@@ -61,8 +76,20 @@ static void _wr_wrunlock(lock_datatype_t datatype);
  *	control */
 void init_locks(void)
 {
+	static bool shards_init = false;
+	int i;
+
+	if (!shards_init) {
+		for (i = 0; i < ENTITY_COUNT; i++) {
+			slurm_mutex_init(&lock_shards[i].mutex);
+			slurm_cond_init(&lock_shards[i].cond, NULL);
+		}
+		shards_init = true;
+	}
+
 	/* just clear all semaphores */
 	memset((void *) &slurmctld_locks, 0, sizeof(slurmctld_locks));
+	memset((void *) lock_stats, 0, sizeof(lock_stats));
 }
 
 /* lock_slurmctld - Issue the required lock requests in a well defined order */
@@ -212,6 +239,38 @@ extern void unlock_slurmctld(slurmctld_lock_t lock_levels)
 		_wr_wrunlock(CONFIG_LOCK);
 }
 
+/* _lock_stats_add - Record the time spent waiting for a lock
+ * IN/OUT stats - statistics record to update, caller holds the shard mutex
+ * IN tv_start - time at which the wait began, NULL if the lock was granted
+ *	without waiting */
+static void _lock_stats_add(lock_stats_t *stats, struct timeval *tv_start)
+{
+	struct timeval tv_end;
+	uint64_t delta_t, limit;
+	int i;
+
+	stats->count++;
+	if (!tv_start) {
+		stats->wait_hist[0]++;
+		return;
+	}
+
+	gettimeofday(&tv_end, NULL);
+	delta_t  = (tv_end.tv_sec - tv_start->tv_sec) * 1000000;
+	delta_t += tv_end.tv_usec;
+	delta_t -= tv_start->tv_usec;
+	stats->wait_time += delta_t;
+	if (delta_t > stats->wait_max)
+		stats->wait_max = delta_t;
+
+	/* Bucket 1 is under 10 usec, each following bucket is 10x larger */
+	for (i = 1, limit = 10; i < (LOCK_STAT_HIST_SIZE - 1); i++, limit *= 10) {
+		if (delta_t < limit)
+			break;
+	}
+	stats->wait_hist[i]++;
+}
+
 /* _wr_rdlock - Issue a read lock on the specified data type
  *	Wait until there are no write locks AND
  *	no pending write locks (write_wait_lock == 0)
@@ -220,43 +279,55 @@ extern void unlock_slurmctld(slurmctld_lock_t lock_levels)
  *	read locks. */
 static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock)
 {
+	lock_shard_t *shard = &lock_shards[datatype];
+	struct timeval tv_start, *tv_wait = NULL;
 	bool success = true;
 
-	slurm_mutex_lock(&locks_mutex);
+	slurm_mutex_lock(&shard->mutex);
 	while (1) {
 		if ((slurmctld_locks.entity[write_lock(datatype)] == 0) &&
 		    (slurmctld_locks.entity[write_wait_lock(datatype)] == 0)) {
 			slurmctld_locks.entity[read_lock(datatype)]++;
 			slurmctld_locks.entity[write_cnt_lock(datatype)] = 0;
+			_lock_stats_add(&lock_stats[datatype][LOCK_STAT_READ],
+					tv_wait);
 			break;
 		} else if (!wait_lock) {
 			success = false;
 			break;
 		} else {	/* wait for state change and retry */
-			slurm_cond_wait(&locks_cond, &locks_mutex);
+			if (!tv_wait) {
+				gettimeofday(&tv_start, NULL);
+				tv_wait = &tv_start;
+			}
+			slurm_cond_wait(&shard->cond, &shard->mutex);
 			if (kill_thread)
 				pthread_exit(NULL);
 		}
 	}
-	slurm_mutex_unlock(&locks_mutex);
+	slurm_mutex_unlock(&shard->mutex);
 	return success;
 }
 
 /* _wr_rdunlock - Issue a read unlock on the specified data type */
 static void _wr_rdunlock(lock_datatype_t datatype)
 {
-	slurm_mutex_lock(&locks_mutex);
+	lock_shard_t *shard = &lock_shards[datatype];
+
+	slurm_mutex_lock(&shard->mutex);
 	slurmctld_locks.entity[read_lock(datatype)]--;
-	slurm_cond_broadcast(&locks_cond);
-	slurm_mutex_unlock(&locks_mutex);
+	slurm_cond_broadcast(&shard->cond);
+	slurm_mutex_unlock(&shard->mutex);
 }
 
 /* _wr_wrlock - Issue a write lock on the specified data type */
 static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock)
 {
+	lock_shard_t *shard = &lock_shards[datatype];
+	struct timeval tv_start, *tv_wait = NULL;
 	bool success = true;
 
-	slurm_mutex_lock(&locks_mutex);
+	slurm_mutex_lock(&shard->mutex);
 	slurmctld_locks.entity[write_wait_lock(datatype)]++;
 
 	while (1) {
@@ -265,28 +336,36 @@ static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock)
 			slurmctld_locks.entity[write_lock(datatype)]++;
 			slurmctld_locks.entity[write_wait_lock(datatype)]--;
 			slurmctld_locks.entity[write_cnt_lock(datatype)]++;
+			_lock_stats_add(&lock_stats[datatype][LOCK_STAT_WRITE],
+					tv_wait);
 			break;
 		} else if (!wait_lock) {
 			slurmctld_locks.entity[write_wait_lock(datatype)]--;
 			success = false;
 			break;
 		} else {	/* wait for state change and retry */
-			slurm_cond_wait(&locks_cond, &locks_mutex);
+			if (!tv_wait) {
+				gettimeofday(&tv_start, NULL);
+				tv_wait = &tv_start;
+			}
+			slurm_cond_wait(&shard->cond, &shard->mutex);
 			if (kill_thread)
 				pthread_exit(NULL);
 		}
 	}
-	slurm_mutex_unlock(&locks_mutex);
+	slurm_mutex_unlock(&shard->mutex);
 	return success;
 }
 
 /* _wr_wrunlock - Issue a write unlock on the specified data type */
 static void _wr_wrunlock(lock_datatype_t datatype)
 {
-	slurm_mutex_lock(&locks_mutex);
+	lock_shard_t *shard = &lock_shards[datatype];
+
+	slurm_mutex_lock(&shard->mutex);
 	slurmctld_locks.entity[write_lock(datatype)]--;
-	slurm_cond_broadcast(&locks_cond);
-	slurm_mutex_unlock(&locks_mutex);
+	slurm_cond_broadcast(&shard->cond);
+	slurm_mutex_unlock(&shard->mutex);
 }
 
 /* get_lock_values - Get the current value of all locks
@@ -301,8 +380,14 @@ void get_lock_values(slurmctld_lock_flags_t * lock_flags)
 /* kill_locked_threads - Kill all threads waiting on semaphores */
 extern void kill_locked_threads(void)
 {
+	int i;
+
 	kill_thread = 1;
-	slurm_cond_broadcast(&locks_cond);
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		slurm_mutex_lock(&lock_shards[i].mutex);
+		slurm_cond_broadcast(&lock_shards[i].cond);
+		slurm_mutex_unlock(&lock_shards[i].mutex);
+	}
 }
 
 /* un/lock semaphore used for saving state of slurmctld */
@@ -314,3 +399,62 @@ extern void unlock_state_files(void)
 {
 	slurm_mutex_unlock(&state_mutex);
 }
+
+/* get_lock_stats - Get a copy of the lock wait time statistics
+ * OUT stats - copy of the statistics, indexed by lock_datatype_t then by
+ *	LOCK_STAT_READ/LOCK_STAT_WRITE */
+extern void get_lock_stats(lock_stats_t stats[ENTITY_COUNT][LOCK_STAT_MODES])
+{
+	int i;
+
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		slurm_mutex_lock(&lock_shards[i].mutex);
+		memcpy(stats[i], lock_stats[i], sizeof(lock_stats[i]));
+		slurm_mutex_unlock(&lock_shards[i].mutex);
+	}
+}
+
+/* reset_lock_stats - Clear the lock wait time statistics */
+extern void reset_lock_stats(void)
+{
+	int i;
+
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		slurm_mutex_lock(&lock_shards[i].mutex);
+		memset(lock_stats[i], 0, sizeof(lock_stats[i]));
+		slurm_mutex_unlock(&lock_shards[i].mutex);
+	}
+}
+
+/* pack_lock_stats - Append lock wait time statistics to an sdiag response
+ * IN/OUT buffer_ptr - packed response, reallocated as needed
+ * IN/OUT buffer_size - size of the packed response in bytes
+ * IN protocol_version - slurm protocol version of client */
+extern void pack_lock_stats(char **buffer_ptr, int *buffer_size,
+			    uint16_t protocol_version)
+{
+	lock_stats_t stats[ENTITY_COUNT][LOCK_STAT_MODES];
+	Buf buffer;
+	int i, j;
+
+	if (protocol_version < SLURM_17_02_PROTOCOL_VERSION)
+		return;
+
+	get_lock_stats(stats);
+	buffer = create_buf(*buffer_ptr, *buffer_size);
+	set_buf_offset(buffer, *buffer_size);
+	pack32(ENTITY_COUNT * LOCK_STAT_MODES, buffer);
+	pack32(LOCK_STAT_HIST_SIZE, buffer);
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		for (j = 0; j < LOCK_STAT_MODES; j++) {
+			pack64(stats[i][j].count, buffer);
+			pack64(stats[i][j].wait_time, buffer);
+			pack64(stats[i][j].wait_max, buffer);
+			pack32_array(stats[i][j].wait_hist,
+				     LOCK_STAT_HIST_SIZE, buffer);
+		}
+	}
+
+	*buffer_size = get_buf_offset(buffer);
+	buffer_ptr[0] = xfer_buf_data(buffer);
+}
@@ -83,6 +83,11 @@
  * and node data structures, and write lock on the partition data structure
  * would look like this: "{ NO_LOCK, READ_LOCK, READ_LOCK, WRITE_LOCK }"
  *
+ * Each data type is guarded by its own mutex and condition variable, so
+ * threads waiting on one data type are not woken by lock releases on another.
+ * The time spent waiting for each data type is recorded in a histogram which
+ * is reported by sdiag (see pack_lock_stats()).
+ *
  * NOTE: When using lock_slurmctld() and assoc_mgr_lock(), always call
  * lock_slurmctld() before calling assoc_mgr_lock() and then call
  * assoc_mgr_unlock() before calling unlock_slurmctld().
@@ -91,6 +96,8 @@
 #ifndef _SLURMCTLD_LOCKS_H
 #define _SLURMCTLD_LOCKS_H
 
+#include <inttypes.h>
+
 /* levels of locking required for each data structure */
 typedef enum {
 	NO_LOCK,
@@ -134,11 +141,32 @@ typedef struct {
 	int entity[ENTITY_COUNT * 4];
 }	slurmctld_lock_flags_t;
 
+/* Lock wait time statistics, one record per data type and lock mode.
+ * wait_hist[0] counts locks granted without waiting, wait_hist[1] counts
+ * waits under 10 usec and each following bucket is 10 times larger, with
+ * the final bucket holding all longer waits. */
+#define LOCK_STAT_READ		0
+#define LOCK_STAT_WRITE		1
+#define LOCK_STAT_MODES		2
+#define LOCK_STAT_HIST_SIZE	8
+
+typedef struct {
+	uint64_t count;		/* locks granted */
+	uint64_t wait_time;	/* total usec waiting */
+	uint64_t wait_max;	/* longest wait in usec */
+	uint32_t wait_hist[LOCK_STAT_HIST_SIZE];
+}	lock_stats_t;
+
 
 /* get_lock_values - Get the current value of all locks
  * OUT lock_flags - a copy of the current lock values */
 extern void get_lock_values (slurmctld_lock_flags_t *lock_flags);
 
+/* get_lock_stats - Get a copy of the lock wait time statistics
+ * OUT stats - copy of the statistics, indexed by lock_datatype_t then by
+ *	LOCK_STAT_READ/LOCK_STAT_WRITE */
+extern void get_lock_stats(lock_stats_t stats[ENTITY_COUNT][LOCK_STAT_MODES]);
+
 /* init_locks - create locks used for slurmctld data structure access
  *	control */
 extern void init_locks ( void );
@@ -157,6 +185,16 @@ extern int try_lock_slurmctld (slurmctld_lock_t lock_levels);
  *	defined order */
 extern void unlock_slurmctld (slurmctld_lock_t lock_levels);
 
+/* pack_lock_stats - Append lock wait time statistics to an sdiag response
+ * IN/OUT buffer_ptr - packed response, reallocated as needed
+ * IN/OUT buffer_size - size of the packed response in bytes
+ * IN protocol_version - slurm protocol version of client */
+extern void pack_lock_stats(char **buffer_ptr, int *buffer_size,
+			    uint16_t protocol_version);
+
+/* reset_lock_stats - Clear the lock wait time statistics */
+extern void reset_lock_stats(void);
+
 /* un/lock semaphore used for saving state of slurmctld */
 extern void lock_state_files ( void );
 extern void unlock_state_files ( void );
@@ -106,7 +106,8 @@ static front_end_record_t * _front_end_reg(
 static bool	_is_cloud_hidden(struct node_record *node_ptr);
 static void 	_make_node_down(struct node_record *node_ptr,
 				time_t event_time);
-static bool	_node_is_hidden(struct node_record *node_ptr, uid_t uid);
+static bool	_node_is_hidden(struct node_record *node_ptr, uid_t uid,
+				struct part_record **hidden);
 static int	_open_node_state_file(char **state_file);
 static void 	_pack_node(struct node_record *dump_node_ptr, Buf buffer,
 			   uint16_t protocol_version, uint16_t show_flags);
@@ -758,7 +759,8 @@ static bool _is_cloud_hidden(struct node_record *node_ptr)
 	return false;
 }
 
-static bool _node_is_hidden(struct node_record *node_ptr, uid_t uid)
+static bool _node_is_hidden(struct node_record *node_ptr, uid_t uid,
+			    struct part_record **hidden)
 {
 	int i;
 	bool shown = false;
@@ -770,7 +772,7 @@ static bool _node_is_hidden(struct node_record *node_ptr, uid_t uid)
 		return true;
 
 	for (i=0; i<node_ptr->part_cnt; i++) {
-		if (!(node_ptr->part_pptr[i]->flags & PART_FLAG_HIDDEN)) {
+		if (!part_is_hidden(node_ptr->part_pptr[i], hidden)) {
 			shown = true;
 			break;
 		}
@@ -793,7 +795,7 @@ static bool _node_is_hidden(struct node_record *node_ptr, uid_t uid)
  * NOTE: the caller must xfree the buffer at *buffer_ptr
  * NOTE: change slurm_load_node() in api/node_info.c when data format changes
  * NOTE: READ lock_slurmctld config before entry
- * NOTE: WRITE lock_slurmctld part before entry for part_filter_set
+ * NOTE: READ lock_slurmctld part before entry for part_hidden_build
  */
 extern void pack_all_node (char **buffer_ptr, int *buffer_size,
 			   uint16_t show_flags, uid_t uid,
@@ -804,6 +806,7 @@ extern void pack_all_node (char **buffer_ptr, int *buffer_size,
 	Buf buffer;
 	time_t now = time(NULL);
 	struct node_record *node_ptr = node_record_table_ptr;
+	struct part_record **hidden_parts = NULL;
 	bool hidden;
 
 	buffer_ptr[0] = NULL;
@@ -822,7 +825,8 @@ extern void pack_all_node (char **buffer_ptr, int *buffer_size,
 		pack_time(now, buffer);
 
 		/* write node records */
-		part_filter_set(uid);
+		if (((show_flags & SHOW_ALL) == 0) && (uid != 0))
+			hidden_parts = part_hidden_build(uid);
 		for (inx = 0; inx < node_record_count; inx++, node_ptr++) {
 			xassert (node_ptr->magic == NODE_MAGIC);
 			xassert (node_ptr->config_ptr->magic ==
@@ -834,7 +838,7 @@ extern void pack_all_node (char **buffer_ptr, int *buffer_size,
 			 * with it. */
 			hidden = false;
 			if (((show_flags & SHOW_ALL) == 0) && (uid != 0) &&
-			    (_node_is_hidden(node_ptr, uid)))
+			    (_node_is_hidden(node_ptr, uid, hidden_parts)))
 				hidden = true;
 			else if (IS_NODE_FUTURE(node_ptr))
 				hidden = true;
@@ -856,7 +860,7 @@ extern void pack_all_node (char **buffer_ptr, int *buffer_size,
 			}
 			nodes_packed++;
 		}
-		part_filter_clear();
+		xfree(hidden_parts);
 	} else {
 		error("select_g_select_jobinfo_pack: protocol_version "
 		      "%hu not supported", protocol_version);
@@ -885,7 +889,7 @@ extern void pack_all_node (char **buffer_ptr, int *buffer_size,
  * NOTE: the caller must xfree the buffer at *buffer_ptr
  * NOTE: change slurm_load_node() in api/node_info.c when data format changes
  * NOTE: READ lock_slurmctld config before entry
- * NOTE: WRITE lock_slurmctld part before entry for part_filter_set
+ * NOTE: READ lock_slurmctld part before entry for part_hidden_build
  */
 extern void pack_one_node (char **buffer_ptr, int *buffer_size,
 			   uint16_t show_flags, uid_t uid, char *node_name,
@@ -895,6 +899,7 @@ extern void pack_one_node (char **buffer_ptr, int *buffer_size,
 	Buf buffer;
 	time_t now = time(NULL);
 	struct node_record *node_ptr;
+	struct part_record **hidden_parts = NULL;
 	bool hidden;
 
 	buffer_ptr[0] = NULL;
@@ -913,7 +918,8 @@ extern void pack_one_node (char **buffer_ptr, int *buffer_size,
 		pack_time(now, buffer);
 
 		/* write node records */
-		part_filter_set(uid);
+		if (((show_flags & SHOW_ALL) == 0) && (uid != 0))
+			hidden_parts = part_hidden_build(uid);
 		if (node_name)
 			node_ptr = find_node_record(node_name);
 		else
@@ -921,7 +927,7 @@ extern void pack_one_node (char **buffer_ptr, int *buffer_size,
 		if (node_ptr) {
 			hidden = false;
 			if (((show_flags & SHOW_ALL) == 0) && (uid != 0) &&
-			    (_node_is_hidden(node_ptr, uid)))
+			    (_node_is_hidden(node_ptr, uid, hidden_parts)))
 				hidden = true;
 			else if (IS_NODE_FUTURE(node_ptr))
 				hidden = true;
@@ -938,7 +944,7 @@ extern void pack_one_node (char **buffer_ptr, int *buffer_size,
 				nodes_packed++;
 			}
 		}
-		part_filter_clear();
+		xfree(hidden_parts);
 	} else {
 		error("select_g_select_jobinfo_pack: protocol_version "
 		      "%hu not supported", protocol_version);
@@ -975,7 +981,7 @@ static void _pack_node (struct node_record *dump_node_ptr, Buf buffer,
 		packstr (dump_node_ptr->comm_name, buffer);
 		pack16(dump_node_ptr->port, buffer);
 		pack32(dump_node_ptr->node_state, buffer);
-		packstr (dump_node_ptr->version, buffer);
+		packstr_dict(dump_node_ptr->version, buffer);
 		/* On a bluegene system always use the regular node
 		* infomation not what is in the config_ptr. */
 #ifndef HAVE_BG
@@ -1001,11 +1007,11 @@ static void _pack_node (struct node_record *dump_node_ptr, Buf buffer,
 #ifndef HAVE_BG
 		}
 #endif
-		packstr(dump_node_ptr->mcs_label, buffer);
+		packstr_dict(dump_node_ptr->mcs_label, buffer);
 		pack32(dump_node_ptr->owner, buffer);
 		pack16(dump_node_ptr->core_spec_cnt, buffer);
 		pack64(dump_node_ptr->mem_spec_limit, buffer);
-		packstr(dump_node_ptr->cpu_spec_list, buffer);
+		packstr_dict(dump_node_ptr->cpu_spec_list, buffer);
 
 		pack32(dump_node_ptr->cpu_load, buffer);
 		pack64(dump_node_ptr->free_mem, buffer);
@@ -1019,13 +1025,13 @@ static void _pack_node (struct node_record *dump_node_ptr, Buf buffer,
 		select_g_select_nodeinfo_pack(dump_node_ptr->select_nodeinfo,
 					      buffer, protocol_version);
 
-		packstr(dump_node_ptr->arch, buffer);
-		packstr(dump_node_ptr->features, buffer);
-		packstr(dump_node_ptr->features_act, buffer);
+		packstr_dict(dump_node_ptr->arch, buffer);
+		packstr_dict(dump_node_ptr->features, buffer);
+		packstr_dict(dump_node_ptr->features_act, buffer);
 		if (dump_node_ptr->gres)
-			packstr(dump_node_ptr->gres, buffer);
+			packstr_dict(dump_node_ptr->gres, buffer);
 		else
-			packstr(dump_node_ptr->config_ptr->gres, buffer);
+			packstr_dict(dump_node_ptr->config_ptr->gres, buffer);
 
 		/* Gathering GRES details is slow, so don't by default */
 		if (show_flags & SHOW_DETAIL) {
@@ -1034,13 +1040,13 @@ static void _pack_node (struct node_record *dump_node_ptr, Buf buffer,
 			gres_used  =
 				gres_get_node_used(dump_node_ptr->gres_list);
 		}
-		packstr(gres_drain, buffer);
-		packstr(gres_used, buffer);
+		packstr_dict(gres_drain, buffer);
+		packstr_dict(gres_used, buffer);
 		xfree(gres_drain);
 		xfree(gres_used);
 
-		packstr(dump_node_ptr->os, buffer);
-		packstr(dump_node_ptr->reason, buffer);
+		packstr_dict(dump_node_ptr->os, buffer);
+		packstr_dict(dump_node_ptr->reason, buffer);
 		acct_gather_energy_pack(dump_node_ptr->energy, buffer,
 					protocol_version);
 		ext_sensors_data_pack(dump_node_ptr->ext_sensors, buffer,
@@ -1048,7 +1054,7 @@ static void _pack_node (struct node_record *dump_node_ptr, Buf buffer,
 		power_mgmt_data_pack(dump_node_ptr->power, buffer,
 				     protocol_version);
 
-		packstr(dump_node_ptr->tres_fmt_str,buffer);
+		packstr_dict(dump_node_ptr->tres_fmt_str,buffer);
 	} else if (protocol_version >= SLURM_16_05_PROTOCOL_VERSION) {
 		packstr (dump_node_ptr->name, buffer);
 		packstr (dump_node_ptr->node_hostname, buffer);
@@ -2328,8 +2334,7 @@ extern int validate_node_specs(slurm_node_registration_status_msg_t *reg_msg,
 
 	node_ptr->protocol_version = protocol_version;
 	xfree(node_ptr->version);
-	node_ptr->version = reg_msg->version;
-	reg_msg->version = NULL;
+	node_ptr->version = xmove(reg_msg->version);
 
 	if (IS_NODE_POWER_UP(node_ptr) &&
 	    (node_ptr->boot_time < node_ptr->boot_req_time)) {
@@ -2526,8 +2531,7 @@ extern int validate_node_specs(slurm_node_registration_status_msg_t *reg_msg,
 
 	if (reg_msg->cpu_spec_list != NULL) {
 		xfree(node_ptr->cpu_spec_list);
-		node_ptr->cpu_spec_list = reg_msg->cpu_spec_list;
-		reg_msg->cpu_spec_list = NULL;	/* Nothing left to free */
+		node_ptr->cpu_spec_list = xmove(reg_msg->cpu_spec_list);
 
 		cpu_spec_array = bitfmt2int(node_ptr->cpu_spec_list);
 		i = 0;
@@ -2545,12 +2549,10 @@ extern int validate_node_specs(slurm_node_registration_status_msg_t *reg_msg,
 	}
 
 	xfree(node_ptr->arch);
-	node_ptr->arch = reg_msg->arch;
-	reg_msg->arch = NULL;	/* Nothing left to free */
+	node_ptr->arch = xmove(reg_msg->arch);
 
 	xfree(node_ptr->os);
-	node_ptr->os = reg_msg->os;
-	reg_msg->os = NULL;	/* Nothing left to free */
+	node_ptr->os = xmove(reg_msg->os);
 
 	if (node_ptr->cpu_load != reg_msg->cpu_load) {
 		node_ptr->cpu_load = reg_msg->cpu_load;
@@ -2851,8 +2853,7 @@ extern int validate_nodes_via_front_end(
 
 	front_end_ptr->protocol_version = protocol_version;
 	xfree(front_end_ptr->version);
-	front_end_ptr->version = reg_msg->version;
-	reg_msg->version = NULL;
+	front_end_ptr->version = xmove(reg_msg->version);
 	*newly_up = false;
 
 	if (reg_msg->status == ESLURMD_PROLOG_FAILED) {
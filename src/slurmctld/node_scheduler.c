@@ -79,6 +79,7 @@
 #include "src/slurmctld/node_scheduler.h"
 #include "src/slurmctld/powercapping.h"
 #include "src/slurmctld/preempt.h"
+#include "src/slurmctld/prio_queue.h"
 #include "src/slurmctld/proc_req.h"
 #include "src/slurmctld/reservation.h"
 #include "src/slurmctld/sched_plugin.h"
@@ -917,9 +918,7 @@ extern void filter_by_node_owner(struct job_record *job_ptr,
 			    (job_ptr->user_id == job_ptr2->user_id) ||
 			    !job_ptr2->node_bitmap)
 				continue;
-			bit_not(job_ptr2->node_bitmap);
-			bit_and(usable_node_mask, job_ptr2->node_bitmap);
-			bit_not(job_ptr2->node_bitmap);
+			bit_and_not(usable_node_mask, job_ptr2->node_bitmap);
 		}
 		list_iterator_destroy(job_iterator);
 		return;
@@ -990,9 +989,7 @@ static void _filter_by_node_feature(struct job_record *job_ptr,
 	for (i = 0; i < node_set_size; i++) {
 		if (node_set_ptr[i].weight != INFINITE)
 			continue;
-		bit_not(node_set_ptr[i].my_bitmap);
-		bit_and(avail_node_bitmap, node_set_ptr[i].my_bitmap);
-		bit_not(node_set_ptr[i].my_bitmap);
+		bit_and_not(avail_node_bitmap, node_set_ptr[i].my_bitmap);
 	}
 }
 
@@ -1073,9 +1070,7 @@ _get_req_features(struct node_set *node_set_ptr, int node_set_size,
 
 	if (!save_avail_node_bitmap)
 		save_avail_node_bitmap = bit_copy(avail_node_bitmap);
-	bit_not(booting_node_bitmap);
-	bit_and(avail_node_bitmap, booting_node_bitmap);
-	bit_not(booting_node_bitmap);
+	bit_and_not(avail_node_bitmap, booting_node_bitmap);
 	filter_by_node_owner(job_ptr, avail_node_bitmap);
 	if (can_reboot && !test_only)
 		_filter_by_node_feature(job_ptr, node_set_ptr, node_set_size);
@@ -1364,9 +1359,7 @@ _get_req_features(struct node_set *node_set_ptr, int node_set_size,
 		 * configuration to check that is is allowed by the current
 		 * power cap */
 		tmp_bitmap = bit_copy(idle_node_bitmap);
-		bit_not(*select_bitmap);
-		bit_and(tmp_bitmap, *select_bitmap);
-		bit_not(*select_bitmap);
+		bit_and_not(tmp_bitmap, *select_bitmap);
 		if (layout_power == 1)
 			tmp_max_watts =
 				 powercap_get_node_bitmap_maxwatts(tmp_bitmap);
@@ -1782,10 +1775,8 @@ _pick_best_nodes(struct node_set *node_set_ptr, int node_set_size,
 					bit_and(node_set_ptr[i].my_bitmap,
 						share_node_bitmap);
 #ifndef HAVE_BG
-					bit_not(cg_node_bitmap);
-					bit_and(node_set_ptr[i].my_bitmap,
-						cg_node_bitmap);
-					bit_not(cg_node_bitmap);
+					bit_and_not(node_set_ptr[i].my_bitmap,
+						    cg_node_bitmap);
 #endif
 				} else {
 					bit_and(node_set_ptr[i].my_bitmap,
@@ -1794,10 +1785,8 @@ _pick_best_nodes(struct node_set *node_set_ptr, int node_set_size,
 				}
 			} else {
 #ifndef HAVE_BG
-				bit_not(cg_node_bitmap);
-				bit_and(node_set_ptr[i].my_bitmap,
-					cg_node_bitmap);
-				bit_not(cg_node_bitmap);
+				bit_and_not(node_set_ptr[i].my_bitmap,
+					    cg_node_bitmap);
 #endif
 			}
 			if (!nodes_busy) {
@@ -2553,6 +2542,7 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 		job_ptr->node_bitmap = NULL;
 		job_ptr->priority = 0;
 		job_ptr->state_reason = WAIT_HELD;
+		prio_queue_update_job(job_ptr);
 		goto cleanup;
 	}
 	if (select_g_job_begin(job_ptr) != SLURM_SUCCESS) {
@@ -2586,6 +2576,7 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 	configuring = IS_JOB_CONFIGURING(job_ptr);
 
 	job_ptr->job_state = JOB_RUNNING;
+	prio_queue_update_job(job_ptr);
 	if (nonstop_ops.job_begin)
 		(nonstop_ops.job_begin)(job_ptr);
 
@@ -3163,9 +3154,8 @@ static int _build_node_list(struct job_record *job_ptr,
 
 	if (detail_ptr->exc_node_bitmap) {
 		if (usable_node_mask) {
-			bit_not(detail_ptr->exc_node_bitmap);
-			bit_and(usable_node_mask, detail_ptr->exc_node_bitmap);
-			bit_not(detail_ptr->exc_node_bitmap);
+			bit_and_not(usable_node_mask,
+				    detail_ptr->exc_node_bitmap);
 		} else {
 			usable_node_mask =
 				bit_copy(detail_ptr->exc_node_bitmap);
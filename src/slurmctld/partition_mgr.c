@@ -96,6 +96,7 @@ static void   _unlink_free_nodes(bitstr_t *old_bitmap,
 			struct part_record *part_ptr);
 static uid_t *_remove_duplicate_uids(uid_t *);
 static int _uid_cmp(const void *, const void *);
+static int _validate_group(struct part_record *part_ptr, uid_t run_uid);
 
 static int _calc_part_tres(void *x, void *arg)
 {
@@ -1135,46 +1136,54 @@ static int _match_part_ptr(void *part_ptr, void *key)
 	return 0;
 }
 
-/* part_filter_set - Set the partition's hidden flag based upon a user's
- * group access. This must be followed by a call to part_filter_clear() */
-static int _part_filter_set(void *x, void *arg)
+/*
+ * part_hidden_build - Build a snapshot of the partitions which are hidden
+ *	from a given user, either through the Hidden flag or AllowGroups.
+ *	Unlike setting PART_FLAG_HIDDEN on the partition records, this leaves
+ *	the partition records unchanged so only a read lock is needed.
+ * IN uid - user ID making the request
+ * RET NULL terminated array of hidden partitions or NULL if none are hidden,
+ *	free with xfree()
+ * NOTE: READ lock_slurmctld part before entry
+ */
+extern struct part_record **part_hidden_build(uid_t uid)
 {
-	struct part_record *part_ptr = (struct part_record *) x;
-	uid_t *uid = (uid_t *) arg;
-
-	if (part_ptr->flags & PART_FLAG_HIDDEN)
-		return 0;
+	ListIterator part_iterator;
+	struct part_record *part_ptr, **hidden = NULL;
+	int hidden_cnt = 0;
 
-	if (validate_group(part_ptr, *uid) == 0) {
-		part_ptr->flags |= PART_FLAG_HIDDEN;
-		part_ptr->flags |= PART_FLAG_HIDDEN_CLR;
+	part_iterator = list_iterator_create(part_list);
+	while ((part_ptr = (struct part_record *) list_next(part_iterator))) {
+		if (!(part_ptr->flags & PART_FLAG_HIDDEN) &&
+		    (validate_group(part_ptr, uid) != 0))
+			continue;
+		xrealloc(hidden, sizeof(struct part_record *) *
+				 (hidden_cnt + 2));
+		hidden[hidden_cnt++] = part_ptr;
 	}
+	list_iterator_destroy(part_iterator);
 
-	return 0;
-}
-
-extern void part_filter_set(uid_t uid)
-{
-	list_for_each(part_list, _part_filter_set, &uid);
+	return hidden;
 }
 
-/* part_filter_clear - Clear the partition's hidden flag based upon a user's
- * group access. This must follow a call to part_filter_set() */
-static int _part_filter_clear(void *x, void *arg)
+/*
+ * part_is_hidden - Test if a partition is in a snapshot of hidden partitions
+ * IN part_ptr - partition to test
+ * IN hidden - snapshot from part_hidden_build()
+ * RET true if the partition is hidden
+ */
+extern bool part_is_hidden(struct part_record *part_ptr,
+			   struct part_record **hidden)
 {
-	struct part_record *part_ptr = (struct part_record *) x;
+	int i;
 
-	if (part_ptr->flags & PART_FLAG_HIDDEN_CLR) {
-		part_ptr->flags &= (~PART_FLAG_HIDDEN);
-		part_ptr->flags &= (~PART_FLAG_HIDDEN_CLR);
+	if (!hidden)
+		return false;
+	for (i = 0; hidden[i]; i++) {
+		if (hidden[i] == part_ptr)
+			return true;
 	}
-
-	return 0;
-}
-
-extern void part_filter_clear(void)
-{
-	list_for_each(part_list, _part_filter_clear, NULL);
+	return false;
 }
 
 /*
@@ -1277,18 +1286,18 @@ void pack_part(struct part_record *part_ptr, Buf buffer,
 		pack16(part_ptr->state_up, buffer);
 		pack16(part_ptr->cr_type, buffer);
 
-		packstr(part_ptr->allow_accounts, buffer);
-		packstr(part_ptr->allow_groups, buffer);
-		packstr(part_ptr->allow_alloc_nodes, buffer);
-		packstr(part_ptr->allow_qos, buffer);
-		packstr(part_ptr->qos_char, buffer);
-		packstr(part_ptr->alternate, buffer);
-		packstr(part_ptr->deny_accounts, buffer);
-		packstr(part_ptr->deny_qos, buffer);
-		packstr(part_ptr->nodes, buffer);
+		packstr_dict(part_ptr->allow_accounts, buffer);
+		packstr_dict(part_ptr->allow_groups, buffer);
+		packstr_dict(part_ptr->allow_alloc_nodes, buffer);
+		packstr_dict(part_ptr->allow_qos, buffer);
+		packstr_dict(part_ptr->qos_char, buffer);
+		packstr_dict(part_ptr->alternate, buffer);
+		packstr_dict(part_ptr->deny_accounts, buffer);
+		packstr_dict(part_ptr->deny_qos, buffer);
+		packstr_dict(part_ptr->nodes, buffer);
 		pack_bit_fmt(part_ptr->node_bitmap, buffer);
-		packstr(part_ptr->billing_weights_str, buffer);
-		packstr(part_ptr->tres_fmt_str, buffer);
+		packstr_dict(part_ptr->billing_weights_str, buffer);
+		packstr_dict(part_ptr->tres_fmt_str, buffer);
 	} else if (protocol_version >= SLURM_16_05_PROTOCOL_VERSION) {
 		if (default_part_loc == part_ptr)
 			part_ptr->flags |= PART_FLAG_DEFAULT;
@@ -1844,8 +1853,22 @@ extern int update_part (update_part_msg_t * part_desc, bool create_flag)
  * IN part_ptr - pointer to a partition
  * IN run_uid - user to run the job as
  * RET 1 if permitted to run, 0 otherwise
+ * NOTE: This may add run_uid to part_ptr->allow_uids, so it is serialized
+ *	for callers which only hold a read lock on partitions.
  */
 extern int validate_group(struct part_record *part_ptr, uid_t run_uid)
+{
+	static pthread_mutex_t validate_mutex = PTHREAD_MUTEX_INITIALIZER;
+	int rc;
+
+	slurm_mutex_lock(&validate_mutex);
+	rc = _validate_group(part_ptr, run_uid);
+	slurm_mutex_unlock(&validate_mutex);
+
+	return rc;
+}
+
+static int _validate_group(struct part_record *part_ptr, uid_t run_uid)
 {
 	static uid_t last_fail_uid = 0;
 	static struct part_record *last_fail_part_ptr = NULL;
@@ -1980,7 +2003,7 @@ extern int validate_group(struct part_record *part_ptr, uid_t run_uid)
 		      (long) run_uid, grp.gr_name, part_ptr->name);
 		part_ptr->allow_uids =
 			xrealloc(part_ptr->allow_uids,
-				 (sizeof(uid_t) * (uid_array_len + 1)));
+				 (sizeof(uid_t) * (uid_array_len + 2)));
 		part_ptr->allow_uids[uid_array_len] = run_uid;
 	}
 
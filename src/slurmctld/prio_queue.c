@@ -0,0 +1,538 @@
+/*****************************************************************************\
+ *  prio_queue.c - persistent priority ordered queue of pending jobs used by
+ *	the main scheduler in place of building and sorting a job queue on
+ *	every pass.
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+/*
+ * Each partition has a binary heap of the pending jobs which requested it,
+ * ordered by reservation, priority then job and task ID. Since all entries
+ * of one heap share the partition's priority tier, the order within a heap
+ * matches sort_job_queue2() and an iterator merges the heaps by visiting
+ * the nodes of each heap in order with a second, small heap holding the
+ * next candidate entries. Returning the first N entries costs O(N log N)
+ * however many jobs are pending.
+ *
+ * Each job record points to its entries, so an entry whose priority or
+ * partitions change is moved in O(log n). The code which changes a pending
+ * job's priority, state, partitions or reservation calls
+ * prio_queue_update_job(), which notes the job for the next sync. Moving
+ * entries is deferred since an iterator may be reading the heaps. Records
+ * changed elsewhere, such as by plugins, are caught by comparing all jobs
+ * every PRIO_QUEUE_FULL_SYNC seconds.
+ */
+
+#include "config.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/xmalloc.h"
+
+#include "src/slurmctld/job_scheduler.h"
+#include "src/slurmctld/prio_queue.h"
+#include "src/slurmctld/slurmctld.h"
+
+#define PRIO_QUEUE_FULL_SYNC 60	/* seconds between comparing all jobs */
+
+typedef struct prio_heap prio_heap_t;
+
+typedef struct prio_queue_rec {
+	struct job_record *job_ptr;
+	prio_heap_t *heap;		/* heap of the entry's partition */
+	uint32_t heap_inx;		/* position in heap->recs */
+	uint32_t array_task_id;
+	uint32_t job_id;
+	uint32_t sort_id;		/* job ID, or array job ID of tasks */
+	uint32_t priority;		/* job priority in this partition */
+	bool has_resv;
+} prio_queue_rec_t;
+
+struct prio_heap {
+	struct part_record *part_ptr;
+	prio_queue_rec_t **recs;
+	uint32_t cnt;
+	uint32_t size;
+};
+
+struct prio_queue_iter {
+	prio_queue_rec_t **recs;	/* heap of candidate entries */
+	uint32_t cnt;
+	uint32_t size;
+};
+
+static prio_heap_t *heaps = NULL;
+static int heap_cnt = 0;
+static uint32_t rec_cnt = 0;
+static struct job_record **dirty_jobs = NULL;	/* jobs to sync */
+static uint32_t dirty_cnt = 0;
+static uint32_t dirty_size = 0;
+static time_t sync_time = 0;		/* when all jobs were last compared */
+static time_t part_sync_time = 0;	/* when heaps were last built */
+
+/* Return true if entry "rec1" is scheduled before "rec2", the order of
+ * sort_job_queue2() without its preemption test */
+static bool _rec_before(prio_queue_rec_t *rec1, prio_queue_rec_t *rec2)
+{
+	uint32_t tier1, tier2;
+
+	if (rec1->has_resv != rec2->has_resv)
+		return rec1->has_resv;
+	if (rec1->heap != rec2->heap) {
+		tier1 = rec1->heap->part_ptr->priority_tier;
+		tier2 = rec2->heap->part_ptr->priority_tier;
+		if (tier1 != tier2)
+			return (tier1 > tier2);
+	}
+	if (rec1->priority != rec2->priority)
+		return (rec1->priority > rec2->priority);
+	if (rec1->sort_id != rec2->sort_id)
+		return (rec1->sort_id < rec2->sort_id);
+	return (rec1->array_task_id < rec2->array_task_id);
+}
+
+static void _heap_swap(prio_heap_t *heap, uint32_t i, uint32_t j)
+{
+	prio_queue_rec_t *tmp = heap->recs[i];
+
+	heap->recs[i] = heap->recs[j];
+	heap->recs[j] = tmp;
+	heap->recs[i]->heap_inx = i;
+	heap->recs[j]->heap_inx = j;
+}
+
+/* Move the entry at "inx" to its place in the heap */
+static void _heap_fix(prio_heap_t *heap, uint32_t inx)
+{
+	uint32_t parent, child;
+
+	while (inx > 0) {
+		parent = (inx - 1) / 2;
+		if (!_rec_before(heap->recs[inx], heap->recs[parent]))
+			break;
+		_heap_swap(heap, inx, parent);
+		inx = parent;
+	}
+	while ((child = (inx * 2) + 1) < heap->cnt) {
+		if (((child + 1) < heap->cnt) &&
+		    _rec_before(heap->recs[child + 1], heap->recs[child]))
+			child++;
+		if (!_rec_before(heap->recs[child], heap->recs[inx]))
+			break;
+		_heap_swap(heap, inx, child);
+		inx = child;
+	}
+}
+
+static void _heap_add(prio_heap_t *heap, prio_queue_rec_t *rec)
+{
+	if (heap->cnt >= heap->size) {
+		heap->size = MAX(64, heap->size * 2);
+		xrealloc(heap->recs, sizeof(prio_queue_rec_t *) * heap->size);
+	}
+	rec->heap = heap;
+	rec->heap_inx = heap->cnt;
+	heap->recs[heap->cnt++] = rec;
+	_heap_fix(heap, rec->heap_inx);
+}
+
+static void _heap_remove(prio_queue_rec_t *rec)
+{
+	prio_heap_t *heap = rec->heap;
+	uint32_t inx = rec->heap_inx;
+
+	heap->cnt--;
+	if (inx != heap->cnt) {
+		heap->recs[inx] = heap->recs[heap->cnt];
+		heap->recs[inx]->heap_inx = inx;
+		_heap_fix(heap, inx);
+	}
+}
+
+static prio_heap_t *_find_heap(struct part_record *part_ptr)
+{
+	int i;
+
+	for (i = 0; i < heap_cnt; i++) {
+		if (heaps[i].part_ptr == part_ptr)
+			return &heaps[i];
+	}
+	return NULL;
+}
+
+static void _clear_dirty_jobs(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < dirty_cnt; i++)
+		dirty_jobs[i]->prio_queue_dirty = false;
+	dirty_cnt = 0;
+}
+
+static void _free_heaps(void)
+{
+	prio_queue_rec_t *rec;
+	int i;
+	uint32_t j;
+
+	for (i = 0; i < heap_cnt; i++) {
+		for (j = 0; j < heaps[i].cnt; j++) {
+			rec = heaps[i].recs[j];
+			rec->job_ptr->prio_queue_cnt = 0;
+			xfree(rec->job_ptr->prio_queue_recs);
+			xfree(rec);
+		}
+		xfree(heaps[i].recs);
+	}
+	xfree(heaps);
+	heap_cnt = 0;
+	rec_cnt = 0;
+	_clear_dirty_jobs();
+}
+
+/* Discard all entries and create an empty heap for each partition */
+static void _build_heaps(void)
+{
+	ListIterator part_iterator;
+	struct part_record *part_ptr;
+
+	_free_heaps();
+	heaps = xmalloc(sizeof(prio_heap_t) * MAX(1, list_count(part_list)));
+	part_iterator = list_iterator_create(part_list);
+	while ((part_ptr = (struct part_record *) list_next(part_iterator)))
+		heaps[heap_cnt++].part_ptr = part_ptr;
+	list_iterator_destroy(part_iterator);
+}
+
+/* Return true if the job should have entries in the queue */
+static bool _job_queued(struct job_record *job_ptr)
+{
+	if (!IS_JOB_PENDING(job_ptr) || IS_JOB_COMPLETING(job_ptr) ||
+	    (job_ptr->priority == 0))	/* held */
+		return false;
+	return true;
+}
+
+/* Return true if entry "rec" matches the job in partition "part_ptr",
+ * with "inx" being the partition's position in the job's part_ptr_list */
+static bool _rec_match(prio_queue_rec_t *rec, struct job_record *job_ptr,
+		       struct part_record *part_ptr, int inx)
+{
+	uint32_t priority;
+
+	if (job_ptr->part_ptr_list && job_ptr->priority_array)
+		priority = job_ptr->priority_array[inx];
+	else
+		priority = job_ptr->priority;
+	if ((rec->heap->part_ptr != part_ptr) ||
+	    (rec->priority != priority) ||
+	    (rec->job_id != job_ptr->job_id) ||
+	    (rec->array_task_id != job_ptr->array_task_id) ||
+	    (rec->has_resv != (job_ptr->resv_id != 0)))
+		return false;
+	return true;
+}
+
+/* Set entry "rec" from the job in partition "part_ptr", with "inx" being
+ * the partition's position in the job's part_ptr_list */
+static void _rec_set(prio_queue_rec_t *rec, struct job_record *job_ptr,
+		     int inx)
+{
+	rec->job_ptr = job_ptr;
+	rec->array_task_id = job_ptr->array_task_id;
+	rec->job_id = job_ptr->job_id;
+	if (job_ptr->array_task_id == NO_VAL)
+		rec->sort_id = job_ptr->job_id;
+	else
+		rec->sort_id = job_ptr->array_job_id;
+	if (job_ptr->part_ptr_list && job_ptr->priority_array)
+		rec->priority = job_ptr->priority_array[inx];
+	else
+		rec->priority = job_ptr->priority;
+	rec->has_resv = (job_ptr->resv_id != 0);
+}
+
+/* Remove all entries of a job */
+static void _job_remove_recs(struct job_record *job_ptr)
+{
+	int i;
+
+	for (i = 0; i < job_ptr->prio_queue_cnt; i++) {
+		_heap_remove(job_ptr->prio_queue_recs[i]);
+		xfree(job_ptr->prio_queue_recs[i]);
+		rec_cnt--;
+	}
+	xfree(job_ptr->prio_queue_recs);
+	job_ptr->prio_queue_cnt = 0;
+}
+
+extern void prio_queue_remove_job(struct job_record *job_ptr)
+{
+	uint32_t i;
+
+	_job_remove_recs(job_ptr);
+	if (!job_ptr->prio_queue_dirty)
+		return;
+	for (i = 0; i < dirty_cnt; i++) {
+		if (dirty_jobs[i] == job_ptr) {
+			dirty_jobs[i] = dirty_jobs[--dirty_cnt];
+			break;
+		}
+	}
+	job_ptr->prio_queue_dirty = false;
+}
+
+extern void prio_queue_update_job(struct job_record *job_ptr)
+{
+	/* Without heaps, the next sync adds every job */
+	if (!heaps || job_ptr->prio_queue_dirty)
+		return;
+	if (dirty_cnt >= dirty_size) {
+		dirty_size = MAX(64, dirty_size * 2);
+		xrealloc(dirty_jobs, sizeof(struct job_record *) * dirty_size);
+	}
+	dirty_jobs[dirty_cnt++] = job_ptr;
+	job_ptr->prio_queue_dirty = true;
+}
+
+/* Add an entry for the job in partition "part_ptr" */
+static void _job_add_rec(struct job_record *job_ptr,
+			 struct part_record *part_ptr, int inx)
+{
+	prio_queue_rec_t *rec;
+	prio_heap_t *heap;
+
+	if (!part_ptr || !(heap = _find_heap(part_ptr)))
+		return;
+	rec = xmalloc(sizeof(prio_queue_rec_t));
+	_rec_set(rec, job_ptr, inx);
+	xrealloc(job_ptr->prio_queue_recs,
+		 sizeof(prio_queue_rec_t *) * (job_ptr->prio_queue_cnt + 1));
+	job_ptr->prio_queue_recs[job_ptr->prio_queue_cnt++] = rec;
+	_heap_add(heap, rec);
+	rec_cnt++;
+}
+
+/* Bring the entries of one job up to date with its record */
+static void _job_sync(struct job_record *job_ptr)
+{
+	ListIterator part_iterator;
+	struct part_record *part_ptr;
+	prio_queue_rec_t *rec;
+	int i = 0;
+
+	if (!_job_queued(job_ptr)) {
+		if (job_ptr->prio_queue_cnt)
+			_job_remove_recs(job_ptr);
+		return;
+	}
+
+	if (!job_ptr->part_ptr_list) {
+		if (job_ptr->prio_queue_cnt == 1) {
+			rec = job_ptr->prio_queue_recs[0];
+			if (_rec_match(rec, job_ptr, job_ptr->part_ptr, 0))
+				return;
+			if (rec->heap->part_ptr == job_ptr->part_ptr) {
+				_rec_set(rec, job_ptr, 0);
+				_heap_fix(rec->heap, rec->heap_inx);
+				return;
+			}
+		}
+		_job_remove_recs(job_ptr);
+		_job_add_rec(job_ptr, job_ptr->part_ptr, 0);
+		return;
+	}
+
+	if (job_ptr->prio_queue_cnt == list_count(job_ptr->part_ptr_list)) {
+		part_iterator = list_iterator_create(job_ptr->part_ptr_list);
+		while ((part_ptr = (struct part_record *)
+				   list_next(part_iterator))) {
+			rec = job_ptr->prio_queue_recs[i];
+			if (rec->heap->part_ptr != part_ptr)
+				break;
+			if (!_rec_match(rec, job_ptr, part_ptr, i)) {
+				_rec_set(rec, job_ptr, i);
+				_heap_fix(rec->heap, rec->heap_inx);
+			}
+			i++;
+		}
+		list_iterator_destroy(part_iterator);
+		if (i == job_ptr->prio_queue_cnt)
+			return;
+	}
+
+	/* Partitions changed, replace all entries */
+	_job_remove_recs(job_ptr);
+	i = 0;
+	part_iterator = list_iterator_create(job_ptr->part_ptr_list);
+	while ((part_ptr = (struct part_record *) list_next(part_iterator)))
+		_job_add_rec(job_ptr, part_ptr, i++);
+	list_iterator_destroy(part_iterator);
+}
+
+extern void prio_queue_sync(void)
+{
+	ListIterator job_iterator;
+	struct job_record *job_ptr;
+	time_t now = time(NULL);
+	uint32_t i;
+
+	/* Updates made later in the second of the last build have the same
+	 * time stamp, so build again until a second has passed */
+	if (!heaps || (last_part_update >= part_sync_time)) {
+		_build_heaps();
+		part_sync_time = now;
+		sync_time = 0;
+	}
+
+	if (now < (sync_time + PRIO_QUEUE_FULL_SYNC)) {
+		for (i = 0; i < dirty_cnt; i++)
+			_job_sync(dirty_jobs[i]);
+	} else {
+		job_iterator = list_iterator_create(job_list);
+		while ((job_ptr = (struct job_record *)
+				  list_next(job_iterator)))
+			_job_sync(job_ptr);
+		list_iterator_destroy(job_iterator);
+		sync_time = now;
+	}
+	_clear_dirty_jobs();
+}
+
+extern uint32_t prio_queue_count(void)
+{
+	return rec_cnt;
+}
+
+static void _iter_add(prio_queue_iter_t iter, prio_queue_rec_t *rec)
+{
+	uint32_t inx, parent;
+
+	if (iter->cnt >= iter->size) {
+		iter->size *= 2;
+		xrealloc(iter->recs, sizeof(prio_queue_rec_t *) * iter->size);
+	}
+	inx = iter->cnt++;
+	while (inx > 0) {
+		parent = (inx - 1) / 2;
+		if (!_rec_before(rec, iter->recs[parent]))
+			break;
+		iter->recs[inx] = iter->recs[parent];
+		inx = parent;
+	}
+	iter->recs[inx] = rec;
+}
+
+static prio_queue_rec_t *_iter_pop(prio_queue_iter_t iter)
+{
+	prio_queue_rec_t *rec, *last;
+	uint32_t inx = 0, child;
+
+	if (iter->cnt == 0)
+		return NULL;
+	rec = iter->recs[0];
+	last = iter->recs[--iter->cnt];
+	while ((child = (inx * 2) + 1) < iter->cnt) {
+		if (((child + 1) < iter->cnt) &&
+		    _rec_before(iter->recs[child + 1], iter->recs[child]))
+			child++;
+		if (!_rec_before(iter->recs[child], last))
+			break;
+		iter->recs[inx] = iter->recs[child];
+		inx = child;
+	}
+	iter->recs[inx] = last;
+	return rec;
+}
+
+extern prio_queue_iter_t prio_queue_iter_create(void)
+{
+	prio_queue_iter_t iter;
+	int i;
+
+	prio_queue_sync();
+
+	iter = xmalloc(sizeof(struct prio_queue_iter));
+	iter->size = heap_cnt + 64;
+	iter->recs = xmalloc(sizeof(prio_queue_rec_t *) * iter->size);
+	for (i = 0; i < heap_cnt; i++) {
+		if (heaps[i].cnt)
+			_iter_add(iter, heaps[i].recs[0]);
+	}
+
+	return iter;
+}
+
+extern bool prio_queue_iter_next(prio_queue_iter_t iter,
+				 job_queue_rec_t *job_queue_rec)
+{
+	prio_queue_rec_t *rec;
+	prio_heap_t *heap;
+	uint32_t child;
+
+	if (!(rec = _iter_pop(iter)))
+		return false;
+
+	heap = rec->heap;
+	child = (rec->heap_inx * 2) + 1;
+	if (child < heap->cnt)
+		_iter_add(iter, heap->recs[child]);
+	if ((child + 1) < heap->cnt)
+		_iter_add(iter, heap->recs[child + 1]);
+
+	job_queue_rec->array_task_id = rec->array_task_id;
+	job_queue_rec->job_id   = rec->job_id;
+	job_queue_rec->job_ptr  = rec->job_ptr;
+	job_queue_rec->part_ptr = heap->part_ptr;
+	job_queue_rec->priority = rec->priority;
+
+	return true;
+}
+
+extern void prio_queue_iter_destroy(prio_queue_iter_t iter)
+{
+	if (iter) {
+		xfree(iter->recs);
+		xfree(iter);
+	}
+}
+
+extern void prio_queue_fini(void)
+{
+	_free_heaps();
+	xfree(dirty_jobs);
+	dirty_size = 0;
+	sync_time = part_sync_time = 0;
+}
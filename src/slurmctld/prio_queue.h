@@ -0,0 +1,94 @@
+/*****************************************************************************\
+ *  prio_queue.h - persistent priority ordered queue of pending jobs used by
+ *	the main scheduler in place of building and sorting a job queue on
+ *	every pass.
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_PRIO_QUEUE_H
+#define _HAVE_PRIO_QUEUE_H
+
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "src/slurmctld/job_scheduler.h"
+#include "src/slurmctld/slurmctld.h"
+
+typedef struct prio_queue_iter *prio_queue_iter_t;
+
+/*
+ * prio_queue_sync - Bring the queue up to date with the job and partition
+ *	records. Each pending job which is not held has one entry in the queue
+ *	of every partition it requested. Only the jobs passed to
+ *	prio_queue_update_job() since the last call are tested, except that
+ *	all jobs are tested when partitions change and periodically.
+ * NOTE: Caller must hold job write and partition read locks
+ */
+extern void prio_queue_sync(void);
+
+/*
+ * prio_queue_update_job - Note that a job's priority, state, partitions or
+ *	reservation changed. Its entries are moved by the next
+ *	prio_queue_sync(), so this may be called while iterating the queue.
+ * NOTE: Caller must hold job write lock
+ */
+extern void prio_queue_update_job(struct job_record *job_ptr);
+
+/* Remove a job's entries from the queue, called when its record is freed */
+extern void prio_queue_remove_job(struct job_record *job_ptr);
+
+/* Return the count of job/partition pairs in the queue */
+extern uint32_t prio_queue_count(void);
+
+/*
+ * prio_queue_iter_create - Synchronize the queue and return an iterator over
+ *	its entries in the order of sort_job_queue2(), excluding the
+ *	preemption test. Only the entries returned are visited.
+ * NOTE: The job and partition records must not be added or removed until
+ *	prio_queue_iter_destroy() is called
+ */
+extern prio_queue_iter_t prio_queue_iter_create(void);
+
+/*
+ * prio_queue_iter_next - Return the next entry of the queue
+ * IN iter - iterator from prio_queue_iter_create()
+ * OUT job_queue_rec - set to the job, partition and priority of the entry
+ * RET false if no entries remain
+ */
+extern bool prio_queue_iter_next(prio_queue_iter_t iter,
+				 job_queue_rec_t *job_queue_rec);
+
+extern void prio_queue_iter_destroy(prio_queue_iter_t iter);
+
+/* Free all queue entries */
+extern void prio_queue_fini(void);
+
+#endif /* !_HAVE_PRIO_QUEUE_H */
@@ -0,0 +1,721 @@
+/*****************************************************************************\
+ *  rpc_queue.c - slurmctld RPC front end. Incoming messages are read by a
+ *	single event driven thread and queued by priority for a fixed pool
+ *	of worker threads.
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "config.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#ifdef HAVE_SYS_EPOLL_H
+#  include <sys/epoll.h>
+#endif
+
+#if HAVE_SYS_PRCTL_H
+#  include <sys/prctl.h>
+#endif
+
+#include "src/common/fd.h"
+#include "src/common/forward.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/pack.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/slurm_protocol_pack.h"
+#include "src/common/xmalloc.h"
+
+#include "src/slurmctld/proc_req.h"
+#include "src/slurmctld/rpc_queue.h"
+#include "src/slurmctld/slurmctld.h"
+
+#define RPC_EVENT_MAX		64	/* events processed per wakeup */
+#define RPC_MAX_MSG_SIZE	(1024 * 1024 * 1024)
+/* Every RPC_AGING_INTERVAL'th request taken from the queue is the oldest
+ * one rather than the oldest of the highest priority, so that information
+ * requests are not starved by a stream of higher priority work */
+#define RPC_AGING_INTERVAL	8
+/* One of every RPC_HIGH_WORKER_RATIO workers only processes high priority
+ * RPCs, so node registrations and completions continue while the other
+ * workers are blocked */
+#define RPC_HIGH_WORKER_RATIO	8
+
+typedef struct rpc_conn {
+	connection_arg_t arg;		/* socket and client address */
+	bool listen;			/* listening socket */
+	uint32_t msg_len;		/* message length in network order
+					 * until fully read */
+	uint32_t len_read;		/* bytes of msg_len read */
+	char *data;			/* message being read */
+	uint32_t data_read;		/* bytes of data read */
+	time_t start_time;		/* for timeout of partial messages */
+	Buf buffer;			/* complete message */
+	uint16_t msg_type;
+	int prio;
+	struct timeval queue_time;	/* when queued for a worker */
+	struct rpc_conn *next;
+	struct rpc_conn *prev;
+} rpc_conn_t;
+
+typedef struct {
+	rpc_conn_t *head;
+	rpc_conn_t *tail;
+	uint32_t depth;			/* RPCs now queued */
+	uint32_t depth_max;		/* most RPCs queued since reset */
+	uint32_t cnt;			/* RPCs dequeued since reset */
+	uint64_t wait_time;		/* total usec queued since reset */
+} rpc_queue_t;
+
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  queue_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  queue_high_cond = PTHREAD_COND_INITIALIZER;
+static rpc_queue_t rpc_queue[RPC_PRIO_CNT];
+static uint32_t dequeue_cnt = 0;
+static int worker_cnt = 0, worker_busy = 0;
+static pthread_t *worker_tid = NULL;
+static bool queue_shutdown = false;
+
+static rpc_conn_t *partial_list = NULL;	/* connections being read */
+
+#ifdef HAVE_SYS_EPOLL_H
+static int ev_fd = -1;
+#else
+static struct pollfd *ev_pfds = NULL;
+static rpc_conn_t **ev_conns = NULL;
+static int ev_cnt = 0, ev_size = 0;
+#endif
+
+/*
+ * Event notification for the RPC manager. epoll is used where available,
+ * otherwise poll() over the registered descriptors.
+ */
+static void _ev_init(void)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	if ((ev_fd = epoll_create(RPC_EVENT_MAX)) < 0)
+		fatal("%s: epoll_create: %m", __func__);
+	fd_set_close_on_exec(ev_fd);
+#endif
+}
+
+static void _ev_fini(void)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	if (ev_fd >= 0)
+		(void) close(ev_fd);
+	ev_fd = -1;
+#else
+	xfree(ev_pfds);
+	xfree(ev_conns);
+	ev_cnt = ev_size = 0;
+#endif
+}
+
+static int _ev_add(rpc_conn_t *conn)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	struct epoll_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = conn;
+	if (epoll_ctl(ev_fd, EPOLL_CTL_ADD, conn->arg.newsockfd, &ev) < 0) {
+		error("%s: epoll_ctl(%d): %m", __func__, conn->arg.newsockfd);
+		return SLURM_ERROR;
+	}
+#else
+	if (ev_cnt >= ev_size) {
+		ev_size += 64;
+		xrealloc(ev_pfds, sizeof(struct pollfd) * ev_size);
+		xrealloc(ev_conns, sizeof(rpc_conn_t *) * ev_size);
+	}
+	ev_pfds[ev_cnt].fd = conn->arg.newsockfd;
+	ev_pfds[ev_cnt].events = POLLIN;
+	ev_pfds[ev_cnt].revents = 0;
+	ev_conns[ev_cnt++] = conn;
+#endif
+	return SLURM_SUCCESS;
+}
+
+static void _ev_del(rpc_conn_t *conn)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	struct epoll_event ev;
+
+	/* Some old kernels require a non-NULL event */
+	if (epoll_ctl(ev_fd, EPOLL_CTL_DEL, conn->arg.newsockfd, &ev) < 0)
+		error("%s: epoll_ctl(%d): %m", __func__, conn->arg.newsockfd);
+#else
+	int i;
+
+	for (i = 0; i < ev_cnt; i++) {
+		if (ev_conns[i] != conn)
+			continue;
+		ev_cnt--;
+		ev_pfds[i]  = ev_pfds[ev_cnt];
+		ev_conns[i] = ev_conns[ev_cnt];
+		break;
+	}
+#endif
+}
+
+/* Wait for readable connections
+ * OUT ready - connections which can be read
+ * IN timeout - milliseconds to wait
+ * RET count of ready connections */
+static int _ev_wait(rpc_conn_t **ready, int timeout)
+{
+	int i, cnt = 0;
+#ifdef HAVE_SYS_EPOLL_H
+	struct epoll_event ev[RPC_EVENT_MAX];
+
+	cnt = epoll_wait(ev_fd, ev, RPC_EVENT_MAX, timeout);
+	if (cnt < 0) {
+		if (errno != EINTR)
+			error("%s: epoll_wait: %m", __func__);
+		return 0;
+	}
+	for (i = 0; i < cnt; i++)
+		ready[i] = (rpc_conn_t *) ev[i].data.ptr;
+#else
+	int rc;
+
+	rc = poll(ev_pfds, ev_cnt, timeout);
+	if (rc < 0) {
+		if (errno != EINTR)
+			error("%s: poll: %m", __func__);
+		return 0;
+	}
+	for (i = 0; (i < ev_cnt) && (cnt < rc) && (cnt < RPC_EVENT_MAX); i++) {
+		if (ev_pfds[i].revents)
+			ready[cnt++] = ev_conns[i];
+	}
+#endif
+	return cnt;
+}
+
+/* Return the priority with which an RPC of the given type is queued */
+extern int rpc_queue_prio(uint16_t msg_type)
+{
+	switch (msg_type) {
+	case MESSAGE_NODE_REGISTRATION_STATUS:
+	case MESSAGE_EPILOG_COMPLETE:
+	case MESSAGE_COMPOSITE:
+	case REQUEST_COMPLETE_BATCH_JOB:
+	case REQUEST_COMPLETE_BATCH_SCRIPT:
+	case REQUEST_COMPLETE_JOB_ALLOCATION:
+	case REQUEST_COMPLETE_PROLOG:
+	case REQUEST_STEP_COMPLETE:
+	case REQUEST_STEP_COMPLETE_AGGR:
+	case REQUEST_CONTROL:
+	case REQUEST_PING:
+	case REQUEST_SHUTDOWN:
+	case REQUEST_SHUTDOWN_IMMEDIATE:
+	case REQUEST_TAKEOVER:
+		return RPC_PRIO_HIGH;
+	default:
+		break;
+	}
+
+	if ((msg_type >= REQUEST_BUILD_INFO) && (msg_type < REQUEST_UPDATE_JOB))
+		return RPC_PRIO_LOW;
+	return RPC_PRIO_NORMAL;
+}
+
+static void _conn_link(rpc_conn_t **list, rpc_conn_t *conn)
+{
+	conn->prev = NULL;
+	conn->next = *list;
+	if (*list)
+		(*list)->prev = conn;
+	*list = conn;
+}
+
+static void _conn_unlink(rpc_conn_t **list, rpc_conn_t *conn)
+{
+	if (conn->prev)
+		conn->prev->next = conn->next;
+	else
+		*list = conn->next;
+	if (conn->next)
+		conn->next->prev = conn->prev;
+	conn->next = conn->prev = NULL;
+}
+
+static void _conn_close(rpc_conn_t *conn)
+{
+	if ((conn->arg.newsockfd >= 0) &&
+	    (slurm_close(conn->arg.newsockfd) < 0))
+		error("close(%d): %m", conn->arg.newsockfd);
+	xfree(conn->data);
+	free_buf(conn->buffer);
+	xfree(conn);
+}
+
+/* Add a complete message to the queue for its priority */
+static void _enqueue(rpc_conn_t *conn)
+{
+	rpc_queue_t *queue = &rpc_queue[conn->prio];
+
+	gettimeofday(&conn->queue_time, NULL);
+	conn->next = NULL;
+
+	slurm_mutex_lock(&queue_mutex);
+	if (queue->tail)
+		queue->tail->next = conn;
+	else
+		queue->head = conn;
+	queue->tail = conn;
+	queue->depth++;
+	if (queue->depth > queue->depth_max)
+		queue->depth_max = queue->depth;
+	if (conn->prio == RPC_PRIO_HIGH)
+		slurm_cond_signal(&queue_high_cond);
+	slurm_cond_signal(&queue_cond);
+	slurm_mutex_unlock(&queue_mutex);
+}
+
+static bool _tv_older(struct timeval *tv1, struct timeval *tv2)
+{
+	if (tv1->tv_sec != tv2->tv_sec)
+		return (tv1->tv_sec < tv2->tv_sec);
+	return (tv1->tv_usec < tv2->tv_usec);
+}
+
+/* Take the next RPC to process from the queues, waiting as needed
+ * IN high_only - only take high priority RPCs
+ * RET RPC or NULL at shutdown once the queues are empty */
+static rpc_conn_t *_dequeue(bool high_only)
+{
+	rpc_queue_t *queue = NULL;
+	rpc_conn_t *conn;
+	struct timeval now;
+	int i;
+
+	slurm_mutex_lock(&queue_mutex);
+	while (1) {
+		if (high_only) {
+			if (rpc_queue[RPC_PRIO_HIGH].head)
+				queue = &rpc_queue[RPC_PRIO_HIGH];
+		} else if ((++dequeue_cnt % RPC_AGING_INTERVAL) == 0) {
+			for (i = 0; i < RPC_PRIO_CNT; i++) {
+				if (!rpc_queue[i].head)
+					continue;
+				if (!queue ||
+				    _tv_older(&rpc_queue[i].head->queue_time,
+					      &queue->head->queue_time))
+					queue = &rpc_queue[i];
+			}
+		} else {
+			for (i = 0; i < RPC_PRIO_CNT; i++) {
+				if (rpc_queue[i].head) {
+					queue = &rpc_queue[i];
+					break;
+				}
+			}
+		}
+		if (queue || queue_shutdown)
+			break;
+		slurm_cond_wait(high_only ? &queue_high_cond : &queue_cond,
+				&queue_mutex);
+	}
+
+	if (!queue) {
+		slurm_mutex_unlock(&queue_mutex);
+		return NULL;
+	}
+
+	conn = queue->head;
+	queue->head = conn->next;
+	if (!queue->head)
+		queue->tail = NULL;
+	queue->depth--;
+	queue->cnt++;
+	gettimeofday(&now, NULL);
+	conn->arg.queue_usec = (now.tv_sec - conn->queue_time.tv_sec) *
+			       1000000 +
+			       (now.tv_usec - conn->queue_time.tv_usec);
+	queue->wait_time += conn->arg.queue_usec;
+	worker_busy++;
+	slurm_mutex_unlock(&queue_mutex);
+
+	return conn;
+}
+
+/* Unpack and process one RPC, then close its connection */
+static void _service_conn(rpc_conn_t *conn)
+{
+	slurm_msg_t msg;
+
+	slurm_msg_t_init(&msg);
+	msg.flags |= SLURM_MSG_KEEP_BUFFER;
+	/*
+	 * Setting the msg connection fd to the accepted fd allows
+	 * slurmctld_req() to close the accepted connection.
+	 */
+	msg.conn_fd = conn->arg.newsockfd;
+	msg.buffer = conn->buffer;
+	conn->buffer = NULL;
+	if (slurm_unpack_received_msg(&msg, conn->arg.newsockfd,
+				      msg.buffer) != 0) {
+		char addr_buf[32];
+		slurm_print_slurm_addr(&conn->arg.cli_addr, addr_buf,
+				       sizeof(addr_buf));
+		error("slurm_receive_msg [%s]: %m", addr_buf);
+	} else {
+		slurmctld_req(&msg, &conn->arg);
+	}
+
+	slurm_free_msg_members(&msg);
+	_conn_close(conn);
+}
+
+static void *_rpc_worker(void *arg)
+{
+	bool high_only = (bool) (intptr_t) arg;
+	rpc_conn_t *conn;
+
+#if HAVE_SYS_PRCTL_H
+	if (prctl(PR_SET_NAME, "rpcwrk", NULL, NULL, NULL) < 0) {
+		error("%s: cannot set my name to %s %m", __func__, "rpcwrk");
+	}
+#endif
+
+	while ((conn = _dequeue(high_only))) {
+		_service_conn(conn);
+		slurm_mutex_lock(&queue_mutex);
+		worker_busy--;
+		slurm_mutex_unlock(&queue_mutex);
+		server_thread_decr();
+	}
+
+	return NULL;
+}
+
+/* The whole message has been read, queue it for a worker */
+static void _conn_complete(rpc_conn_t *conn)
+{
+	header_t header;
+
+	_ev_del(conn);
+	_conn_unlink(&partial_list, conn);
+
+	conn->buffer = create_buf(conn->data, conn->data_read);
+	conn->data = NULL;
+	memset(&header, 0, sizeof(header_t));
+	if (unpack_header(&header, conn->buffer) == SLURM_SUCCESS) {
+		conn->msg_type = header.msg_type;
+		destroy_forward(&header.forward);
+		FREE_NULL_LIST(header.ret_list);
+	}
+	set_buf_offset(conn->buffer, 0);
+	conn->prio = rpc_queue_prio(conn->msg_type);
+
+	/* Count the RPC against the thread limit from the time it is
+	 * queued, so the limit bounds the queue depth */
+	if (!server_thread_wait()) {
+		_conn_close(conn);	/* Shutting down */
+		return;
+	}
+	_enqueue(conn);
+}
+
+static void _conn_error(rpc_conn_t *conn, char *msg)
+{
+	char addr_buf[32];
+
+	slurm_print_slurm_addr(&conn->arg.cli_addr, addr_buf,
+			       sizeof(addr_buf));
+	if (msg)
+		error("slurm_receive_msg [%s]: %s", addr_buf, msg);
+	else
+		error("slurm_receive_msg [%s]: %m", addr_buf);
+	_ev_del(conn);
+	_conn_unlink(&partial_list, conn);
+	_conn_close(conn);
+}
+
+/* Read what is available of a connection's message: a 32-bit length in
+ * network byte order followed by that many bytes */
+static void _conn_read(rpc_conn_t *conn)
+{
+	int fd = conn->arg.newsockfd;
+	ssize_t len;
+
+	while (conn->len_read < sizeof(conn->msg_len)) {
+		len = read(fd, ((char *) &conn->msg_len) + conn->len_read,
+			   sizeof(conn->msg_len) - conn->len_read);
+		if (len == 0) {
+			_conn_error(conn, "Zero Bytes were transmitted or "
+				    "received");
+			return;
+		}
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				return;
+			_conn_error(conn, NULL);
+			return;
+		}
+		conn->len_read += len;
+		if (conn->len_read < sizeof(conn->msg_len))
+			continue;
+		conn->msg_len = ntohl(conn->msg_len);
+		if (conn->msg_len > RPC_MAX_MSG_SIZE) {
+			_conn_error(conn, "Insane message length");
+			return;
+		}
+		conn->data = xmalloc_nz(conn->msg_len + 1);
+	}
+
+	while (conn->data_read < conn->msg_len) {
+		len = read(fd, conn->data + conn->data_read,
+			   conn->msg_len - conn->data_read);
+		if (len == 0) {
+			_conn_error(conn, "Zero Bytes were transmitted or "
+				    "received");
+			return;
+		}
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				return;
+			_conn_error(conn, NULL);
+			return;
+		}
+		conn->data_read += len;
+	}
+
+	_conn_complete(conn);
+}
+
+/* Accept all pending connections on a listening socket */
+static void _conn_accept(rpc_conn_t *listen_conn)
+{
+	rpc_conn_t *conn;
+	slurm_addr_t cli_addr;
+	int newsockfd;
+
+	while (!slurmctld_config.shutdown_time) {
+		/*
+		 * accept needed for stream implementation is a no-op in
+		 * message implementation that just passes sockfd to newsockfd
+		 */
+		if ((newsockfd = slurm_accept_msg_conn(
+				listen_conn->arg.newsockfd, &cli_addr)) ==
+		    SLURM_SOCKET_ERROR) {
+			if ((errno != EINTR) && (errno != EAGAIN) &&
+			    (errno != EWOULDBLOCK))
+				error("slurm_accept_msg_conn: %m");
+			return;
+		}
+		fd_set_close_on_exec(newsockfd);
+		fd_set_nonblocking(newsockfd);
+
+		if (slurmctld_conf.debug_flags & DEBUG_FLAG_PROTOCOL) {
+			char inetbuf[64];
+
+			slurm_print_slurm_addr(&cli_addr, inetbuf,
+					       sizeof(inetbuf));
+			info("%s: accept() connection from %s",
+			     __func__, inetbuf);
+		}
+
+		conn = xmalloc(sizeof(rpc_conn_t));
+		conn->arg.newsockfd = newsockfd;
+		memcpy(&conn->arg.cli_addr, &cli_addr, sizeof(slurm_addr_t));
+		conn->start_time = time(NULL);
+		if (_ev_add(conn) != SLURM_SUCCESS) {
+			_conn_close(conn);
+			continue;
+		}
+		_conn_link(&partial_list, conn);
+	}
+}
+
+/* Close connections which have not sent a whole message in time */
+static void _conn_expire(time_t now, int timeout)
+{
+	rpc_conn_t *conn, *next_conn;
+
+	for (conn = partial_list; conn; conn = next_conn) {
+		next_conn = conn->next;
+		if (difftime(now, conn->start_time) < timeout)
+			continue;
+		_conn_error(conn, "Socket timed out on send/recv operation");
+	}
+}
+
+/*
+ * rpc_queue_run - Read incoming RPCs from the listening sockets and queue
+ *	them for processing by worker threads until slurmctld shutdown
+ * IN sockfd - listening sockets
+ * IN nports - count of listening sockets
+ * IN thread_cnt - number of worker threads to process RPCs
+ * NOTE: Each queued RPC is counted in slurmctld_config.server_thread_count,
+ *	reading stops while that is at the server thread limit
+ * NOTE: Call rpc_queue_fini() to wait for queued RPCs to be processed
+ */
+extern void rpc_queue_run(int *sockfd, int nports, int thread_cnt)
+{
+	rpc_conn_t **listen_conn, *ready[RPC_EVENT_MAX];
+	pthread_attr_t thread_attr;
+	time_t now, last_expire = time(NULL);
+	int i, cnt, msg_timeout;
+
+	queue_shutdown = false;
+	worker_cnt = MAX(thread_cnt, 2);
+	worker_tid = xmalloc(sizeof(pthread_t) * worker_cnt);
+	for (i = 0; i < worker_cnt; i++) {
+		bool high_only = ((i % RPC_HIGH_WORKER_RATIO) == 0);
+		slurm_attr_init(&thread_attr);
+		while (pthread_create(&worker_tid[i], &thread_attr,
+				      _rpc_worker,
+				      (void *) (intptr_t) high_only)) {
+			error("pthread_create error %m");
+			sleep(1);
+		}
+		slurm_attr_destroy(&thread_attr);
+	}
+
+	_ev_init();
+	listen_conn = xmalloc(sizeof(rpc_conn_t *) * nports);
+	for (i = 0; i < nports; i++) {
+		listen_conn[i] = xmalloc(sizeof(rpc_conn_t));
+		listen_conn[i]->listen = true;
+		listen_conn[i]->arg.newsockfd = sockfd[i];
+		fd_set_nonblocking(sockfd[i]);
+		if (_ev_add(listen_conn[i]) != SLURM_SUCCESS)
+			fatal("%s: unable to watch listening socket", __func__);
+	}
+
+	msg_timeout = slurm_get_msg_timeout();
+	while (!slurmctld_config.shutdown_time) {
+		cnt = _ev_wait(ready, 1000);
+		for (i = 0; i < cnt; i++) {
+			if (ready[i]->listen)
+				_conn_accept(ready[i]);
+			else
+				_conn_read(ready[i]);
+		}
+
+		now = time(NULL);
+		if (now != last_expire) {
+			_conn_expire(now, msg_timeout);
+			last_expire = now;
+		}
+	}
+
+	while (partial_list) {
+		rpc_conn_t *conn = partial_list;
+		_conn_unlink(&partial_list, conn);
+		_conn_close(conn);
+	}
+	for (i = 0; i < nports; i++)
+		xfree(listen_conn[i]);	/* sockets closed by caller */
+	xfree(listen_conn);
+	_ev_fini();
+
+	/* Workers finish the queued RPCs, then exit */
+	slurm_mutex_lock(&queue_mutex);
+	queue_shutdown = true;
+	slurm_cond_broadcast(&queue_cond);
+	slurm_cond_broadcast(&queue_high_cond);
+	slurm_mutex_unlock(&queue_mutex);
+}
+
+/* Wait for the worker threads to process all queued RPCs and exit */
+extern void rpc_queue_fini(void)
+{
+	int i;
+
+	for (i = 0; i < worker_cnt; i++)
+		pthread_join(worker_tid[i], NULL);
+	xfree(worker_tid);
+	worker_cnt = 0;
+}
+
+/* Reset RPC queue statistics */
+extern void reset_rpc_queue_stats(void)
+{
+	int i;
+
+	slurm_mutex_lock(&queue_mutex);
+	for (i = 0; i < RPC_PRIO_CNT; i++) {
+		rpc_queue[i].depth_max = rpc_queue[i].depth;
+		rpc_queue[i].cnt = 0;
+		rpc_queue[i].wait_time = 0;
+	}
+	slurm_mutex_unlock(&queue_mutex);
+}
+
+/* pack_rpc_queue_stats - Append RPC queue statistics to an sdiag response
+ * IN/OUT buffer_ptr - packed response, reallocated as needed
+ * IN/OUT buffer_size - size of the packed response in bytes
+ * IN protocol_version - slurm protocol version of client */
+extern void pack_rpc_queue_stats(char **buffer_ptr, int *buffer_size,
+				 uint16_t protocol_version)
+{
+	Buf buffer;
+	int i;
+
+	if (protocol_version < SLURM_17_02_PROTOCOL_VERSION)
+		return;
+
+	buffer = create_buf(*buffer_ptr, *buffer_size);
+	set_buf_offset(buffer, *buffer_size);
+
+	slurm_mutex_lock(&queue_mutex);
+	pack32(worker_cnt, buffer);
+	pack32(worker_busy, buffer);
+	pack32(RPC_PRIO_CNT, buffer);
+	for (i = 0; i < RPC_PRIO_CNT; i++) {
+		pack32(rpc_queue[i].depth, buffer);
+		pack32(rpc_queue[i].depth_max, buffer);
+		pack32(rpc_queue[i].cnt, buffer);
+		pack64(rpc_queue[i].wait_time, buffer);
+	}
+	slurm_mutex_unlock(&queue_mutex);
+
+	*buffer_size = get_buf_offset(buffer);
+	buffer_ptr[0] = xfer_buf_data(buffer);
+}
@@ -0,0 +1,75 @@
+/*****************************************************************************\
+ *  rpc_queue.h - slurmctld RPC front end. Incoming messages are read by a
+ *	single event driven thread and queued by priority for a fixed pool
+ *	of worker threads.
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_RPC_QUEUE_H
+#define _HAVE_RPC_QUEUE_H
+
+#include <inttypes.h>
+
+/* RPC priorities, lower values are processed first */
+#define RPC_PRIO_HIGH	0	/* node registration, job and step completion */
+#define RPC_PRIO_NORMAL	1	/* job submission and control */
+#define RPC_PRIO_LOW	2	/* information requests */
+#define RPC_PRIO_CNT	3
+
+/* Return the priority with which an RPC of the given type is queued */
+extern int rpc_queue_prio(uint16_t msg_type);
+
+/*
+ * rpc_queue_run - Read incoming RPCs from the listening sockets and queue
+ *	them for processing by worker threads until slurmctld shutdown
+ * IN sockfd - listening sockets
+ * IN nports - count of listening sockets
+ * IN thread_cnt - number of worker threads to process RPCs
+ * NOTE: Each queued RPC is counted in slurmctld_config.server_thread_count,
+ *	reading stops while that is at the server thread limit
+ * NOTE: Call rpc_queue_fini() to wait for queued RPCs to be processed
+ */
+extern void rpc_queue_run(int *sockfd, int nports, int thread_cnt);
+
+/* Wait for the worker threads to process all queued RPCs and exit */
+extern void rpc_queue_fini(void);
+
+/* Reset RPC queue statistics */
+extern void reset_rpc_queue_stats(void);
+
+/* pack_rpc_queue_stats - Append RPC queue statistics to an sdiag response
+ * IN/OUT buffer_ptr - packed response, reallocated as needed
+ * IN/OUT buffer_size - size of the packed response in bytes
+ * IN protocol_version - slurm protocol version of client */
+extern void pack_rpc_queue_stats(char **buffer_ptr, int *buffer_size,
+				 uint16_t protocol_version);
+
+#endif /* !_HAVE_RPC_QUEUE_H */
@@ -79,6 +79,12 @@
 #define MAX_SERVER_THREADS 256
 #endif
 
+/* Threads processing incoming RPCs. RPCs beyond this count wait in a queue,
+ * up to MAX_SERVER_THREADS RPCs being queued or processed. */
+#ifndef RPC_WORKER_THREADS
+#define RPC_WORKER_THREADS 64
+#endif
+
 /* Perform full slurmctld's state every PERIODIC_CHECKPOINT seconds */
 #ifndef PERIODIC_CHECKPOINT
 #define	PERIODIC_CHECKPOINT	300
@@ -149,6 +155,8 @@ typedef struct slurmctld_config {
 	pthread_t thread_id_rpc;
 } slurmctld_config_t;
 
+#define BF_MAX_THREADS	64	/* most backfill worker threads */
+
 /* Job scheduling statistics */
 typedef struct diag_stats {
 	int proc_req_threads;
@@ -181,6 +189,34 @@ typedef struct diag_stats {
 	uint32_t bf_queue_len_sum;
 	time_t   bf_when_last_cycle;
 	uint32_t bf_active;
+	uint32_t bf_group_cnt;		/* node set groups in last cycle */
+	uint32_t bf_worker_cnt;		/* worker threads in last cycle */
+	uint32_t bf_worker_group_cnt[BF_MAX_THREADS];	/* groups tested */
+	uint32_t bf_worker_depth[BF_MAX_THREADS];	/* jobs considered */
+	uint32_t bf_worker_depth_try[BF_MAX_THREADS];	/* jobs tested */
+	uint64_t bf_worker_test_time[BF_MAX_THREADS];	/* usec testing */
+	uint32_t bf_worker_overlap[BF_MAX_THREADS];	/* tests run while
+							 * another worker
+							 * was testing */
+
+	uint32_t job_info_cache_hits;	/* REQUEST_JOB_INFO served from a
+					 * shared snapshot */
+	uint32_t job_info_cache_misses;	/* snapshots packed */
+
+	uint32_t job_state_ckpt_cnt;	/* job_state files written */
+	uint32_t job_state_journal_cnt;	/* job state journal records written */
+	uint64_t job_state_bytes;	/* job state bytes written */
+	uint32_t job_state_journal_size; /* bytes in job state journal */
+	uint32_t job_state_load_time;	/* usec to load job state at startup */
+
+	uint32_t prio_calc_cnt;		/* priority recalculations */
+	uint32_t prio_calc_jobs;	/* jobs in last recalculation */
+	uint32_t prio_calc_threads;	/* threads in last recalculation */
+	uint32_t prio_decay_time;	/* usec decaying association usage */
+	uint32_t prio_usage_time;	/* usec applying new job usage */
+	uint32_t prio_fs_time;		/* usec calculating fair share */
+	uint32_t prio_factor_time;	/* usec calculating job priorities */
+	uint32_t prio_store_time;	/* usec storing job priorities */
 } diag_stats_t;
 
 /* This is used to point out constants that exist in the
@@ -649,9 +685,8 @@ struct job_record {
 					 * to be passed to slurmdbd */
 	uint32_t group_id;		/* group submitted under */
 	uint32_t job_id;		/* job ID */
-	struct job_record *job_next;	/* next entry with same hash index */
-	struct job_record *job_array_next_j; /* job array linked list by job_id */
-	struct job_record *job_array_next_t; /* job array linked list by task_id */
+	struct job_record *job_array_next_j; /* next task of same job array */
+	struct job_record *job_array_prev_j; /* prev task of same job array */
 	job_resources_t *job_resrcs;	/* details of allocated cores */
 	uint32_t job_state;		/* state of the job */
 	uint16_t kill_on_node_fail;	/* 1 if job should be killed on
@@ -712,6 +747,12 @@ struct job_record {
 	uint32_t *priority_array;	/* partition based priority */
 	priority_factors_object_t *prio_factors; /* cached value used
 						  * by sprio command */
+	struct prio_queue_rec **prio_queue_recs; /* entries in the pending
+						  * job queue, one for each
+						  * partition (Internal use
+						  * only, don't save) */
+	uint16_t prio_queue_cnt;	/* count of prio_queue_recs */
+	bool prio_queue_dirty;		/* entries need a sync */
 	uint32_t profile;		/* Acct_gather_profile option */
 	uint32_t qos_id;		/* quality of service id */
 	void *qos_ptr;			/* pointer to the quality of
@@ -897,8 +938,11 @@ enum select_plugindata_info {
 	SELECT_AVAIL_MEMORY, /* data-> uint64 avail mem  (CR support) */
 	SELECT_STATIC_PART,  /* data-> uint16, 1 if static partitioning
 			      * BlueGene support */
-	SELECT_CONFIG_INFO   /* data-> List get .conf info from select
+	SELECT_CONFIG_INFO,  /* data-> List get .conf info from select
 			      * plugin */
+	SELECT_WILL_RUN_REENTRANT /* data-> uint32 1 if select_p_job_test()
+				   * in SELECT_MODE_WILL_RUN can run in
+				   * several threads at the same time */
 } ;
 
 /*****************************************************************************\
@@ -1769,6 +1813,50 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 			  uint16_t show_flags, uid_t uid, uint32_t filter_uid,
 			  uint16_t protocol_version);
 
+/*
+ * pack_all_jobs_cached - equivalent to pack_all_jobs(), but the job records
+ *	are packed once into a snapshot shared by all requests for the same
+ *	show_flags and protocol_version until job or partition records change
+ * OUT buffer_ptr - the pointer is set to the response buffer
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN show_flags - job filtering options
+ * IN uid - uid of user making request (for partition filtering)
+ * IN filter_uid - pack only jobs belonging to this user if not NO_VAL
+ * IN protocol_version - slurm protocol version of client
+ * OUT cache_ref - reference to the snapshot used, if any
+ * NOTE: the buffer must be released with pack_all_jobs_free()
+ * NOTE: READ lock_slurmctld config, job and partition before entry
+ */
+extern void pack_all_jobs_cached(char **buffer_ptr, int *buffer_size,
+				 uint16_t show_flags, uid_t uid,
+				 uint32_t filter_uid, uint16_t protocol_version,
+				 void **cache_ref);
+
+/*
+ * pack_all_jobs_free - release a buffer from pack_all_jobs_cached()
+ * IN buffer - response buffer
+ * IN cache_ref - snapshot reference from pack_all_jobs_cached()
+ */
+extern void pack_all_jobs_free(char *buffer, void *cache_ref);
+
+/*
+ * pack_all_jobs_delta - dump the job records which changed since a previous
+ *	response in machine independent form (for network transmission).
+ *	Only jobs the client holds are reported as removed. If the client's
+ *	generation can not be compared, all visible records are packed and
+ *	the response is flagged JOB_INFO_DELTA_COMPLETE.
+ * OUT buffer_ptr - the pointer is set to the allocated buffer.
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN req_ptr - generation and job IDs held by the client, show_flags
+ * IN uid - uid of user making request (for partition filtering)
+ * IN protocol_version - slurm protocol version of client
+ * NOTE: the buffer at *buffer_ptr must be xfreed by the caller
+ * NOTE: READ lock_slurmctld config, job and partition before entry
+ */
+extern void pack_all_jobs_delta(char **buffer_ptr, int *buffer_size,
+				job_info_delta_request_msg_t *req_ptr,
+				uid_t uid, uint16_t protocol_version);
+
 /*
  * pack_all_node - dump all configuration and node information for all nodes
  *	in machine independent form (for network transmission)
@@ -1883,13 +1971,24 @@ extern void pack_one_node (char **buffer_ptr, int *buffer_size,
 			   uint16_t show_flags, uid_t uid, char *node_name,
 			   uint16_t protocol_version);
 
-/* part_filter_clear - Clear the partition's hidden flag based upon a user's
- * group access. This must follow a call to part_filter_set() */
-extern void part_filter_clear(void);
+/*
+ * part_hidden_build - Build a snapshot of the partitions which are hidden
+ *	from a given user, either through the Hidden flag or AllowGroups
+ * IN uid - user ID making the request
+ * RET NULL terminated array of hidden partitions or NULL if none are hidden,
+ *	free with xfree()
+ * NOTE: READ lock_slurmctld part before entry
+ */
+extern struct part_record **part_hidden_build(uid_t uid);
 
-/* part_filter_set - Set the partition's hidden flag based upon a user's
- * group access. This must be followed by a call to part_filter_clear() */
-extern void part_filter_set(uid_t uid);
+/*
+ * part_is_hidden - Test if a partition is in a snapshot of hidden partitions
+ * IN part_ptr - partition to test
+ * IN hidden - snapshot from part_hidden_build()
+ * RET true if the partition is hidden
+ */
+extern bool part_is_hidden(struct part_record *part_ptr,
+			   struct part_record **hidden);
 
 /* part_fini - free all memory associated with partition records */
 extern void part_fini (void);
@@ -1952,7 +2051,7 @@ extern void qos_list_build(char *qos, bitstr_t **qos_bits);
 extern void queue_job_scheduler(void);
 
 /*
- * rehash_jobs - Create or rebuild the job hash table.
+ * rehash_jobs - Create the job hash tables.
  * NOTE: run lock_slurmctld before entry: Read config, write job
  */
 extern void rehash_jobs(void);
@@ -2047,6 +2146,11 @@ extern void server_thread_decr(void);
 /* Increment slurmctld thread count (as applies to thread limit) */
 extern void server_thread_incr(void);
 
+/* Increment slurmctld thread count (as applies to thread limit), first
+ * waiting until the count is below the limit
+ * RET true unless shutdown in progress */
+extern bool server_thread_wait(void);
+
 /* Set a job's alias_list string */
 extern void set_job_alias_list(struct job_record *job_ptr);
 
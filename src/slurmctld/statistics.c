@@ -111,6 +111,61 @@ extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 			pack32(slurmctld_diag_stats.bf_depth_try_sum, buffer);
 			pack32(slurmctld_diag_stats.bf_queue_len_sum, buffer);
 			pack32(slurmctld_diag_stats.bf_active,	 buffer);
+
+			if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+				pack32(slurmctld_diag_stats.
+				       job_info_cache_hits, buffer);
+				pack32(slurmctld_diag_stats.
+				       job_info_cache_misses, buffer);
+				pack32(slurmctld_diag_stats.
+				       job_state_ckpt_cnt, buffer);
+				pack32(slurmctld_diag_stats.
+				       job_state_journal_cnt, buffer);
+				pack64(slurmctld_diag_stats.
+				       job_state_bytes, buffer);
+				pack32(slurmctld_diag_stats.
+				       job_state_journal_size, buffer);
+				pack32(slurmctld_diag_stats.
+				       job_state_load_time, buffer);
+				pack32(slurmctld_diag_stats.bf_group_cnt,
+				       buffer);
+				pack32_array(slurmctld_diag_stats.
+					     bf_worker_group_cnt,
+					     slurmctld_diag_stats.bf_worker_cnt,
+					     buffer);
+				pack32_array(slurmctld_diag_stats.
+					     bf_worker_depth,
+					     slurmctld_diag_stats.bf_worker_cnt,
+					     buffer);
+				pack32_array(slurmctld_diag_stats.
+					     bf_worker_depth_try,
+					     slurmctld_diag_stats.bf_worker_cnt,
+					     buffer);
+				pack64_array(slurmctld_diag_stats.
+					     bf_worker_test_time,
+					     slurmctld_diag_stats.bf_worker_cnt,
+					     buffer);
+				pack32_array(slurmctld_diag_stats.
+					     bf_worker_overlap,
+					     slurmctld_diag_stats.bf_worker_cnt,
+					     buffer);
+				pack32(slurmctld_diag_stats.prio_calc_cnt,
+				       buffer);
+				pack32(slurmctld_diag_stats.prio_calc_jobs,
+				       buffer);
+				pack32(slurmctld_diag_stats.prio_calc_threads,
+				       buffer);
+				pack32(slurmctld_diag_stats.prio_decay_time,
+				       buffer);
+				pack32(slurmctld_diag_stats.prio_usage_time,
+				       buffer);
+				pack32(slurmctld_diag_stats.prio_fs_time,
+				       buffer);
+				pack32(slurmctld_diag_stats.prio_factor_time,
+				       buffer);
+				pack32(slurmctld_diag_stats.prio_store_time,
+				       buffer);
+			}
 		}
 	}
 
@@ -150,6 +205,21 @@ extern void reset_stats(int level)
 	slurmctld_diag_stats.bf_last_depth = 0;
 	slurmctld_diag_stats.bf_last_depth_try = 0;
 	slurmctld_diag_stats.bf_active = 0;
+	slurmctld_diag_stats.bf_group_cnt = 0;
+	slurmctld_diag_stats.bf_worker_cnt = 0;
+	slurmctld_diag_stats.job_info_cache_hits = 0;
+	slurmctld_diag_stats.job_info_cache_misses = 0;
+	slurmctld_diag_stats.job_state_ckpt_cnt = 0;
+	slurmctld_diag_stats.job_state_journal_cnt = 0;
+	slurmctld_diag_stats.job_state_bytes = 0;
+	slurmctld_diag_stats.prio_calc_cnt = 0;
+	slurmctld_diag_stats.prio_calc_jobs = 0;
+	slurmctld_diag_stats.prio_calc_threads = 0;
+	slurmctld_diag_stats.prio_decay_time = 0;
+	slurmctld_diag_stats.prio_usage_time = 0;
+	slurmctld_diag_stats.prio_fs_time = 0;
+	slurmctld_diag_stats.prio_factor_time = 0;
+	slurmctld_diag_stats.prio_store_time = 0;
 
 	last_proc_req_start = time(NULL);
 }
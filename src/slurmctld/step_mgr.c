@@ -2473,8 +2473,7 @@ step_create(job_step_create_request_msg_t *step_specs,
 		break;
 	}
 
-	step_ptr->gres      = step_specs->gres;
-	step_specs->gres    = NULL;
+	step_ptr->gres      = xmove(step_specs->gres);
 	step_ptr->gres_list = step_gres_list;
 	step_gres_list      = (List) NULL;
 	gres_plugin_step_state_log(step_ptr->gres_list, job_ptr->job_id,
@@ -3084,11 +3083,13 @@ extern int pack_ctld_job_step_info_response_msg(
 	struct job_record *job_ptr;
 	time_t now = time(NULL);
 	int valid_job = 0;
+	struct part_record **hidden = NULL;
 
 	pack_time(now, buffer);
 	pack32(steps_packed, buffer);	/* steps_packed placeholder */
 
-	part_filter_set(uid);
+	if (((show_flags & SHOW_ALL) == 0) && (uid != 0))
+		hidden = part_hidden_build(uid);
 
 	job_iterator = list_iterator_create(job_list);
 	while ((job_ptr = list_next(job_iterator))) {
@@ -3098,9 +3099,8 @@ extern int pack_ctld_job_step_info_response_msg(
 
 		valid_job = 1;
 
-		if (((show_flags & SHOW_ALL) == 0) && (uid != 0) &&
-		    (job_ptr->part_ptr) &&
-		    (job_ptr->part_ptr->flags & PART_FLAG_HIDDEN))
+		if (job_ptr->part_ptr &&
+		    part_is_hidden(job_ptr->part_ptr, hidden))
 			continue;
 
 		if ((slurmctld_conf.private_data & PRIVATE_DATA_JOBS) &&
@@ -3128,7 +3128,7 @@ extern int pack_ctld_job_step_info_response_msg(
 	if (list_count(job_list) && !valid_job && !steps_packed)
 		error_code = ESLURM_INVALID_JOB_ID;
 
-	part_filter_clear();
+	xfree(hidden);
 
 	/* put the real record count in the message body header */
 	tmp_offset = get_buf_offset(buffer);
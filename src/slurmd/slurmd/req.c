@@ -86,6 +86,7 @@
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_protocol_interface.h"
 #include "src/common/stepd_api.h"
+#include "src/common/timers.h"
 #include "src/common/uid.h"
 #include "src/common/util-net.h"
 #include "src/common/xstring.h"
@@ -482,10 +483,15 @@ static int _send_slurmd_conf_lite (int fd, slurmd_conf_t *cf)
 	return (-1);
 }
 
+/*
+ * Send a slurmstepd its initialization data. A pooled slurmstepd was sent
+ * the slurmd's configuration when it was started, so it is not sent again.
+ */
 static int
 _send_slurmstepd_init(int fd, int type, void *req,
 		      slurm_addr_t *cli, slurm_addr_t *self,
-		      hostset_t step_hset, uint16_t protocol_version)
+		      hostset_t step_hset, uint16_t protocol_version,
+		      bool pooled)
 {
 	int len = 0;
 	Buf buffer = NULL;
@@ -588,7 +594,7 @@ _send_slurmstepd_init(int fd, int type, void *req,
 	safe_write(fd, &parent_addr, sizeof(slurm_addr_t));
 
 	/* send conf over to slurmstepd */
-	if (_send_slurmd_conf_lite(fd, conf) < 0)
+	if (!pooled && (_send_slurmd_conf_lite(fd, conf) < 0))
 		goto rwfail;
 
 	/* send cli address over to slurmstepd */
@@ -725,11 +731,486 @@ rwfail:
 
 
 /*
- * Fork and exec the slurmstepd, then send the slurmstepd its
- * initialization data.  Then wait for slurmstepd to send an "ok"
- * message before returning.  When the "ok" message is received,
- * the slurmstepd has created and begun listening on its unix
- * domain socket.
+ * Child side of the fork of a slurmstepd: fork again so that init, not the
+ * slurmd, becomes the slurmstepd's parent, and exec it with to_stepd as
+ * its stdin and to_slurmd as its stdout. A pooled slurmstepd loads its
+ * plugins and waits for its initialization data. Does not return.
+ */
+static void
+_exec_slurmstepd(uint16_t type, void *req, int to_stepd[2], int to_slurmd[2],
+		 bool pooled)
+{
+	pid_t pid;
+#if (SLURMSTEPD_MEMCHECK == 1)
+	/* memcheck test of slurmstepd, option #1 */
+	char *const argv[3] = {"memcheck",
+			       (char *)conf->stepd_loc, NULL};
+#elif (SLURMSTEPD_MEMCHECK == 2)
+	/* valgrind test of slurmstepd, option #2 */
+	uint32_t job_id = 0, step_id = 0;
+	char log_file[256];
+	char *const argv[13] = {"valgrind", "--tool=memcheck",
+				"--error-limit=no",
+				"--leak-check=summary",
+				"--show-reachable=yes",
+				"--max-stackframe=16777216",
+				"--num-callers=20",
+				"--child-silent-after-fork=yes",
+				"--track-origins=yes",
+				log_file, (char *)conf->stepd_loc,
+				NULL};
+	if (type == LAUNCH_BATCH_JOB) {
+		job_id = ((batch_job_launch_msg_t *)req)->job_id;
+		step_id = ((batch_job_launch_msg_t *)req)->step_id;
+	} else if (type == LAUNCH_TASKS) {
+		job_id = ((launch_tasks_request_msg_t *)req)->job_id;
+		step_id = ((launch_tasks_request_msg_t *)req)->job_step_id;
+	}
+	snprintf(log_file, sizeof(log_file),
+		 "--log-file=/tmp/slurmstepd_valgrind_%u.%u",
+		 job_id, step_id);
+#elif (SLURMSTEPD_MEMCHECK == 3)
+	/* valgrind/drd test of slurmstepd, option #3 */
+	uint32_t job_id = 0, step_id = 0;
+	char log_file[256];
+	char *const argv[10] = {"valgrind", "--tool=drd",
+				"--error-limit=no",
+				"--max-stackframe=16777216",
+				"--num-callers=20",
+				"--child-silent-after-fork=yes",
+				log_file, (char *)conf->stepd_loc,
+				NULL};
+	if (type == LAUNCH_BATCH_JOB) {
+		job_id = ((batch_job_launch_msg_t *)req)->job_id;
+		step_id = ((batch_job_launch_msg_t *)req)->step_id;
+	} else if (type == LAUNCH_TASKS) {
+		job_id = ((launch_tasks_request_msg_t *)req)->job_id;
+		step_id = ((launch_tasks_request_msg_t *)req)->job_step_id;
+	}
+	snprintf(log_file, sizeof(log_file),
+		 "--log-file=/tmp/slurmstepd_valgrind_%u.%u",
+		 job_id, step_id);
+#elif (SLURMSTEPD_MEMCHECK == 4)
+	/* valgrind/helgrind test of slurmstepd, option #4 */
+	uint32_t job_id = 0, step_id = 0;
+	char log_file[256];
+	char *const argv[10] = {"valgrind", "--tool=helgrind",
+				"--error-limit=no",
+				"--max-stackframe=16777216",
+				"--num-callers=20",
+				"--child-silent-after-fork=yes",
+				log_file, (char *)conf->stepd_loc,
+				NULL};
+	if (type == LAUNCH_BATCH_JOB) {
+		job_id = ((batch_job_launch_msg_t *)req)->job_id;
+		step_id = ((batch_job_launch_msg_t *)req)->step_id;
+	} else if (type == LAUNCH_TASKS) {
+		job_id = ((launch_tasks_request_msg_t *)req)->job_id;
+		step_id = ((launch_tasks_request_msg_t *)req)->job_step_id;
+	}
+	snprintf(log_file, sizeof(log_file),
+		 "--log-file=/tmp/slurmstepd_valgrind_%u.%u",
+		 job_id, step_id);
+#else
+	/* no memory checking, default */
+	char *const argv[3] = { (char *)conf->stepd_loc,
+				pooled ? "pool" : NULL, NULL };
+#endif
+	int i;
+	int failed = 0;
+	/* inform slurmstepd about our config */
+	setenv("SLURM_CONF", conf->conffile, 1);
+
+	/*
+	 * Child forks and exits
+	 */
+	if (setsid() < 0) {
+		error("_forkexec_slurmstepd: setsid: %m");
+		failed = 1;
+	}
+	if ((pid = fork()) < 0) {
+		error("_forkexec_slurmstepd: "
+		      "Unable to fork grandchild: %m");
+		failed = 2;
+	} else if (pid > 0) { /* child */
+		exit(0);
+	}
+
+	/*
+	 * Just incase we (or someone we are linking to)
+	 * opened a file and didn't do a close on exec.  This
+	 * is needed mostly to protect us against libs we link
+	 * to that don't set the flag as we should already be
+	 * setting it for those that we open.  The number 256
+	 * is an arbitrary number based off test7.9.
+	 */
+	for (i=3; i<256; i++) {
+		(void) fcntl(i, F_SETFD, FD_CLOEXEC);
+	}
+
+	/*
+	 * Grandchild exec's the slurmstepd
+	 *
+	 * If the slurmd is being shutdown/restarted before
+	 * the pipe happens the old conf->lfd could be reused
+	 * and if we close it the dup2 below will fail.
+	 */
+	if ((to_stepd[0] != conf->lfd)
+	    && (to_slurmd[1] != conf->lfd))
+		slurm_shutdown_msg_engine(conf->lfd);
+
+	if (close(to_stepd[1]) < 0)
+		error("close write to_stepd in grandchild: %m");
+	if (close(to_slurmd[0]) < 0)
+		error("close read to_slurmd in parent: %m");
+
+	(void) close(STDIN_FILENO); /* ignore return */
+	if (dup2(to_stepd[0], STDIN_FILENO) == -1) {
+		error("dup2 over STDIN_FILENO: %m");
+		exit(1);
+	}
+	fd_set_close_on_exec(to_stepd[0]);
+	(void) close(STDOUT_FILENO); /* ignore return */
+	if (dup2(to_slurmd[1], STDOUT_FILENO) == -1) {
+		error("dup2 over STDOUT_FILENO: %m");
+		exit(1);
+	}
+	fd_set_close_on_exec(to_slurmd[1]);
+	(void) close(STDERR_FILENO); /* ignore return */
+	if (dup2(devnull, STDERR_FILENO) == -1) {
+		error("dup2 /dev/null to STDERR_FILENO: %m");
+		exit(1);
+	}
+	fd_set_noclose_on_exec(STDERR_FILENO);
+	log_fini();
+	if (!failed) {
+		if (conf->chos_loc && !access(conf->chos_loc, X_OK))
+			execvp(conf->chos_loc, argv);
+		else
+			execvp(argv[0], argv);
+		error("exec of slurmstepd failed: %m");
+	}
+	exit(2);
+}
+
+/*
+ * Send the slurmstepd its initialization data, then wait for it to
+ * send an "ok" message, meaning it has created and begun listening on its
+ * unix domain socket, and acknowledge it.
+ */
+static int
+_init_slurmstepd(int to_stepd, int to_slurmd, uint16_t type, void *req,
+		 slurm_addr_t *cli, slurm_addr_t *self,
+		 const hostset_t step_hset, uint16_t protocol_version,
+		 bool pooled)
+{
+	int rc = SLURM_SUCCESS;
+#if (SLURMSTEPD_MEMCHECK == 0)
+	int i;
+	time_t start_time = time(NULL);
+#endif
+
+	if ((rc = _send_slurmstepd_init(to_stepd, type, req, cli, self,
+					step_hset, protocol_version,
+					pooled)) != 0) {
+		error("Unable to init slurmstepd");
+		return rc;
+	}
+
+	/* If running under valgrind/memcheck, this pipe doesn't work
+	 * correctly so just skip it. */
+#if (SLURMSTEPD_MEMCHECK == 0)
+	i = read(to_slurmd, &rc, sizeof(int));
+	if (i < 0) {
+		error("%s: Can not read return code from slurmstepd "
+		      "got %d: %m", __func__, i);
+		rc = SLURM_FAILURE;
+	} else if (i != sizeof(int)) {
+		error("%s: slurmstepd failed to send return code "
+		      "got %d: %m", __func__, i);
+		rc = SLURM_FAILURE;
+	} else {
+		int delta_time = time(NULL) - start_time;
+		int cc;
+		if (delta_time > 5) {
+			info("Warning: slurmstepd startup took %d sec, "
+			     "possible file system problem or full "
+			     "memory", delta_time);
+		}
+		if (rc != SLURM_SUCCESS)
+			error("slurmstepd return code %d", rc);
+
+		cc = SLURM_SUCCESS;
+		cc = write(to_stepd, &cc, sizeof(int));
+		if (cc != sizeof(int)) {
+			error("%s: failed to send ack to stepd %d: %m",
+			      __func__, cc);
+		}
+	}
+#endif
+	return rc;
+}
+
+/*
+ * Pool of idle slurmstepd, sized by LaunchParameters=slurmstepd_pool=#.
+ * Each was exec'ed with the "pool" argument and sent the slurmd's
+ * configuration, which the plugins read when they are loaded. It has
+ * loaded its plugins while waiting for the rest of the initialization data
+ * _init_slurmstepd() sends, so that a launch only has to hand it the step.
+ * An agent thread refills the pool, launches fork and exec a slurmstepd
+ * when it is empty. The pooled slurmstepd exits when its pipe is closed.
+ */
+#define STEPD_POOL_MAX		64
+#define STEPD_LAT_SAMPLES	1024	/* launch latencies kept per method */
+#define STEPD_LAT_REPORT	256	/* log percentiles every # launches */
+
+typedef struct {
+	int to_stepd;		/* write end of the slurmstepd's stdin */
+	int to_slurmd;		/* read end of the slurmstepd's stdout */
+} stepd_pool_t;
+
+static pthread_mutex_t stepd_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  stepd_pool_cond  = PTHREAD_COND_INITIALIZER;
+static stepd_pool_t stepd_pool[STEPD_POOL_MAX];
+static int  stepd_pool_cnt = 0;		/* idle slurmstepd in stepd_pool */
+static int  stepd_pool_size = 0;	/* idle slurmstepd to keep */
+static uint32_t stepd_pool_gen = 0;	/* bumped by stepd_pool_purge() */
+static bool stepd_pool_agent_running = false;
+static bool stepd_pool_shutdown = false;
+
+/* launch latencies in usec, [0] from the pool, [1] fork and exec */
+static uint32_t stepd_lat[2][STEPD_LAT_SAMPLES];
+static uint32_t stepd_lat_cnt[2] = { 0, 0 };
+
+static void _stepd_pool_close(stepd_pool_t *ent)
+{
+	(void) close(ent->to_stepd);
+	(void) close(ent->to_slurmd);
+}
+
+/* Fork and exec an idle slurmstepd for the pool */
+static int _stepd_pool_spawn(stepd_pool_t *ent)
+{
+	int to_stepd[2] = {-1, -1};
+	int to_slurmd[2] = {-1, -1};
+	pid_t pid;
+
+	if (pipe(to_stepd) < 0) {
+		error("%s: pipe failed: %m", __func__);
+		return SLURM_ERROR;
+	}
+	if (pipe(to_slurmd) < 0) {
+		error("%s: pipe failed: %m", __func__);
+		close(to_stepd[0]);
+		close(to_stepd[1]);
+		return SLURM_ERROR;
+	}
+	if ((pid = fork()) < 0) {
+		error("%s: fork: %m", __func__);
+		close(to_stepd[0]);
+		close(to_stepd[1]);
+		close(to_slurmd[0]);
+		close(to_slurmd[1]);
+		return SLURM_ERROR;
+	} else if (pid == 0)
+		_exec_slurmstepd(0, NULL, to_stepd, to_slurmd, true);
+
+	close(to_stepd[0]);
+	close(to_slurmd[1]);
+	if (waitpid(pid, NULL, 0) < 0)
+		error("Unable to reap slurmd child process");
+
+	if (_send_slurmd_conf_lite(to_stepd[1], conf) < 0) {
+		error("%s: unable to send conf to slurmstepd: %m", __func__);
+		close(to_stepd[1]);
+		close(to_slurmd[0]);
+		return SLURM_ERROR;
+	}
+
+	/* The slurmstepd must see EOF once we close our end, so no other
+	 * process the slurmd starts may inherit it */
+	fd_set_close_on_exec(to_stepd[1]);
+	fd_set_close_on_exec(to_slurmd[0]);
+	ent->to_stepd = to_stepd[1];
+	ent->to_slurmd = to_slurmd[0];
+
+	return SLURM_SUCCESS;
+}
+
+/* Take an idle slurmstepd from the pool, skipping any that died */
+static bool _stepd_pool_get(int *to_stepd, int *to_slurmd)
+{
+	stepd_pool_t ent;
+	struct pollfd pfd;
+	bool found = false;
+
+	slurm_mutex_lock(&stepd_pool_mutex);
+	while (stepd_pool_cnt > 0) {
+		ent = stepd_pool[--stepd_pool_cnt];
+		/* An idle slurmstepd never writes, any event means it exited */
+		pfd.fd = ent.to_slurmd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, 0) != 0) {
+			debug("%s: discarding exited slurmstepd", __func__);
+			_stepd_pool_close(&ent);
+			continue;
+		}
+		*to_stepd = ent.to_stepd;
+		*to_slurmd = ent.to_slurmd;
+		found = true;
+		break;
+	}
+	if (stepd_pool_size)
+		slurm_cond_signal(&stepd_pool_cond);
+	slurm_mutex_unlock(&stepd_pool_mutex);
+
+	return found;
+}
+
+static void *_stepd_pool_agent(void *arg)
+{
+	stepd_pool_t ent;
+	struct timespec ts = {0, 0};
+	uint32_t gen;
+	int rc;
+
+	slurm_mutex_lock(&stepd_pool_mutex);
+	while (!stepd_pool_shutdown) {
+		if (stepd_pool_cnt >= stepd_pool_size) {
+			slurm_cond_wait(&stepd_pool_cond, &stepd_pool_mutex);
+			continue;
+		}
+		gen = stepd_pool_gen;
+		slurm_mutex_unlock(&stepd_pool_mutex);
+		rc = _stepd_pool_spawn(&ent);
+		slurm_mutex_lock(&stepd_pool_mutex);
+		if (rc != SLURM_SUCCESS) {
+			/* do not spin on fork or pipe failures */
+			ts.tv_sec = time(NULL) + RETRY_DELAY;
+			slurm_cond_timedwait(&stepd_pool_cond,
+					     &stepd_pool_mutex, &ts);
+		} else if (stepd_pool_shutdown || (gen != stepd_pool_gen) ||
+			   (stepd_pool_cnt >= stepd_pool_size)) {
+			/* started with an old configuration or not needed */
+			_stepd_pool_close(&ent);
+		} else
+			stepd_pool[stepd_pool_cnt++] = ent;
+	}
+	stepd_pool_agent_running = false;
+	slurm_mutex_unlock(&stepd_pool_mutex);
+
+	return NULL;
+}
+
+static int _cmp_uint32(const void *a, const void *b)
+{
+	uint32_t x = *(uint32_t *) a, y = *(uint32_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+/* Log launch latency percentiles of each launch method.
+ * stepd_pool_mutex must be locked. */
+static void _stepd_lat_log(void)
+{
+	static const char *method[2] = { "pool", "fork/exec" };
+	uint32_t sorted[STEPD_LAT_SAMPLES];
+	int i, n;
+
+	for (i = 0; i < 2; i++) {
+		if (!(n = MIN(stepd_lat_cnt[i], STEPD_LAT_SAMPLES)))
+			continue;
+		memcpy(sorted, stepd_lat[i], sizeof(uint32_t) * n);
+		qsort(sorted, n, sizeof(uint32_t), _cmp_uint32);
+		debug("slurmstepd launch latency from %s over last %d "
+		      "launches: p50 %u p90 %u p99 %u max %u usec",
+		      method[i], n, sorted[n / 2], sorted[(n * 9) / 10],
+		      sorted[(n * 99) / 100], sorted[n - 1]);
+	}
+}
+
+static void _stepd_lat_record(bool pooled, long usec)
+{
+	int i = pooled ? 0 : 1;
+
+	slurm_mutex_lock(&stepd_pool_mutex);
+	stepd_lat[i][stepd_lat_cnt[i]++ % STEPD_LAT_SAMPLES] = usec;
+	if (((stepd_lat_cnt[0] + stepd_lat_cnt[1]) % STEPD_LAT_REPORT) == 0)
+		_stepd_lat_log();
+	slurm_mutex_unlock(&stepd_pool_mutex);
+}
+
+/* Read the pool size from LaunchParameters and start filling it */
+void stepd_pool_init(void)
+{
+	char *launch_params = slurm_get_launch_params(), *tmp;
+	pthread_attr_t attr;
+	pthread_t id;
+	int size = 0;
+
+	if (launch_params && (tmp = strstr(launch_params, "slurmstepd_pool=")))
+		size = atoi(tmp + strlen("slurmstepd_pool="));
+	xfree(launch_params);
+	size = MAX(0, MIN(size, STEPD_POOL_MAX));
+
+#if (SLURMSTEPD_MEMCHECK != 0)
+	/* the memcheck wrappers need the job and step ids */
+	size = 0;
+#endif
+	/* chos_loc picks the environment of each slurmstepd it execs */
+	if (size && conf->chos_loc && !access(conf->chos_loc, X_OK)) {
+		info("slurmstepd_pool ignored when ChosLoc is set");
+		size = 0;
+	}
+
+	slurm_mutex_lock(&stepd_pool_mutex);
+	stepd_pool_size = size;
+	stepd_pool_shutdown = false;
+	if (size && !stepd_pool_agent_running) {
+		slurm_attr_init(&attr);
+		if (pthread_attr_setdetachstate(&attr,
+						PTHREAD_CREATE_DETACHED))
+			error("%s: pthread_attr_setdetachstate: %m", __func__);
+		if (pthread_create(&id, &attr, _stepd_pool_agent, NULL))
+			error("%s: pthread_create: %m", __func__);
+		else
+			stepd_pool_agent_running = true;
+		slurm_attr_destroy(&attr);
+	}
+	slurm_cond_signal(&stepd_pool_cond);
+	slurm_mutex_unlock(&stepd_pool_mutex);
+
+	if (size)
+		debug("keeping %d idle slurmstepd", size);
+}
+
+/* Retire all idle slurmstepd, they are replaced unless the pool is shut
+ * down */
+void stepd_pool_purge(void)
+{
+	slurm_mutex_lock(&stepd_pool_mutex);
+	while (stepd_pool_cnt > 0)
+		_stepd_pool_close(&stepd_pool[--stepd_pool_cnt]);
+	stepd_pool_gen++;
+	slurm_mutex_unlock(&stepd_pool_mutex);
+}
+
+void stepd_pool_fini(void)
+{
+	slurm_mutex_lock(&stepd_pool_mutex);
+	stepd_pool_shutdown = true;
+	slurm_cond_signal(&stepd_pool_cond);
+	_stepd_lat_log();
+	slurm_mutex_unlock(&stepd_pool_mutex);
+
+	stepd_pool_purge();
+}
+
+/*
+ * Start a slurmstepd, taken from the pool of idle ones if possible and
+ * forked and exec'ed otherwise, then send the slurmstepd its
+ * initialization data and wait for its "ok" message.
  *
  * Note that this code forks twice and it is the grandchild that
  * becomes the slurmstepd process, so the slurmstepd's parent process
@@ -740,34 +1221,38 @@ _forkexec_slurmstepd(uint16_t type, void *req,
 		     slurm_addr_t *cli, slurm_addr_t *self,
 		     const hostset_t step_hset, uint16_t protocol_version)
 {
-	pid_t pid;
+	pid_t pid = 0;
 	int to_stepd[2] = {-1, -1};
 	int to_slurmd[2] = {-1, -1};
+	bool pooled = true;
+	int rc;
+	DEF_TIMERS;
 
-	if (pipe(to_stepd) < 0 || pipe(to_slurmd) < 0) {
-		error("_forkexec_slurmstepd pipe failed: %m");
-		return SLURM_FAILURE;
-	}
-
+	START_TIMER;
 	if (_add_starting_step(type, req)) {
 		error("_forkexec_slurmstepd failed in _add_starting_step: %m");
 		return SLURM_FAILURE;
 	}
 
-	if ((pid = fork()) < 0) {
-		error("_forkexec_slurmstepd: fork: %m");
-		close(to_stepd[0]);
-		close(to_stepd[1]);
-		close(to_slurmd[0]);
-		close(to_slurmd[1]);
-		_remove_starting_step(type, req);
-		return SLURM_FAILURE;
-	} else if (pid > 0) {
-		int rc = SLURM_SUCCESS;
-#if (SLURMSTEPD_MEMCHECK == 0)
-		int i;
-		time_t start_time = time(NULL);
-#endif
+	if (!_stepd_pool_get(&to_stepd[1], &to_slurmd[0])) {
+		pooled = false;
+		if (pipe(to_stepd) < 0 || pipe(to_slurmd) < 0) {
+			error("_forkexec_slurmstepd pipe failed: %m");
+			_remove_starting_step(type, req);
+			return SLURM_FAILURE;
+		}
+
+		if ((pid = fork()) < 0) {
+			error("_forkexec_slurmstepd: fork: %m");
+			close(to_stepd[0]);
+			close(to_stepd[1]);
+			close(to_slurmd[0]);
+			close(to_slurmd[1]);
+			_remove_starting_step(type, req);
+			return SLURM_FAILURE;
+		} else if (pid == 0)
+			_exec_slurmstepd(type, req, to_stepd, to_slurmd, false);
+
 		/*
 		 * Parent sends initialization data to the slurmstepd
 		 * over the to_stepd pipe, and waits for the return code
@@ -777,209 +1262,26 @@ _forkexec_slurmstepd(uint16_t type, void *req,
 			error("Unable to close read to_stepd in parent: %m");
 		if (close(to_slurmd[1]) < 0)
 			error("Unable to close write to_slurmd in parent: %m");
+	}
 
-		if ((rc = _send_slurmstepd_init(to_stepd[1], type,
-						req, cli, self,
-						step_hset,
-						protocol_version)) != 0) {
-			error("Unable to init slurmstepd");
-			goto done;
-		}
+	rc = _init_slurmstepd(to_stepd[1], to_slurmd[0], type, req, cli, self,
+			      step_hset, protocol_version, pooled);
 
-		/* If running under valgrind/memcheck, this pipe doesn't work
-		 * correctly so just skip it. */
-#if (SLURMSTEPD_MEMCHECK == 0)
-		i = read(to_slurmd[0], &rc, sizeof(int));
-		if (i < 0) {
-			error("%s: Can not read return code from slurmstepd "
-			      "got %d: %m", __func__, i);
-			rc = SLURM_FAILURE;
-		} else if (i != sizeof(int)) {
-			error("%s: slurmstepd failed to send return code "
-			      "got %d: %m", __func__, i);
-			rc = SLURM_FAILURE;
-		} else {
-			int delta_time = time(NULL) - start_time;
-			int cc;
-			if (delta_time > 5) {
-				info("Warning: slurmstepd startup took %d sec, "
-				     "possible file system problem or full "
-				     "memory", delta_time);
-			}
-			if (rc != SLURM_SUCCESS)
-				error("slurmstepd return code %d", rc);
-
-			cc = SLURM_SUCCESS;
-			cc = write(to_stepd[1], &cc, sizeof(int));
-			if (cc != sizeof(int)) {
-				error("%s: failed to send ack to stepd %d: %m",
-				      __func__, cc);
-			}
-		}
-#endif
-	done:
-		if (_remove_starting_step(type, req))
-			error("Error cleaning up starting_step list");
-
-		/* Reap child */
-		if (waitpid(pid, NULL, 0) < 0)
-			error("Unable to reap slurmd child process");
-		if (close(to_stepd[1]) < 0)
-			error("close write to_stepd in parent: %m");
-		if (close(to_slurmd[0]) < 0)
-			error("close read to_slurmd in parent: %m");
-		return rc;
-	} else {
-#if (SLURMSTEPD_MEMCHECK == 1)
-		/* memcheck test of slurmstepd, option #1 */
-		char *const argv[3] = {"memcheck",
-				       (char *)conf->stepd_loc, NULL};
-#elif (SLURMSTEPD_MEMCHECK == 2)
-		/* valgrind test of slurmstepd, option #2 */
-		uint32_t job_id = 0, step_id = 0;
-		char log_file[256];
-		char *const argv[13] = {"valgrind", "--tool=memcheck",
-					"--error-limit=no",
-					"--leak-check=summary",
-					"--show-reachable=yes",
-					"--max-stackframe=16777216",
-					"--num-callers=20",
-					"--child-silent-after-fork=yes",
-					"--track-origins=yes",
-					log_file, (char *)conf->stepd_loc,
-					NULL};
-		if (type == LAUNCH_BATCH_JOB) {
-			job_id = ((batch_job_launch_msg_t *)req)->job_id;
-			step_id = ((batch_job_launch_msg_t *)req)->step_id;
-		} else if (type == LAUNCH_TASKS) {
-			job_id = ((launch_tasks_request_msg_t *)req)->job_id;
-			step_id = ((launch_tasks_request_msg_t *)req)->job_step_id;
-		}
-		snprintf(log_file, sizeof(log_file),
-			 "--log-file=/tmp/slurmstepd_valgrind_%u.%u",
-			 job_id, step_id);
-#elif (SLURMSTEPD_MEMCHECK == 3)
-		/* valgrind/drd test of slurmstepd, option #3 */
-		uint32_t job_id = 0, step_id = 0;
-		char log_file[256];
-		char *const argv[10] = {"valgrind", "--tool=drd",
-					"--error-limit=no",
-					"--max-stackframe=16777216",
-					"--num-callers=20",
-					"--child-silent-after-fork=yes",
-					log_file, (char *)conf->stepd_loc,
-					NULL};
-		if (type == LAUNCH_BATCH_JOB) {
-			job_id = ((batch_job_launch_msg_t *)req)->job_id;
-			step_id = ((batch_job_launch_msg_t *)req)->step_id;
-		} else if (type == LAUNCH_TASKS) {
-			job_id = ((launch_tasks_request_msg_t *)req)->job_id;
-			step_id = ((launch_tasks_request_msg_t *)req)->job_step_id;
-		}
-		snprintf(log_file, sizeof(log_file),
-			 "--log-file=/tmp/slurmstepd_valgrind_%u.%u",
-			 job_id, step_id);
-#elif (SLURMSTEPD_MEMCHECK == 4)
-		/* valgrind/helgrind test of slurmstepd, option #4 */
-		uint32_t job_id = 0, step_id = 0;
-		char log_file[256];
-		char *const argv[10] = {"valgrind", "--tool=helgrind",
-					"--error-limit=no",
-					"--max-stackframe=16777216",
-					"--num-callers=20",
-					"--child-silent-after-fork=yes",
-					log_file, (char *)conf->stepd_loc,
-					NULL};
-		if (type == LAUNCH_BATCH_JOB) {
-			job_id = ((batch_job_launch_msg_t *)req)->job_id;
-			step_id = ((batch_job_launch_msg_t *)req)->step_id;
-		} else if (type == LAUNCH_TASKS) {
-			job_id = ((launch_tasks_request_msg_t *)req)->job_id;
-			step_id = ((launch_tasks_request_msg_t *)req)->job_step_id;
-		}
-		snprintf(log_file, sizeof(log_file),
-			 "--log-file=/tmp/slurmstepd_valgrind_%u.%u",
-			 job_id, step_id);
-#else
-		/* no memory checking, default */
-		char *const argv[2] = { (char *)conf->stepd_loc, NULL};
-#endif
-		int i;
-		int failed = 0;
-		/* inform slurmstepd about our config */
-		setenv("SLURM_CONF", conf->conffile, 1);
+	if (_remove_starting_step(type, req))
+		error("Error cleaning up starting_step list");
 
-		/*
-		 * Child forks and exits
-		 */
-		if (setsid() < 0) {
-			error("_forkexec_slurmstepd: setsid: %m");
-			failed = 1;
-		}
-		if ((pid = fork()) < 0) {
-			error("_forkexec_slurmstepd: "
-			      "Unable to fork grandchild: %m");
-			failed = 2;
-		} else if (pid > 0) { /* child */
-			exit(0);
-		}
+	/* Reap child */
+	if ((pid > 0) && (waitpid(pid, NULL, 0) < 0))
+		error("Unable to reap slurmd child process");
+	if (close(to_stepd[1]) < 0)
+		error("close write to_stepd in parent: %m");
+	if (close(to_slurmd[0]) < 0)
+		error("close read to_slurmd in parent: %m");
 
-		/*
-		 * Just incase we (or someone we are linking to)
-		 * opened a file and didn't do a close on exec.  This
-		 * is needed mostly to protect us against libs we link
-		 * to that don't set the flag as we should already be
-		 * setting it for those that we open.  The number 256
-		 * is an arbitrary number based off test7.9.
-		 */
-		for (i=3; i<256; i++) {
-			(void) fcntl(i, F_SETFD, FD_CLOEXEC);
-		}
+	END_TIMER;
+	_stepd_lat_record(pooled, DELTA_TIMER);
 
-		/*
-		 * Grandchild exec's the slurmstepd
-		 *
-		 * If the slurmd is being shutdown/restarted before
-		 * the pipe happens the old conf->lfd could be reused
-		 * and if we close it the dup2 below will fail.
-		 */
-		if ((to_stepd[0] != conf->lfd)
-		    && (to_slurmd[1] != conf->lfd))
-			slurm_shutdown_msg_engine(conf->lfd);
-
-		if (close(to_stepd[1]) < 0)
-			error("close write to_stepd in grandchild: %m");
-		if (close(to_slurmd[0]) < 0)
-			error("close read to_slurmd in parent: %m");
-
-		(void) close(STDIN_FILENO); /* ignore return */
-		if (dup2(to_stepd[0], STDIN_FILENO) == -1) {
-			error("dup2 over STDIN_FILENO: %m");
-			exit(1);
-		}
-		fd_set_close_on_exec(to_stepd[0]);
-		(void) close(STDOUT_FILENO); /* ignore return */
-		if (dup2(to_slurmd[1], STDOUT_FILENO) == -1) {
-			error("dup2 over STDOUT_FILENO: %m");
-			exit(1);
-		}
-		fd_set_close_on_exec(to_slurmd[1]);
-		(void) close(STDERR_FILENO); /* ignore return */
-		if (dup2(devnull, STDERR_FILENO) == -1) {
-			error("dup2 /dev/null to STDERR_FILENO: %m");
-			exit(1);
-		}
-		fd_set_noclose_on_exec(STDERR_FILENO);
-		log_fini();
-		if (!failed) {
-			if (conf->chos_loc && !access(conf->chos_loc, X_OK))
-				execvp(conf->chos_loc, argv);
-			else
-				execvp(argv[0], argv);
-			error("exec of slurmstepd failed: %m");
-		}
-		exit(2);
-	}
+	return rc;
 }
 
 
@@ -4025,10 +4327,17 @@ static int _rpc_file_bcast(slurm_msg_t *msg)
 		return SLURM_FAILURE;
 	}
 
+	/* Blocks between the first and the last one may arrive in any order
+	 * from current clients, write each at its own offset */
 	offset = 0;
 	while (req->block_len - offset) {
-		inx = write(file_info->fd, &req->block[offset],
-			    (req->block_len - offset));
+		if (msg->protocol_version >= SLURM_17_02_PROTOCOL_VERSION)
+			inx = pwrite(file_info->fd, &req->block[offset],
+				     (req->block_len - offset),
+				     req->block_offset + offset);
+		else
+			inx = write(file_info->fd, &req->block[offset],
+				    (req->block_len - offset));
 		if (inx == -1) {
 			if ((errno == EINTR) || (errno == EAGAIN))
 				continue;
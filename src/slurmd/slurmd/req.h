@@ -57,6 +57,17 @@ extern void record_launched_jobs(void);
 void file_bcast_init(void);
 void file_bcast_purge(void);
 
+/*
+ * Pool of idle slurmstepd processes used to launch steps, configured by
+ * LaunchParameters=slurmstepd_pool=#. stepd_pool_init() (re)reads the
+ * configuration and starts filling the pool, stepd_pool_purge() retires
+ * the idle slurmstepd so they get replaced and stepd_pool_fini() retires
+ * them for good.
+ */
+void stepd_pool_init(void);
+void stepd_pool_purge(void);
+void stepd_pool_fini(void);
+
 /*
  * ume_notify - Notify all jobs and steps on this node that a Uncorrectable
  *	Memory Error (UME) has occured by sending SIG_UME (to log event in
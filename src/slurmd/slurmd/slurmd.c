@@ -373,7 +373,9 @@ main (int argc, char **argv)
 	msg_aggr_sender_init(conf->hostname, conf->port,
 			     conf->msg_aggr_window_time,
 			     conf->msg_aggr_window_msgs);
+	stepd_pool_init();
 	_msg_engine();
+	stepd_pool_fini();
 
 	/*
 	 * Close fd here, otherwise we'll deadlock since create_pidfile()
@@ -1090,6 +1092,12 @@ _reconfigure(void)
 	 */
 	gids_cache_purge();
 
+	/*
+	 * Replace the idle slurmstepd, they read the old configuration
+	 */
+	stepd_pool_purge();
+	stepd_pool_init();
+
 	/* send reconfig to each stepd so they can refresh their log
 	 * file handle
 	 */
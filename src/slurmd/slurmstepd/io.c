@@ -56,6 +56,7 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "src/common/cbuf.h"
@@ -162,10 +163,12 @@ struct task_write_info {
  **********************************************************************/
 static bool _task_readable(eio_obj_t *);
 static int  _task_read(eio_obj_t *, List);
+static int  _task_hold_expired(eio_obj_t *, List);
 
 struct io_operations task_read_ops = {
 	.readable = &_task_readable,
 	.handle_read = &_task_read,
+	.handle_timer = &_task_hold_expired,
 };
 
 struct task_read_info {
@@ -180,6 +183,8 @@ struct task_read_info {
 	cbuf_t           buf;
 	bool		 eof;
 	bool		 eof_msg_sent;
+	struct timeval	 hold_time;	 /* when a partial message was first
+					  * held back, zero if none is held */
 };
 
 /**********************************************************************
@@ -210,6 +215,13 @@ static void _free_incoming_msg(struct io_buf *msg, stepd_step_rec_t *job);
 static void _free_all_outgoing_msgs(List msg_queue, stepd_step_rec_t *job);
 static bool _incoming_buf_free(stepd_step_rec_t *job);
 static bool _outgoing_buf_free(stepd_step_rec_t *job);
+static ssize_t _client_writev(struct client_io_info *client, int fd,
+			      int skip);
+static bool _client_takes_stream(struct client_io_info *client,
+				 struct task_read_info *out);
+static bool _clients_busy(struct task_read_info *out);
+static bool _hold_msg(eio_obj_t *obj);
+static void _route_all_tasks_to_client(stepd_step_rec_t *job);
 static int  _send_connection_okay_response(stepd_step_rec_t *job);
 static struct io_buf *_build_connection_okay_message(stepd_step_rec_t *job);
 
@@ -426,6 +438,51 @@ _client_read(eio_obj_t *obj, List objs)
 	return SLURM_SUCCESS;
 }
 
+/*
+ * Write the rest of client->out_msg and as many of the queued messages as
+ * fit in one writev(), skipping the first "skip" bytes of each queued
+ * message. The messages written in full are released and the next one
+ * becomes client->out_msg. Returns the result of writev().
+ */
+static ssize_t
+_client_writev(struct client_io_info *client, int fd, int skip)
+{
+	struct iovec iov[STDIO_MAX_IOV];
+	struct io_buf *msg;
+	ListIterator msgs;
+	int iovcnt = 1;
+	ssize_t n, left;
+
+	iov[0].iov_base = client->out_msg->data +
+		(client->out_msg->length - client->out_remaining);
+	iov[0].iov_len = client->out_remaining;
+	msgs = list_iterator_create(client->msg_queue);
+	while ((iovcnt < STDIO_MAX_IOV) && (msg = list_next(msgs))) {
+		iov[iovcnt].iov_base = msg->data + skip;
+		iov[iovcnt].iov_len = msg->length - skip;
+		iovcnt++;
+	}
+	list_iterator_destroy(msgs);
+
+	while (((n = writev(fd, iov, iovcnt)) < 0) && (errno == EINTR))
+		;
+	if (n < 0)
+		return n;
+
+	left = n;
+	while (client->out_msg && (left >= client->out_remaining)) {
+		left -= client->out_remaining;
+		_free_outgoing_msg(client->out_msg, client->job);
+		client->out_msg = list_dequeue(client->msg_queue);
+		if (client->out_msg)
+			client->out_remaining = client->out_msg->length - skip;
+	}
+	if (client->out_msg)
+		client->out_remaining -= left;
+
+	return n;
+}
+
 /*
  * Write outgoing packed messages to the client socket.
  */
@@ -433,8 +490,7 @@ static int
 _client_write(eio_obj_t *obj, List objs)
 {
 	struct client_io_info *client = (struct client_io_info *) obj->arg;
-	void *buf;
-	int n;
+	ssize_t n;
 
 	xassert(client->magic == CLIENT_IO_MAGIC);
 
@@ -458,34 +514,22 @@ _client_write(eio_obj_t *obj, List objs)
 	debug5("  client->out_remaining = %d", client->out_remaining);
 
 	/*
-	 * Write message to socket.
+	 * Write messages to socket.
 	 */
-	buf = client->out_msg->data +
-		(client->out_msg->length - client->out_remaining);
-again:
-	if ((n = write(obj->fd, buf, client->out_remaining)) < 0) {
-		if (errno == EINTR) {
-			goto again;
-		} else if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+	if ((n = _client_writev(client, obj->fd, 0)) < 0) {
+		if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
 			debug5("_client_write returned EAGAIN");
 			return SLURM_SUCCESS;
-		} else {
-			client->out_eof = true;
-			_free_all_outgoing_msgs(client->msg_queue, client->job);
-			return SLURM_SUCCESS;
 		}
-	}
-	if (n < client->out_remaining) {
-		error("Only wrote %d of %d bytes to socket",
-		      n, client->out_remaining);
-	} else
-		debug5("Wrote %d bytes to socket", n);
-	client->out_remaining -= n;
-	if (client->out_remaining > 0)
+		client->out_eof = true;
+		_free_all_outgoing_msgs(client->msg_queue, client->job);
 		return SLURM_SUCCESS;
+	}
+	debug5("Wrote %zd bytes to socket", n);
 
-	_free_outgoing_msg(client->out_msg, client->job);
-	client->out_msg = NULL;
+	/* Send the output held back while this client was busy */
+	if (client->out_msg == NULL)
+		_route_all_tasks_to_client(client->job);
 
 	return SLURM_SUCCESS;
 }
@@ -534,6 +578,19 @@ _local_file_write(eio_obj_t *obj, List objs)
 					io_hdr_packed_size();
 	}
 
+	/* Without labels the payloads are written as they are, many messages
+	   at a time. Zero-length messages add nothing to the file. */
+	if (!client->labelio) {
+		if (_client_writev(client, obj->fd, io_hdr_packed_size()) < 0) {
+			client->out_eof = true;
+			_free_all_outgoing_msgs(client->msg_queue, client->job);
+			return SLURM_ERROR;
+		}
+		if (client->out_msg == NULL)
+			_route_all_tasks_to_client(client->job);
+		return SLURM_SUCCESS;
+	}
+
 	/* This code to make a buffer, fill it, unpack its contents, and free
 	   it is just used to read the header to get the global task id. */
 	header_tmp_buf = create_buf(client->out_msg->data,
@@ -571,6 +628,8 @@ _local_file_write(eio_obj_t *obj, List objs)
 	if (client->out_remaining == 0) {
 		_free_outgoing_msg(client->out_msg, client->job);
 		client->out_msg = NULL;
+		if (list_is_empty(client->msg_queue))
+			_route_all_tasks_to_client(client->job);
 	}
 	return SLURM_SUCCESS;
 }
@@ -715,7 +774,13 @@ _create_task_out_eio(int fd, uint16_t type,
 	out->gtaskid = task->gtid;
 	out->ltaskid = task->id;
 	out->job = job;
-	out->buf = cbuf_create(MAX_MSG_LEN, MAX_MSG_LEN*4);
+	/* Let the output of each task grow into a larger buffer when there
+	 * are few tasks to share STDIO_TASK_BUF_TOTAL */
+	out->buf = cbuf_create(MAX_MSG_LEN,
+			       MAX(MAX_MSG_LEN * 4,
+				   MIN(STDIO_TASK_BUF_MAX,
+				       STDIO_TASK_BUF_TOTAL /
+				       MAX(job->node_tasks, 1))));
 	out->eof = false;
 	out->eof_msg_sent = false;
 	if (cbuf_opt_set(out->buf, CBUF_OPT_OVERWRITE, CBUF_NO_DROP) == -1)
@@ -799,6 +864,24 @@ again:
 	return SLURM_SUCCESS;
 }
 
+/*
+ * A partial message has been held back for STDIO_HOLD_MSEC, route it even if
+ * the clients are still busy
+ */
+static int
+_task_hold_expired(eio_obj_t *obj, List objs)
+{
+	struct task_read_info *out = (struct task_read_info *)obj->arg;
+
+	xassert(out->magic == TASK_OUT_MAGIC);
+
+	_route_msg_task_to_client(obj);
+	if (cbuf_used(out->buf) == 0 && out->eof && !out->eof_msg_sent)
+		_send_eof_msg(out);
+
+	return SLURM_SUCCESS;
+}
+
 /**********************************************************************
  * Pseudo terminal functions
  **********************************************************************/
@@ -1313,6 +1396,8 @@ _route_msg_task_to_client(eio_obj_t *obj)
 	while (cbuf_used(out->buf) > 0
 	       && _outgoing_buf_free(out->job)) {
 		debug5("cbuf_used = %d", cbuf_used(out->buf));
+		if (_hold_msg(obj))
+			break;
 		msg = _task_build_message(out, out->job, out->buf);
 		if (msg == NULL)
 			return;
@@ -1324,17 +1409,8 @@ _route_msg_task_to_client(eio_obj_t *obj)
 			if (client->out_eof == true)
 				continue;
 
-			/* Some clients only take certain I/O streams */
-			if (out->type==SLURM_IO_STDOUT) {
-				if (client->ltaskid_stdout != -1 &&
-				    client->ltaskid_stdout != out->ltaskid)
-					continue;
-			}
-			if (out->type==SLURM_IO_STDERR) {
-				if (client->ltaskid_stderr != -1 &&
-				    client->ltaskid_stderr != out->ltaskid)
-					continue;
-			}
+			if (!_client_takes_stream(client, out))
+				continue;
 
 			debug5("======================== Enqueued message");
 			xassert(client->magic == CLIENT_IO_MAGIC);
@@ -1351,6 +1427,107 @@ _route_msg_task_to_client(eio_obj_t *obj)
 	}
 }
 
+/*
+ * Hold back a partial message while the clients taking this output still
+ * have messages to write. It is coalesced with what the task writes next,
+ * or sent once the clients catch up or STDIO_HOLD_MSEC has passed.
+ * RET true if the output in the task's cbuf is to be held back now
+ */
+static bool
+_hold_msg(eio_obj_t *obj)
+{
+	struct task_read_info *out = (struct task_read_info *)obj->arg;
+	struct timeval now;
+	long msec;
+
+	if (!out->eof && (cbuf_used(out->buf) < MAX_MSG_LEN) &&
+	    _clients_busy(out)) {
+		if (out->hold_time.tv_sec == 0) {
+			gettimeofday(&out->hold_time, NULL);
+			eio_obj_set_timer(obj, STDIO_HOLD_MSEC);
+			return true;
+		}
+		gettimeofday(&now, NULL);
+		msec = (now.tv_sec - out->hold_time.tv_sec) * 1000 +
+		       (now.tv_usec - out->hold_time.tv_usec) / 1000;
+		if (msec < STDIO_HOLD_MSEC)
+			return true;
+	}
+	if (out->hold_time.tv_sec) {
+		out->hold_time.tv_sec = 0;
+		out->hold_time.tv_usec = 0;
+		eio_obj_set_timer(obj, -1);
+	}
+	return false;
+}
+
+/* true if the client takes the output stream of this task */
+static bool
+_client_takes_stream(struct client_io_info *client,
+		     struct task_read_info *out)
+{
+	/* Some clients only take certain I/O streams */
+	if (out->type == SLURM_IO_STDOUT) {
+		if (client->ltaskid_stdout != -1 &&
+		    client->ltaskid_stdout != out->ltaskid)
+			return false;
+	}
+	if (out->type == SLURM_IO_STDERR) {
+		if (client->ltaskid_stderr != -1 &&
+		    client->ltaskid_stderr != out->ltaskid)
+			return false;
+	}
+	return true;
+}
+
+/* true if any client taking this task's output has messages waiting to be
+ * written */
+static bool
+_clients_busy(struct task_read_info *out)
+{
+	struct client_io_info *client;
+	ListIterator clients;
+	eio_obj_t *eio;
+	bool busy = false;
+
+	clients = list_iterator_create(out->job->clients);
+	while ((eio = list_next(clients))) {
+		client = (struct client_io_info *)eio->arg;
+		if (client->out_eof || !_client_takes_stream(client, out))
+			continue;
+		if (client->out_msg ||
+		    (client->msg_queue && !list_is_empty(client->msg_queue))) {
+			busy = true;
+			break;
+		}
+	}
+	list_iterator_destroy(clients);
+
+	return busy;
+}
+
+/* Try packing messages from all tasks' output cbufs */
+static void
+_route_all_tasks_to_client(stepd_step_rec_t *job)
+{
+	int i;
+
+	if (job->task == NULL)
+		return;
+	for (i = 0; i < job->node_tasks; i++) {
+		if (job->task[i]->err != NULL) {
+			_route_msg_task_to_client(job->task[i]->err);
+			if (!_outgoing_buf_free(job))
+				break;
+		}
+		if (job->task[i]->out != NULL) {
+			_route_msg_task_to_client(job->task[i]->out);
+			if (!_outgoing_buf_free(job))
+				break;
+		}
+	}
+}
+
 static void
 _free_incoming_msg(struct io_buf *msg, stepd_step_rec_t *job)
 {
@@ -1367,8 +1544,6 @@ _free_incoming_msg(struct io_buf *msg, stepd_step_rec_t *job)
 static void
 _free_outgoing_msg(struct io_buf *msg, stepd_step_rec_t *job)
 {
-	int i;
-
 	msg->ref_count--;
 	if (msg->ref_count == 0) {
 		/* Put the message back on the free List */
@@ -1377,18 +1552,8 @@ _free_outgoing_msg(struct io_buf *msg, stepd_step_rec_t *job)
 		/* Try packing messages from tasks' output cbufs */
 		if (job->task == NULL)
 			return;
-		for (i = 0; i < job->node_tasks; i++) {
-			if (job->task[i]->err != NULL) {
-				_route_msg_task_to_client(job->task[i]->err);
-				if (!_outgoing_buf_free(job))
-					break;
-			}
-			if (job->task[i]->out != NULL) {
-				_route_msg_task_to_client(job->task[i]->out);
-				if (!_outgoing_buf_free(job))
-					break;
-			}
-		}
+		_route_all_tasks_to_client(job);
+
 		/* Kick the event IO engine */
 		eio_signal_wakeup(job->eio);
 	}
@@ -1902,7 +2067,10 @@ _outgoing_buf_free(stepd_step_rec_t *job)
 
 	if (list_count(job->free_outgoing) > 0) {
 		return true;
-	} else if (job->outgoing_count < STDIO_MAX_FREE_BUF) {
+	} else if (job->outgoing_count <
+		   MIN(STDIO_MAX_FREE_BUF_SCALED,
+		       MAX(STDIO_MAX_FREE_BUF,
+			   job->node_tasks * STDIO_TASK_FREE_BUF))) {
 		buf = alloc_io_buf();
 		if (buf != NULL) {
 			list_enqueue(job->free_outgoing, buf);
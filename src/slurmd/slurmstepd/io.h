@@ -50,6 +50,24 @@
 #define STDIO_MAX_FREE_BUF 1024
 #define STDIO_MAX_MSG_CACHE 128
 
+/*
+ * Steps with many tasks may use STDIO_TASK_FREE_BUF more outgoing message
+ * buffers per task, up to STDIO_MAX_FREE_BUF_SCALED in total. The cbuf
+ * holding a task's output grows up to STDIO_TASK_BUF_TOTAL divided among
+ * the tasks, within MAX_MSG_LEN*4 and STDIO_TASK_BUF_MAX bytes.
+ */
+#define STDIO_TASK_FREE_BUF 32
+#define STDIO_MAX_FREE_BUF_SCALED (STDIO_MAX_FREE_BUF * 4)
+#define STDIO_TASK_BUF_TOTAL (4 * 1024 * 1024)
+#define STDIO_TASK_BUF_MAX (64 * 1024)
+
+/* Most messages written to a client with one writev() */
+#define STDIO_MAX_IOV 64
+
+/* Longest time in msec a task's partial output message is held back while
+ * the clients taking it have output waiting to be written */
+#define STDIO_HOLD_MSEC 50
+
 struct io_buf {
 	int ref_count;
 	uint32_t length;
@@ -85,6 +85,7 @@ static stepd_step_rec_t *_step_setup(slurm_addr_t *cli, slurm_addr_t *self,
 static void _step_cleanup(stepd_step_rec_t *job, slurm_msg_t *msg, int rc);
 #endif
 static int _process_cmdline (int argc, char **argv);
+static void _pool_preload(char **argv);
 
 int slurmstepd_blocked_signals[] = {
 	SIGPIPE, 0
@@ -94,6 +95,9 @@ int slurmstepd_blocked_signals[] = {
 slurmd_conf_t * conf;
 extern char  ** environ;
 
+/* started ahead of time for the slurmd's pool of idle slurmstepd */
+static bool pooled = false;
+
 int
 main (int argc, char **argv)
 {
@@ -119,6 +123,9 @@ main (int argc, char **argv)
 	if (slurm_auth_init(NULL) != SLURM_SUCCESS)
 		fatal( "failed to initialize authentication plugin" );
 
+	if (pooled)
+		_pool_preload(argv);
+
 	/* Receive job parameters from the slurmd */
 	_init_from_slurmd(STDIN_FILENO, argv, &cli, &self, &msg,
 			  &ngids, &gids);
@@ -357,6 +364,10 @@ static int _handle_spank_mode (int argc, char **argv)
  */
 static int _process_cmdline (int argc, char **argv)
 {
+	if ((argc == 2) && (xstrcmp(argv[1], "pool") == 0)) {
+		pooled = true;
+		return (0);
+	}
 	if ((argc == 2) && (xstrcmp(argv[1], "getenv") == 0)) {
 		print_rlimits();
 		_dump_user_env();
@@ -371,6 +382,30 @@ static int _process_cmdline (int argc, char **argv)
 }
 
 
+/*
+ *  A pooled slurmstepd loads the plugins used by every step while it waits
+ *   for the slurmd to give it one, so that launching the step does not
+ *   have to. The slurmd sends its configuration first, as the plugins read
+ *   it when loaded (e.g. task/cgroup reads real_memory_size). Failures are
+ *   reported when job_manager() tries again.
+ */
+static void _pool_preload(char **argv)
+{
+	log_options_t lopts = LOG_OPTS_INITIALIZER;
+
+	log_init(argv[0], lopts, LOG_DAEMON, NULL);
+
+	/* the slurmd closes the pipe to retire an idle slurmstepd */
+	if (read_slurmd_conf_lite(STDIN_FILENO) == NULL)
+		exit(0);
+	log_alter(conf->log_opts, 0, conf->logfile);
+	log_set_timefmt(conf->log_fmt);
+
+	setproctitle("[pool]");
+	if (mgr_plugins_init() != SLURM_SUCCESS)
+		debug("%s: unable to preload plugins", __func__);
+}
+
 static void
 _send_ok_to_slurmd(int sock)
 {
@@ -442,7 +477,18 @@ _init_from_slurmd(int sock, char **argv,
 	log_init(argv[0], lopts, LOG_DAEMON, NULL);
 
 	/* receive job type from slurmd */
-	safe_read(sock, &step_type, sizeof(int));
+	if (pooled) {
+		/* the slurmd closes the pipe to retire an idle slurmstepd */
+		ssize_t rc;
+		while (((rc = read(sock, &step_type, sizeof(int))) < 0) &&
+		       (errno == EINTR))
+			;
+		if (rc == 0)
+			exit(0);
+		if (rc != sizeof(int))
+			goto rwfail;
+	} else
+		safe_read(sock, &step_type, sizeof(int));
 	debug3("step_type = %d", step_type);
 
 	/* receive reverse-tree info from slurmd */
@@ -457,8 +503,8 @@ _init_from_slurmd(int sock, char **argv,
 	step_complete.jobacct = jobacctinfo_create(NULL);
 	slurm_mutex_unlock(&step_complete.lock);
 
-	/* receive conf from slurmd */
-	if ((conf = read_slurmd_conf_lite (sock)) == NULL)
+	/* receive conf from slurmd, a pooled slurmstepd already has it */
+	if (!pooled && ((conf = read_slurmd_conf_lite (sock)) == NULL))
 		fatal("Failed to read conf from slurmd");
 
 	log_alter(conf->log_opts, 0, conf->logfile);
@@ -168,6 +168,8 @@ static int
 _print_job ( bool clear_old )
 {
 	static job_info_msg_t *old_job_ptr;
+	static bool delta_unsupported = false;
+	static uint32_t delta_seq = 0;
 	job_info_msg_t *new_job_ptr;
 	int error_code;
 	uint16_t show_flags = 0;
@@ -182,7 +184,32 @@ _print_job ( bool clear_old )
 	if (params.format && strstr(params.format, "C"))
 		show_flags |= SHOW_DETAIL;
 
-	if (old_job_ptr) {
+	if (params.iterate && !params.job_id && !params.user_id &&
+	    !delta_unsupported) {
+		/* Only fetch the job records changed since the last pass */
+		if (clear_old)
+			delta_seq = 0;
+		error_code = slurm_load_jobs_delta(&old_job_ptr, &delta_seq,
+						   show_flags);
+		new_job_ptr = old_job_ptr;
+		if (error_code) {
+			int delta_errno = slurm_get_errno();
+			/* An older slurmctld rejects REQUEST_JOB_INFO_DELTA,
+			 * load all jobs from it on this and later passes.
+			 * On any other error load all jobs on this pass only
+			 * and try the delta again on the next one. */
+			if ((delta_errno == SLURM_PROTOCOL_VERSION_ERROR) ||
+			    (delta_errno == ESLURM_NOT_SUPPORTED) ||
+			    (delta_errno == EINVAL))
+				delta_unsupported = true;
+			error_code = slurm_load_jobs((time_t) NULL,
+						     &new_job_ptr, show_flags);
+			if (error_code == SLURM_SUCCESS) {
+				slurm_free_job_info_msg(old_job_ptr);
+				delta_seq = 0;
+			}
+		}
+	} else if (old_job_ptr) {
 		if (clear_old)
 			old_job_ptr->last_update = 0;
 		if (params.job_id) {
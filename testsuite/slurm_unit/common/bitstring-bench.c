@@ -0,0 +1,85 @@
+/* Benchmark of whole bitmap operations in src/common/bitstring.c
+ *
+ * Usage: bitstring-bench [iterations]
+ * Reports the time per call in nanoseconds of each operation for each
+ * instruction set supported by this processor and several bitmap sizes.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "src/common/bitstring.h"
+
+static const char *names[] = { "generic", "popcnt", "avx2", "avx512" };
+static const int sizes[] = { 128, 1024, 10000, 100000 };
+
+static volatile int32_t sink;
+
+static double
+_now_usec(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (tv.tv_sec * 1000000.0) + tv.tv_usec;
+}
+
+#define BENCH(_op) do {							\
+	double start = _now_usec();					\
+	for (j = 0; j < iters; j++) {					\
+		_op;							\
+	}								\
+	printf(" %10.1f", ((_now_usec() - start) * 1000.0) / iters);	\
+} while (0)
+
+int
+main(int argc, char *argv[])
+{
+	int iters = 100000, i, j, k, n;
+	bitstr_t *a, *b, *c;
+
+	if (argc > 1)
+		iters = atoi(argv[1]);
+	if (iters < 1)
+		iters = 1;
+
+	printf("%-8s %7s %10s %10s %10s %10s %10s %10s %10s\n",
+	       "kernels", "bits", "and", "and_not", "or", "set_count",
+	       "overlap", "super_set", "ffs");
+	for (i = 0; i < (sizeof(names) / sizeof(names[0])); i++) {
+		if (bit_kernels_select(names[i]) != 0)
+			continue;
+		for (k = 0; k < (sizeof(sizes) / sizeof(sizes[0])); k++) {
+			n = sizes[k];
+			a = bit_alloc(n);
+			b = bit_alloc(n);
+			c = bit_alloc(n);
+			srandom(1);
+			for (j = 0; j < n; j++) {
+				if (random() & 1)
+					bit_set(a, j);
+				bit_set(b, j);
+			}
+			bit_set(c, n - 1);
+
+			printf("%-8s %7d", names[i], n);
+			BENCH(bit_and(a, b));
+			BENCH(bit_and_not(c, a));
+			BENCH(bit_or(c, a));
+			BENCH(sink = bit_set_count(a));
+			BENCH(sink = bit_overlap(a, b));
+			BENCH(sink = bit_super_set(a, b));
+			bit_clear_all(c);
+			bit_set(c, n - 1);
+			BENCH(sink = bit_ffs(c));
+			printf("\n");
+
+			bit_free(a);
+			bit_free(b);
+			bit_free(c);
+		}
+	}
+
+	return 0;
+}
@@ -21,6 +21,87 @@
 } while (0)
 
 
+/* Compare whole bitmap operations against bit by bit results on random
+ * bitmaps of sizes which are and are not a multiple of the word size */
+static int
+_test_kernels(void)
+{
+	static const int sizes[] = { 1, 31, 32, 33, 255, 256, 257, 1000, 4099 };
+	int i, j, k, errors = 0;
+
+	srandom(1);
+	for (i = 0; i < (sizeof(sizes) / sizeof(sizes[0])); i++) {
+		int n = sizes[i];
+		bitstr_t *a = bit_alloc(n), *b = bit_alloc(n), *c;
+		int32_t and_cnt = 0, a_cnt = 0, and_not_any = 0;
+		bitoff_t first = -1;
+
+		for (k = 0; k < 4; k++) {
+			/* sparse, dense, empty and full bitmaps */
+			bit_clear_all(a);
+			bit_clear_all(b);
+			for (j = 0; j < n; j++) {
+				if ((k == 0) && ((random() % 97) == 0))
+					bit_set(a, j);
+				if ((k == 1) && (random() & 1))
+					bit_set(a, j);
+				if ((k == 3) || (random() & 1))
+					bit_set(b, j);
+			}
+			and_cnt = a_cnt = and_not_any = 0;
+			first = -1;
+			for (j = 0; j < n; j++) {
+				if (!bit_test(a, j))
+					continue;
+				if (first == -1)
+					first = j;
+				a_cnt++;
+				if (bit_test(b, j))
+					and_cnt++;
+				else
+					and_not_any = 1;
+			}
+			if (bit_set_count(a) != a_cnt)
+				errors++;
+			if (bit_ffs(a) != first)
+				errors++;
+			if (bit_overlap(a, b) != and_cnt)
+				errors++;
+			if (bit_overlap_any(a, b) != (and_cnt != 0))
+				errors++;
+			if (bit_super_set(a, b) != !and_not_any)
+				errors++;
+
+			c = bit_copy(a);
+			bit_and_not(c, b);
+			if (bit_set_count(c) != (a_cnt - and_cnt))
+				errors++;
+			bit_not(b);
+			bit_and(b, a);
+			if (!bit_equal(b, c))
+				errors++;
+			bit_not(b);		/* b = ~a | b, junk in tail */
+			bit_free(c);
+
+			c = bit_copy(a);
+			bit_or(c, b);
+			for (j = 0; j < n; j++) {
+				if (!bit_test(c, j) != !(bit_test(a, j) ||
+							 bit_test(b, j)))
+					errors++;
+			}
+			if (bit_and_set_count(c, a) != a_cnt)
+				errors++;
+			if (!bit_equal(c, a))
+				errors++;
+			bit_free(c);
+		}
+		bit_free(a);
+		bit_free(b);
+	}
+	return errors;
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -202,6 +283,23 @@ main(int argc, char *argv[])
 		TEST(bit_equal(bs, bs2), "bitstring");
 	}
 
+	note("Testing whole bitmap operations");
+	{
+		static const char *names[] =
+			{ "generic", "popcnt", "avx2", "avx512" };
+		char msg[64];
+		int i;
+
+		for (i = 0; i < (sizeof(names) / sizeof(names[0])); i++) {
+			if (bit_kernels_select(names[i]) != 0)
+				continue;
+			snprintf(msg, sizeof(msg), "%s bitmap operations",
+				 names[i]);
+			TEST(_test_kernels() == 0, msg);
+		}
+		TEST(bit_kernels_select(NULL) == 0, "select best kernels");
+	}
+
 	totals();
 	return failed;
 }
@@ -0,0 +1,172 @@
+/* Benchmark of node name expression handling in src/common/hostlist.c
+ * and src/common/node_conf.c
+ *
+ * Usage: hostlist-bench [nodes]
+ * Builds a node table of tux1 through tux<nodes> (100000 by default) and
+ * reports the time in microseconds to convert expressions naming all,
+ * every other and every tenth node into bitmaps and to test hostset
+ * membership, by range and by looking up each name, checking that both
+ * give the same result. Exits with 1 if they differ.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "src/common/bitstring.h"
+#include "src/common/hostlist.h"
+#include "src/common/node_conf.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+static int nodes = 100000;
+static int mismatches = 0;
+
+static double
+_now_usec(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (tv.tv_sec * 1000000.0) + tv.tv_usec;
+}
+
+static char *
+_expr(int stride, int first)
+{
+	hostlist_t hl = hostlist_create(NULL);
+	char *str;
+	int i;
+
+	for (i = first; i <= nodes; i += stride) {
+		char name[32];
+		snprintf(name, sizeof(name), "tux%d", i);
+		hostlist_push_host(hl, name);
+	}
+	str = hostlist_ranged_string_xmalloc(hl);
+	hostlist_destroy(hl);
+	return str;
+}
+
+/* bitmap of the nodes in expr, looking up each name */
+static bitstr_t *
+_ref_bitmap(char *expr)
+{
+	hostlist_t hl = hostlist_create(expr);
+	bitstr_t *bitmap = bit_alloc(node_record_count);
+	struct node_record *node_ptr;
+	char *name;
+
+	while ((name = hostlist_shift(hl))) {
+		if ((node_ptr = find_node_record(name)))
+			bit_set(bitmap, node_ptr - node_record_table_ptr);
+		free(name);
+	}
+	hostlist_destroy(hl);
+	return bitmap;
+}
+
+/* hostset_within() or hostset_intersects(), looking up each name */
+static int
+_ref_hostset(hostset_t set, char *expr, int any)
+{
+	hostlist_t hl = hostlist_create(expr);
+	int found = 0, count = hostlist_count(hl);
+	char *name;
+
+	while ((name = hostlist_shift(hl))) {
+		if (hostset_find(set, name) >= 0)
+			found++;
+		free(name);
+		if (any && found)
+			break;
+	}
+	hostlist_destroy(hl);
+	return any ? (found > 0) : (found == count);
+}
+
+static void
+_bench(const char *label, char *expr, hostset_t all, hostset_t odd)
+{
+	bitstr_t *bitmap = NULL, *ref;
+	double start, t_range, t_name;
+	int rc, ref_rc;
+
+	start = _now_usec();
+	node_name2bitmap(expr, false, &bitmap);
+	t_range = _now_usec() - start;
+	start = _now_usec();
+	ref = _ref_bitmap(expr);
+	t_name = _now_usec() - start;
+	if (!bit_equal(bitmap, ref))
+		mismatches++;
+	printf("%-22s %-12s %12.0f %12.0f%s\n", label, "name2bitmap",
+	       t_range, t_name, bit_equal(bitmap, ref) ? "" : " MISMATCH");
+	FREE_NULL_BITMAP(bitmap);
+	FREE_NULL_BITMAP(ref);
+
+	start = _now_usec();
+	rc = hostset_within(all, expr);
+	t_range = _now_usec() - start;
+	start = _now_usec();
+	ref_rc = _ref_hostset(all, expr, 0);
+	t_name = _now_usec() - start;
+	if (rc != ref_rc)
+		mismatches++;
+	printf("%-22s %-12s %12.0f %12.0f%s\n", label, "within",
+	       t_range, t_name, (rc == ref_rc) ? "" : " MISMATCH");
+
+	start = _now_usec();
+	rc = hostset_intersects(odd, expr);
+	t_range = _now_usec() - start;
+	start = _now_usec();
+	ref_rc = _ref_hostset(odd, expr, 1);
+	t_name = _now_usec() - start;
+	if (rc != ref_rc)
+		mismatches++;
+	printf("%-22s %-12s %12.0f %12.0f%s\n", label, "intersects",
+	       t_range, t_name, (rc == ref_rc) ? "" : " MISMATCH");
+}
+
+int
+main(int argc, char *argv[])
+{
+	char *all_expr, *odd_expr, *even_expr, *tenth_expr;
+	hostset_t all, odd;
+	int i;
+
+	if (argc > 1)
+		nodes = atoi(argv[1]);
+	if (nodes < 10)
+		nodes = 10;
+
+	node_record_table_ptr = xmalloc(sizeof(struct node_record) * nodes);
+	for (i = 0; i < nodes; i++) {
+		node_record_table_ptr[i].magic = NODE_MAGIC;
+		node_record_table_ptr[i].name = xstrdup_printf("tux%d", i + 1);
+	}
+	node_record_count = nodes;
+	rehash_node();
+
+	all_expr = _expr(1, 1);
+	odd_expr = _expr(2, 1);
+	even_expr = _expr(2, 2);
+	tenth_expr = _expr(10, 10);
+	all = hostset_create(all_expr);
+	odd = hostset_create(odd_expr);
+
+	printf("%-22s %-12s %12s %12s\n", "expression", "operation",
+	       "by range", "by name");
+	_bench("all nodes", all_expr, all, odd);
+	_bench("odd nodes", odd_expr, all, odd);
+	_bench("even nodes", even_expr, all, odd);
+	_bench("every tenth node", tenth_expr, all, odd);
+
+	hostset_destroy(all);
+	hostset_destroy(odd);
+	xfree(all_expr);
+	xfree(odd_expr);
+	xfree(even_expr);
+	xfree(tenth_expr);
+
+	return mismatches ? 1 : 0;
+}
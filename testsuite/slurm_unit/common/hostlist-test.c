@@ -0,0 +1,206 @@
+/* Test of the range at a time paths of src/common/hostlist.c and
+ * src/common/node_conf.c: hostset_within(), hostset_intersects() and
+ * node_name2bitmap() must give the same answers as looking up each name,
+ * including for padded, mixed width and digit ending prefixes
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/common/bitstring.h"
+#include "src/common/hostlist.h"
+#include "src/common/log.h"
+#include "src/common/node_conf.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+/* dejagnu.h defines a wait() of its own, which node_conf.h already has
+ * from <sys/wait.h> */
+#define wait dejagnu_wait
+#include <testsuite/dejagnu.h>
+#undef wait
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+#define FUZZ_ROUNDS 5000
+
+static const char *prefixes[] = { "n", "n0", "n1", "n10", "nid0000", "nid000",
+				  "x", "rack1n" };
+
+/* hostset_within() or hostset_intersects(), looking up each name */
+static int _ref_hostset(hostset_t set, char *expr, int any)
+{
+	hostlist_t hl = hostlist_create(expr);
+	int found = 0, count = hostlist_count(hl);
+	char *name;
+
+	while ((name = hostlist_shift(hl))) {
+		if (hostset_find(set, name) >= 0)
+			found++;
+		free(name);
+	}
+	hostlist_destroy(hl);
+	return any ? (found > 0) : (found == count);
+}
+
+/* bitmap of the nodes in expr, looking up each name */
+static bitstr_t *_ref_bitmap(char *expr)
+{
+	hostlist_t hl = hostlist_create(expr);
+	bitstr_t *bitmap = bit_alloc(node_record_count);
+	struct node_record *node_ptr;
+	char *name;
+
+	while ((name = hostlist_shift(hl))) {
+		if ((node_ptr = find_node_record(name)))
+			bit_set(bitmap, node_ptr - node_record_table_ptr);
+		free(name);
+	}
+	hostlist_destroy(hl);
+	return bitmap;
+}
+
+/* append a random range or host of one of the prefixes to expr */
+static void _add_random_range(char **expr)
+{
+	const char *prefix = prefixes[random() %
+				      (sizeof(prefixes) / sizeof(prefixes[0]))];
+	int width = random() % 4, lo = random() % 250, hi;
+
+	if (width == 1)
+		width = 0;		/* no padding */
+	hi = lo + random() % 40;
+	if (*expr)
+		xstrcat(*expr, ",");
+	if (random() % 4 == 0)
+		xstrfmtcat(*expr, "%s%0*d", prefix, width, lo);
+	else
+		xstrfmtcat(*expr, "%s[%0*d-%0*d]", prefix, width, lo,
+			   width, hi);
+}
+
+static char *_random_expr(int ranges)
+{
+	char *expr = NULL;
+	int i;
+
+	for (i = 0; i < ranges; i++)
+		_add_random_range(&expr);
+	return expr;
+}
+
+static int _check_hostset(char *set_expr, char *expr)
+{
+	hostset_t set = hostset_create(set_expr);
+	int bad = 0;
+
+	if (hostset_within(set, expr) != _ref_hostset(set, expr, 0)) {
+		note("hostset_within(%s, %s) mismatch", set_expr, expr);
+		bad++;
+	}
+	if (hostset_intersects(set, expr) != _ref_hostset(set, expr, 1)) {
+		note("hostset_intersects(%s, %s) mismatch", set_expr, expr);
+		bad++;
+	}
+	hostset_destroy(set);
+	return bad;
+}
+
+static int _check_bitmap(char *expr)
+{
+	bitstr_t *bitmap = NULL, *ref;
+	int bad = 0;
+
+	node_name2bitmap(expr, true, &bitmap);
+	ref = _ref_bitmap(expr);
+	if (!bit_equal(bitmap, ref)) {
+		note("node_name2bitmap(%s) mismatch", expr);
+		bad++;
+	}
+	FREE_NULL_BITMAP(bitmap);
+	FREE_NULL_BITMAP(ref);
+	return bad;
+}
+
+/* build a node table of the distinct hosts of expr */
+static void _build_node_table(char *expr)
+{
+	hostlist_t hl = hostlist_create(expr);
+	char *name;
+	int i = 0;
+
+	hostlist_uniq(hl);
+	node_record_count = hostlist_count(hl);
+	node_record_table_ptr = xmalloc(sizeof(struct node_record) *
+					node_record_count);
+	while ((name = hostlist_shift(hl))) {
+		node_record_table_ptr[i].magic = NODE_MAGIC;
+		node_record_table_ptr[i].name = xstrdup(name);
+		free(name);
+		i++;
+	}
+	hostlist_destroy(hl);
+	rehash_node();
+}
+
+int main(int argc, char *argv[])
+{
+	log_options_t log_opts = LOG_OPTS_INITIALIZER;
+	char *set_expr, *expr;
+	int i, bad;
+
+	/* unknown names are expected, do not log each of them */
+	log_opts.stderr_level = LOG_LEVEL_QUIET;
+	log_init("hostlist-test", log_opts, 0, NULL);
+
+	note("Testing hostset_within() and hostset_intersects()");
+	TEST(hostset_within(hostset_create("n[100-200]"), "n1[36-49]") == 1,
+	     "within, host prefix ends in a digit");
+	TEST(hostset_intersects(hostset_create("n[100-200]"), "n1[36-49]") == 1,
+	     "intersects, host prefix ends in a digit");
+	TEST(hostset_intersects(hostset_create("n147"), "n1[36-49]") == 1,
+	     "intersects a single host");
+	TEST(hostset_within(hostset_create("n1[36-49]"), "n[136-149]") == 1,
+	     "within, set prefix ends in a digit");
+	TEST(hostset_within(hostset_create("nid0000[2-7]"), "nid00002") == 1,
+	     "within, set prefix extended with zeros");
+	TEST(hostset_within(hostset_create("n[001-100]"), "n[1-9]") == 0,
+	     "within, padded set and unpadded hosts");
+	TEST(hostset_within(hostset_create("n[001-100]"), "n[100-100]") == 1,
+	     "within, padded set and hosts of full width");
+	TEST(hostset_intersects(hostset_create("n[01-20]"), "n[005-009]") == 0,
+	     "intersects, padding of another width");
+	TEST(hostset_within(hostset_create("n[1-20],n[01-20]"), "n[01-20]") == 1,
+	     "within, set of mixed widths");
+
+	bad = 0;
+	srandom(1);
+	for (i = 0; i < FUZZ_ROUNDS; i++) {
+		set_expr = _random_expr(1 + random() % 6);
+		expr = _random_expr(1 + random() % 3);
+		bad += _check_hostset(set_expr, expr);
+		xfree(set_expr);
+		xfree(expr);
+	}
+	TEST(bad == 0, "random sets agree with lookups by name");
+
+	note("Testing node_name2bitmap()");
+	_build_node_table("n[1-50],n[051-099],n1[00-20],nid0000[1-9],"
+			  "nid000[10-40],x[00-30],rack1n[1-30],tux");
+	bad = 0;
+	for (i = 0; i < FUZZ_ROUNDS; i++) {
+		expr = _random_expr(1 + random() % 3);
+		bad += _check_bitmap(expr);
+		xfree(expr);
+	}
+	TEST(bad == 0, "random expressions agree with lookups by name");
+
+	totals();
+	return failed;
+}
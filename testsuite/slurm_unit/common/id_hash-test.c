@@ -0,0 +1,160 @@
+/* Test of src/common/id_hash.c, including lookup times for the table sizes
+ * slurmctld uses for job records
+ */
+#include <stdlib.h>
+#include <sys/time.h>
+#include <src/common/id_hash.h>
+#include <src/common/xmalloc.h>
+#include <testsuite/dejagnu.h>
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+/* Bucket count of the fixed size chained tables formerly used for job
+ * records, sized from the default MaxJobCount */
+#define CHAIN_TABLE_SIZE 10000
+
+typedef struct rec {
+	uint32_t id;
+	struct rec *next;
+} rec_t;
+
+static long _delta_usec(struct timeval *start)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return (now.tv_sec - start->tv_sec) * 1000000 +
+	       (now.tv_usec - start->tv_usec);
+}
+
+static void _time_lookups(uint32_t cnt)
+{
+	rec_t *recs = xmalloc(sizeof(rec_t) * cnt);
+	rec_t **chain = xmalloc(sizeof(rec_t *) * CHAIN_TABLE_SIZE);
+	id_hash_t *hash = id_hash_init(0);
+	struct timeval start;
+	long add_usec, find_usec, chain_usec;
+	uint32_t i, id, found = 0;
+	rec_t *rec;
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < cnt; i++) {
+		recs[i].id = i + 1;
+		id_hash_add(hash, recs[i].id, &recs[i]);
+	}
+	add_usec = _delta_usec(&start);
+
+	gettimeofday(&start, NULL);
+	for (i = 0, id = 1; i < cnt; i++) {
+		if (id_hash_find(hash, id))
+			found++;
+		id = (id + 7919) % cnt + 1;	/* Not sequential */
+	}
+	find_usec = _delta_usec(&start);
+	TEST(found == cnt, "id_hash_find all");
+
+	for (i = 0; i < cnt; i++) {
+		recs[i].next = chain[recs[i].id % CHAIN_TABLE_SIZE];
+		chain[recs[i].id % CHAIN_TABLE_SIZE] = &recs[i];
+	}
+	found = 0;
+	gettimeofday(&start, NULL);
+	for (i = 0, id = 1; i < cnt; i++) {
+		rec = chain[id % CHAIN_TABLE_SIZE];
+		for ( ; rec; rec = rec->next) {
+			if (rec->id == id) {
+				found++;
+				break;
+			}
+		}
+		id = (id + 7919) % cnt + 1;
+	}
+	chain_usec = _delta_usec(&start);
+	TEST(found == cnt, "chained table find all");
+
+	note("%7u records: add %.1f nsec, find %.1f nsec "
+	     "(fixed %u bucket chained table %.1f nsec)",
+	     cnt, add_usec * 1000.0 / cnt, find_usec * 1000.0 / cnt,
+	     CHAIN_TABLE_SIZE, chain_usec * 1000.0 / cnt);
+
+	id_hash_free(hash);
+	xfree(chain);
+	xfree(recs);
+}
+
+int
+main(int argc, char *argv[])
+{
+	note("Testing basic functions");
+	{
+		id_hash_t *hash = id_hash_init(10);
+		int a = 1, b = 2, c = 3;
+
+		TEST(id_hash_find(hash, 5) == NULL, "find in empty table");
+		id_hash_add(hash, 5, &a);
+		id_hash_add(hash, 6, &b);
+		id_hash_add(hash, 5, &c);
+		TEST(id_hash_count(hash) == 3, "count");
+		TEST(id_hash_find(hash, 6) == &b, "find");
+		TEST(id_hash_remove(hash, 5, &c) == &c, "remove item");
+		TEST(id_hash_find(hash, 5) == &a, "find duplicate key");
+		TEST(id_hash_remove(hash, 5, &c) == NULL, "remove twice");
+		TEST(id_hash_remove(hash, 5, NULL) == &a, "remove any item");
+		TEST(id_hash_find(hash, 5) == NULL, "find removed");
+		TEST(id_hash_count(hash) == 1, "count after remove");
+		TEST(id_hash_find(NULL, 5) == NULL, "find in NULL table");
+		id_hash_free(hash);
+	}
+
+	note("Testing growth");
+	{
+		id_hash_t *hash = id_hash_init(0);
+		uint32_t cnt = 200000, i, bad = 0;
+		uintptr_t item;
+
+		/* Remove every third item while the table is growing */
+		for (i = 1; i <= cnt; i++) {
+			id_hash_add(hash, ID_HASH_KEY2(i % 1000, i),
+				    (void *) (uintptr_t) i);
+			if ((i % 3) == 0) {
+				item = (uintptr_t) id_hash_remove(hash,
+						ID_HASH_KEY2((i / 2) % 1000,
+							     i / 2), NULL);
+				if (item != (i / 2))
+					bad++;
+			}
+		}
+		for (i = 1; i <= cnt; i++) {
+			item = (uintptr_t) id_hash_find(hash,
+						ID_HASH_KEY2(i % 1000, i));
+			if (item && (item != i))
+				bad++;
+		}
+		TEST(bad == 0, "items found under their own keys");
+		TEST(id_hash_count(hash) == (cnt - cnt / 3), "count");
+		for (i = 1; i <= cnt; i++) {
+			if (id_hash_find(hash, ID_HASH_KEY2(i % 1000, i)))
+				id_hash_remove(hash, ID_HASH_KEY2(i % 1000, i),
+					       NULL);
+		}
+		TEST(id_hash_count(hash) == 0, "all items removed");
+		id_hash_add(hash, 1, (void *) 1);
+		TEST(id_hash_find(hash, 1) == (void *) 1, "add after emptying");
+		id_hash_free(hash);
+	}
+
+	note("Testing lookup times");
+	_time_lookups(10000);
+	_time_lookups(100000);
+	_time_lookups(1000000);
+
+	totals();
+	return failed;
+}
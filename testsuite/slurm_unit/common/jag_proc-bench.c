@@ -0,0 +1,271 @@
+/* Benchmark of process sampling in src/plugins/jobacct_gather/common
+ *
+ * Usage: jag_proc-bench [processes] [polls]
+ * Forks a tree of processes (256 by default) which touch some memory and
+ * sleep, then reports the wall clock and CPU time per poll of reading all of
+ * them with the /proc files kept open between polls, with the files opened
+ * on every poll and with fopen() and sscanf() as before, for each of the
+ * JobAcctGatherParams options changing the files read. "opens/poll" is
+ * not counted for fopen().
+ */
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "src/common/xmalloc.h"
+#include "src/plugins/jobacct_gather/common/common_jag_proc.h"
+
+#define CHILD_MEM	(1024 * 1024)
+
+enum {
+	BENCH_KEPT_OPEN,	/* files kept open between polls */
+	BENCH_OPENED,		/* files opened on every poll */
+	BENCH_LEGACY		/* fopen() and sscanf() */
+};
+
+static int procs = 256, polls = 100;
+static pid_t *pids;
+
+static double
+_cpu_usec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return (ts.tv_sec * 1000000.0) + (ts.tv_nsec / 1000.0);
+}
+
+static double
+_now_usec(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (tv.tv_sec * 1000000.0) + tv.tv_usec;
+}
+
+/* Each child forks the next until there are procs processes */
+static void
+_fork_tree(int pipe_fd)
+{
+	char *mem;
+	pid_t pid;
+	int i;
+
+	for (i = 0; i < procs; i++) {
+		if ((pid = fork()) < 0) {
+			perror("fork");
+			exit(1);
+		}
+		if (pid) {
+			if (write(pipe_fd, &pid, sizeof(pid)) != sizeof(pid))
+				exit(1);
+			break;
+		}
+		/* Each process has some private and some shared pages */
+		mem = mmap(NULL, CHILD_MEM, PROT_READ | PROT_WRITE,
+			   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mem != MAP_FAILED)
+			memset(mem, i, CHILD_MEM);
+	}
+	close(pipe_fd);
+	while (1)
+		pause();
+}
+
+/* Read a process as common_jag.c did before the sampler kept files open */
+static int
+_legacy_read(pid_t pid, uint32_t flags, jag_prec_t *prec)
+{
+	char path[64], sbuf[256], line[128], cmd[40], state[1], *tmp;
+	long unsigned flg, minflt, cminflt, majflt, cmajflt, utime, stime;
+	long unsigned starttime, vsize, f[13];
+	long int cutime, cstime, priority, nice, timeout, itrealvalue, rss;
+	long int size, share, text, lib, data, dt;
+	int ppid, pgrp, session, tty_nr, tpgid, exit_signal, last_cpu;
+	int n, lwp, tgid;
+	uint64_t rchar, wchar, pss = 0, p;
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+	if (!(fp = fopen(path, "r")))
+		return 0;
+	n = read(fileno(fp), sbuf, sizeof(sbuf) - 1);
+	fclose(fp);
+	if (n <= 0)
+		return 0;
+	sbuf[n] = '\0';
+	tmp = strrchr(sbuf, ')');
+	*tmp = '\0';
+	if (sscanf(sbuf, "%d (%39c", &prec->pid, cmd) < 2)
+		return 0;
+	n = sscanf(tmp + 2, "%c %d %d %d %d %d %lu %lu %lu %lu %lu %lu %lu "
+		   "%ld %ld %ld %ld %ld %ld %lu %lu %ld %lu %lu %lu %lu %lu "
+		   "%lu %lu %lu %lu %lu %lu %lu %lu %d %d ",
+		   state, &ppid, &pgrp, &session, &tty_nr, &tpgid, &flg,
+		   &minflt, &cminflt, &majflt, &cmajflt, &utime, &stime,
+		   &cutime, &cstime, &priority, &nice, &timeout, &itrealvalue,
+		   &starttime, &vsize, &rss, &f[0], &f[1], &f[2], &f[3], &f[4],
+		   &f[5], &f[6], &f[7], &f[8], &f[9], &f[10], &f[11], &f[12],
+		   &exit_signal, &last_cpu);
+	if ((n < 37) || (rss < 0))
+		return 0;
+
+	/* The thread check was made on reading both stat and io */
+	for (lwp = 0; lwp < 2; lwp++) {
+		snprintf(path, sizeof(path), "/proc/%d/status", pid);
+		if (!(fp = fopen(path, "r")))
+			return 0;
+		n = fscanf(fp, "Name:\t%*s\n%*[ \ta-zA-Z0-9:()]\nTgid:\t%d\n",
+			   &tgid);
+		fclose(fp);
+		if ((n == 1) && (tgid != pid))
+			return 0;
+	}
+	prec->ppid = ppid;
+	prec->rss = rss * (getpagesize() / 1024);
+
+	if (flags & JAG_PROC_NO_SHARE) {
+		snprintf(path, sizeof(path), "/proc/%d/statm", pid);
+		if ((fp = fopen(path, "r"))) {
+			n = read(fileno(fp), sbuf, sizeof(sbuf) - 1);
+			fclose(fp);
+			sbuf[(n > 0) ? n : 0] = '\0';
+			if (sscanf(sbuf, "%ld %ld %ld %ld %ld %ld %ld", &size,
+				   &rss, &share, &text, &lib, &data, &dt) == 7)
+				prec->rss = (rss - share) *
+					    (getpagesize() / 1024);
+		}
+	}
+	if (flags & JAG_PROC_USE_PSS) {
+		snprintf(path, sizeof(path), "/proc/%d/smaps", pid);
+		if (!(fp = fopen(path, "r")))
+			return 0;
+		while (fgets(line, sizeof(line), fp)) {
+			if (strncmp(line, "Pss:", 4))
+				continue;
+			if (sscanf(line + 4, "%"PRIu64, &p) == 1)
+				pss += p;
+		}
+		fclose(fp);
+		if ((pss > 0) && (prec->rss > pss))
+			prec->rss = pss;
+	}
+
+	snprintf(path, sizeof(path), "/proc/%d/io", pid);
+	if ((fp = fopen(path, "r"))) {
+		n = read(fileno(fp), sbuf, sizeof(sbuf) - 1);
+		fclose(fp);
+		sbuf[(n > 0) ? n : 0] = '\0';
+		if (sscanf(sbuf, "%*s %"PRIu64" %*s %"PRIu64, &rchar,
+			   &wchar) == 2) {
+			prec->disk_read = (double) rchar / 1048576;
+			prec->disk_write = (double) wchar / 1048576;
+		}
+	}
+	return 1;
+}
+
+static void
+_bench(const char *label, int mode, uint32_t flags)
+{
+	jag_proc_stats_t stats;
+	jag_prec_t prec;
+	double start, cpu_start, usec, cpu_usec;
+	uint64_t rss = 0, opened = 0;
+	int i, j, found = 0;
+
+	if (mode != BENCH_LEGACY)
+		jag_proc_init((mode == BENCH_KEPT_OPEN) ? -1 : 0);
+	start = _now_usec();
+	cpu_start = _cpu_usec();
+	for (i = 0; i < polls; i++) {
+		found = 0;
+		rss = 0;
+		if (mode != BENCH_LEGACY)
+			jag_proc_poll_start();
+		for (j = 0; j < procs; j++) {
+			if ((mode == BENCH_LEGACY) ?
+			    _legacy_read(pids[j], flags, &prec) :
+			    jag_proc_read(pids[j], flags, &prec)) {
+				found++;
+				rss += prec.rss;
+			}
+		}
+		if (mode != BENCH_LEGACY) {
+			jag_proc_poll_end(&stats);
+			opened += stats.opened;
+		}
+	}
+	usec = (_now_usec() - start) / polls;
+	cpu_usec = (_cpu_usec() - cpu_start) / polls;
+	if (mode != BENCH_LEGACY)
+		jag_proc_fini();
+
+	printf("%-14s %-8s %10.0f %10.0f %10.1f %8d %10"PRIu64"\n",
+	       label, (flags & JAG_PROC_USE_PSS) ? "UsePss" :
+	       (flags & JAG_PROC_NO_SHARE) ? "NoShare" : "-",
+	       usec, cpu_usec, (double) opened / polls, found,
+	       found ? (rss / found) : 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+	static const uint32_t flags[] =
+		{ 0, JAG_PROC_NO_SHARE, JAG_PROC_USE_PSS };
+	pid_t root;
+	int fds[2], i;
+
+	if (argc > 1)
+		procs = atoi(argv[1]);
+	if (argc > 2)
+		polls = atoi(argv[2]);
+	if (procs < 1)
+		procs = 1;
+	if (polls < 1)
+		polls = 1;
+
+	pids = xmalloc(sizeof(pid_t) * procs);
+	if (pipe(fds) < 0) {
+		perror("pipe");
+		return 1;
+	}
+	if ((root = fork()) == 0) {
+		close(fds[0]);
+		_fork_tree(fds[1]);
+	}
+	close(fds[1]);
+	for (i = 0; i < procs; i++) {
+		if (read(fds[0], &pids[i], sizeof(pid_t)) != sizeof(pid_t)) {
+			fprintf(stderr, "only %d processes started\n", i);
+			procs = i;
+			break;
+		}
+	}
+	close(fds[0]);
+	usleep(100000);		/* let the last processes touch their pages */
+
+	printf("%d processes, %d polls\n", procs, polls);
+	printf("%-14s %-8s %10s %10s %10s %8s %10s\n", "files", "params",
+	       "usec/poll", "cpu usec", "opens/poll", "procs", "rss KB");
+	for (i = 0; i < (sizeof(flags) / sizeof(flags[0])); i++) {
+		_bench("kept open", BENCH_KEPT_OPEN, flags[i]);
+		_bench("opened", BENCH_OPENED, flags[i]);
+		_bench("fopen/sscanf", BENCH_LEGACY, flags[i]);
+	}
+
+	kill(root, SIGKILL);
+	for (i = 0; i < procs; i++)
+		kill(pids[i], SIGKILL);
+	while (wait(NULL) > 0)
+		;
+	xfree(pids);
+	return 0;
+}
@@ -0,0 +1,85 @@
+/* Benchmark of list node and iterator allocation in src/common/list.c
+ *
+ * Usage: list-bench [iterations]
+ * Each thread appends to, iterates over and pops from a list of its own,
+ * so the threads only share the list allocator. Reports the rate of list
+ * operations for 1 to 64 threads.
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "src/common/list.h"
+
+#define ITEMS_PER_PASS 16
+
+static const int threads[] = { 1, 2, 4, 8, 16, 32, 64 };
+static int iters = 100000;
+
+static double
+_now_usec(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (tv.tv_sec * 1000000.0) + tv.tv_usec;
+}
+
+static void *
+_worker(void *arg)
+{
+	List l = list_create(NULL);
+	ListIterator itr;
+	long i, j, sum = 0;
+
+	for (i = 0; i < iters; i++) {
+		for (j = 0; j < ITEMS_PER_PASS; j++)
+			list_append(l, (void *) (j + 1));
+		itr = list_iterator_create(l);
+		while ((j = (long) list_next(itr)))
+			sum += j;
+		list_iterator_destroy(itr);
+		while (list_pop(l))
+			;
+	}
+	list_destroy(l);
+
+	return (void *) sum;
+}
+
+int
+main(int argc, char *argv[])
+{
+	pthread_t tid[64];
+	double start, usec, ops;
+	int i, t, n;
+
+	if (argc > 1)
+		iters = atoi(argv[1]);
+	if (iters < 1)
+		iters = 1;
+
+	printf("%7s %12s %14s %14s\n",
+	       "threads", "usec", "ops/sec", "ops/sec/thread");
+	for (i = 0; i < (sizeof(threads) / sizeof(threads[0])); i++) {
+		n = threads[i];
+		start = _now_usec();
+		for (t = 0; t < n; t++) {
+			if (pthread_create(&tid[t], NULL, _worker, NULL)) {
+				perror("pthread_create");
+				return 1;
+			}
+		}
+		for (t = 0; t < n; t++)
+			pthread_join(tid[t], NULL);
+		usec = _now_usec() - start;
+
+		/* appends, pops, iterator create/destroy */
+		ops = (double) n * iters * ((2 * ITEMS_PER_PASS) + 1);
+		printf("%7d %12.0f %14.0f %14.0f\n", n, usec,
+		       ops * 1000000.0 / usec, ops * 1000000.0 / usec / n);
+	}
+
+	return 0;
+}
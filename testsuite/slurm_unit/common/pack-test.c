@@ -3,8 +3,11 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <slurm/slurm_errno.h>
+
 #include <src/common/pack.h>
 #include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
 
 #include <testsuite/dejagnu.h>
 
@@ -82,7 +85,69 @@ int main (int argc, char *argv[])
 
 	xfree(outstring);
 
+	/* Unpack again into an arena */
+	set_buf_offset(buffer, 0);
+	buffer->arena = xarena_create(0);
+	unpack16(&out16, buffer);
+	unpack32(&out32, buffer);
+	unpack64(&test64, buffer);
+	unpackstr_ptr(&outbytes, &byte_cnt, buffer);
+	unpackstr_xmalloc(&outstring, &byte_cnt, buffer);
+	TEST(strcmp(teststring, outstring) != 0, "un/packstr_xmalloc arena");
+	TEST(xsize(outstring) != strlen(teststring) + 1, "xsize of arena string");
+	unpackstr_xmalloc(&nullstr, &byte_cnt, buffer);
+	TEST(nullstr != NULL, "un/packstr of null string arena");
+	unpackstr_xmalloc(&data, &byte_cnt, buffer);
+	xarena_release(buffer->arena);
+	buffer->arena = NULL;
+	/* The arena lives on until its last string is freed */
+	xstrcat(data, " grown");
+	TEST(strcmp("literal grown", data) != 0, "xrealloc of arena string");
+	xfree(data);
+	data = xmove(outstring);
+	TEST((outstring != NULL) || strcmp(teststring, data),
+	     "xmove of arena string");
+	xfree(data);
+
 	free_buf(buffer);
+
+	/* Repeated strings are packed once, then by reference */
+	buffer = init_buf(0);
+	packstr_dict("gpu:2", buffer);
+	packstr_dict(NULL, buffer);
+	packstr_dict("", buffer);
+	packstr_dict("gpu:2", buffer);
+	packstr_dict("", buffer);
+	byte_cnt = get_buf_offset(buffer);
+	TEST(byte_cnt != (4 + 6) + 4 + (4 + 1) + 4 + 4, "packstr_dict size");
+	buffer = create_buf(xfer_buf_data(buffer), byte_cnt);
+	unpackstr_xmalloc(&outstring, &byte_cnt, buffer);
+	TEST(strcmp("gpu:2", outstring) != 0, "packstr_dict first string");
+	xfree(outstring);
+	set_buf_offset(buffer, 0);
+	unpackstr_dict_xmalloc(&outstring, &byte_cnt, buffer);
+	unpackstr_dict_xmalloc(&nullstr, &byte_cnt, buffer);
+	TEST(nullstr != NULL, "un/packstr_dict of null string");
+	unpackstr_dict_xmalloc(&data, &byte_cnt, buffer);
+	xfree(data);
+	unpackstr_dict_xmalloc(&data, &byte_cnt, buffer);
+	TEST(strcmp(outstring, data) != 0 || (byte_cnt != 6),
+	     "un/packstr_dict of reference");
+	TEST(outstring == data, "un/packstr_dict reference copied");
+	xfree(outstring);
+	xfree(data);
+	unpackstr_dict_xmalloc(&data, &byte_cnt, buffer);
+	TEST(strcmp("", data) != 0, "un/packstr_dict of string \"\"");
+	xfree(data);
+	TEST(unpackstr_dict_xmalloc(&data, &byte_cnt, buffer) == SLURM_SUCCESS,
+	     "unpackstr_dict_xmalloc past end of buffer");
+	set_buf_offset(buffer, 0);
+	pack32(PACK_STR_DICT_REF | 3, buffer);
+	set_buf_offset(buffer, 0);
+	TEST(unpackstr_dict_xmalloc(&data, &byte_cnt, buffer) == SLURM_SUCCESS,
+	     "unpackstr_dict_xmalloc of invalid reference");
+	free_buf(buffer);
+
 	totals();
 	return failed;
 
@@ -0,0 +1,339 @@
+/* Test of the persistent pending job queue of src/slurmctld/prio_queue.c:
+ * the iterator must return the job and partition pairs in the order of
+ * sort_job_queue2(), each heap must keep its order as jobs change, and only
+ * the jobs passed to prio_queue_update_job() may be compared between full
+ * syncs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+/* dejagnu.h defines a wait() of its own, which slurmctld.h already has
+ * from <sys/wait.h> */
+#define wait dejagnu_wait
+#include <testsuite/dejagnu.h>
+#undef wait
+
+/* The heaps are static, so test them in place */
+#include "src/slurmctld/prio_queue.c"
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+#define JOB_CNT		500
+#define PART_CNT	4
+#define FUZZ_ROUNDS	200
+
+/* Normally from the slurmctld */
+List job_list = NULL;
+List part_list = NULL;
+time_t last_part_update = (time_t) 0;
+
+static struct part_record parts[PART_CNT];
+static struct job_record *jobs[JOB_CNT];
+
+typedef struct {
+	struct job_record *job_ptr;
+	struct part_record *part_ptr;
+	uint32_t priority;
+} ref_rec_t;
+
+static uint32_t _job_part_prio(struct job_record *job_ptr, int inx)
+{
+	if (job_ptr->part_ptr_list && job_ptr->priority_array)
+		return job_ptr->priority_array[inx];
+	return job_ptr->priority;
+}
+
+/* The order of sort_job_queue2() without its preemption test */
+static int _ref_cmp(const void *x, const void *y)
+{
+	const ref_rec_t *r1 = x, *r2 = y;
+	uint32_t id1, id2;
+
+	if ((r1->job_ptr->resv_id != 0) != (r2->job_ptr->resv_id != 0))
+		return r1->job_ptr->resv_id ? -1 : 1;
+	if (r1->part_ptr->priority_tier != r2->part_ptr->priority_tier)
+		return (r1->part_ptr->priority_tier >
+			r2->part_ptr->priority_tier) ? -1 : 1;
+	if (r1->priority != r2->priority)
+		return (r1->priority > r2->priority) ? -1 : 1;
+	id1 = r1->job_ptr->job_id;
+	id2 = r2->job_ptr->job_id;
+	if (id1 != id2)
+		return (id1 < id2) ? -1 : 1;
+	return 0;
+}
+
+/* Build the queue the slow way, from every job record */
+static ref_rec_t *_ref_queue(uint32_t *cnt)
+{
+	ref_rec_t *ref = xmalloc(sizeof(ref_rec_t) * JOB_CNT * PART_CNT);
+	struct job_record *job_ptr;
+	struct part_record *part_ptr;
+	ListIterator iter;
+	int i, inx;
+
+	*cnt = 0;
+	for (i = 0; i < JOB_CNT; i++) {
+		job_ptr = jobs[i];
+		if (!IS_JOB_PENDING(job_ptr) || IS_JOB_COMPLETING(job_ptr) ||
+		    (job_ptr->priority == 0))
+			continue;
+		if (!job_ptr->part_ptr_list) {
+			ref[*cnt].job_ptr = job_ptr;
+			ref[*cnt].part_ptr = job_ptr->part_ptr;
+			ref[(*cnt)++].priority = job_ptr->priority;
+			continue;
+		}
+		inx = 0;
+		iter = list_iterator_create(job_ptr->part_ptr_list);
+		while ((part_ptr = list_next(iter))) {
+			ref[*cnt].job_ptr = job_ptr;
+			ref[*cnt].part_ptr = part_ptr;
+			ref[(*cnt)++].priority = _job_part_prio(job_ptr, inx++);
+		}
+		list_iterator_destroy(iter);
+	}
+	qsort(ref, *cnt, sizeof(ref_rec_t), _ref_cmp);
+	return ref;
+}
+
+/* Return the count of pairs the iterator returns out of the order of the
+ * job records */
+static int _check_order(void)
+{
+	prio_queue_iter_t iter;
+	job_queue_rec_t rec;
+	ref_rec_t *ref, got;
+	uint32_t ref_cnt, i = 0;
+	int bad = 0;
+
+	ref = _ref_queue(&ref_cnt);
+	iter = prio_queue_iter_create();
+	while (prio_queue_iter_next(iter, &rec)) {
+		got.job_ptr = rec.job_ptr;
+		got.part_ptr = rec.part_ptr;
+		got.priority = rec.priority;
+		/* A job's partitions of equal tier and priority may come in
+		 * either order */
+		if ((i >= ref_cnt) || (got.job_ptr != ref[i].job_ptr) ||
+		    _ref_cmp(&got, &ref[i]))
+			bad++;
+		i++;
+	}
+	prio_queue_iter_destroy(iter);
+	if ((i != ref_cnt) || (prio_queue_count() != ref_cnt)) {
+		note("queue holds %u pairs, %u expected", i, ref_cnt);
+		bad++;
+	}
+	xfree(ref);
+	return bad;
+}
+
+/* Return the count of heap entries before their parent */
+static int _check_heaps(void)
+{
+	uint32_t j;
+	int i, bad = 0;
+
+	for (i = 0; i < heap_cnt; i++) {
+		for (j = 1; j < heaps[i].cnt; j++) {
+			if (_rec_before(heaps[i].recs[j],
+					heaps[i].recs[(j - 1) / 2]))
+				bad++;
+			if (heaps[i].recs[j]->heap_inx != j)
+				bad++;
+		}
+	}
+	return bad;
+}
+
+static void _set_parts(struct job_record *job_ptr)
+{
+	int i, cnt = 1 + random() % 3, first = random() % PART_CNT;
+
+	FREE_NULL_LIST(job_ptr->part_ptr_list);
+	xfree(job_ptr->priority_array);
+	job_ptr->part_ptr = &parts[first];
+	if (cnt == 1)
+		return;
+	job_ptr->part_ptr_list = list_create(NULL);
+	job_ptr->priority_array = xmalloc(sizeof(uint32_t) * (cnt + 1));
+	for (i = 0; i < cnt; i++) {
+		list_append(job_ptr->part_ptr_list,
+			    &parts[(first + i) % PART_CNT]);
+		job_ptr->priority_array[i] = 1 + random() % 1000;
+	}
+}
+
+static void _set_priority(struct job_record *job_ptr)
+{
+	int i, cnt;
+
+	job_ptr->priority = 1 + random() % 1000;
+	if (job_ptr->part_ptr_list) {
+		cnt = list_count(job_ptr->part_ptr_list);
+		for (i = 0; i < cnt; i++)
+			job_ptr->priority_array[i] = 1 + random() % 1000;
+	}
+}
+
+/* Apply a random change to a job, as the slurmctld would */
+static void _change_job(struct job_record *job_ptr)
+{
+	switch (random() % 6) {
+	case 0:
+		_set_parts(job_ptr);
+		break;
+	case 1:
+		job_ptr->job_state = IS_JOB_PENDING(job_ptr) ?
+				     JOB_RUNNING : JOB_PENDING;
+		break;
+	case 2:
+		job_ptr->priority = job_ptr->priority ? 0 : 1 + random() % 1000;
+		break;
+	case 3:
+		job_ptr->resv_id = job_ptr->resv_id ? 0 : 1;
+		break;
+	default:
+		_set_priority(job_ptr);
+		break;
+	}
+}
+
+static void _create_jobs(void)
+{
+	int i;
+
+	part_list = list_create(NULL);
+	for (i = 0; i < PART_CNT; i++) {
+		parts[i].name = xstrdup_printf("p%d", i);
+		parts[i].priority_tier = (i == PART_CNT - 1) ? 2 : 1;
+		list_append(part_list, &parts[i]);
+	}
+
+	job_list = list_create(NULL);
+	for (i = 0; i < JOB_CNT; i++) {
+		jobs[i] = xmalloc(sizeof(struct job_record));
+		jobs[i]->magic = JOB_MAGIC;
+		jobs[i]->job_id = i + 1;
+		jobs[i]->array_task_id = NO_VAL;
+		jobs[i]->job_state = JOB_PENDING;
+		_set_parts(jobs[i]);
+		_set_priority(jobs[i]);
+		if (random() % 20 == 0)
+			jobs[i]->resv_id = 1;
+		list_append(job_list, jobs[i]);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	log_options_t log_opts = LOG_OPTS_INITIALIZER;
+	struct job_record *job_ptr;
+	uint32_t old_prio;
+	int i, j, bad;
+
+	log_opts.stderr_level = LOG_LEVEL_QUIET;
+	log_init("prio_queue-test", log_opts, 0, NULL);
+
+	srandom(1);
+	_create_jobs();
+
+	note("Testing the initial queue");
+	TEST(_check_order() == 0, "initial order");
+	TEST(_check_heaps() == 0, "initial heaps");
+
+	note("Testing updates of single jobs");
+	job_ptr = jobs[0];
+	FREE_NULL_LIST(job_ptr->part_ptr_list);
+	xfree(job_ptr->priority_array);
+	job_ptr->part_ptr = &parts[0];
+	job_ptr->resv_id = 0;
+	job_ptr->priority = 5000;
+	prio_queue_update_job(job_ptr);
+	TEST(_check_order() == 0, "raised priority");
+
+	/* Without prio_queue_update_job(), the change is not seen until the
+	 * next full sync: no job is compared on each pass */
+	old_prio = job_ptr->priority;
+	job_ptr->priority = 1;
+	prio_queue_sync();
+	TEST(job_ptr->prio_queue_recs[0]->priority == old_prio,
+	     "job not updated is not compared");
+	sync_time -= PRIO_QUEUE_FULL_SYNC;
+	TEST(_check_order() == 0, "job not updated is found by full sync");
+
+	job_ptr->job_state = JOB_RUNNING;
+	prio_queue_update_job(job_ptr);
+	TEST(_check_order() == 0, "started job removed");
+	TEST(job_ptr->prio_queue_cnt == 0, "started job has no entries");
+
+	/* A job freed while waiting for a sync must leave the list */
+	job_ptr->job_state = JOB_PENDING;
+	prio_queue_update_job(job_ptr);
+	prio_queue_remove_job(job_ptr);
+	TEST((dirty_cnt == 0) && !job_ptr->prio_queue_dirty,
+	     "removed job is not synced");
+	prio_queue_update_job(job_ptr);
+	TEST(_check_order() == 0, "removed job added again");
+
+	note("Testing random updates");
+	bad = 0;
+	for (i = 0; i < FUZZ_ROUNDS; i++) {
+		for (j = random() % 20; j >= 0; j--) {
+			job_ptr = jobs[random() % JOB_CNT];
+			_change_job(job_ptr);
+			prio_queue_update_job(job_ptr);
+		}
+		bad += _check_order();
+		bad += _check_heaps();
+	}
+	TEST(bad == 0, "queue order after random updates");
+
+	/* Updates noted while iterating are applied on the next sync */
+	bad = 0;
+	for (i = 0; i < FUZZ_ROUNDS; i++) {
+		prio_queue_iter_t iter = prio_queue_iter_create();
+		job_queue_rec_t rec;
+		while (prio_queue_iter_next(iter, &rec)) {
+			if (random() % 10)
+				continue;
+			_change_job(rec.job_ptr);
+			prio_queue_update_job(rec.job_ptr);
+		}
+		prio_queue_iter_destroy(iter);
+		bad += _check_order();
+	}
+	TEST(bad == 0, "queue order after updates while iterating");
+
+	note("Testing partition changes");
+	parts[0].priority_tier = 3;
+	last_part_update = time(NULL);
+	TEST(_check_order() == 0, "queue rebuilt for a new priority tier");
+
+	prio_queue_fini();
+	for (i = 0; i < JOB_CNT; i++) {
+		FREE_NULL_LIST(jobs[i]->part_ptr_list);
+		xfree(jobs[i]->priority_array);
+		xfree(jobs[i]);
+	}
+	for (i = 0; i < PART_CNT; i++)
+		xfree(parts[i].name);
+	FREE_NULL_LIST(job_list);
+	FREE_NULL_LIST(part_list);
+
+	totals();
+	return failed;
+}
@@ -0,0 +1,212 @@
+/* Test of slurm_pack_node_msg() and slurm_unpack_received_msgs() of
+ * src/common/slurm_protocol_api.c, used by the slurmctld agent to send
+ * and receive messages on its own sockets: a packed message must unpack
+ * into the same message, along with the responses forwarded with it, and
+ * damaged messages must fail without losing the forwarded responses.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "src/common/forward.h"
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/pack.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+/* dejagnu.h defines a wait() of its own, which slurm_protocol_api.h
+ * already has from <sys/wait.h> */
+#define wait dejagnu_wait
+#include <testsuite/dejagnu.h>
+#undef wait
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+/* Configuration to load the auth/none plugin from the build tree */
+static char *_write_conf(void)
+{
+	char *conf_file = xstrdup("/tmp/protocol_api-test.XXXXXX");
+	FILE *fp;
+	int fd;
+
+	if ((fd = mkstemp(conf_file)) < 0) {
+		xfree(conf_file);
+		return NULL;
+	}
+	fp = fdopen(fd, "w");
+	fprintf(fp, "ClusterName=test\n");
+	fprintf(fp, "ControlMachine=localhost\n");
+	fprintf(fp, "AuthType=auth/none\n");
+	fprintf(fp, "PluginDir=%s\n", AUTH_PLUGIN_DIR);
+	fprintf(fp, "NodeName=n[1-4]\n");
+	fclose(fp);
+
+	return conf_file;
+}
+
+static ret_data_info_t *_ret_data(char *node_name, uint32_t rc)
+{
+	ret_data_info_t *ret_data_info = xmalloc(sizeof(ret_data_info_t));
+	return_code_msg_t *rc_msg = xmalloc(sizeof(return_code_msg_t));
+
+	rc_msg->return_code = rc;
+	ret_data_info->node_name = xstrdup(node_name);
+	ret_data_info->type = RESPONSE_SLURM_RC;
+	ret_data_info->data = rc_msg;
+	return ret_data_info;
+}
+
+/* Pack a RESPONSE_SLURM_RC as a node would, with the responses of the
+ * nodes it forwarded the request to in ret_list */
+static Buf _pack_rc(uint32_t rc, List ret_list)
+{
+	slurm_msg_t msg;
+	return_code_msg_t rc_msg;
+
+	slurm_msg_t_init(&msg);
+	msg.protocol_version = SLURM_PROTOCOL_VERSION;
+	msg.msg_type = RESPONSE_SLURM_RC;
+	rc_msg.return_code = rc;
+	msg.data = &rc_msg;
+	msg.ret_list = ret_list;
+
+	return slurm_pack_node_msg(&msg);
+}
+
+/* Copy the first size bytes of a packed message, as read from a socket */
+static Buf _received(Buf buffer, uint32_t size)
+{
+	char *data = xmalloc(size);
+
+	memcpy(data, get_buf_data(buffer), size);
+	return create_buf(data, size);
+}
+
+/* Return the count of ret_data_info_t in ret_list which are not a
+ * RESPONSE_SLURM_RC of rc from node_name */
+static int _check_rc(List ret_list, char *node_name, uint32_t rc)
+{
+	ListIterator itr;
+	ret_data_info_t *ret_data_info;
+	int bad = 0, found = 0;
+
+	itr = list_iterator_create(ret_list);
+	while ((ret_data_info = list_next(itr))) {
+		if (xstrcmp(ret_data_info->node_name, node_name))
+			continue;
+		found++;
+		if ((ret_data_info->type != RESPONSE_SLURM_RC) ||
+		    (ret_data_info->err != SLURM_SUCCESS) ||
+		    (((return_code_msg_t *) ret_data_info->data)->return_code
+		     != rc))
+			bad++;
+	}
+	list_iterator_destroy(itr);
+
+	return bad + ((found == 1) ? 0 : 1);
+}
+
+int main(int argc, char *argv[])
+{
+	log_options_t log_opts = LOG_OPTS_INITIALIZER;
+	ret_data_info_t *ret_data_info;
+	List fwd_list, ret_list;
+	Buf buffer;
+	char *conf_file;
+	uint32_t size;
+
+	/* the damaged messages are logged as errors */
+	log_opts.stderr_level = LOG_LEVEL_QUIET;
+	log_init("protocol_api-test", log_opts, 0, NULL);
+
+	if (!(conf_file = _write_conf())) {
+		fail("unable to write configuration");
+		totals();
+		return failed;
+	}
+	setenv("SLURM_CONF", conf_file, 1);
+
+	note("Testing a message without forwarded responses");
+	buffer = _pack_rc(42, NULL);
+	TEST(buffer != NULL, "message packed");
+	if (!buffer) {
+		unlink(conf_file);
+		totals();
+		return failed;
+	}
+	size = get_buf_offset(buffer);
+	ret_list = slurm_unpack_received_msgs(-1, _received(buffer, size));
+	TEST((errno == SLURM_SUCCESS) && ret_list &&
+	     (list_count(ret_list) == 1), "message unpacked");
+	if (ret_list) {
+		TEST(_check_rc(ret_list, NULL, 42) == 0,
+		     "response unpacked without node name");
+		FREE_NULL_LIST(ret_list);
+	}
+	free_buf(buffer);
+
+	note("Testing a message with forwarded responses");
+	fwd_list = list_create(destroy_data_info);
+	list_append(fwd_list, _ret_data("n2", 7));
+	list_append(fwd_list, _ret_data("n3", 8));
+	buffer = _pack_rc(42, fwd_list);
+	size = get_buf_offset(buffer);
+	ret_list = slurm_unpack_received_msgs(-1, _received(buffer, size));
+	TEST((errno == SLURM_SUCCESS) && ret_list &&
+	     (list_count(ret_list) == 3), "message unpacked");
+	if (ret_list) {
+		TEST((_check_rc(ret_list, NULL, 42) == 0) &&
+		     (_check_rc(ret_list, "n2", 7) == 0) &&
+		     (_check_rc(ret_list, "n3", 8) == 0),
+		     "own and forwarded responses unpacked");
+		FREE_NULL_LIST(ret_list);
+	}
+
+	note("Testing damaged messages");
+	/* the body cut short, the forwarded responses are in the header */
+	ret_list = slurm_unpack_received_msgs(-1,
+					      _received(buffer, size - 2));
+	TEST(errno == ESLURM_PROTOCOL_INCOMPLETE_PACKET,
+	     "truncated message fails");
+	TEST(ret_list && (list_count(ret_list) == 3) &&
+	     (_check_rc(ret_list, "n2", 7) == 0) &&
+	     (_check_rc(ret_list, "n3", 8) == 0),
+	     "forwarded responses of truncated message kept");
+	if (ret_list) {
+		ret_data_info = list_peek(ret_list);
+		TEST((ret_data_info->type == RESPONSE_FORWARD_FAILED) &&
+		     (ret_data_info->err == ESLURM_PROTOCOL_INCOMPLETE_PACKET),
+		     "truncated message's own response failed");
+		FREE_NULL_LIST(ret_list);
+	}
+	free_buf(buffer);
+	FREE_NULL_LIST(fwd_list);
+
+	buffer = _pack_rc(42, NULL);
+	size = get_buf_offset(buffer);
+	ret_list = slurm_unpack_received_msgs(-1, _received(buffer, 4));
+	TEST((errno == SLURM_COMMUNICATIONS_RECEIVE_ERROR) && !ret_list,
+	     "truncated header fails");
+	/* the header starts with the protocol version, make it a newer one */
+	get_buf_data(buffer)[0] = (SLURM_PROTOCOL_VERSION + 1) >> 8;
+	get_buf_data(buffer)[1] = (SLURM_PROTOCOL_VERSION + 1) & 0xff;
+	ret_list = slurm_unpack_received_msgs(-1, _received(buffer, size));
+	TEST((errno == SLURM_PROTOCOL_VERSION_ERROR) && !ret_list,
+	     "unknown protocol version fails");
+	free_buf(buffer);
+
+	unlink(conf_file);
+	xfree(conf_file);
+
+	totals();
+	return failed;
+}